@@ -31,7 +31,7 @@ SET(ARROW_OPTS
   -DARROW_ORC:BOOL=OFF
   -DARROW_NO_DEPRECATED_API:BOOL=ON
   -DARROW_JEMALLOC:BOOL=OFF
-  -DARROW_IPC=OFF 
+  -DARROW_IPC=ON
   -DARROW_COMPUTE=OFF 
   -DARROW_HDFS=OFF 
   -DARROW_WITH_BROTLI=OFF 
@@ -8,8 +8,10 @@ add_library(${NEBULA_API} STATIC
     ${NEBULA_SRC}/api/dsl/Expressions.cpp
     ${NEBULA_SRC}/api/dsl/Serde.cpp
     ${NEBULA_SRC}/api/udf/Avg.cpp
+    ${NEBULA_SRC}/api/udf/ExactDistinct.cpp
     ${NEBULA_SRC}/api/udf/Like.cpp
-    ${NEBULA_SRC}/api/udf/Sum.cpp)
+    ${NEBULA_SRC}/api/udf/Sum.cpp
+    ${NEBULA_SRC}/api/udf/TDigest.cpp)
 target_link_libraries(${NEBULA_API}
     PUBLIC ${NEBULA_TYPE}
     PUBLIC ${NEBULA_COMMON}
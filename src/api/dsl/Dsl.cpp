@@ -264,7 +264,9 @@ std::unique_ptr<ExecutionPlan> Query::compile(QueryContext& qc) noexcept {
     .compute(std::move(fields))
     .aggregate(numAggColumns, std::move(aggColumns))
     .sort(std::move(zbSorts), sortType_ == SortType::DESC)
-    .limit(limit_);
+    .limit(limit_)
+    .sample(sampleMode_)
+    .fraction(fraction_);
 
   // partial aggrgation, keys and agg methods
   auto node = std::make_unique<NodePhase>(std::move(block));
@@ -99,6 +99,28 @@ static UDFExpression<nebula::surface::eval::UDFType::AVG> avg(const T& expr) {
   return UDFExpression<nebula::surface::eval::UDFType::AVG>(std::shared_ptr<Expression>(new T(expr)));
 }
 
+#define PERCENTILE_FUNC(UT, NAME)                                                                       \
+  template <typename T>                                                                                 \
+  static UDFExpression<nebula::surface::eval::UDFType::UT> NAME(const T& expr) {                        \
+    return UDFExpression<nebula::surface::eval::UDFType::UT>(std::shared_ptr<Expression>(new T(expr))); \
+  }
+
+PERCENTILE_FUNC(P50, p50)
+PERCENTILE_FUNC(P90, p90)
+PERCENTILE_FUNC(P99, p99)
+
+#undef PERCENTILE_FUNC
+
+template <typename T>
+static UDFExpression<nebula::surface::eval::UDFType::APPROX_DISTINCT> approx_distinct(const T& expr) {
+  return UDFExpression<nebula::surface::eval::UDFType::APPROX_DISTINCT>(std::shared_ptr<Expression>(new T(expr)));
+}
+
+template <typename T>
+static UDFExpression<nebula::surface::eval::UDFType::EXACT_DISTINCT> exact_distinct(const T& expr) {
+  return UDFExpression<nebula::surface::eval::UDFType::EXACT_DISTINCT>(std::shared_ptr<Expression>(new T(expr)));
+}
+
 template <typename T>
 static LikeExpression like(const T& expr, const std::string& pattern, bool caseSensitive = true) {
   // TODO(cao) - model UDAF/UDF with existing expression
@@ -45,7 +45,12 @@ enum class SortType {
 class Query {
 public:
   Query(const std::string& table, const std::shared_ptr<nebula::meta::MetaService> ms)
-    : ms_{ ms }, table_{ ms_->query(table) }, filter_{ nullptr }, limit_{ 0 } {}
+    : ms_{ ms },
+      table_{ ms_->query(table) },
+      filter_{ nullptr },
+      limit_{ 0 },
+      sampleMode_{ nebula::execution::SampleMode::FIRST },
+      fraction_{ 0 } {}
 
   // The copy constructor is actually a move constructor
   // We do this is to favor DSL chain method
@@ -56,7 +61,9 @@ public:
                     groups_{ std::move(q.groups_) },
                     sorts_{ std::move(q.sorts_) },
                     sortType_{ q.sortType_ },
-                    limit_{ q.limit_ } {}
+                    limit_{ q.limit_ },
+                    sampleMode_{ q.sampleMode_ },
+                    fraction_{ q.fraction_ } {}
 
   Query(const Query&) = delete;
   virtual ~Query() = default;
@@ -101,6 +108,18 @@ public:
     return *this;
   }
 
+  // how samples are drawn if the query has no aggregation
+  Query& sample(nebula::execution::SampleMode mode) {
+    sampleMode_ = mode;
+    return *this;
+  }
+
+  // run approximately on a random fraction of blocks, exact if fraction is not in (0, 1)
+  Query& approximate(double fraction) {
+    fraction_ = fraction;
+    return *this;
+  }
+
 public:
   // compile the query into an execution plan
   std::unique_ptr<nebula::execution::ExecutionPlan> compile(QueryContext&) noexcept;
@@ -125,6 +144,12 @@ public:
   // limit the results to return
   size_t limit_;
 
+  // sampling mode for samples query
+  nebula::execution::SampleMode sampleMode_;
+
+  // fraction of blocks for approximate query
+  double fraction_;
+
 private:
   static std::vector<std::shared_ptr<Expression>> preprocess(
     const nebula::type::Schema&, const std::vector<std::shared_ptr<Expression>>&);
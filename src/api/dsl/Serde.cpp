@@ -244,6 +244,11 @@ std::shared_ptr<Expression> u_expr(const std::string& alias, UDFType ut, std::sh
     COM_UDF(MIN)
     COM_UDF(COUNT)
     COM_UDF(SUM)
+    COM_UDF(APPROX_DISTINCT)
+    COM_UDF(EXACT_DISTINCT)
+    COM_UDF(P50)
+    COM_UDF(P90)
+    COM_UDF(P99)
 
 #undef COM_UDF
 
@@ -293,6 +298,28 @@ std::shared_ptr<Expression> Serde::deserialize(const std::string& data) {
   }
 }
 
+std::shared_ptr<Expression> Serde::deserialize(const ExpressionData& data) {
+  switch (data.type) {
+  case ExpressionType::CONSTANT: {
+    return c_expr(data.alias, data.c_type, data.c_value);
+  }
+  case ExpressionType::COLUMN: {
+    return as(data.alias, std::make_shared<ColumnExpression>(data.c_name));
+  }
+  case ExpressionType::LOGICAL: {
+    return l_expr(data.alias, data.b_lop, deserialize(*data.b_left), deserialize(*data.b_right));
+  }
+  case ExpressionType::ARTHMETIC: {
+    return a_expr(data.alias, data.b_aop, deserialize(*data.b_left), deserialize(*data.b_right));
+  }
+  case ExpressionType::UDF: {
+    return u_expr(data.alias, data.u_type, deserialize(*data.inner), data.custom, data.flag);
+  }
+  default:
+    throw NException("Not recognized expression!");
+  }
+}
+
 } // namespace dsl
 } // namespace api
 } // namespace nebula
\ No newline at end of file
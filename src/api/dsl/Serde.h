@@ -28,6 +28,9 @@ class Serde {
 public:
   static std::string serialize(const Expression&);
   static std::shared_ptr<Expression> deserialize(const std::string&);
+
+  // build an expression from its data tree, such as one decoded from binary plan
+  static std::shared_ptr<Expression> deserialize(const ExpressionData&);
 };
 } // namespace dsl
 } // namespace api
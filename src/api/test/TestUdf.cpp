@@ -18,15 +18,20 @@
 #include <gtest/gtest.h>
 
 #include "api/dsl/Expressions.h"
+#include "api/udf/ApproxDistinct.h"
+#include "api/udf/ExactDistinct.h"
 #include "api/udf/Avg.h"
 #include "api/udf/Count.h"
 #include "api/udf/In.h"
 #include "api/udf/Like.h"
 #include "api/udf/Not.h"
 #include "api/udf/Prefix.h"
+#include "api/udf/TDigest.h"
+#include "memory/keyed/HashFlat.h"
 #include "surface/DataSurface.h"
 #include "surface/MockSurface.h"
 #include "surface/eval/ValueEval.h"
+#include "type/Serde.h"
 
 namespace nebula {
 namespace api {
@@ -257,6 +262,14 @@ TEST(UDFTest, TestIn) {
       }
     }
   }
+
+  {
+    // values are length prefixed in signature so separators inside values survive
+    using InString = nebula::api::udf::In<nebula::type::Kind::VARCHAR>;
+    EXPECT_EQ(InString::encode({ "a,b", "x]", "" }), "3:a,b,2:x],0:");
+    EXPECT_EQ(InString::encode({}), "");
+    EXPECT_EQ(nebula::api::udf::In<nebula::type::Kind::INTEGER>::encode({ 1, 23 }), "1:1,2:23");
+  }
 }
 
 TEST(UDFTest, TestCount) {
@@ -478,37 +491,176 @@ TEST(UDFTest, TestAvgByte) {
   EXPECT_EQ(avg4, sum / count);
 }
 
-// TEST(UDFTest, TestTDigest) {
-//   using CType = nebula::api::udf::TDigest<nebula::type::Kind::VARCHAR, nebula::type::Kind::INTEGER>;
-
-//   // simulate the run times 11 for c1 and 22 for c2
-//   nebula::surface::eval::EvalContext ctx;
-//   bool invalid;
-//   auto v9 = std::make_shared<nebula::api::dsl::ConstExpression<int32_t>>(0);
-//   CType td1("td1", v9->asEval());
-
-//   for (auto i = 0; i < 11; ++i) {
-//     auto vi = std::make_shared<nebula::api::dsl::ConstExpression<int32_t>>(i);
-//     CType ci("count1", vi->asEval());
-//     td1 = td1.merge(td1, ci.eval(ctx, invalid));
-//   }
-
-//   CType::StoreType count2 = 0;
-//   for (auto i = 0; i < 22; ++i) {
-//     auto vi = std::make_shared<nebula::api::dsl::ConstExpression<int32_t>>(i);
-//     CType ci("count2", vi->asEval());
-//     count2 = cf.merge(count2, ci.eval(ctx, invalid));
-//   }
-
-//   // partial merge
-//   CType c3("count3", v9->asEval());
-//   CType::StoreType count3 = c3.merge(count1, count2);
-
-//   // we will ask itself for finalize
-//   CType::NativeType count4 = c3.finalize(count3);
-//   EXPECT_EQ(count4, 33);
-// }
+TEST(UDFTest, TestPercentile) {
+  using CType = nebula::api::udf::TDigest<nebula::surface::eval::UDFType::P99, nebula::type::Kind::INTEGER>;
+  using MType = nebula::api::udf::TDigest<nebula::surface::eval::UDFType::P50, nebula::type::Kind::INTEGER>;
+  nebula::surface::eval::EvalContext ctx;
+  bool valid = true;
+  auto v9 = std::make_shared<nebula::api::dsl::ConstExpression<int32_t>>(0);
+  CType tf("p99", v9->asEval());
+  MType mf("p50", v9->asEval());
+
+  // two partial digests of [0, 5000) and [5000, 10000) in reverse order
+  auto build = [&tf, &ctx, &valid](int32_t start, int32_t end) {
+    std::string store;
+    for (auto i = end - 1; i >= start; --i) {
+      auto vi = std::make_shared<nebula::api::dsl::ConstExpression<int32_t>>(i);
+      CType ti("p99", vi->asEval());
+      store = tf.merge(store, ti.eval(ctx, valid));
+    }
+    return store;
+  };
+
+  auto s1 = build(0, 5000);
+  auto s2 = build(5000, 10000);
+  EXPECT_EQ(s1.size(), nebula::common::TDigest::SIZE);
+  EXPECT_NEAR(tf.finalize(s1), 4950, 25);
+  EXPECT_NEAR(mf.finalize(s1), 2500, 50);
+
+  // merge digests in the same size, quantiles of the whole range
+  std::string s3 = tf.merge(s1, s2);
+  EXPECT_EQ(s3.size(), s1.size());
+  EXPECT_NEAR(tf.finalize(s3), 9900, 50);
+  EXPECT_NEAR(mf.finalize(s3), 5000, 100);
+}
+
+TEST(UDFTest, TestApproxDistinct) {
+  auto v = std::make_shared<nebula::api::dsl::ConstExpression<int64_t>>(0);
+  using CType = nebula::api::udf::ApproxDistinct<nebula::type::Kind::BIGINT>;
+  nebula::surface::eval::EvalContext ctx;
+  bool valid = true;
+  CType af("ad", v->asEval());
+
+  // two partial stores of [0, 1000) and [500, 1500), every value is seen twice
+  auto build = [&af, &ctx, &valid](int64_t start, int64_t end) {
+    std::string store;
+    for (auto k = 0; k < 2; ++k) {
+      for (auto i = start; i < end; ++i) {
+        auto vi = std::make_shared<nebula::api::dsl::ConstExpression<int64_t>>(i);
+        CType ai("ad", vi->asEval());
+        store = af.merge(store, ai.eval(ctx, valid));
+      }
+    }
+    return store;
+  };
+
+  auto s1 = build(0, 1000);
+  auto s2 = build(500, 1500);
+  EXPECT_EQ(s1.size(), nebula::common::HyperLogLog::REGISTERS);
+  EXPECT_EQ(s2.size(), nebula::common::HyperLogLog::REGISTERS);
+  EXPECT_NEAR(af.finalize(s1), 1000, 50);
+
+  // merge in the same size and estimate union of them
+  auto s3 = af.merge(s1, s2);
+  EXPECT_EQ(s3.size(), s1.size());
+  EXPECT_NEAR(af.finalize(s3), 1500, 75);
+}
+
+TEST(UDFTest, TestExactDistinct) {
+  auto v = std::make_shared<nebula::api::dsl::ConstExpression<int64_t>>(0);
+  using CType = nebula::api::udf::ExactDistinct<nebula::type::Kind::BIGINT>;
+  nebula::surface::eval::EvalContext ctx;
+  bool valid = true;
+  CType af("ed", v->asEval());
+
+  // two partial stores of [0, 1000) and [500, 1500), every value is seen twice
+  auto build = [&af, &ctx, &valid](int64_t start, int64_t end) {
+    std::string store;
+    for (auto k = 0; k < 2; ++k) {
+      for (auto i = start; i < end; ++i) {
+        auto vi = std::make_shared<nebula::api::dsl::ConstExpression<int64_t>>(i);
+        CType ai("ed", vi->asEval());
+        store = af.merge(store, ai.eval(ctx, valid));
+      }
+    }
+    return store;
+  };
+
+  auto s1 = build(0, 1000);
+  auto s2 = build(500, 1500);
+  EXPECT_EQ(af.finalize(s1), 1000);
+  EXPECT_EQ(af.finalize(s2), 1000);
+
+  // merge two bitmaps by OR
+  std::string s3 = s1;
+  s3 = af.merge(s3, s2);
+  EXPECT_EQ(af.finalize(s3), 1500);
+
+  // values far apart for 64-bit bitmap
+  std::string s4;
+  for (int64_t i : { 1L, 1L << 40, 1L << 50, 1L << 40 }) {
+    auto vi = std::make_shared<nebula::api::dsl::ConstExpression<int64_t>>(i);
+    CType ai("ed", vi->asEval());
+    s4 = af.merge(s4, ai.eval(ctx, valid));
+  }
+  EXPECT_EQ(af.finalize(s4), 3);
+}
+
+// a row of a key and a distinct store
+class StoreRow : public nebula::surface::MockRowData {
+public:
+  StoreRow(int32_t key, std::string store) : key_{ key }, store_{ std::move(store) } {}
+
+  using nebula::surface::MockRowData::isNull;
+  using nebula::surface::MockRowData::readInt;
+  using nebula::surface::MockRowData::readString;
+
+  bool isNull(nebula::surface::IndexType) const override {
+    return false;
+  }
+
+  int32_t readInt(nebula::surface::IndexType) const override {
+    return key_;
+  }
+
+  std::string_view readString(nebula::surface::IndexType) const override {
+    return store_;
+  }
+
+private:
+  int32_t key_;
+  std::string store_;
+};
+
+TEST(UDFTest, TestExactDistinctRelocation) {
+  using CType = nebula::api::udf::ExactDistinct<nebula::type::Kind::INTEGER>;
+  nebula::surface::eval::EvalContext ctx;
+  bool valid = true;
+  auto schema = nebula::type::TypeSerializer::from("ROW<key:int, ed:string>");
+
+  // aggregate values spread apart into groups by value index mod groups
+  auto run = [&](int32_t groups, int32_t values) {
+    nebula::surface::eval::Fields fields;
+    fields.push_back(nebula::surface::eval::constant<int32_t>(0));
+    auto ed = std::make_unique<CType>("ed", nebula::surface::eval::constant<int32_t>(0));
+    auto& af = *ed;
+    fields.push_back(std::move(ed));
+    nebula::memory::keyed::HashFlat hf(schema, { 0 }, fields);
+    for (auto i = 0; i < values; ++i) {
+      CType ai("ed", nebula::surface::eval::constant<int32_t>(i * 3));
+      hf.update(StoreRow(i % groups, std::string(ai.eval(ctx, valid))));
+    }
+
+    EXPECT_EQ(hf.getRows(), static_cast<size_t>(groups));
+    size_t live = 0;
+    for (auto g = 0; g < groups; ++g) {
+      auto store = hf.crow(g)->readString(1);
+      EXPECT_EQ(af.finalize(store), values / groups);
+      live += store.size();
+    }
+
+    return std::make_pair(live, hf.binSize());
+  };
+
+  // a single growing store is at the end of data and grows in place
+  auto single = run(1, 4000);
+  EXPECT_LT(single.second, single.first + 128);
+
+  // slots left by grown stores are coalesced and reused by other groups
+  auto multiple = run(2, 6000);
+  EXPECT_LT(multiple.second, multiple.first * 3 / 2);
+}
 
 } // namespace test
 } // namespace api
-} // namespace nebula
\ No newline at end of file
+} // namespace nebula
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "common/HyperLogLog.h"
+#include "surface/eval/UDF.h"
+
+/**
+ * Implement UDAF APPROX_DISTINCT to estimate count of distinct values by a hyper log log sketch.
+ * Its store is registers of the sketch in a fixed size string,
+ * so that merging two stores doesn't change its size and can be done in place.
+ */
+namespace nebula {
+namespace api {
+namespace udf {
+
+// UDAF - approx distinct
+template <nebula::type::Kind IK,
+          typename Traits = nebula::surface::eval::UdfTraits<nebula::surface::eval::UDFType::APPROX_DISTINCT, IK>,
+          typename BaseType = nebula::surface::eval::UDAF<Traits::Type, Traits::Store, IK>>
+class ApproxDistinct : public BaseType {
+  using HLL = nebula::common::HyperLogLog;
+
+  // registers owned by current thread which a returned store is pointing to
+  // store is copied by the caller (flat buffer or eval cache) before next call
+  struct Registers {
+    Registers() : last{ 0 } {
+      data.fill(0);
+    }
+
+    inline std::string_view view() const {
+      return std::string_view(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    std::array<uint8_t, HLL::REGISTERS> data;
+    size_t last;
+  };
+
+public:
+  using InputType = typename BaseType::InputType;
+  using StoreType = typename BaseType::StoreType;
+  using NativeType = typename BaseType::NativeType;
+
+  ApproxDistinct(const std::string& name, std::unique_ptr<nebula::surface::eval::ValueEval> expr)
+    : BaseType(name,
+               std::move(expr),
+               // compute method - a sketch of single value
+               [](InputType nv) -> StoreType {
+                 static thread_local Registers single;
+                 // reset only the register set by last value
+                 single.data[single.last] = 0;
+                 auto hash = HLL::hash(nv);
+                 single.last = hash >> (64 - HLL::P);
+                 HLL::add(single.data.data(), hash);
+                 return single.view();
+               },
+
+               // stack method
+               {},
+
+               // merge method
+               [](StoreType ov, StoreType nv) -> StoreType {
+                 if (!HLL::valid(nv)) {
+                   return ov;
+                 }
+
+                 if (!HLL::valid(ov)) {
+                   return nv;
+                 }
+
+                 static thread_local Registers merged;
+                 std::memcpy(merged.data.data(), ov.data(), HLL::REGISTERS);
+                 HLL::merge(merged.data.data(), reinterpret_cast<const uint8_t*>(nv.data()));
+                 return merged.view();
+               },
+
+               // finalize method
+               [](StoreType v) -> NativeType {
+                 return HLL::estimate(v);
+               }) {}
+
+  virtual ~ApproxDistinct() = default;
+};
+
+} // namespace udf
+} // namespace api
+} // namespace nebula
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <roaring.hh>
+#include <roaring64map.hh>
+#include <string>
+#include <vector>
+
+#include "surface/eval/UDF.h"
+
+/**
+ * Implement UDAF EXACT_DISTINCT to count distinct values of integer types by roaring bitmap.
+ * BIGINT values use 64-bit roaring map, other integers are stored as 32-bit values.
+ *
+ * Its store is a string of
+ *   [bitmap bytes (4 bytes)][buffered values (4 bytes)][bitmap in portable format][buffered values][slack]
+ * Values are buffered into the slack of the store first and added into the bitmap in batches,
+ * so that the bitmap is not deserialized for every single row.
+ * When merged store outgrows its slot, a new store is returned with slack about the size of the bitmap.
+ */
+namespace nebula {
+namespace api {
+namespace udf {
+
+// bitmap and value type used by given input type
+template <nebula::type::Kind IK>
+struct DistinctBitmap {
+  using Value = uint32_t;
+  using Bitmap = Roaring;
+};
+
+template <>
+struct DistinctBitmap<nebula::type::Kind::BIGINT> {
+  using Value = uint64_t;
+  using Bitmap = Roaring64Map;
+};
+
+// UDAF - exact distinct
+template <nebula::type::Kind IK,
+          typename Traits = nebula::surface::eval::UdfTraits<nebula::surface::eval::UDFType::EXACT_DISTINCT, IK>,
+          typename BaseType = nebula::surface::eval::UDAF<Traits::Type, Traits::Store, IK>>
+class ExactDistinct : public BaseType {
+  using Value = typename DistinctBitmap<IK>::Value;
+  using Bitmap = typename DistinctBitmap<IK>::Bitmap;
+
+  static constexpr size_t HEADER = 2 * sizeof(uint32_t);
+  static constexpr size_t WIDTH = sizeof(Value);
+
+  // min number of values a new store can buffer
+  static constexpr size_t MIN_BUFFER = 16;
+
+public:
+  using InputType = typename BaseType::InputType;
+  using StoreType = typename BaseType::StoreType;
+  using NativeType = typename BaseType::NativeType;
+
+  ExactDistinct(const std::string& name, std::unique_ptr<nebula::surface::eval::ValueEval> expr)
+    : BaseType(name,
+               std::move(expr),
+               // compute method - a store of single buffered value owned by current thread
+               // store is copied by the caller (flat buffer or eval cache) before next call
+               [](InputType nv) -> StoreType {
+                 static thread_local char single[HEADER + WIDTH];
+                 header(single, 0, 1);
+                 Value v = static_cast<Value>(nv);
+                 std::memcpy(single + HEADER, &v, WIDTH);
+                 return StoreType(single, HEADER + WIDTH);
+               },
+
+               // stack method
+               {},
+
+               // merge method
+               [](StoreType ov, StoreType nv) -> StoreType {
+                 if (!valid(nv)) {
+                   return ov;
+                 }
+
+                 if (!valid(ov)) {
+                   return nv;
+                 }
+
+                 // buffer new values in the slack of old store
+                 const auto ob = read(ov.data(), 0);
+                 const auto obuf = read(ov.data(), 1);
+                 const auto nb = read(nv.data(), 0);
+                 const auto nbuf = read(nv.data(), 1);
+                 const auto used = HEADER + ob + obuf * WIDTH;
+                 if (nb == 0 && used + nbuf * WIDTH <= ov.size()) {
+                   auto dest = const_cast<char*>(ov.data());
+                   std::memcpy(dest + used, nv.data() + HEADER, nbuf * WIDTH);
+                   header(dest, ob, obuf + nbuf);
+                   return ov;
+                 }
+
+                 // add all buffered values into the bitmap in a batch
+                 auto bitmap = load(ov);
+                 bitmap |= load(nv);
+                 bitmap.runOptimize();
+
+                 const size_t bytes = bitmap.getSizeInBytes(true);
+                 const auto size = HEADER + bytes + std::max(MIN_BUFFER, bytes / WIDTH) * WIDTH;
+                 char* dest = nullptr;
+                 StoreType result;
+                 if (HEADER + bytes <= ov.size()) {
+                   dest = const_cast<char*>(ov.data());
+                   result = ov;
+                 } else {
+                   static thread_local std::string grown;
+                   grown.resize(size);
+                   dest = grown.data();
+                   result = StoreType(dest, size);
+                 }
+
+                 header(dest, bytes, 0);
+                 bitmap.write(dest + HEADER, true);
+                 return result;
+               },
+
+               // finalize method
+               [](StoreType v) -> NativeType {
+                 if (!valid(v)) {
+                   return 0;
+                 }
+
+                 return load(v).cardinality();
+               }) {}
+
+  virtual ~ExactDistinct() = default;
+
+private:
+  static inline uint32_t read(const char* store, size_t index) {
+    uint32_t v;
+    std::memcpy(&v, store + index * sizeof(uint32_t), sizeof(uint32_t));
+    return v;
+  }
+
+  static inline void header(char* store, uint32_t bytes, uint32_t buffered) {
+    std::memcpy(store, &bytes, sizeof(uint32_t));
+    std::memcpy(store + sizeof(uint32_t), &buffered, sizeof(uint32_t));
+  }
+
+  static inline bool valid(StoreType store) {
+    return store.size() >= HEADER && HEADER + read(store.data(), 0) + read(store.data(), 1) * WIDTH <= store.size();
+  }
+
+  // bitmap of a store including its buffered values
+  static Bitmap load(StoreType store) {
+    const auto bytes = read(store.data(), 0);
+    const auto buffered = read(store.data(), 1);
+    auto bitmap = bytes > 0 ? Bitmap::read(store.data() + HEADER, true) : Bitmap();
+    if (buffered > 0) {
+      std::vector<Value> values(buffered);
+      std::memcpy(values.data(), store.data() + HEADER + bytes, buffered * WIDTH);
+      bitmap.addMany(buffered, values.data());
+    }
+
+    return bitmap;
+  }
+};
+
+template <>
+ExactDistinct<nebula::type::Kind::INVALID>::ExactDistinct(
+  const std::string& name, std::unique_ptr<nebula::surface::eval::ValueEval> expr);
+
+template <>
+ExactDistinct<nebula::type::Kind::BOOLEAN>::ExactDistinct(
+  const std::string& name, std::unique_ptr<nebula::surface::eval::ValueEval> expr);
+
+template <>
+ExactDistinct<nebula::type::Kind::REAL>::ExactDistinct(
+  const std::string& name, std::unique_ptr<nebula::surface::eval::ValueEval> expr);
+
+template <>
+ExactDistinct<nebula::type::Kind::DOUBLE>::ExactDistinct(
+  const std::string& name, std::unique_ptr<nebula::surface::eval::ValueEval> expr);
+
+template <>
+ExactDistinct<nebula::type::Kind::VARCHAR>::ExactDistinct(
+  const std::string& name, std::unique_ptr<nebula::surface::eval::ValueEval> expr);
+
+template <>
+ExactDistinct<nebula::type::Kind::INT128>::ExactDistinct(
+  const std::string& name, std::unique_ptr<nebula::surface::eval::ValueEval> expr);
+
+} // namespace udf
+} // namespace api
+} // namespace nebula
@@ -41,7 +41,9 @@ public:
      std::unique_ptr<nebula::surface::eval::ValueEval> expr,
      const std::vector<ValueType>& values)
     : UdfInBase(
-        name,
+        // values are part of signature so that different lists don't share evaluation cache
+        // and block pruning can probe them against bloom filters
+        fmt::format("{0}[{1}]", name, encode(values)),
         std::move(expr),
         // logic for "in []"
         [this](const InputType& source, bool& valid) -> bool {
@@ -59,7 +61,7 @@ public:
      std::unique_ptr<nebula::surface::eval::ValueEval> expr,
      const std::vector<ValueType>& values,
      bool in)
-    : UdfInBase(name,
+    : UdfInBase(fmt::format("!{0}[{1}]", name, encode(values)),
                 std::move(expr),
                 // logic for "not in []"
                 [this](const InputType& source, bool& valid) -> bool {
@@ -77,6 +79,21 @@ public:
 
   virtual ~In() = default;
 
+  // every value is written as "<size>:<value>" so values containing "," or "]" decode exactly
+  static std::string encode(const std::vector<ValueType>& values) {
+    std::string list;
+    for (const auto& value : values) {
+      const auto str = fmt::format("{0}", value);
+      if (!list.empty()) {
+        list.push_back(',');
+      }
+
+      list.append(fmt::format("{0}:{1}", str.size(), str));
+    }
+
+    return list;
+  }
+
 private:
   const std::vector<ValueType> values_;
 };
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "TDigest.h"
+
+/**
+ * Percentile UDAF doesn't support non-number types.
+ */
+namespace nebula {
+namespace api {
+namespace udf {
+using nebula::surface::eval::UDFType;
+using nebula::type::Kind;
+
+#define DO_NOT_SUPPORT(UT, K)                                                                                             \
+  template <>                                                                                                             \
+  TDigest<UDFType::UT, Kind::K>::TDigest(const std::string& name, std::unique_ptr<nebula::surface::eval::ValueEval> expr) \
+    : nebula::surface::eval::UDAF<Kind::K>(                                                                               \
+        name,                                                                                                             \
+        std::move(expr),                                                                                                  \
+        {},                                                                                                               \
+        [](StoreType, StoreType) -> StoreType { throw NException("not supported"); },                                     \
+        {},                                                                                                               \
+        {}) {}
+
+#define DO_NOT_SUPPORT_ALL(UT) \
+  DO_NOT_SUPPORT(UT, INVALID)  \
+  DO_NOT_SUPPORT(UT, BOOLEAN)  \
+  DO_NOT_SUPPORT(UT, VARCHAR)  \
+  DO_NOT_SUPPORT(UT, INT128)
+
+DO_NOT_SUPPORT_ALL(P50)
+DO_NOT_SUPPORT_ALL(P90)
+DO_NOT_SUPPORT_ALL(P99)
+
+#undef DO_NOT_SUPPORT_ALL
+#undef DO_NOT_SUPPORT
+
+} // namespace udf
+} // namespace api
+} // namespace nebula
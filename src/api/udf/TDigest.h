@@ -14,28 +14,42 @@
  * limitations under the License.
  */
 
-#pragma once
 
-#include <atomic>
-#include <folly/stats/TDigest.h>
+#pragma once
 
+#include "common/TDigest.h"
 #include "surface/eval/UDF.h"
 
 /**
- * Implement UDAF TDigest to get quantiles of target values
- * Internally this UDAF maintains a sketch binary stream with all numbers in double type.
+ * Implement percentile UDAF (P50, P90, P99) by t-digest to get quantiles of target values.
+ * Its store is a digest in a fixed size string, values are buffered in the digest per group
+ * and compressed into centroids in batches, no object is allocated per row.
  */
 namespace nebula {
 namespace api {
 namespace udf {
 
-// UDAF - TDigest
-template <nebula::type::Kind IK,
-          typename Traits = nebula::surface::eval::UdfTraits<nebula::surface::eval::UDFType::TDIGEST, IK>,
+// quantile of each percentile UDAF
+template <nebula::surface::eval::UDFType UT>
+constexpr double quantile() {
+  if constexpr (UT == nebula::surface::eval::UDFType::P50) {
+    return 0.5;
+  }
+
+  if constexpr (UT == nebula::surface::eval::UDFType::P90) {
+    return 0.9;
+  }
+
+  return 0.99;
+}
+
+// UDAF - percentile by TDigest
+template <nebula::surface::eval::UDFType UT,
+          nebula::type::Kind IK,
+          typename Traits = nebula::surface::eval::UdfTraits<UT, IK>,
           typename BaseType = nebula::surface::eval::UDAF<Traits::Type, Traits::Store, IK>>
 class TDigest : public BaseType {
-  // most commonly for percentiles
-  static constexpr size_t DIGEST_SIZE = 100;
+  using Digest = nebula::common::TDigest;
 
 public:
   using InputType = typename BaseType::InputType;
@@ -45,43 +59,67 @@ public:
   TDigest(const std::string& name, std::unique_ptr<nebula::surface::eval::ValueEval> expr)
     : BaseType(name,
                std::move(expr),
-               // compute method
+               // compute method - a digest of single value owned by current thread
+               // store is copied by the caller (flat buffer or eval cache) before next call
                [](InputType nv) -> StoreType {
-                 // we can not pay serde cost for all values to be integrated
-                 // we need to get object out of a memory chunk
-                 auto obj = new folly::TDigest(DIGEST_SIZE);
-                 obj->merge({ nv });
-                 return obj;
+                 static thread_local Digest::Layout single;
+                 Digest::init(single, nv);
+                 return Digest::view(single);
                },
 
                // stack method
                {},
 
-               // merge method
-               [](StoreType ov, StoreType nv) {
-                 auto another = static_cast<const folly::TDigest*>(nv);
-                 static_cast<folly::TDigest*>(ov)->merge({ another });
+               // merge method - merged digest has the same size so it can be written in place
+               [](StoreType ov, StoreType nv) -> StoreType {
+                 if (!Digest::valid(nv)) {
+                   return ov;
+                 }
+
+                 if (!Digest::valid(ov)) {
+                   return nv;
+                 }
 
-                 // delete another object
-                 delete another;
-                 return ov;
+                 static thread_local Digest::Layout merged;
+                 static thread_local Digest::Layout another;
+                 Digest::read(ov, merged);
+                 Digest::read(nv, another);
+                 Digest::merge(merged, another);
+                 return Digest::view(merged);
                },
 
                // finalize method
-               [](const StoreType& v) -> NativeType {
-                 // convert the v;
-                 auto x = static_cast<folly::TDigest*>(v);
-                 auto result = fmt::format("sum: {0}", x->sum());
-
-                 // TODO(cao): if finalize method is not called, the object is leaked
-                 // somehow we need some smart pointer rather than (void*)
-                 delete x;
-                 return result;
+               [](StoreType v) -> NativeType {
+                 if (!Digest::valid(v)) {
+                   return 0;
+                 }
+
+                 Digest::Layout digest;
+                 Digest::read(v, digest);
+                 return Digest::quantile(digest, quantile<UT>());
                }) {}
 
   virtual ~TDigest() = default;
 };
 
+#define DECLARE_NOT_SUPPORT(UT, K)                                                    \
+  template <>                                                                         \
+  TDigest<nebula::surface::eval::UDFType::UT, nebula::type::Kind::K>::TDigest(        \
+    const std::string& name, std::unique_ptr<nebula::surface::eval::ValueEval> expr);
+
+#define DECLARE_NOT_SUPPORT_ALL(UT) \
+  DECLARE_NOT_SUPPORT(UT, INVALID)  \
+  DECLARE_NOT_SUPPORT(UT, BOOLEAN)  \
+  DECLARE_NOT_SUPPORT(UT, VARCHAR)  \
+  DECLARE_NOT_SUPPORT(UT, INT128)
+
+DECLARE_NOT_SUPPORT_ALL(P50)
+DECLARE_NOT_SUPPORT_ALL(P90)
+DECLARE_NOT_SUPPORT_ALL(P99)
+
+#undef DECLARE_NOT_SUPPORT_ALL
+#undef DECLARE_NOT_SUPPORT
+
 } // namespace udf
 } // namespace api
-} // namespace nebula
\ No newline at end of file
+} // namespace nebula
@@ -16,8 +16,10 @@
 
 #pragma once
 
+#include "ApproxDistinct.h"
 #include "Avg.h"
 #include "Count.h"
+#include "ExactDistinct.h"
 #include "In.h"
 #include "Like.h"
 #include "Max.h"
@@ -25,6 +27,7 @@
 #include "Not.h"
 #include "Prefix.h"
 #include "Sum.h"
+#include "TDigest.h"
 #include "api/dsl/Base.h"
 #include "surface/eval/UDF.h"
 #include "type/Type.h"
@@ -70,6 +73,18 @@ public:
       return std::make_unique<Avg<IK>>(name, expr->asEval());
     }
 
+    if constexpr (UKIND == UDFKind::APPROX_DISTINCT) {
+      return std::make_unique<ApproxDistinct<IK>>(name, expr->asEval());
+    }
+
+    if constexpr (UKIND == UDFKind::EXACT_DISTINCT) {
+      return std::make_unique<ExactDistinct<IK>>(name, expr->asEval());
+    }
+
+    if constexpr (UKIND == UDFKind::P50 || UKIND == UDFKind::P90 || UKIND == UDFKind::P99) {
+      return std::make_unique<TDigest<UKIND, IK>>(name, expr->asEval());
+    }
+
     if constexpr (UKIND == UDFKind::LIKE) {
       return std::make_unique<Like>(name, expr->asEval(), std::forward<Args>(args)...);
     }
@@ -16,72 +16,157 @@
 
 #pragma once
 
-#include <gflags/gflags.h>
-#include <glog/logging.h>
+#include <cmath>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
-#include "Bloom.h"
-#include "Evidence.h"
+#include "Hash.h"
 
-// #include "bf/bloom_filter/basic.hpp"
-// #include "cuckoofilter.h"
-
-// DEFINE_double(BF_FPP, 0.001, "false positive rate for the bloom filter");
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 /**
  * Define a bloom filter module.
- * Internally we're using cuckoo filter as initial implementation.
+ * It is a split block bloom filter (same layout as parquet SBBF):
+ * a key selects one 256-bit block by its hash and sets one bit in each of the 8 32-bit words of the block.
+ * So add/probe touches a single cache line and a probe is one SIMD test when AVX2 is available.
+ * Keys are hashed by XXH3 over its bytes, hash can be computed once and probed against many filters.
  */
 namespace nebula {
 namespace common {
-template <typename T, size_t BITS = 16>
+template <typename T>
 class BloomFilter {
+  static constexpr size_t WORDS = 8;
+  struct alignas(32) Block {
+    uint32_t words[WORDS];
+  };
+
+  // bits budget per distinct item - false positive rate is under 0.02%
+  static constexpr size_t BITS_PER_ITEM = 24;
+  static constexpr size_t BLOCK_BITS = sizeof(Block) * 8;
+
 public:
-  BloomFilter(size_t items) {
-    bloom_parameters parameters;
-    parameters.projected_element_count = items;
-    parameters.false_positive_probability = 0.001;
-    parameters.random_seed = Evidence::ticks();
-    parameters.compute_optimal_parameters();
-
-    //Instantiate Bloom Filter
-    filter_ = std::make_unique<bloom_filter>(parameters);
-  }
+  BloomFilter(size_t items) : blocks_(numBlocks(items)), mask_{ blocks_.size() - 1 } {}
   virtual ~BloomFilter() = default;
 
 public:
+  // hash of an item used by this filter
+  static inline uint64_t hash(const T& item) noexcept {
+    if constexpr (std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>) {
+      return Hasher::hash64(item.data(), item.size());
+    } else {
+      return Hasher::hash64(&item, sizeof(T));
+    }
+  }
+
   // add an item in the set, if no more space or other issues
   // return false to indicate this item was not added
   bool add(const T& item) noexcept {
-    filter_->insert(item);
-    // filter_.add(item);
-    // auto x = filter_.Add(item);
-    // if (x != cuckoofilter::Ok) {
-    //   LOG(INFO) << (int)x;
-    // }
-    // return x == cuckoofilter::Ok;
+    addHash(hash(item));
     return true;
   }
 
   // check if given item is probably in the set.
   // return false if absolutely not in the set
   bool probably(const T& item) const noexcept {
-    return filter_->contains(item);
-    // return filter_.lookup(item) == 1;
-    // return filter_.Contain(item) == cuckoofilter::Ok;
+    return probablyHash(hash(item));
+  }
+
+  // check if any of given hashes (such as an IN list) is probably in the set
+  bool probably(const uint64_t* hashes, size_t size) const noexcept {
+    for (size_t i = 0; i < size; ++i) {
+      if (probablyHash(hashes[i])) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  // shrink the filter to fit observed cardinality, which is estimated from its fill ratio.
+  // block index is taken by mask, so halving the filter is exact by folding two halves together.
+  void seal() noexcept {
+    size_t bits = 0;
+    for (const auto& block : blocks_) {
+      for (size_t i = 0; i < WORDS; ++i) {
+        bits += __builtin_popcount(block.words[i]);
+      }
+    }
+
+    const double total = blocks_.size() * BLOCK_BITS;
+    const double fill = std::min(bits / total, 0.999);
+    const size_t items = -(total / WORDS) * std::log(1 - fill);
+    const auto target = numBlocks(items);
+    while (blocks_.size() > target) {
+      const auto half = blocks_.size() >> 1;
+      for (size_t b = 0; b < half; ++b) {
+        for (size_t i = 0; i < WORDS; ++i) {
+          blocks_[b].words[i] |= blocks_[b + half].words[i];
+        }
+      }
+
+      blocks_.resize(half);
+    }
+
+    blocks_.shrink_to_fit();
+    mask_ = blocks_.size() - 1;
   }
 
   // memory bytes used by this filter
   size_t bytes() const noexcept {
-    return filter_->size();
-    // return 0;
-    // return filter_.SizeInBytes();
+    return blocks_.size() * sizeof(Block);
+  }
+
+private:
+  // number of blocks in power of 2 to hold given items
+  static size_t numBlocks(size_t items) noexcept {
+    const size_t blocks = (std::max<size_t>(items, 1) * BITS_PER_ITEM + BLOCK_BITS - 1) / BLOCK_BITS;
+    size_t n = 1;
+    while (n < blocks) {
+      n <<= 1;
+    }
+
+    return n;
+  }
+
+  inline void addHash(uint64_t hash) noexcept {
+    auto& block = blocks_[(hash >> 32) & mask_];
+    const uint32_t key = hash;
+    for (size_t i = 0; i < WORDS; ++i) {
+      block.words[i] |= 1u << ((key * SALT[i]) >> 27);
+    }
+  }
+
+  inline bool probablyHash(uint64_t hash) const noexcept {
+    const auto& block = blocks_[(hash >> 32) & mask_];
+    const uint32_t key = hash;
+#ifdef __AVX2__
+    const auto salt = _mm256_load_si256(reinterpret_cast<const __m256i*>(SALT));
+    const auto bits = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(key), salt), 27);
+    const auto mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), bits);
+    return _mm256_testc_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(block.words)), mask);
+#else
+    for (size_t i = 0; i < WORDS; ++i) {
+      if ((block.words[i] & (1u << ((key * SALT[i]) >> 27))) == 0) {
+        return false;
+      }
+    }
+
+    return true;
+#endif
   }
 
 private:
-  std::unique_ptr<bloom_filter> filter_;
-  // cuckoofilter::CuckooFilter<T, BITS> filter_;
+  alignas(32) static constexpr uint32_t SALT[WORDS] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+  };
+
+  std::vector<Block> blocks_;
+  size_t mask_;
 };
 
 } // namespace common
-} // namespace nebula
\ No newline at end of file
+} // namespace nebula
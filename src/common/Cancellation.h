@@ -0,0 +1,136 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+
+/**
+ * A cancellation token shared by all work of a query.
+ * It is cancelled explicitly, by passing its deadline, or by an external probe such as a rpc context
+ * whose client is gone. Workers poll it at points where they can stop cheaply.
+ */
+namespace nebula {
+namespace common {
+
+class Cancellation {
+  using Clock = std::chrono::steady_clock;
+
+public:
+  Cancellation()
+    : cancelled_{ false }, expired_{ false }, deadline_{ Clock::time_point::max().time_since_epoch().count() }, id_{ 0 } {}
+  Cancellation(Cancellation&) = delete;
+  Cancellation(Cancellation&&) = delete;
+  virtual ~Cancellation() = default;
+
+public:
+  // cancel and notify all subscribers once, callbacks run under lock so they should be short and
+  // never subscribe or unsubscribe
+  void cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cancelled_.exchange(true)) {
+      return;
+    }
+
+    for (auto& c : callbacks_) {
+      c.second();
+    }
+
+    callbacks_.clear();
+  }
+
+  // a passed deadline or a positive probe turns it cancelled without notifying subscribers
+  bool cancelled() const {
+    if (cancelled_.load(std::memory_order_relaxed) || expired_.load(std::memory_order_relaxed)) {
+      return true;
+    }
+
+    if (Clock::now().time_since_epoch().count() > deadline_.load(std::memory_order_relaxed)
+        || (probe_ && probe_())) {
+      expired_ = true;
+      return true;
+    }
+
+    return false;
+  }
+
+  // set a deadline, an earlier existing deadline is kept
+  void expire(Clock::time_point deadline) {
+    auto value = deadline.time_since_epoch().count();
+    auto current = deadline_.load();
+    while (value < current && !deadline_.compare_exchange_weak(current, value)) {
+    }
+  }
+
+  // set an external probe telling if the work is abandoned, it should be set before any worker polls
+  void watch(std::function<bool()> probe) {
+    probe_ = std::move(probe);
+  }
+
+  // subscribe a callback to cancel, it is called right away if already cancelled.
+  // returns an id to unsubscribe, a callback never runs after its unsubscribe returns.
+  size_t subscribe(std::function<void()> callback) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!cancelled_) {
+        callbacks_.emplace(++id_, std::move(callback));
+        return id_;
+      }
+    }
+
+    callback();
+    return 0;
+  }
+
+  void unsubscribe(size_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    callbacks_.erase(id);
+  }
+
+private:
+  std::atomic<bool> cancelled_;
+  mutable std::atomic<bool> expired_;
+  std::atomic<Clock::rep> deadline_;
+  std::function<bool()> probe_;
+  std::mutex mutex_;
+  std::map<size_t, std::function<void()>> callbacks_;
+  size_t id_;
+};
+
+// a subscription unsubscribed when it goes out of scope, so that a callback referencing objects
+// of the scope never runs after they are gone, even if the scope is left by an exception
+class Subscription {
+public:
+  Subscription(Cancellation& cancel, std::function<void()> callback)
+    : cancel_{ cancel }, id_{ cancel.subscribe(std::move(callback)) } {}
+  Subscription(Subscription&) = delete;
+  Subscription(Subscription&&) = delete;
+  ~Subscription() {
+    cancel_.unsubscribe(id_);
+  }
+
+private:
+  Cancellation& cancel_;
+  const size_t id_;
+};
+
+} // namespace common
+} // namespace nebula
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "Hash.h"
+
+/**
+ * A dense HyperLogLog sketch to estimate number of distinct values.
+ * It keeps 2^P one-byte registers, the first P bits of a 64-bit hash select a register
+ * and the register records max rank (position of first set bit) of the rest bits.
+ * Registers are a fixed size byte array, so two sketches are merged by max of each register,
+ * which also makes it usable as an aggregation store of fixed size in a flat buffer.
+ * Standard error is about 1.04/sqrt(2^P), 2.3% for P=11.
+ */
+namespace nebula {
+namespace common {
+
+class HyperLogLog {
+public:
+  static constexpr size_t P = 11;
+  static constexpr size_t REGISTERS = 1 << P;
+
+  HyperLogLog() {
+    registers_.fill(0);
+  }
+  virtual ~HyperLogLog() = default;
+
+  // hash of an item used by sketch, same hash function as bloom filter
+  template <typename T>
+  static inline uint64_t hash(const T& item) noexcept {
+    if constexpr (std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>) {
+      return Hasher::hash64(item.data(), item.size());
+    } else {
+      return Hasher::hash64(&item, sizeof(T));
+    }
+  }
+
+  // record a hash in given registers
+  static inline void add(uint8_t* registers, uint64_t hash) noexcept {
+    const auto index = hash >> (64 - P);
+    // a sentinel bit caps the rank when all remaining bits are zero
+    const uint8_t rank = __builtin_clzll((hash << P) | (1UL << (P - 1))) + 1;
+    if (rank > registers[index]) {
+      registers[index] = rank;
+    }
+  }
+
+  // merge registers of another sketch into given registers
+  static inline void merge(uint8_t* registers, const uint8_t* another) noexcept {
+    for (size_t i = 0; i < REGISTERS; ++i) {
+      registers[i] = std::max(registers[i], another[i]);
+    }
+  }
+
+  // estimate number of distinct values from given registers
+  static size_t estimate(const uint8_t* registers) noexcept {
+    constexpr double m = REGISTERS;
+    constexpr double alpha = 0.7213 / (1 + 1.079 / m);
+    double sum = 0;
+    size_t zeros = 0;
+    for (size_t i = 0; i < REGISTERS; ++i) {
+      sum += std::ldexp(1.0, -registers[i]);
+      zeros += registers[i] == 0;
+    }
+
+    auto e = alpha * m * m / sum;
+
+    // small range correction by linear counting
+    if (e <= 2.5 * m && zeros > 0) {
+      e = m * std::log(m / zeros);
+    }
+
+    return std::llround(e);
+  }
+
+  // registers as a string store, size is always REGISTERS
+  static inline bool valid(std::string_view registers) noexcept {
+    return registers.size() == REGISTERS;
+  }
+
+  static inline size_t estimate(std::string_view registers) noexcept {
+    return valid(registers) ? estimate(reinterpret_cast<const uint8_t*>(registers.data())) : 0;
+  }
+
+public:
+  template <typename T>
+  inline void add(const T& item) noexcept {
+    addHash(hash(item));
+  }
+
+  inline void addHash(uint64_t hash) noexcept {
+    add(registers_.data(), hash);
+  }
+
+  inline void merge(const HyperLogLog& another) noexcept {
+    merge(registers_.data(), another.registers_.data());
+  }
+
+  inline size_t estimate() const noexcept {
+    return estimate(registers_.data());
+  }
+
+  inline std::string_view registers() const noexcept {
+    return std::string_view(reinterpret_cast<const char*>(registers_.data()), REGISTERS);
+  }
+
+private:
+  std::array<uint8_t, REGISTERS> registers_;
+};
+
+} // namespace common
+} // namespace nebula
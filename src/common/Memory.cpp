@@ -63,6 +63,7 @@ void PagedSlice::ensure(size_t size) {
     }
 
     N_ENSURE_GT(slices, slices_, "required slices should be more than existing capacity");
+    N_ENSURE(ownbuffer_, "can not extend a read-only slice");
     ++numExtended_;
     this->ptr_ = static_cast<NByte*>(this->pool_.extend(this->ptr_, capacity(), slices * size_));
     std::swap(slices, slices_);
@@ -92,5 +93,16 @@ size_t PagedSlice::copy(NByte* buffer, size_t offset, size_t length) const {
   return length;
 }
 
+void PagedSlice::attach(const NByte* buffer, size_t size) {
+  if (ownbuffer_ && !!ptr_) {
+    pool_.free(static_cast<void*>(ptr_));
+  }
+
+  this->ptr_ = const_cast<NByte*>(buffer);
+  this->size_ = size;
+  this->slices_ = 1;
+  this->ownbuffer_ = false;
+}
+
 } // namespace common
 } // namespace nebula
\ No newline at end of file
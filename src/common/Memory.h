@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <cstring>
 #include <glog/logging.h>
 #include <iostream>
 
@@ -137,11 +138,10 @@ public:
     constexpr size_t size = sizeof(T);
     ensure(position + size);
 
-    // a couple of options to copy the scalar type object into this memory address
-    // 1. use reinterpret cast to assign the value directly
-    // 2. use place new to construct the data there
-    // not sure which one is better?
-    *reinterpret_cast<T*>(this->ptr_ + position) = value;
+    // rows pack values without padding, so the position may not be aligned for T.
+    // memcpy compiles to a plain unaligned move while a dereference lets the compiler assume alignment,
+    // e.g. aligned SSE moves of int128 which crash at -O2 and above.
+    std::memcpy(this->ptr_ + position, &value, size);
 
     return size;
   }
@@ -154,7 +154,9 @@ public:
     constexpr size_t size = sizeof(T);
     N_ENSURE(position + size <= capacity(), "invalid position to read");
 
-    return *reinterpret_cast<T*>(this->ptr_ + position);
+    T value;
+    std::memcpy(&value, this->ptr_ + position, size);
+    return value;
   }
 
   std::string_view read(size_t position, size_t length) const {
@@ -193,6 +195,10 @@ public:
   // copy current slice data into a given buffer
   size_t copy(NByte*, size_t, size_t) const;
 
+  // release owned memory and serve reads from an external read-only buffer, such as a mmap region.
+  // the slice can not be written anymore after attaching.
+  void attach(const NByte*, size_t);
+
 private:
   // ensure capacity of memory allocation
   void ensure(size_t);
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+
+/**
+ * A merging t-digest in a fixed size flat layout to estimate quantiles.
+ * Incoming values are buffered and compressed into centroids in batches when buffer is full,
+ * centroids are sized by k1 scale function (arcsine) which keeps tails accurate for P99.
+ * The layout is plain bytes without pointers, so a digest can be stored as a fixed size string,
+ * sent over the wire and merged in place.
+ */
+namespace nebula {
+namespace common {
+
+class TDigest {
+public:
+  // max centroids and buffered values of a digest
+  static constexpr size_t CENTROIDS = 64;
+  static constexpr size_t BUFFER = 64;
+
+  struct Centroid {
+    double mean;
+    double weight;
+  };
+
+  struct Layout {
+    double min;
+    double max;
+    uint32_t centroids;
+    uint32_t buffered;
+    Centroid c[CENTROIDS];
+    double buffer[BUFFER];
+  };
+
+  // size of a digest in bytes
+  static constexpr size_t SIZE = sizeof(Layout);
+
+  // compression guarantees number of centroids after compress is no more than CENTROIDS
+  static constexpr double DELTA = CENTROIDS - 1;
+
+public:
+  // reset a digest with single value
+  static inline void init(Layout& d, double v) noexcept {
+    d.min = v;
+    d.max = v;
+    d.centroids = 0;
+    d.buffered = 1;
+    d.buffer[0] = v;
+  }
+
+  // bytes of a digest are valid only if it has the exact layout size
+  static inline bool valid(std::string_view bytes) noexcept {
+    return bytes.size() == SIZE;
+  }
+
+  // copy bytes of a digest into an aligned layout
+  static inline void read(std::string_view bytes, Layout& d) noexcept {
+    std::memcpy(&d, bytes.data(), SIZE);
+  }
+
+  static inline std::string_view view(const Layout& d) noexcept {
+    return std::string_view(reinterpret_cast<const char*>(&d), SIZE);
+  }
+
+  // merge another digest into given digest
+  static void merge(Layout& d, const Layout& another) noexcept {
+    d.min = std::min(d.min, another.min);
+    d.max = std::max(d.max, another.max);
+
+    // most common case: stack a few values into buffer
+    if (another.centroids == 0 && d.buffered + another.buffered <= BUFFER) {
+      std::memcpy(d.buffer + d.buffered, another.buffer, another.buffered * sizeof(double));
+      d.buffered += another.buffered;
+      return;
+    }
+
+    compress(d, &another);
+  }
+
+  // compress all buffered values and centroids (including another digest's) into centroids
+  static void compress(Layout& d, const Layout* another = nullptr) noexcept {
+    std::array<Centroid, 2 * (CENTROIDS + BUFFER)> all;
+    size_t n = 0;
+    double total = 0;
+    auto collect = [&all, &n, &total](const Layout& x) {
+      for (size_t i = 0; i < x.centroids; ++i) {
+        all[n++] = x.c[i];
+        total += x.c[i].weight;
+      }
+
+      for (size_t i = 0; i < x.buffered; ++i) {
+        all[n++] = { x.buffer[i], 1 };
+      }
+
+      total += x.buffered;
+    };
+
+    collect(d);
+    if (another != nullptr) {
+      collect(*another);
+    }
+
+    d.buffered = 0;
+    d.centroids = 0;
+    if (n == 0) {
+      return;
+    }
+
+    std::sort(all.begin(), all.begin() + n, [](const Centroid& a, const Centroid& b) {
+      return a.mean < b.mean;
+    });
+
+    // greedy merge neighbors as long as the centroid spans no more than 1 in k scale
+    double sofar = 0;
+    auto current = all[0];
+    auto limit = qlimit(0);
+    for (size_t i = 1; i < n; ++i) {
+      // merge if it fits in k scale or there is no more room for new centroids
+      const auto& next = all[i];
+      const auto q = (sofar + current.weight + next.weight) / total;
+      if (q <= limit || d.centroids == CENTROIDS - 1) {
+        current.weight += next.weight;
+        current.mean += (next.mean - current.mean) * next.weight / current.weight;
+        continue;
+      }
+
+      d.c[d.centroids++] = current;
+      sofar += current.weight;
+      current = next;
+      limit = qlimit(sofar / total);
+    }
+
+    d.c[d.centroids++] = current;
+  }
+
+  // estimate value at quantile q in [0, 1]
+  static double quantile(const Layout& digest, double q) noexcept {
+    if (digest.buffered + digest.centroids == 0) {
+      return 0;
+    }
+
+    // compress a copy if there are buffered values
+    const Layout* dp = &digest;
+    Layout copy;
+    if (digest.buffered > 0) {
+      std::memcpy(&copy, &digest, SIZE);
+      compress(copy);
+      dp = &copy;
+    }
+
+    const auto& d = *dp;
+    const auto n = d.centroids;
+    if (n == 1) {
+      return d.c[0].mean;
+    }
+
+    double total = 0;
+    for (size_t i = 0; i < n; ++i) {
+      total += d.c[i].weight;
+    }
+
+    const auto index = std::clamp(q, 0.0, 1.0) * total;
+
+    // within half of the first centroid, interpolate from min
+    if (index < d.c[0].weight / 2) {
+      return d.min + (d.c[0].mean - d.min) * index / (d.c[0].weight / 2);
+    }
+
+    // interpolate between neighbor centroids by their centers
+    double sofar = d.c[0].weight / 2;
+    for (size_t i = 0; i < n - 1; ++i) {
+      const auto dw = (d.c[i].weight + d.c[i + 1].weight) / 2;
+      if (sofar + dw > index) {
+        const auto z = (index - sofar) / dw;
+        return d.c[i].mean + (d.c[i + 1].mean - d.c[i].mean) * z;
+      }
+
+      sofar += dw;
+    }
+
+    // within half of the last centroid, interpolate to max
+    const auto& last = d.c[n - 1];
+    const auto z = std::min(1.0, (index - sofar) / (last.weight / 2));
+    return last.mean + (d.max - last.mean) * z;
+  }
+
+private:
+  // max quantile a centroid starting at q can reach, which is 1 more in k scale
+  // k(q) = DELTA / (2 * PI) * asin(2q - 1)
+  static inline double qlimit(double q) noexcept {
+    const auto k = std::asin(std::clamp(2 * q - 1, -1.0, 1.0)) + 2 * M_PI / DELTA;
+    return k >= M_PI / 2 ? 1 : (std::sin(k) + 1) / 2;
+  }
+};
+
+} // namespace common
+} // namespace nebula
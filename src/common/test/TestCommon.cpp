@@ -21,6 +21,7 @@
 #include <valarray>
 #include <xxh3.h>
 
+#include "common/Cancellation.h"
 #include "common/Chars.h"
 #include "common/Errors.h"
 #include "common/Evidence.h"
@@ -640,6 +641,54 @@ TEST(CommonTest, TestCharsUtils) {
 #undef TEST_SPLIT
 }
 
+TEST(CommonTest, TestCancellation) {
+  Cancellation cancel;
+  EXPECT_FALSE(cancel.cancelled());
+
+  // subscribers are notified once on explicit cancel, unsubscribed ones never
+  auto notified = 0;
+  cancel.subscribe([&notified]() { ++notified; });
+  auto id = cancel.subscribe([&notified]() { notified += 10; });
+  cancel.unsubscribe(id);
+
+  // a later deadline doesn't replace an earlier one
+  cancel.expire(std::chrono::steady_clock::now() + std::chrono::hours(1));
+  cancel.expire(std::chrono::steady_clock::now() + std::chrono::hours(2));
+  EXPECT_FALSE(cancel.cancelled());
+
+  cancel.cancel();
+  cancel.cancel();
+  EXPECT_TRUE(cancel.cancelled());
+  EXPECT_EQ(notified, 1);
+
+  // subscribing a cancelled token calls back right away
+  cancel.subscribe([&notified]() { ++notified; });
+  EXPECT_EQ(notified, 2);
+
+  // passed deadline or a positive probe cancels it
+  Cancellation expired;
+  expired.expire(std::chrono::steady_clock::now() - std::chrono::milliseconds(1));
+  EXPECT_TRUE(expired.cancelled());
+
+  Cancellation probed;
+  auto gone = false;
+  probed.watch([&gone]() { return gone; });
+  EXPECT_FALSE(probed.cancelled());
+  gone = true;
+  EXPECT_TRUE(probed.cancelled());
+
+  // a scoped subscription is gone with its scope, also when the scope is left by an exception
+  Cancellation scoped;
+  auto calls = 0;
+  try {
+    Subscription subscription(scoped, [&calls]() { ++calls; });
+    throw std::runtime_error("failed in scope");
+  } catch (const std::exception&) {
+  }
+  scoped.cancel();
+  EXPECT_EQ(calls, 0);
+}
+
 } // namespace test
 } // namespace common
 } // namespace nebula
\ No newline at end of file
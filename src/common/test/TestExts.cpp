@@ -168,6 +168,38 @@ TEST(CuckooTest, TestCuckooFilter) {
             << " filter size: " << filter.bytes();
 }
 
+TEST(BloomTest, TestBlockedBloomFilter) {
+  const size_t items = 10000;
+  // filter is sized for much more items than the observed cardinality
+  BloomFilter<std::string_view> filter(items * 10);
+  std::vector<std::string> values;
+  values.reserve(items);
+  for (size_t i = 0; i < items; ++i) {
+    values.push_back(fmt::format("user-{0}", i));
+    filter.add(values.back());
+  }
+
+  const auto bytes = filter.bytes();
+  filter.seal();
+  EXPECT_LT(filter.bytes(), bytes);
+
+  // no false negative after folding
+  for (const auto& v : values) {
+    EXPECT_TRUE(filter.probably(v));
+  }
+
+  size_t falsePositives = 0;
+  for (size_t i = items; i < 2 * items; ++i) {
+    falsePositives += filter.probably(fmt::format("user-{0}", i));
+  }
+  EXPECT_LT(falsePositives * 100.0 / items, 0.1);
+
+  // batch probe an IN list by hashes
+  std::vector<uint64_t> hashes{ BloomFilter<std::string_view>::hash("nobody"), BloomFilter<std::string_view>::hash("user-7") };
+  EXPECT_TRUE(filter.probably(hashes.data(), hashes.size()));
+  EXPECT_FALSE(filter.probably(hashes.data(), 1));
+}
+
 // Testing yomm2 open multi-methods
 struct A {
   virtual ~A() {}
@@ -15,16 +15,28 @@
  */
 
 #include "BlockManager.h"
+#include <gflags/gflags.h>
 #include <regex>
+#include <folly/String.h>
+#include "common/BloomFilter.h"
 #include "common/Folly.h"
+#include "execution/core/BlockCache.h"
+#include "execution/core/SelectionCache.h"
+#include "execution/meta/TableService.h"
+#include "storage/local/File.h"
 #include "type/Tree.h"
 
+DEFINE_string(SPILL_DIR, "", "local directory (SSD) to spill cold blocks into, empty to disable tiered storage");
+DEFINE_uint64(SPILL_MEMORY_LIMIT, 8589934592, "in-memory block data size allowed before spilling cold blocks");
+DEFINE_bool(BLOCK_CACHE, false, "persist in-proc blocks into SPILL_DIR and restore them when node restarts");
+
 /**
  * Nebula execution in block managment.
  */
 namespace nebula {
 namespace execution {
 
+using nebula::common::BloomFilter;
 using nebula::execution::io::BatchBlock;
 using nebula::memory::Batch;
 using nebula::meta::BlockSignature;
@@ -64,17 +76,87 @@ void BlockManager::collectBlockMetrics(const io::BatchBlock& meta, TableStates&
   std::get<4>(tuple) = std::max(std::get<4>(tuple), meta.end());
 }
 
+// decode IN values encoded as "<size>:<value>,..." (see udf::In::encode) starting at pos,
+// pos is moved past the closing "]", return false if the list is malformed
+static bool decodeIn(const std::string& str, size_t& pos, std::vector<std::string>& values) {
+  if (pos < str.size() && str[pos] == ']') {
+    ++pos;
+    return true;
+  }
+
+  while (pos < str.size()) {
+    const auto colon = str.find(':', pos);
+    if (colon == std::string::npos || colon == pos || colon - pos > 9) {
+      return false;
+    }
+
+    size_t size = 0;
+    for (auto i = pos; i < colon; ++i) {
+      if (str[i] < '0' || str[i] > '9') {
+        return false;
+      }
+
+      size = size * 10 + (str[i] - '0');
+    }
+
+    pos = colon + 1;
+    if (pos + size >= str.size()) {
+      return false;
+    }
+
+    values.push_back(str.substr(pos, size));
+    pos += size;
+    const auto next = str[pos++];
+    if (next == ']') {
+      return true;
+    }
+
+    if (next != ',') {
+      return false;
+    }
+  }
+
+  return false;
+}
+
 /// HACK! - Replace it!
-std::pair<std::string, std::string> hackColEqValue(std::string_view input) {
+// column and its values from filter signature like "(...&&(F:col==C:v))" or "(...&&IN[1:a,2:bc](F:col))"
+// the IN list has to be the last conjunct so that it constrains the whole filter, or the whole filter itself
+std::pair<std::string, std::vector<std::string>> hackColEqValue(std::string_view input) {
   std::regex col_regex("&&\\(F:(\\w+)==C:(\\w+)\\)\\)");
+  std::regex only_regex("\\(F:(\\w+)==C:(\\w+)\\)");
   std::smatch matches;
   std::string str(input.data(), input.size());
-  if (std::regex_search(str, matches, col_regex) && matches.size() == 3) {
+  if ((std::regex_search(str, matches, col_regex) || std::regex_match(str, matches, only_regex)) && matches.size() == 3) {
     return { matches[1].str(),
-             matches[2].str() };
+             { matches[2].str() } };
   }
 
-  return { "", "" };
+  static constexpr std::string_view IN = "&&IN[";
+  std::regex tail_regex("\\(F:(\\w+)\\)\\)");
+  for (auto start = str.find(IN); start != std::string::npos; start = str.find(IN, start + 1)) {
+    std::vector<std::string> values;
+    auto pos = start + IN.size();
+    if (decodeIn(str, pos, values)
+        && std::regex_match(str.cbegin() + pos, str.cend(), matches, tail_regex)
+        && matches.size() == 2) {
+      return { matches[1].str(), values };
+    }
+  }
+
+  // the whole filter is an IN list
+  static constexpr std::string_view ONLY = "IN[";
+  std::regex only_tail_regex("\\(F:(\\w+)\\)");
+  std::vector<std::string> values;
+  size_t pos = ONLY.size();
+  if (str.compare(0, ONLY.size(), ONLY) == 0
+      && decodeIn(str, pos, values)
+      && std::regex_match(str.cbegin() + pos, str.cend(), matches, only_tail_regex)
+      && matches.size() == 2) {
+    return { matches[1].str(), values };
+  }
+
+  return { "", {} };
 }
 
 bool BlockManager::tableInBlockSet(const std::string& table, const BlockSet& bs) {
@@ -92,7 +174,7 @@ const std::vector<NNode> BlockManager::query(const std::string& table) {
   std::vector<NNode> nodes;
 
   // all blocks in proc
-  if (tableInBlockSet(table, blocks_)) {
+  if (auto lock = scan(); tableInBlockSet(table, blocks_)) {
     nodes.push_back(NNode::inproc());
   }
 
@@ -106,6 +188,71 @@ const std::vector<NNode> BlockManager::query(const std::string& table) {
   return nodes;
 }
 
+std::unordered_map<std::string, std::vector<std::pair<NNode, size_t>>> BlockManager::holders(
+  const std::string& table, const QueryWindow& window) const {
+  std::unordered_map<std::string, std::vector<std::pair<NNode, size_t>>> holders;
+  for (auto n = remotes_.begin(); n != remotes_.end(); ++n) {
+    // blocks of each spec on this node
+    std::unordered_map<std::string, size_t> counts;
+    for (auto& b : n->second) {
+      if (table == b.getTable() && b.overlap(window)) {
+        ++counts[b.spec()];
+      }
+    }
+
+    for (auto& c : counts) {
+      holders[c.first].emplace_back(n->first, c.second);
+    }
+  }
+
+  return holders;
+}
+
+size_t BlockManager::count(const std::string& table, const QueryWindow& window) const {
+  size_t count = 0;
+  auto overlap = [&](const BlockSet& bs) {
+    for (auto& b : bs) {
+      if (table == b.getTable() && b.overlap(window)) {
+        ++count;
+      }
+    }
+  };
+
+  {
+    auto lock = scan();
+    overlap(blocks_);
+  }
+  for (auto n = remotes_.begin(); n != remotes_.end(); ++n) {
+    overlap(n->second);
+  }
+
+  return count;
+}
+
+size_t BlockManager::fingerprint(const std::string& table, const QueryWindow& window) const {
+  // blocks are combined in any order
+  size_t sum = 0;
+  size_t count = 0;
+  auto combine = [&](const BlockSet& bs) {
+    for (auto& b : bs) {
+      if (table == b.getTable() && b.overlap(window)) {
+        sum += b.hash() ^ (b.state().numRows * 0x9E3779B97F4A7C15UL);
+        ++count;
+      }
+    }
+  };
+
+  {
+    auto lock = scan();
+    combine(blocks_);
+  }
+  for (auto n = remotes_.begin(); n != remotes_.end(); ++n) {
+    combine(n->second);
+  }
+
+  return sum ^ (count * 0xC6A4A7935BD1E995UL);
+}
+
 const std::vector<Batch*> BlockManager::query(const Table& table, const ExecutionPlan& plan) {
   // 1. a table and a predicate should determined by meta service how many blocks we should query
   // 2. determine how many blocks are not in memory yet, if they are not, load them in
@@ -127,6 +274,7 @@ const std::vector<Batch*> BlockManager::query(const Table& table, const Executio
 
   if (pair.first.size() > 0) {
     const auto& colName = pair.first;
+    const auto& values = pair.second;
     Kind kind = Kind::INVALID;
 
     // TODO(cao) - we should use table.schema() but here we use compute input schema instead
@@ -136,10 +284,15 @@ const std::vector<Batch*> BlockManager::query(const Table& table, const Executio
     });
 
     N_ENSURE(kind != Kind::INVALID, "column not found");
-#define KIND_CHECK(K, T)                                                                                            \
-  case Kind::K: {                                                                                                   \
-    pass = [&colName, &pair](Batch* batch) -> bool { return batch->probably(colName, folly::to<T>(pair.second)); }; \
-    break;                                                                                                          \
+    // hash values once and probe their hashes against bloom filter of every block
+    std::vector<uint64_t> hashes;
+    hashes.reserve(values.size());
+#define KIND_CHECK(K, T)                                                   \
+  case Kind::K: {                                                          \
+    for (const auto& value : values) {                                     \
+      hashes.push_back(BloomFilter<T>::hash(folly::to<T>(value)));         \
+    }                                                                      \
+    break;                                                                 \
   }
 
     switch (kind) {
@@ -150,19 +303,40 @@ const std::vector<Batch*> BlockManager::query(const Table& table, const Executio
       KIND_CHECK(BIGINT, int64_t)
       KIND_CHECK(REAL, float)
       KIND_CHECK(DOUBLE, double)
+    case Kind::VARCHAR: {
+      for (const auto& value : values) {
+        hashes.push_back(BloomFilter<std::string_view>::hash(value));
+      }
+      break;
+    }
     default:
       break;
     }
 
+    if (hashes.size() > 0) {
+      pass = [&colName, hashes = std::move(hashes)](Batch* batch) -> bool { return batch->probably(colName, hashes); };
+    }
+
 #undef KIND_CHECK
   }
 
+  // a plan scoped to some specs leaves blocks of other specs to their replicas
+  const auto& specs = plan.specs();
   for (auto& b : blocks_) {
     if (b.getTable() == table.name()) {
+      if (!specs.empty() && specs.find(b.spec()) == specs.end()) {
+        continue;
+      }
+
       ++total;
 
       Batch* ptr = b.data().get();
       if (b.overlap(window) && pass(ptr)) {
+        // block survived pruning, bring its spilled data back
+        if (ptr->spilled()) {
+          ptr->pageIn();
+        }
+
         tableBlocks.push_back(ptr);
       }
     }
@@ -187,6 +361,8 @@ bool BlockManager::add(const BatchBlock& block) {
   const auto& node = block.residence();
   // ensure the block is not in memory
   if (node.isInProc()) {
+    persist(block);
+    std::unique_lock<std::shared_mutex> lock(scan_);
     blocks_.insert(block);
   } else {
 
@@ -206,22 +382,36 @@ bool BlockManager::add(const BatchBlock& block) {
 }
 
 bool BlockManager::add(std::vector<io::BatchBlock> range) {
+  for (auto& block : range) {
+    persist(block);
+  }
+
+  std::unique_lock<std::shared_mutex> lock(scan_);
   std::move(range.begin(), range.end(), std::inserter(blocks_, blocks_.begin()));
   return true;
 }
 
-bool BlockManager::remove(const BatchBlock&) {
-  throw NException("Not implemeneted yet");
+bool BlockManager::remove(const BatchBlock& block) {
+  std::unique_lock<std::shared_mutex> lock(scan_);
+  auto itr = blocks_.find(block);
+  if (itr == blocks_.end()) {
+    return false;
+  }
+
+  recycle(*itr);
+  blocks_.erase(itr);
+  return true;
 }
 
 // remove block that share the given ID
-// NOTE: thread-unsafe~!
 size_t BlockManager::removeById(const std::string& id) {
   //TODO(cao) - perf issue: we should not iterate all
   // instead, leverage the hash set nature by converting id into a BlockSignature
+  std::unique_lock<std::shared_mutex> lock(scan_);
   auto itr = blocks_.begin();
   while (itr != blocks_.end()) {
     if (itr->signature().toString() == id) {
+      recycle(*itr);
       itr = blocks_.erase(itr);
       return 1;
     }
@@ -239,12 +429,13 @@ void BlockManager::set(const NNode& node, BlockSet set) {
 }
 
 // remove all blocks that share the given spec
-// NOTE: thread-unsafe~!
 size_t BlockManager::removeSameSpec(const nebula::meta::BlockSignature& bs) {
   size_t count = 0;
+  std::unique_lock<std::shared_mutex> lock(scan_);
   auto itr = blocks_.begin();
   while (itr != blocks_.end()) {
     if (bs.sameSpec(itr->signature())) {
+      recycle(*itr);
       itr = blocks_.erase(itr);
       count++;
       continue;
@@ -256,14 +447,223 @@ size_t BlockManager::removeSameSpec(const nebula::meta::BlockSignature& bs) {
   return count;
 }
 
+// spill cold blocks until in-memory data size is under the limit.
+// files are written without blocking queries, a block is mapped to its file only when no query is scanning.
+size_t BlockManager::spill() {
+  if (FLAGS_SPILL_DIR.empty()) {
+    return 0;
+  }
+
+  // collect all blocks that are still in memory, copies keep their data alive during writing
+  std::vector<BatchBlock> hot;
+  size_t memory = 0;
+  {
+    auto lock = scan();
+    for (auto& b : blocks_) {
+      if (!b.data()->spilled()) {
+        hot.push_back(b);
+        memory += b.state().rawSize;
+      }
+    }
+  }
+
+  if (memory <= FLAGS_SPILL_MEMORY_LIMIT) {
+    return 0;
+  }
+
+  // time series data gets cold as it ages, spill blocks holding oldest data first
+  std::sort(hot.begin(), hot.end(), [](const BatchBlock& b1, const BatchBlock& b2) {
+    return b1.end() < b2.end();
+  });
+
+  size_t count = 0;
+  for (const auto& block : hot) {
+    if (memory <= FLAGS_SPILL_MEMORY_LIMIT) {
+      break;
+    }
+
+    // block persisted already (cache enabled) only needs to be mapped,
+    // a block still being persisted is left to next round
+    auto pending = false;
+    auto file = stored(block, pending);
+    if (pending) {
+      continue;
+    }
+
+    const auto size = block.state().rawSize;
+    const auto saved = file.empty();
+    try {
+      if (saved) {
+        file = io::BlockLoader::save(block, FLAGS_SPILL_DIR);
+      }
+
+      // data memory is released by mapping, wait for queries scanning it.
+      // the file is written before from sealed data which is never changed, so it needs no lock.
+      std::unique_lock<std::shared_mutex> lock(scan_);
+      auto itr = blocks_.find(block);
+      if (itr == blocks_.end()) {
+        // the block is removed while being written
+        if (saved) {
+          std::remove(file.c_str());
+        }
+        continue;
+      }
+
+      block.data()->spill(file);
+
+      // record storage of the block, re-insert it since items in the set are immutable
+      auto node = blocks_.extract(itr);
+      node.value().setStorage(file);
+      blocks_.insert(std::move(node));
+    } catch (const std::exception& ex) {
+      LOG(ERROR) << "Failed to spill block " << block.signature().toString() << ": " << ex.what();
+      continue;
+    }
+
+    memory -= size;
+    ++count;
+  }
+
+  LOG(INFO) << fmt::format("Spilled {0} blocks into {1}, in-memory data size: {2}.", count, FLAGS_SPILL_DIR, memory);
+  return count;
+}
+
+// single writer of block files off the ingestion path
+static folly::CPUThreadPoolExecutor& writer() {
+  static folly::CPUThreadPoolExecutor pool{ 1 };
+  return pool;
+}
+
+void BlockManager::persist(const BatchBlock& block) {
+  if (!FLAGS_BLOCK_CACHE || FLAGS_SPILL_DIR.empty() || !block.storage().empty()) {
+    return;
+  }
+
+  // the block is registered as pending, its file is recorded once written
+  const auto id = block.signature().toString();
+  {
+    std::lock_guard<std::mutex> lock(filesMutex_);
+    files_[id] = "";
+  }
+
+  writer().add([this, block, id]() {
+    std::string file;
+    try {
+      file = io::BlockLoader::save(block, FLAGS_SPILL_DIR);
+    } catch (const std::exception& ex) {
+      LOG(ERROR) << "Failed to persist block " << id << ": " << ex.what();
+    }
+
+    std::lock_guard<std::mutex> lock(filesMutex_);
+    auto itr = files_.find(id);
+    if (itr == files_.end() || file.empty()) {
+      // the block is removed while being written, or failed to be written
+      if (!file.empty()) {
+        std::remove(file.c_str());
+      }
+
+      if (itr != files_.end()) {
+        files_.erase(itr);
+      }
+      return;
+    }
+
+    itr->second = file;
+  });
+}
+
+std::string BlockManager::stored(const BatchBlock& block, bool& pending) {
+  pending = false;
+  if (!block.storage().empty()) {
+    return block.storage();
+  }
+
+  std::lock_guard<std::mutex> lock(filesMutex_);
+  auto itr = files_.find(block.signature().toString());
+  if (itr == files_.end()) {
+    return {};
+  }
+
+  pending = itr->second.empty();
+  return itr->second;
+}
+
+void BlockManager::recycle(const BatchBlock& block) {
+  // cached results and selections of the block are no longer valid
+  if (block.data() != nullptr) {
+    nebula::execution::core::BlockCache::singleton().invalidate(block.data().get());
+    nebula::execution::core::SelectionCache::singleton().invalidate(block.data().get());
+  }
+
+  // a file being written is removed by the writer when it is done
+  std::string file;
+  {
+    std::lock_guard<std::mutex> lock(filesMutex_);
+    auto itr = files_.find(block.signature().toString());
+    if (itr != files_.end()) {
+      file = std::move(itr->second);
+      files_.erase(itr);
+    }
+  }
+
+  if (file.empty()) {
+    file = block.storage();
+  }
+
+  if (!file.empty()) {
+    std::remove(file.c_str());
+  }
+}
+
+// restore blocks persisted by last run of current node
+// if block cache is off, files left in the local storage are purged
+size_t BlockManager::restore() {
+  if (FLAGS_SPILL_DIR.empty()) {
+    return 0;
+  }
+
+  nebula::storage::local::File fs;
+  size_t count = 0;
+  for (const auto& f : fs.list(FLAGS_SPILL_DIR)) {
+    const auto& name = f.name;
+    if (f.isDir || name.size() < 3 || name.compare(name.size() - 3, 3, ".nb") != 0) {
+      continue;
+    }
+
+    const auto file = fmt::format("{0}/{1}", FLAGS_SPILL_DIR, name);
+    if (!FLAGS_BLOCK_CACHE) {
+      std::remove(file.c_str());
+      continue;
+    }
+
+    try {
+      auto block = io::BlockLoader::restore(file);
+
+      // enroll the table in case nobody did it yet
+      nebula::execution::meta::TableService::singleton()->enroll(block.data()->table());
+      add(block);
+      ++count;
+    } catch (const std::exception& ex) {
+      LOG(ERROR) << "Failed to restore block from " << file << ": " << ex.what();
+      std::remove(file.c_str());
+    }
+  }
+
+  LOG(INFO) << fmt::format("Restored {0} blocks from {1}.", count, FLAGS_SPILL_DIR);
+  return count;
+}
+
 void BlockManager::updateTableMetrics() {
   // remove existing states
   TableStates states;
   NodeSpecs specs;
 
   // go through all blocks and do the aggregation again
-  for (auto i = blocks_.begin(); i != blocks_.end(); ++i) {
-    collectBlockMetrics(*i, states);
+  {
+    auto lock = scan();
+    for (auto i = blocks_.begin(); i != blocks_.end(); ++i) {
+      collectBlockMetrics(*i, states);
+    }
   }
 
   // go through all nodes's block set
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 #include "ExecutionPlan.h"
 #include "io/BlockLoader.h"
@@ -63,6 +64,18 @@ public:
   // query all nodes that hold data for given table
   const std::vector<nebula::meta::NNode> query(const std::string&);
 
+  // nodes holding blocks of given table overlapping given window by spec, with number of these blocks.
+  // a spec replicated to more than one node has more than one holder.
+  std::unordered_map<std::string, std::vector<std::pair<nebula::meta::NNode, size_t>>> holders(
+    const std::string&, const QueryWindow&) const;
+
+  // number of blocks of given table overlapping given window in proc and in all nodes
+  size_t count(const std::string&, const QueryWindow&) const;
+
+  // fingerprint of all blocks of given table overlapping given window in proc and in all nodes,
+  // it changes whenever any of these blocks is added, removed or replaced.
+  size_t fingerprint(const std::string&, const QueryWindow&) const;
+
   // add a block into the system - the data may be loaded internal
   bool add(const nebula::meta::BlockSignature&);
 
@@ -116,6 +129,20 @@ public:
   // remove blocks that share the spec of given block signature
   size_t removeSameSpec(const nebula::meta::BlockSignature&);
 
+  // spill cold in-proc blocks into local storage when their data size exceeds memory limit
+  // return number of blocks spilled. it waits for readers holding scan() before it swaps block data.
+  size_t spill();
+
+  // hold it while scanning in-proc blocks returned by query and reading results referencing them,
+  // so that their data is not swapped by spill nor blocks removed in the middle.
+  // other readers of in-proc blocks take it themselves, don't call them while holding it.
+  inline std::shared_lock<std::shared_mutex> scan() const {
+    return std::shared_lock<std::shared_mutex>(scan_);
+  }
+
+  // restore blocks persisted in local storage, return number of blocks restored
+  size_t restore();
+
   // has spec in node
   bool hasSpec(const nebula::meta::NNode& node, const std::string& spec) {
     auto entry = specs_.find(node);
@@ -141,12 +168,28 @@ private:
   // node to spec set (by spec signature) mapping, updated by udpate table metrics
   NodeSpecs specs_;
 
+  // shared by readers of in-proc blocks, exclusive to spill and every change of the in-proc block set
+  mutable std::shared_mutex scan_;
+
+  // files of in-proc blocks persisted in background by block signature, empty while being written
+  std::mutex filesMutex_;
+  std::unordered_map<std::string, std::string> files_;
+
 private:
   static std::mutex smux;
   static std::shared_ptr<BlockManager> inst;
   BlockManager() {}
 
   static void collectBlockMetrics(const io::BatchBlock&, TableStates&);
+
+  // persist an in-proc block into local storage in background if block cache is enabled
+  void persist(const io::BatchBlock&);
+
+  // local file of a block, empty if it has none yet. pending is set if the file is still being written.
+  std::string stored(const io::BatchBlock&, bool& pending);
+
+  // remove the persisted file and cached results of a block leaving the system
+  void recycle(const io::BatchBlock&);
   static bool tableInBlockSet(const std::string&, const BlockSet&);
 };
 
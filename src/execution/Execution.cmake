@@ -4,11 +4,16 @@ set(NEBULA_EXEC NExec)
 # target_include_directories(${NEBULA_EXEC} INTERFACE src/execution)
 add_library(${NEBULA_EXEC} STATIC 
     ${NEBULA_SRC}/execution/core/AggregationMerge.cpp    
+    ${NEBULA_SRC}/execution/core/AggregationSpill.cpp    
+    ${NEBULA_SRC}/execution/core/Approximate.cpp    
+    ${NEBULA_SRC}/execution/core/BlockCache.cpp    
     ${NEBULA_SRC}/execution/core/BlockExecutor.cpp    
     ${NEBULA_SRC}/execution/core/ComputedRow.cpp    
-    ${NEBULA_SRC}/execution/core/Finalize.cpp    
+    ${NEBULA_SRC}/execution/core/Finalize.cpp
+    ${NEBULA_SRC}/execution/core/Hedging.cpp    
     ${NEBULA_SRC}/execution/core/NodeClient.cpp    
     ${NEBULA_SRC}/execution/core/NodeExecutor.cpp    
+    ${NEBULA_SRC}/execution/core/SelectionCache.cpp    
     ${NEBULA_SRC}/execution/core/ServerExecutor.cpp    
     ${NEBULA_SRC}/execution/io/BlockLoader.cpp
     ${NEBULA_SRC}/execution/meta/TableService.cpp
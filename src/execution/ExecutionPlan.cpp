@@ -39,7 +39,30 @@ ExecutionPlan::ExecutionPlan(
   : uuid_{ "<uuid>" },
     plan_{ std::move(plan) },
     nodes_{ std::move(nodes) },
-    output_{ output } {}
+    output_{ output },
+    estimates_{ std::make_shared<Estimates>() },
+    transfer_{ std::make_shared<Transfer>() },
+    coverage_{ std::make_shared<Coverage>() },
+    cancellation_{ std::make_shared<nebula::common::Cancellation>() } {}
+
+std::unique_ptr<ExecutionPlan> ExecutionPlan::copy() const {
+  auto plan = std::make_unique<ExecutionPlan>(nullptr, nodes_, output_);
+  plan->plan_ = plan_;
+  plan->window_ = window_;
+  plan->specs_ = specs_;
+  plan->cacheKey_ = cacheKey_;
+  plan->filterKey_ = filterKey_;
+  return plan;
+}
+
+std::shared_ptr<const ExecutionPlan> ExecutionPlan::share() const {
+  std::shared_ptr<ExecutionPlan> plan = copy();
+  plan->estimates_ = estimates_;
+  plan->transfer_ = transfer_;
+  plan->coverage_ = coverage_;
+  plan->cancellation_ = cancellation_;
+  return plan;
+}
 
 void ExecutionPlan::display() const {
   LOG(INFO) << "Query will be executed in nodes: " << nodes_.size();
@@ -16,9 +16,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include <numeric>
+#include <unordered_map>
 #include <unordered_set>
 
+#include "common/Cancellation.h"
 #include "common/Cursor.h"
 #include "meta/NNode.h"
 #include "surface/DataSurface.h"
@@ -52,6 +56,16 @@ enum class PhaseType {
   GLOBAL
 };
 
+// how samples are drawn for a query without aggregation
+enum class SampleMode {
+  // first matching rows of each block in storage order
+  FIRST,
+  // uniform random rows, quota of each block is proportional to its rows
+  UNIFORM,
+  // uniform random rows in every time bucket, quota of each block is allocated by its time range
+  STRATIFIED
+};
+
 template <PhaseType PHASE>
 struct PhaseTraits {};
 
@@ -63,10 +77,105 @@ class Phase {};
 
 // define query window type
 using QueryWindow = std::pair<size_t, size_t>;
+
+// if a time value is in window [start, end]
+inline bool inWindow(const QueryWindow& window, int64_t time) noexcept {
+  return time >= 0 && static_cast<size_t>(time) >= window.first && static_cast<size_t>(time) <= window.second;
+}
+
 using BlockPhase = Phase<PhaseType::COMPUTE>;
 using NodePhase = Phase<PhaseType::PARTIAL>;
 using FinalPhase = Phase<PhaseType::GLOBAL>;
 
+// estimated total of an additive column (SUM/COUNT) by an approximate query
+// and variance of the estimator
+struct Estimate {
+  double total;
+  double variance;
+};
+
+using EstimateMap = std::unordered_map<std::string, Estimate>;
+
+// estimates reported by nodes of an approximate query, keyed by column name.
+// estimates of different nodes are independent so they add up.
+class Estimates {
+public:
+  void add(const std::string& column, const Estimate& estimate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& e = estimates_[column];
+    e.total += estimate.total;
+    e.variance += estimate.variance;
+  }
+
+  EstimateMap get() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return estimates_;
+  }
+
+private:
+  mutable std::mutex mutex_;
+  EstimateMap estimates_;
+};
+
+// bytes of node results received by server, before and after compression
+class Transfer {
+public:
+  inline void add(size_t raw, size_t wire) noexcept {
+    raw_ += raw;
+    wire_ += wire;
+  }
+
+  // compression ratio of all transferred results, 1 if nothing transferred
+  inline double ratio() const noexcept {
+    const size_t wire = wire_;
+    return wire == 0 ? 1 : (double)raw_ / wire;
+  }
+
+private:
+  std::atomic<size_t> raw_{ 0 };
+  std::atomic<size_t> wire_{ 0 };
+};
+
+// nodes whose results are missing from a query because they failed or timed out,
+// and number of blocks on them, a result missing any is partial.
+class Coverage {
+public:
+  void miss(const std::string& node, size_t blocks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nodes_.push_back(node);
+    blocks_ += blocks;
+  }
+
+  // take over misses of another plan whose result is merged into the result of this plan
+  void add(const Coverage& other) {
+    const auto nodes = other.nodes();
+    const auto blocks = other.blocks();
+    std::lock_guard<std::mutex> lock(mutex_);
+    nodes_.insert(nodes_.end(), nodes.begin(), nodes.end());
+    blocks_ += blocks;
+  }
+
+  std::vector<std::string> nodes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nodes_;
+  }
+
+  size_t blocks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return blocks_;
+  }
+
+  bool partial() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !nodes_.empty();
+  }
+
+private:
+  mutable std::mutex mutex_;
+  std::vector<std::string> nodes_;
+  size_t blocks_ = 0;
+};
+
 // An execution plan that can be serialized and passed around
 // protobuf?
 class ExecutionPlan {
@@ -79,6 +188,14 @@ public:
 public:
   void display() const;
 
+  // a new plan sharing the compiled phases, it has its own window, estimates, transfer and coverage stats
+  // and cancellation
+  std::unique_ptr<ExecutionPlan> copy() const;
+
+  // a plan sharing the compiled phases and stats and cancellation of this run,
+  // it is held by work that may outlive this plan such as an in-proc node execution
+  std::shared_ptr<const ExecutionPlan> share() const;
+
   template <PhaseType PT>
   const Phase<PT>& fetch() const;
 
@@ -94,7 +211,8 @@ public:
     return output_;
   }
 
-  // set time range as [start, end] alias window
+  // set time range as [start, end] alias window, rows out of it are dropped by block executors.
+  // it is not part of compiled phases, so plans of different windows share them.
   inline void setWindow(const QueryWindow& window) noexcept {
     window_ = window;
   }
@@ -103,15 +221,69 @@ public:
     return window_;
   }
 
+  // estimates of an approximate query, shared with clients executing it on nodes
+  inline const std::shared_ptr<Estimates>& estimates() const noexcept {
+    return estimates_;
+  }
+
+  // transfer stats of node results, shared with clients executing it on nodes
+  inline const std::shared_ptr<Transfer>& transfer() const noexcept {
+    return transfer_;
+  }
+
+  // coverage of node results, shared with the server executor fanning it out
+  inline const std::shared_ptr<Coverage>& coverage() const noexcept {
+    return coverage_;
+  }
+
+  // cancellation of this run of the plan polled by its block tasks, shared with the rpc serving it
+  inline const std::shared_ptr<nebula::common::Cancellation>& cancellation() const noexcept {
+    return cancellation_;
+  }
+
+  // restrict the plan to blocks of given specs on a node, empty for all blocks.
+  // server scopes nodes this way when the same spec is on more than one node.
+  inline void setSpecs(std::unordered_set<std::string> specs) noexcept {
+    specs_ = std::move(specs);
+  }
+
+  inline const std::unordered_set<std::string>& specs() const noexcept {
+    return specs_;
+  }
+
+  // key of the plan and key of its filter with time comparisons left out.
+  // a block within the window has the same result for all plans of the key, and the same selected rows
+  // for all plans of the filter key. empty keys disable caching.
+  inline void setCacheKey(std::string key, std::string filter) noexcept {
+    cacheKey_ = std::move(key);
+    filterKey_ = std::move(filter);
+  }
+
+  inline const std::string& cacheKey() const noexcept {
+    return cacheKey_;
+  }
+
+  inline const std::string& filterKey() const noexcept {
+    return filterKey_;
+  }
+
 private:
   const ExecutionPhase& fetch(PhaseType type) const;
 
 private:
   const std::string uuid_;
-  std::unique_ptr<ExecutionPhase> plan_;
+  // compiled phases are read only so that plans of the same query shape share them
+  std::shared_ptr<const ExecutionPhase> plan_;
   std::vector<nebula::meta::NNode> nodes_;
   nebula::type::Schema output_;
   QueryWindow window_;
+  std::shared_ptr<Estimates> estimates_;
+  std::shared_ptr<Transfer> transfer_;
+  std::shared_ptr<Coverage> coverage_;
+  std::shared_ptr<nebula::common::Cancellation> cancellation_;
+  std::unordered_set<std::string> specs_;
+  std::string cacheKey_;
+  std::string filterKey_;
 };
 
 // base execution phase definition - templated lambda - looking for C++ 20?
@@ -203,6 +375,16 @@ public:
     return *this;
   }
 
+  Phase& sample(SampleMode mode) {
+    sample_ = mode;
+    return *this;
+  }
+
+  Phase& fraction(double fraction) {
+    fraction_ = fraction;
+    return *this;
+  }
+
 public:
   virtual nebula::type::Schema outputSchema() const override {
     return output_;
@@ -246,6 +428,19 @@ public:
     return limit_;
   }
 
+  inline SampleMode sampleMode() const {
+    return sample_;
+  }
+
+  // fraction of blocks to execute on for an approximate query, exact query if not in (0, 1)
+  inline double fraction() const {
+    return fraction_;
+  }
+
+  inline bool approximate() const {
+    return fraction_ > 0 && fraction_ < 1;
+  }
+
   // decide if we want to cache expression evaluations
   // TODO(cao) - cache evaluation is interesting, some work need to be done to have fair evaluation
   // 1. collect both leaf and composition of evaluation expressions. asEval can open to receive and set
@@ -279,6 +474,12 @@ private:
 
   // results limitation
   size_t limit_;
+
+  // sampling mode of samples query
+  SampleMode sample_ = SampleMode::FIRST;
+
+  // fraction of blocks sampled by an approximate query
+  double fraction_ = 0;
 };
 
 template <>
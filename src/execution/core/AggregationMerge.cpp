@@ -19,6 +19,7 @@
 #include <fmt/format.h>
 #include <gflags/gflags.h>
 
+#include "AggregationSpill.h"
 #include "common/Fold.h"
 #include "execution/serde/RowCursorSerde.h"
 #include "memory/keyed/FlatRowCursor.h"
@@ -31,6 +32,14 @@ DEFINE_uint64(MULTI_FOLD_WIDTH, 1,
               "1: use current thread, not using pool"
               "2+: use this width to do folding parallel");
 
+DEFINE_uint64(AGG_MEMORY_CAP, 4294967296,
+              "memory cap in bytes of aggregation table merging results in a query, 0 for no cap."
+              "an aggregation table hitting the cap spills into local disk unless AGG_APPROX_TOPK is set");
+
+DEFINE_bool(AGG_APPROX_TOPK, false,
+            "instead of spilling, keep only top rows of a sorted top query when aggregation table hits the cap."
+            "result may be approximate since groups dropped can show up again from later blocks");
+
 /**
  * A logic wrapper to merge aggregation results shared by aggregators (Node Executor or Server Executor)
  */
@@ -41,6 +50,7 @@ namespace core {
 using nebula::common::CompositeCursor;
 using nebula::memory::keyed::FlatRowCursor;
 using nebula::memory::keyed::HashFlat;
+using nebula::memory::keyed::HashedRowCursor;
 using nebula::surface::EmptyRowCursor;
 using nebula::surface::RowCursorPtr;
 using nebula::surface::RowData;
@@ -48,13 +58,108 @@ using nebula::surface::eval::ValueEval;
 using nebula::type::Kind;
 using nebula::type::Schema;
 
+Merger::Merger(
+  const Schema schema,
+  const std::vector<size_t>& keys,
+  const std::vector<std::unique_ptr<ValueEval>>& fields,
+  const bool hasAggregation,
+  const Prune& prune)
+  : schema_{ schema },
+    keys_{ keys },
+    fields_{ fields },
+    hasAggregation_{ hasAggregation },
+    prune_{ prune },
+    hf_{ nullptr },
+    spill_{ nullptr },
+    rows_{ 0 },
+    composite_{ nullptr } {
+  if (hasAggregation_) {
+    hf_ = std::make_unique<HashFlat>(schema_, keys_, fields_);
+  } else {
+    composite_ = std::make_shared<CompositeCursor<RowData>>();
+  }
+}
+
+Merger::~Merger() = default;
+
+void Merger::add(RowCursorPtr cursor) {
+  if (!cursor) {
+    return;
+  }
+
+  if (!hasAggregation_) {
+    composite_->combine(cursor);
+    return;
+  }
+
+  // rows carrying key hashes computed on the same keys are not hashed again
+  auto hashed = std::dynamic_pointer_cast<HashedRowCursor>(cursor);
+  if (hashed && (hashed->hashKeys().empty() || hashed->hashKeys() != hf_->hashKeys())) {
+    hashed = nullptr;
+  }
+
+  // if it is aggregation, we're sure the data cursor will be hash flat.
+  static constexpr size_t CHECK_ROWS = 4096;
+  const size_t cap = FLAGS_AGG_MEMORY_CAP;
+  while (cursor->hasNext()) {
+    const auto& row = cursor->next();
+    if (hashed) {
+      hf_->update(row, hashed->hash());
+    } else {
+      hf_->update(row);
+    }
+
+    // check memory cap periodically
+    if (cap == 0 || ++rows_ % CHECK_ROWS != 0 || hf_->memory() <= cap) {
+      continue;
+    }
+
+    if (FLAGS_AGG_APPROX_TOPK && prune_) {
+      // degrade to top rows of current table and continue aggregating on them
+      hf_->flush();
+      auto top = prune_(std::make_shared<FlatRowCursor>(std::move(hf_)));
+      hf_ = std::make_unique<HashFlat>(schema_, keys_, fields_);
+      while (top->hasNext()) {
+        hf_->update(top->next());
+      }
+
+      LOG(WARNING) << fmt::format("Aggregation hits memory cap {0}, keep top {1} rows only.", cap, hf_->getRows());
+      continue;
+    }
+
+    if (!spill_) {
+      spill_ = std::make_unique<AggregationSpill>(schema_, keys_, fields_);
+    }
+
+    spill_->add(*hf_);
+    hf_ = std::make_unique<HashFlat>(schema_, keys_, fields_);
+  }
+}
+
+RowCursorPtr Merger::result() {
+  if (!hasAggregation_) {
+    return composite_;
+  }
+
+  // merge all spilled runs back along with the last table
+  if (spill_) {
+    spill_->add(*hf_);
+    hf_ = nullptr;
+    return spill_->merge();
+  }
+
+  hf_->flush();
+  return std::make_shared<FlatRowCursor>(std::move(hf_));
+}
+
 RowCursorPtr merge(
   folly::ThreadPoolExecutor&,
   const Schema schema,
   const std::vector<size_t>& keys,
   const std::vector<std::unique_ptr<ValueEval>>& fields,
   const bool hasAggregation,
-  const std::vector<folly::Try<nebula::surface::RowCursorPtr>>& sources) {
+  const std::vector<folly::Try<nebula::surface::RowCursorPtr>>& sources,
+  const Prune& prune) {
   const auto size = sources.size();
   LOG(INFO) << fmt::format("Merge sources: {0} with aggregation: {1}", size, hasAggregation);
   if (size == 0) {
@@ -62,78 +167,15 @@ RowCursorPtr merge(
     return EmptyRowCursor::instance();
   }
 
-  if (hasAggregation) {
-    // if it is aggregation, we're sure the data cursor will be hash flat.
-    // So that we can do this multi-fold pass
-    // transform folly tries into HashFlat
-    // std::vector<std::unique_ptr<HashFlat>> blocks;
-    // blocks.reserve(size);
-    auto hf = std::make_unique<HashFlat>(schema, keys, fields);
-    for (auto it = sources.begin(); it < sources.end(); ++it) {
-      // if the result is empty
-      if (!it->hasValue()) {
-        continue;
-      }
-
-      auto blockResult = it->value();
-      while (blockResult->hasNext()) {
-        const auto& row = blockResult->next();
-        hf->update(row);
-      }
-    }
-
-    return std::make_shared<FlatRowCursor>(std::move(hf));
-  }
-
   // TODO(cao) - I'm seeing multi-fold problems and even worse performance
   // Need more time to work on this, most likely caused by the manipulation on the pointers/casting/moving
-  //   // convert to flat buffer pointer, we do not need schema used for new instance
-  //   auto buffer = nebula::execution::serde::asBuffer(*it->value(), nullptr);
-  //   N_ENSURE_NOT_NULL(buffer, "invalid buffer in merge path");
-  //   // this buffer could be HashFlat if it is from local aggregation
-  //   // or plain flat buffer which is searialized through boundary
-  //   auto origin = buffer.release();
-  //   auto flat = dynamic_cast<HashFlat*>(origin);
-  //   if (flat) {
-  //     blocks.push_back(std::unique_ptr<HashFlat>{ flat });
-  //   } else {
-  //     blocks.push_back(std::make_unique<HashFlat>(origin, keys));
-  //   }
-  // }
-
-  // if (blocks.size() == 0) {
-  //   LOG(INFO) << "no valid block to merge.";
-  //   return EmptyRowCursor::instance();
-  // }
-
-  // fold blocks if there are more than one
-  // if (blocks.size() > 1) {
-  //   nebula::common::fold<std::unique_ptr<HashFlat>>(
-  //     pool, blocks, [&update](std::unique_ptr<HashFlat>& from, std::unique_ptr<HashFlat>& to) {
-  //       // do the in-place merge
-  //       // iterate the block result and partial aggregate it in hash flat
-  //       FlatRowCursor cursor(std::move(from));
-  //       auto i = 0;
-  //       while (cursor.hasNext()) {
-  //         const auto& row = cursor.next();
-  //         to->update(row, update);
-  //       }
-  //     },
-  //     FLAGS_MULTI_FOLD_WIDTH);
-  // }
-
-  // // after fold, all data aggregated at position 0
-  // return std::make_shared<FlatRowCursor>(std::move(blocks.at(0)));
-
-  auto composite = std::make_shared<CompositeCursor<RowData>>();
+  // so all sources are merged one by one in current thread.
+  Merger merger(schema, keys, fields, hasAggregation, prune);
   auto failures = 0;
   for (auto it = sources.begin(); it < sources.end(); ++it) {
-    if (it->hasValue()) {
-      auto& cursor = it->value();
-      if (cursor) {
-        composite->combine(cursor);
-        continue;
-      }
+    if (it->hasValue() && it->value()) {
+      merger.add(it->value());
+      continue;
     }
 
     ++failures;
@@ -144,7 +186,7 @@ RowCursorPtr merge(
     LOG(INFO) << "Error or timeout nodes: " << failures;
   }
 
-  return composite;
+  return merger.result();
 }
 
 } // namespace core
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "common/Folly.h"
+#include "memory/keyed/HashFlat.h"
 #include "surface/DataSurface.h"
 #include "surface/eval/ValueEval.h"
 #include "type/Type.h"
@@ -28,13 +29,54 @@ namespace nebula {
 namespace execution {
 namespace core {
 
+// reduce an aggregation table out of memory cap to its top rows, such as sorted top K of a query
+using Prune = std::function<nebula::surface::RowCursorPtr(nebula::surface::RowCursorPtr)>;
+
+class AggregationSpill;
+
+// an incremental merger which takes result cursors one by one, such as chunks streamed from nodes.
+// it is not thread safe, callers need to serialize calls of add.
+class Merger {
+public:
+  Merger(const nebula::type::Schema,
+         const std::vector<size_t>&,
+         const nebula::surface::eval::Fields&,
+         const bool,
+         const Prune& = {});
+  ~Merger();
+
+  // merge rows of given cursor into current result
+  void add(nebula::surface::RowCursorPtr);
+
+  // result of all merged cursors, merger can not take more cursors after this call
+  nebula::surface::RowCursorPtr result();
+
+private:
+  const nebula::type::Schema schema_;
+  const std::vector<size_t>& keys_;
+  const nebula::surface::eval::Fields& fields_;
+  const bool hasAggregation_;
+  const Prune prune_;
+
+  // aggregation table and spilled runs when it hits memory cap
+  std::unique_ptr<nebula::memory::keyed::HashFlat> hf_;
+  std::unique_ptr<AggregationSpill> spill_;
+  size_t rows_;
+
+  // chained cursors for non-aggregation results
+  std::shared_ptr<nebula::surface::CompositeRowCursor> composite_;
+};
+
+// aggregation table is capped by AGG_MEMORY_CAP, it spills into local disk when the cap is hit,
+// or if AGG_APPROX_TOPK is enabled and prune is given, it keeps only the top rows to continue.
 nebula::surface::RowCursorPtr merge(
   folly::ThreadPoolExecutor&,
   const nebula::type::Schema,
   const std::vector<size_t>&,
   const nebula::surface::eval::Fields&,
   const bool,
-  const std::vector<folly::Try<nebula::surface::RowCursorPtr>>&);
+  const std::vector<folly::Try<nebula::surface::RowCursorPtr>>&,
+  const Prune& = {});
 } // namespace core
 } // namespace execution
 } // namespace nebula
\ No newline at end of file
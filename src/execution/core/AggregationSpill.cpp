@@ -0,0 +1,227 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "AggregationSpill.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fmt/format.h>
+#include <fstream>
+#include <functional>
+#include <gflags/gflags.h>
+#include <unistd.h>
+
+#include "common/Memory.h"
+
+DEFINE_string(AGG_SPILL_DIR, "/tmp", "local directory to spill aggregation runs into when memory cap is hit");
+DEFINE_uint64(AGG_SPILL_PARTITIONS, 16, "number of partitions an aggregation table spills into by key hash");
+
+/**
+ * Spill aggregation runs into local files.
+ */
+namespace nebula {
+namespace execution {
+namespace core {
+
+using nebula::common::Pool;
+using nebula::memory::keyed::FlatBuffer;
+using nebula::memory::keyed::HashFlat;
+using nebula::surface::RowCursorPtr;
+using nebula::surface::RowData;
+
+AggregationSpill::AggregationSpill(const nebula::type::Schema schema,
+                                   const std::vector<size_t>& keys,
+                                   const nebula::surface::eval::Fields& fields)
+  : schema_{ schema }, keys_{ keys }, fields_{ fields }, bytes_{ 0 } {
+  static std::atomic<size_t> sequence{ 0 };
+  const auto id = sequence++;
+  const auto partitions = std::max<size_t>(FLAGS_AGG_SPILL_PARTITIONS, 1);
+  files_.reserve(partitions);
+  for (size_t i = 0; i < partitions; ++i) {
+    files_.push_back(fmt::format("{0}/nebula-agg-{1}-{2}-{3}.run", FLAGS_AGG_SPILL_DIR, getpid(), id, i));
+  }
+}
+
+AggregationSpill::~AggregationSpill() {
+  for (const auto& file : files_) {
+    std::remove(file.c_str());
+  }
+}
+
+void AggregationSpill::add(HashFlat& flat) {
+  // states are kept in accumulators until flushed into rows
+  flat.flush();
+
+  const auto partitions = files_.size();
+  std::vector<std::unique_ptr<FlatBuffer>> runs;
+  runs.reserve(partitions);
+  for (size_t i = 0; i < partitions; ++i) {
+    runs.push_back(std::make_unique<FlatBuffer>(schema_));
+  }
+
+  for (size_t row = 0, size = flat.getRows(); row < size; ++row) {
+    runs.at(flat.hash(row) % partitions)->add(flat.row(row));
+  }
+
+  // append every run to its partition file as [size][bytes]
+  std::string buffer;
+  for (size_t i = 0; i < partitions; ++i) {
+    const auto& run = runs.at(i);
+    if (run->getRows() == 0) {
+      continue;
+    }
+
+    buffer.resize(run->binSize());
+    const size_t size = run->serialize(reinterpret_cast<NByte*>(buffer.data()));
+    std::ofstream os(files_.at(i), std::ios::binary | std::ios::app);
+    os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    os.write(buffer.data(), size);
+    os.flush();
+    N_ENSURE(os.good(), fmt::format("failed to write aggregation run: {0}", files_.at(i)));
+    bytes_ += size + sizeof(size);
+  }
+
+  LOG(INFO) << fmt::format("Spilled {0} aggregated rows, total spilled bytes: {1}", flat.getRows(), bytes_);
+}
+
+// read every run of a partition file written as [size][bytes]
+static void readRuns(const std::string& file,
+                     const nebula::type::Schema& schema,
+                     const std::function<void(std::unique_ptr<FlatBuffer>)>& func) {
+  std::ifstream is(file, std::ios::binary);
+  N_ENSURE(is.good(), fmt::format("failed to open aggregation run: {0}", file));
+  size_t size = 0;
+  while (is.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+    // flat buffer owns the chunk and frees it through the pool
+    auto chunk = static_cast<NByte*>(Pool::getDefault().allocate(size));
+    if (!is.read(reinterpret_cast<char*>(chunk), size)) {
+      Pool::getDefault().free(chunk);
+      throw NException(fmt::format("truncated aggregation run: {0}", file));
+    }
+
+    func(std::make_unique<FlatBuffer>(schema, chunk));
+  }
+
+  // a partial size header is a truncated run too
+  N_ENSURE(is.eof() && is.gcount() == 0, fmt::format("truncated aggregation run: {0}", file));
+}
+
+// rows of merged partitions, every partition is loaded from its file when it is reached.
+// iterating frees a partition when it moves to the next one, random access keeps partitions it touches.
+class PartitionCursor : public nebula::surface::RowCursor {
+public:
+  PartitionCursor(const nebula::type::Schema schema, std::vector<std::string> files, std::vector<size_t> ends)
+    : nebula::surface::RowCursor(ends.empty() ? 0 : ends.back()),
+      schema_{ schema },
+      files_{ std::move(files) },
+      ends_{ std::move(ends) },
+      partitions_(files_.size()),
+      current_{ 0 } {}
+
+  virtual ~PartitionCursor() {
+    for (const auto& file : files_) {
+      std::remove(file.c_str());
+    }
+  }
+
+  virtual const RowData& next() override {
+    if (index_ == ends_.at(current_)) {
+      partitions_.at(current_++) = nullptr;
+    }
+
+    return load(current_).row(index_++ - offset(current_));
+  }
+
+  virtual std::unique_ptr<RowData> item(size_t index) const override {
+    const auto p = std::upper_bound(ends_.begin(), ends_.end(), index) - ends_.begin();
+    return load(p).crow(index - offset(p));
+  }
+
+private:
+  inline size_t offset(size_t p) const {
+    return p == 0 ? 0 : ends_.at(p - 1);
+  }
+
+  FlatBuffer& load(size_t p) const {
+    auto& partition = partitions_.at(p);
+    if (!partition) {
+      readRuns(files_.at(p), schema_, [&partition](std::unique_ptr<FlatBuffer> run) {
+        partition = std::move(run);
+      });
+      N_ENSURE_NOT_NULL(partition, "merged partition should have a run");
+    }
+
+    return *partition;
+  }
+
+  const nebula::type::Schema schema_;
+  const std::vector<std::string> files_;
+  // accumulated rows at the end of every partition
+  const std::vector<size_t> ends_;
+  mutable std::vector<std::unique_ptr<FlatBuffer>> partitions_;
+  size_t current_;
+};
+
+RowCursorPtr AggregationSpill::merge() {
+  // merge runs of one partition at a time and write it back as a single run,
+  // so that only one partition is in memory until the cursor reads them
+  std::vector<std::string> files;
+  std::vector<size_t> ends;
+  size_t total = 0;
+  for (const auto& file : files_) {
+    if (!std::ifstream(file).good()) {
+      continue;
+    }
+
+    auto hf = std::make_unique<HashFlat>(schema_, keys_, fields_);
+    readRuns(file, schema_, [&hf](std::unique_ptr<FlatBuffer> run) {
+      for (size_t row = 0, rows = run->getRows(); row < rows; ++row) {
+        hf->update(run->row(row));
+      }
+    });
+
+    hf->flush();
+    const auto rows = hf->getRows();
+    if (rows == 0) {
+      std::remove(file.c_str());
+      continue;
+    }
+
+    std::string buffer(hf->binSize(), 0);
+    const size_t size = hf->serialize(reinterpret_cast<NByte*>(buffer.data()));
+    hf = nullptr;
+
+    std::ofstream os(file, std::ios::binary | std::ios::trunc);
+    os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    os.write(buffer.data(), size);
+    os.flush();
+    N_ENSURE(os.good(), fmt::format("failed to write aggregation run: {0}", file));
+
+    total += rows;
+    files.push_back(file);
+    ends.push_back(total);
+  }
+
+  // merged files are owned by the cursor from now on
+  files_.clear();
+  return std::make_shared<PartitionCursor>(schema_, std::move(files), std::move(ends));
+}
+
+} // namespace core
+} // namespace execution
+} // namespace nebula
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "memory/keyed/HashFlat.h"
+#include "surface/DataSurface.h"
+#include "surface/eval/ValueEval.h"
+#include "type/Type.h"
+
+/**
+ * Aggregation spill writes an aggregation table out of its memory cap into local disk.
+ * Rows are partitioned by hash of their keys, every spill appends one run per partition,
+ * and runs of a partition are merged back in memory one partition at a time.
+ * Merged partitions are written back and read by the result cursor one partition at a time.
+ */
+namespace nebula {
+namespace execution {
+namespace core {
+
+class AggregationSpill {
+public:
+  AggregationSpill(const nebula::type::Schema,
+                   const std::vector<size_t>&,
+                   const nebula::surface::eval::Fields&);
+  virtual ~AggregationSpill();
+
+  // write all rows of given hash flat as runs of partitions
+  void add(nebula::memory::keyed::HashFlat&);
+
+  // merge runs of each partition into one run, the cursor of all partitions owns the merged files
+  nebula::surface::RowCursorPtr merge();
+
+  // total bytes spilled to disk
+  inline size_t bytes() const {
+    return bytes_;
+  }
+
+private:
+  const nebula::type::Schema schema_;
+  const std::vector<size_t>& keys_;
+  const nebula::surface::eval::Fields& fields_;
+
+  // run file of every partition
+  std::vector<std::string> files_;
+  size_t bytes_;
+};
+
+} // namespace core
+} // namespace execution
+} // namespace nebula
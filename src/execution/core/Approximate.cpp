@@ -0,0 +1,235 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "Approximate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "surface/SchemaRow.h"
+#include "surface/eval/ValueEval.h"
+
+/**
+ * Approximate query by block sampling.
+ */
+namespace nebula {
+namespace execution {
+namespace core {
+
+using nebula::memory::Batch;
+using nebula::surface::IndexType;
+using nebula::surface::RowCursor;
+using nebula::surface::RowCursorPtr;
+using nebula::surface::RowData;
+using nebula::type::Kind;
+using nebula::type::Schema;
+
+// a row forwarding reads to inner row with additive columns scaled by a factor
+class ScaledRowData : public nebula::surface::SchemaRow {
+public:
+  ScaledRowData(const Schema& schema, const std::vector<bool>& scaled, double factor)
+    : SchemaRow(schema), row_{ nullptr }, scaled_{ scaled }, factor_{ factor } {}
+  ScaledRowData(const Schema& schema, const std::vector<bool>& scaled, double factor, std::unique_ptr<RowData> inner)
+    : SchemaRow(schema), inner_{ std::move(inner) }, row_{ inner_.get() }, scaled_{ scaled }, factor_{ factor } {}
+
+public:
+#define FORWARD_READ(T, F)          \
+  T F(IndexType i) const override { \
+    return row_->F(i);              \
+  }
+
+  FORWARD_READ(bool, isNull)
+  FORWARD_READ(bool, readBool)
+  FORWARD_READ(int8_t, readByte)
+  FORWARD_READ(int16_t, readShort)
+  FORWARD_READ(int32_t, readInt)
+  FORWARD_READ(float, readFloat)
+  FORWARD_READ(int128_t, readInt128)
+  FORWARD_READ(std::string_view, readString)
+  FORWARD_READ(std::unique_ptr<nebula::surface::ListData>, readList)
+  FORWARD_READ(std::unique_ptr<nebula::surface::MapData>, readMap)
+
+#undef FORWARD_READ
+
+  int64_t readLong(IndexType i) const override {
+    auto v = row_->readLong(i);
+    return scaled_.at(i) ? std::llround(v * factor_) : v;
+  }
+
+  double readDouble(IndexType i) const override {
+    auto v = row_->readDouble(i);
+    return scaled_.at(i) ? v * factor_ : v;
+  }
+
+public:
+  inline void set(const RowData& row) {
+    row_ = &row;
+  }
+
+private:
+  std::unique_ptr<RowData> inner_;
+  const RowData* row_;
+  const std::vector<bool>& scaled_;
+  const double factor_;
+};
+
+class ScaledRowCursor : public RowCursor {
+public:
+  ScaledRowCursor(RowCursorPtr inner, Schema schema, std::vector<bool> scaled, double factor)
+    : RowCursor(inner->size()),
+      inner_{ inner },
+      schema_{ schema },
+      scaled_{ std::move(scaled) },
+      factor_{ factor },
+      row_{ schema_, scaled_, factor_ } {}
+  virtual ~ScaledRowCursor() = default;
+
+  virtual const RowData& next() override {
+    ++index_;
+    row_.set(inner_->next());
+    return row_;
+  }
+
+  virtual std::unique_ptr<RowData> item(size_t i) const override {
+    return std::make_unique<ScaledRowData>(schema_, scaled_, factor_, inner_->item(i));
+  }
+
+private:
+  RowCursorPtr inner_;
+  Schema schema_;
+  std::vector<bool> scaled_;
+  double factor_;
+  ScaledRowData row_;
+};
+
+Approximate::Approximate(const BlockPhase& phase, const Schema schema)
+  : fraction_{ phase.fraction() },
+    schema_{ schema },
+    blocks_{ 0 },
+    population_{ 0 },
+    rows_{ 0 } {
+  // only SUM and COUNT add up across blocks, other aggregations are not scaled
+  auto additive = [](std::string_view sign) {
+    auto starts = [&sign](std::string_view name) {
+      return sign.size() > name.size() && sign.substr(0, name.size()) == name && sign[name.size()] == '(';
+    };
+    return starts("SUM") || starts("COUNT");
+  };
+
+  const auto& fields = phase.fields();
+  for (size_t i = 0, size = fields.size(); i < size; ++i) {
+    const auto kind = schema_->childType(i)->k();
+    if (additive(fields.at(i)->signature()) && (kind == Kind::BIGINT || kind == Kind::DOUBLE)) {
+      columns_.push_back(i);
+      kinds_.push_back(kind);
+    }
+  }
+}
+
+std::vector<Batch*> Approximate::sample(const std::vector<Batch*>& blocks) {
+  blocks_ = blocks.size();
+  population_ = 0;
+  for (auto block : blocks) {
+    population_ += block->getRows();
+  }
+
+  // exact query or the fraction covers every block
+  const size_t n = std::max<size_t>(std::ceil(fraction_ * blocks_), 1);
+  if (fraction_ <= 0 || fraction_ >= 1 || n >= blocks_) {
+    return blocks;
+  }
+
+  // partial Fisher-Yates shuffle to pick n blocks
+  static thread_local std::mt19937_64 rng{ std::random_device{}() };
+  std::vector<Batch*> picks{ blocks };
+  for (size_t i = 0; i < n; ++i) {
+    std::uniform_int_distribution<size_t> dist(i, blocks_ - 1);
+    std::swap(picks[i], picks[dist(rng)]);
+  }
+
+  picks.resize(n);
+  return picks;
+}
+
+void Approximate::observe(const Batch& block, const RowCursorPtr result) {
+  std::vector<double> totals(columns_.size(), 0);
+  for (size_t r = 0, size = result->size(); r < size; ++r) {
+    auto row = result->item(r);
+    for (size_t c = 0; c < columns_.size(); ++c) {
+      const auto column = columns_.at(c);
+      if (row->isNull(column)) {
+        continue;
+      }
+
+      totals[c] += kinds_.at(c) == Kind::BIGINT ? row->readLong(column) : row->readDouble(column);
+    }
+  }
+
+  rows_ += block.getRows();
+  sizes_.push_back(block.getRows());
+  totals_.push_back(std::move(totals));
+}
+
+RowCursorPtr Approximate::scale(RowCursorPtr result, Estimates& estimates) const {
+  const auto n = sizes_.size();
+  const auto N = static_cast<double>(blocks_);
+  for (size_t c = 0; c < columns_.size(); ++c) {
+    double sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+      sum += totals_.at(i).at(c);
+    }
+
+    // ratio estimator: total = X * sum(t) / sum(x)
+    // var = N^2 * (1 - n/N) / n * sum((t - R * x)^2) / (n - 1)
+    const double ratio = rows_ == 0 ? 0 : sum / rows_;
+    const double total = ratio * population_;
+    double variance = 0;
+    if (n < blocks_) {
+      if (n < 2) {
+        // no spread to learn from a single block, report the estimate itself as its deviation
+        variance = total * total;
+      } else {
+        double ss = 0;
+        for (size_t i = 0; i < n; ++i) {
+          const double e = totals_.at(i).at(c) - ratio * sizes_.at(i);
+          ss += e * e;
+        }
+
+        variance = N * N * (1 - n / N) / n * ss / (n - 1);
+      }
+    }
+
+    estimates.add(schema_->childType(columns_.at(c))->name(), { total, variance });
+  }
+
+  // no scaling needed if every block is executed
+  if (n >= blocks_ || columns_.empty()) {
+    return result;
+  }
+
+  std::vector<bool> scaled(schema_->size(), false);
+  for (auto c : columns_) {
+    scaled[c] = true;
+  }
+
+  return std::make_shared<ScaledRowCursor>(result, schema_, std::move(scaled), factor());
+}
+
+} // namespace core
+} // namespace execution
+} // namespace nebula
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "execution/ExecutionPlan.h"
+#include "memory/Batch.h"
+#include "surface/DataSurface.h"
+#include "type/Type.h"
+
+/**
+ * Approximate executes an aggregation query on a random fraction of the blocks it hits.
+ * Additive columns (SUM, COUNT) of the result are scaled up by ratio of total rows to sampled rows,
+ * and variance of every scaled total is estimated from totals of the sampled blocks (ratio estimator).
+ */
+namespace nebula {
+namespace execution {
+namespace core {
+
+class Approximate {
+public:
+  Approximate(const BlockPhase&, const nebula::type::Schema);
+  virtual ~Approximate() = default;
+
+  // randomly pick fraction of given blocks, at least one block is picked
+  std::vector<nebula::memory::Batch*> sample(const std::vector<nebula::memory::Batch*>&);
+
+  // record totals of additive columns in result of a sampled block, call it before results are merged
+  void observe(const nebula::memory::Batch&, const nebula::surface::RowCursorPtr);
+
+  // scale additive columns of the merged result and report estimated totals
+  nebula::surface::RowCursorPtr scale(nebula::surface::RowCursorPtr, Estimates&) const;
+
+  // ratio of total rows to sampled rows
+  inline double factor() const {
+    return rows_ == 0 ? 1 : static_cast<double>(population_) / rows_;
+  }
+
+private:
+  const double fraction_;
+  const nebula::type::Schema schema_;
+
+  // additive columns and their kinds
+  std::vector<size_t> columns_;
+  std::vector<nebula::type::Kind> kinds_;
+
+  // number of blocks and rows hit by the query
+  size_t blocks_;
+  size_t population_;
+
+  // rows and column totals of every observed block
+  size_t rows_;
+  std::vector<size_t> sizes_;
+  std::vector<std::vector<double>> totals_;
+};
+
+} // namespace core
+} // namespace execution
+} // namespace nebula
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "BlockCache.h"
+
+#include <gflags/gflags.h>
+
+#include "memory/keyed/FlatRowCursor.h"
+#include "memory/serde/Histogram.h"
+#include "meta/Table.h"
+
+DEFINE_uint64(BLOCK_RESULT_CACHE_MB, 512, "memory budget in MB of block results cached on a node, 0 to disable");
+
+namespace nebula {
+namespace execution {
+namespace core {
+
+using nebula::memory::Batch;
+using nebula::memory::keyed::FlatBuffer;
+using nebula::memory::keyed::FlatRowCursor;
+using nebula::memory::serde::IntHistogram;
+using nebula::meta::Table;
+using nebula::surface::RowCursorPtr;
+
+BlockCache::BlockCache() : BlockCache(FLAGS_BLOCK_RESULT_CACHE_MB << 20) {}
+
+bool BlockCache::within(const Batch& block, const QueryWindow& range) {
+  if (!block.sealed() || range.first > range.second) {
+    return false;
+  }
+
+  // time histogram has the actual time range of rows rather than the range of the block signature
+  auto times = block.histogram<IntHistogram>(Table::TIME_COLUMN);
+  return times.count > 0
+         && times.min() >= 0
+         && static_cast<size_t>(times.min()) >= range.first
+         && static_cast<size_t>(times.max()) <= range.second;
+}
+
+std::string BlockCache::key(const Batch* block, const std::string& plan) {
+  const auto generation = block->generation();
+  std::string key(reinterpret_cast<const char*>(&generation), sizeof(generation));
+  key.append(plan);
+  return key;
+}
+
+RowCursorPtr BlockCache::get(const Batch* block, const std::string& plan) {
+  std::shared_ptr<std::vector<NByte>> data;
+  nebula::type::Schema schema;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr = cache_.find(key(block, plan));
+    if (itr == cache_.end()) {
+      ++misses_;
+      return nullptr;
+    }
+
+    data = itr->second.data;
+    schema = itr->second.schema;
+  }
+
+  ++hits_;
+  // every hit reads the shared data through its own cursor
+  return std::make_shared<FlatRowCursor>(std::make_unique<FlatBuffer>(schema, data->data(), data));
+}
+
+void BlockCache::put(const Batch* block, const std::string& plan, const FlatBuffer& result) {
+  auto k = key(block, plan);
+  const size_t size = result.binSize();
+  const size_t bytes = k.size() + size;
+  if (bytes > budget_) {
+    return;
+  }
+
+  auto data = std::make_shared<std::vector<NByte>>(size);
+  result.serialize(data->data());
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (cache_.exists(k)) {
+    erase(k);
+  }
+
+  blocks_[block->generation()].insert(k);
+  cache_.set(k, Entry{ block->generation(), bytes, result.schema(), std::move(data) });
+  bytes_ += bytes;
+
+  // evict least recently used results
+  while (bytes_ > budget_) {
+    const auto evict = cache_.rbegin()->first;
+    erase(evict);
+  }
+}
+
+void BlockCache::invalidate(const Batch* block) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr = blocks_.find(block->generation());
+  if (itr == blocks_.end()) {
+    return;
+  }
+
+  for (const auto& k : itr->second) {
+    auto entry = cache_.find(k);
+    if (entry != cache_.end()) {
+      bytes_ -= entry->second.bytes;
+      cache_.erase(k);
+    }
+  }
+
+  blocks_.erase(itr);
+}
+
+void BlockCache::erase(const std::string& k) {
+  auto itr = cache_.find(k);
+  if (itr == cache_.end()) {
+    return;
+  }
+
+  bytes_ -= itr->second.bytes;
+  auto block = blocks_.find(itr->second.block);
+  if (block != blocks_.end()) {
+    block->second.erase(k);
+    if (block->second.empty()) {
+      blocks_.erase(block);
+    }
+  }
+
+  cache_.erase(k);
+}
+
+} // namespace core
+} // namespace execution
+} // namespace nebula
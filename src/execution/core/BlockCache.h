@@ -0,0 +1,119 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <folly/container/EvictingCacheMap.h>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "execution/ExecutionPlan.h"
+#include "memory/Batch.h"
+#include "memory/keyed/FlatBuffer.h"
+#include "surface/DataSurface.h"
+
+/**
+ * A LRU cache of partial results of sealed blocks on a node within a memory budget.
+ * A result is keyed by the block and the plan with its time comparisons left out,
+ * so it is reused by queries of different windows as long as the block is fully inside them.
+ * Results of a block are dropped when the block leaves the node.
+ */
+namespace nebula {
+namespace execution {
+namespace core {
+
+class BlockCache {
+public:
+  // memory budget is given by flag BLOCK_RESULT_CACHE_MB
+  BlockCache();
+  explicit BlockCache(size_t budget) : budget_{ budget }, bytes_{ 0 }, cache_{ 0 } {}
+  BlockCache(BlockCache&) = delete;
+  BlockCache(BlockCache&&) = delete;
+  virtual ~BlockCache() = default;
+
+  static BlockCache& singleton() {
+    static BlockCache cache;
+    return cache;
+  }
+
+public:
+  inline bool enabled() const {
+    return budget_ > 0;
+  }
+
+  // a sealed block whose rows are all in the time range has the same result for all plans of a cache key
+  static bool within(const nebula::memory::Batch&, const QueryWindow&);
+
+  // a new cursor of cached result of given block for the plan key, nullptr if not cached
+  nebula::surface::RowCursorPtr get(const nebula::memory::Batch*, const std::string&);
+
+  // cache result of given block for the plan key, least recently used results are evicted to keep total size in budget
+  void put(const nebula::memory::Batch*, const std::string&, const nebula::memory::keyed::FlatBuffer&);
+
+  // drop all results of given block
+  void invalidate(const nebula::memory::Batch*);
+
+  inline size_t hits() const {
+    return hits_;
+  }
+
+  inline size_t misses() const {
+    return misses_;
+  }
+
+  inline size_t bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+  }
+
+  inline size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cache_.size();
+  }
+
+private:
+  struct Entry {
+    // generation of the block
+    uint64_t block;
+    size_t bytes;
+    nebula::type::Schema schema;
+    // serialized flat buffer shared by all cursors reading it
+    std::shared_ptr<std::vector<NByte>> data;
+  };
+
+  // keyed by generation of the block rather than its address which may be reused by a later block
+  static std::string key(const nebula::memory::Batch*, const std::string&);
+
+  // remove an entry along with its index by block, caller holds the lock
+  void erase(const std::string&);
+
+  const size_t budget_;
+  size_t bytes_;
+  mutable std::mutex mutex_;
+  // evicting by memory budget rather than number of entries
+  folly::EvictingCacheMap<std::string, Entry> cache_;
+  // keys of cached results of every block
+  std::unordered_map<uint64_t, std::unordered_set<std::string>> blocks_;
+  std::atomic<size_t> hits_{ 0 };
+  std::atomic<size_t> misses_{ 0 };
+};
+
+} // namespace core
+} // namespace execution
+} // namespace nebula
@@ -16,12 +16,24 @@
 
 #include "BlockExecutor.h"
 
+#include <gflags/gflags.h>
+#include <random>
+#include <regex>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "AggregationMerge.h"
+#include "BlockCache.h"
+#include "SelectionCache.h"
 #include "memory/keyed/HashFlat.h"
+#include "meta/Table.h"
+#include "surface/SchemaRow.h"
 #include "surface/eval/UDF.h"
 
+DEFINE_uint64(DIRECT_AGG_SLOTS, 65536,
+              "max slots of direct address table used by block aggregation "
+              "when all keys are integers of small value range in the block, 0 to disable it");
+
 /**
  * Nebula runtime / online meta data.
  */
@@ -29,17 +41,135 @@ namespace nebula {
 namespace execution {
 namespace core {
 
+using nebula::memory::Batch;
+using nebula::memory::keyed::DirectKey;
 using nebula::memory::keyed::HashFlat;
+using nebula::memory::serde::IntHistogram;
+using nebula::meta::Table;
+using nebula::surface::IndexType;
+using nebula::surface::ListData;
+using nebula::surface::MapData;
 using nebula::surface::RowCursorPtr;
+using nebula::surface::SchemaRow;
 using nebula::surface::eval::EvalContext;
 using nebula::type::Kind;
+using nebula::type::Schema;
+
+// a single row of string values such as sketch registers served from block metadata
+class MetaRow : public SchemaRow {
+public:
+  MetaRow(const Schema& schema, std::vector<std::string_view> values)
+    : SchemaRow(schema), values_{ std::move(values) } {}
+  virtual ~MetaRow() = default;
+
+#define NOT_IMPL_FUNC(TYPE, NAME)       \
+  TYPE NAME(IndexType) const override { \
+    throw NException("not supported");  \
+  }
+
+  NOT_IMPL_FUNC(bool, readBool)
+  NOT_IMPL_FUNC(int8_t, readByte)
+  NOT_IMPL_FUNC(int16_t, readShort)
+  NOT_IMPL_FUNC(int32_t, readInt)
+  NOT_IMPL_FUNC(int64_t, readLong)
+  NOT_IMPL_FUNC(float, readFloat)
+  NOT_IMPL_FUNC(double, readDouble)
+  NOT_IMPL_FUNC(int128_t, readInt128)
+  NOT_IMPL_FUNC(std::unique_ptr<ListData>, readList)
+  NOT_IMPL_FUNC(std::unique_ptr<MapData>, readMap)
+
+#undef NOT_IMPL_FUNC
+
+  bool isNull(IndexType) const override {
+    return false;
+  }
+
+  std::string_view readString(IndexType index) const override {
+    return values_.at(index);
+  }
+
+private:
+  std::vector<std::string_view> values_;
+};
+
+// time window rows of a block are checked against, nullptr if all rows of the block are in it
+static const QueryWindow* bound(const Batch& data, const QueryWindow* window) {
+  return window == nullptr || BlockCache::within(data, *window) ? nullptr : window;
+}
+
+// plan direct address keys when every key is a boolean or integer column with small value range
+// in given block according to its histograms, return empty if direct address is not applicable
+static std::vector<DirectKey> directKeys(const nebula::execution::BlockPhase& plan, const Batch& data) {
+  const auto& keys = plan.keys();
+  const auto& fields = plan.fields();
+  const auto& schema = plan.outputSchema();
+  const uint64_t limit = FLAGS_DIRECT_AGG_SLOTS;
+  std::vector<DirectKey> direct;
+  direct.reserve(keys.size());
+  uint64_t total = 1;
+  for (auto k : keys) {
+    // key has to be a column reference
+    const auto& sign = fields.at(k)->signature();
+    if (sign.size() < 3 || sign.substr(0, 2) != "F:") {
+      return {};
+    }
+
+    DirectKey key{ k, 0, 0 };
+    switch (schema->childType(k)->k()) {
+    case Kind::BOOLEAN: {
+      key.slots = 3;
+      break;
+    }
+    case Kind::TINYINT:
+    case Kind::SMALLINT:
+    case Kind::INTEGER:
+    case Kind::BIGINT: {
+      auto histo = data.histogram<IntHistogram>(std::string(sign.substr(2)));
+      if (histo.count == 0) {
+        key.slots = 1;
+        break;
+      }
+
+      auto range = static_cast<uint64_t>(histo.max()) - static_cast<uint64_t>(histo.min());
+      if (range >= limit) {
+        return {};
+      }
+
+      key.base = histo.min();
+      key.slots = range + 2;
+      break;
+    }
+    default:
+      return {};
+    }
+
+    total *= key.slots;
+    if (total > limit) {
+      return {};
+    }
+
+    direct.push_back(key);
+  }
+
+  return direct;
+}
+
+// rows scanned between two polls of query cancellation
+static constexpr size_t CANCEL_POLL_ROWS = 4096;
 
-RowCursorPtr compute(const nebula::memory::Batch& data, const nebula::execution::BlockPhase& plan) {
+static inline void poll(const nebula::common::Cancellation* cancel, size_t row) {
+  if (cancel != nullptr && row % CANCEL_POLL_ROWS == 0 && cancel->cancelled()) {
+    throw NException("query cancelled");
+  }
+}
+
+RowCursorPtr compute(const nebula::memory::Batch& data, const nebula::execution::BlockPhase& plan, size_t quota, const std::string& selection,
+                     const nebula::common::Cancellation* cancel, const QueryWindow* window) {
   if (plan.hasAggregation()) {
-    return std::make_shared<BlockExecutor>(data, plan);
+    return std::make_shared<BlockExecutor>(data, plan, selection, cancel, window);
   }
 
-  return std::make_shared<SamplesExecutor>(data, plan);
+  return std::make_shared<SamplesExecutor>(data, plan, quota, cancel, window);
 }
 
 void BlockExecutor::compute() {
@@ -52,6 +182,23 @@ void BlockExecutor::compute() {
   EvalContext ctx(plan_.cacheEval());
   ComputedRow cr(plan_.outputSchema(), ctx, fields);
   result_ = std::make_unique<HashFlat>(plan_.outputSchema(), plan_.keys(), fields);
+  window_ = bound(data_, window_);
+
+  // a query of distinct sketches only may be answered by block metadata without scan
+  if (computeByMeta()) {
+    result_->flush();
+    index_ = 0;
+    size_ = result_->getRows();
+    return;
+  }
+
+  // group rows by direct address table if keys allow, it is converted back to hash index at the end
+  if (FLAGS_DIRECT_AGG_SLOTS > 0) {
+    auto keys = directKeys(plan_, data_);
+    if (!keys.empty() || plan_.keys().empty()) {
+      result_->direct(keys);
+    }
+  }
 
   // we want to evaluate here for the whole block before we go to iterations of computing
   // by leveraging its metadata including histogram, bloom filter, dictionary etc.
@@ -64,34 +211,124 @@ void BlockExecutor::compute() {
   // and these methods will be used in each individual ValueEval and give result like above.
   // So we need an special operator to be implemented to have this function
 
-  for (size_t i = 0, size = data_.getRows(); i < size; ++i) {
-    ctx.reset(accessor->seek(i));
+  // rows selected by the same filter on this block before are scanned without evaluating it,
+  // selected rows don't depend on the window only if all rows are in it
+  auto& selections = SelectionCache::singleton();
+  const auto record = !selection_.empty() && window_ == nullptr;
+  auto selected = record ? selections.get(&data_, selection_) : nullptr;
+  if (selected) {
+    size_t n = 0;
+    for (auto i : *selected) {
+      poll(cancel_, n++);
+      ctx.reset(accessor->seek(i));
+      result_->update(cr);
+    }
+  } else {
+    Roaring rows;
+    for (size_t i = 0, size = data_.getRows(); i < size; ++i) {
+      poll(cancel_, i);
+      const auto& row = accessor->seek(i);
+      if (window_ && !inWindow(*window_, row.readLong(Table::TIME_COLUMN))) {
+        continue;
+      }
+
+      ctx.reset(row);
+
+      // if not fullfil the condition
+      // ignore valid here - if system can't determine how to act on NULL value
+      // we don't know how to make decision here too
+      bool valid = true;
+      if (!ctx.eval<bool>(filter, valid)) {
+        continue;
+      }
+
+      if (record) {
+        rows.add(static_cast<uint32_t>(i));
+      }
 
-    // if not fullfil the condition
-    // ignore valid here - if system can't determine how to act on NULL value
-    // we don't know how to make decision here too
-    bool valid = true;
-    if (!ctx.eval<bool>(filter, valid)) {
-      continue;
+      // flat compute every new value of each field and set to corresponding column in flat
+      result_->update(cr);
     }
 
-    // flat compute every new value of each field and set to corresponding column in flat
-    result_->update(cr);
+    if (record) {
+      selections.put(&data_, selection_, std::move(rows));
+    }
   }
 
+  // merging with other blocks goes through hash lookup, and rows carry final states
+  result_->rehash();
+  result_->flush();
+
   // after the compute flat should contain all the data we need.
   index_ = 0;
   size_ = result_->getRows();
 }
 
+bool BlockExecutor::computeByMeta() {
+  // only work for aggregation without keys
+  if (!plan_.keys().empty()) {
+    return false;
+  }
+
+  static const std::regex sketch("APPROX_DISTINCT\\(F:(\\w+)\\)");
+  const auto& fields = plan_.fields();
+  std::vector<std::string_view> values;
+  values.reserve(fields.size());
+  for (const auto& field : fields) {
+    std::smatch matches;
+    std::string sign(field->signature());
+    if (!std::regex_match(sign, matches, sketch)) {
+      return false;
+    }
+
+    auto hll = data_.sketch(matches[1].str());
+    if (hll == nullptr) {
+      return false;
+    }
+
+    values.push_back(hll->registers());
+  }
+
+  // sketches cover all rows of the block, so the filter has to select all of them
+  if (plan_.filter().signature() != "C:true" || window_ != nullptr) {
+    return false;
+  }
+
+  MetaRow row(plan_.outputSchema(), std::move(values));
+  result_->update(row);
+  return true;
+}
+
 void SamplesExecutor::compute() {
   // build context and computed row associated with this context
-  samples_ = std::make_unique<ReferenceRows>(plan_, data_);
+  samples_ = std::make_unique<ReferenceRows>(plan_, data_, bound(data_, window_));
 
-  for (size_t i = 0, size = data_.getRows(); i < size; ++i) {
-    // if we have enough samples, just return
-    if (samples_->check(i) >= plan_.top()) {
-      break;
+  if (plan_.sampleMode() == nebula::execution::SampleMode::FIRST || quota_ == 0) {
+    for (size_t i = 0, size = data_.getRows(); i < size; ++i) {
+      poll(cancel_, i);
+      // if we have enough samples, just return
+      if (samples_->check(i) >= plan_.top()) {
+        break;
+      }
+    }
+  } else {
+    // visit rows in random order by a lazy Fisher-Yates shuffle until the quota is met,
+    // only swapped positions are materialized so filter is evaluated on candidates only.
+    static thread_local std::mt19937_64 rng{ std::random_device{}() };
+    std::unordered_map<size_t, size_t> swaps;
+    const auto at = [&swaps](size_t i) {
+      auto itr = swaps.find(i);
+      return itr == swaps.end() ? i : itr->second;
+    };
+
+    for (size_t i = 0, size = data_.getRows(); i < size; ++i) {
+      poll(cancel_, i);
+      auto j = std::uniform_int_distribution<size_t>(i, size - 1)(rng);
+      auto position = at(j);
+      swaps[j] = at(i);
+      if (samples_->check(position) >= quota_) {
+        break;
+      }
     }
   }
 
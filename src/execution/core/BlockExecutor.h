@@ -18,6 +18,7 @@
 
 #include "ComputedRow.h"
 #include "ReferenceRows.h"
+#include "common/Cancellation.h"
 #include "execution/ExecutionPlan.h"
 #include "surface/eval/ValueEval.h"
 #include "memory/Batch.h"
@@ -38,8 +39,20 @@ namespace core {
 class BlockExecutor : public nebula::surface::RowCursor {
 
 public:
-  BlockExecutor(const nebula::memory::Batch& data, const nebula::execution::BlockPhase& plan)
-    : nebula::surface::RowCursor(0), data_{ data }, plan_{ plan } {
+  // selection is key of the filter in selection cache, empty to evaluate the filter on every row.
+  // scan throws once the query is cancelled, it is polled every chunk of rows.
+  // rows out of the time window are dropped, nullptr for all rows.
+  BlockExecutor(const nebula::memory::Batch& data,
+                const nebula::execution::BlockPhase& plan,
+                std::string selection = "",
+                const nebula::common::Cancellation* cancel = nullptr,
+                const nebula::execution::QueryWindow* window = nullptr)
+    : nebula::surface::RowCursor(0),
+      data_{ data },
+      plan_{ plan },
+      selection_{ std::move(selection) },
+      cancel_{ cancel },
+      window_{ window } {
     // compute will finish the compute and fill the data state in
     this->compute();
   }
@@ -53,6 +66,10 @@ public:
     return result_->crow(index);
   }
 
+  inline const nebula::memory::keyed::FlatBuffer& result() const {
+    return *result_;
+  }
+
   inline std::unique_ptr<nebula::memory::keyed::FlatBuffer> takeResult() {
     auto temp = std::move(result_);
     result_ = nullptr;
@@ -62,16 +79,27 @@ public:
 private:
   void compute();
 
+  // answer the block from its metadata such as distinct sketches if possible
+  bool computeByMeta();
+
 private:
   const nebula::memory::Batch& data_;
   const nebula::execution::BlockPhase& plan_;
+  const std::string selection_;
+  const nebula::common::Cancellation* cancel_;
+  const nebula::execution::QueryWindow* window_;
   std::unique_ptr<nebula::memory::keyed::HashFlat> result_;
 };
 
 class SamplesExecutor : public nebula::surface::RowCursor {
 public:
-  SamplesExecutor(const nebula::memory::Batch& data, const nebula::execution::BlockPhase& plan)
-    : nebula::surface::RowCursor(0), data_{ data }, plan_{ plan } {
+  // quota is number of samples to draw from this block in random sampling modes, 0 for top of the plan
+  SamplesExecutor(const nebula::memory::Batch& data,
+                  const nebula::execution::BlockPhase& plan,
+                  size_t quota = 0,
+                  const nebula::common::Cancellation* cancel = nullptr,
+                  const nebula::execution::QueryWindow* window = nullptr)
+    : nebula::surface::RowCursor(0), data_{ data }, plan_{ plan }, quota_{ quota }, cancel_{ cancel }, window_{ window } {
     // compute will finish the compute and fill the data state in
     this->compute();
   }
@@ -92,10 +120,18 @@ private:
 private:
   const nebula::memory::Batch& data_;
   const nebula::execution::BlockPhase& plan_;
+  const size_t quota_;
+  const nebula::common::Cancellation* cancel_;
+  const nebula::execution::QueryWindow* window_;
   std::unique_ptr<ReferenceRows> samples_;
 };
 
-nebula::surface::RowCursorPtr compute(const nebula::memory::Batch&, const nebula::execution::BlockPhase&);
+// compute a plan on a block, quota is number of samples for random sampling modes,
+// selection is key of the filter in selection cache for aggregation, see BlockExecutor.
+// window is the time window of the plan bound at run time, nullptr for all rows.
+nebula::surface::RowCursorPtr compute(const nebula::memory::Batch&, const nebula::execution::BlockPhase&, size_t = 0, const std::string& = "",
+                                      const nebula::common::Cancellation* = nullptr,
+                                      const nebula::execution::QueryWindow* = nullptr);
 
 } // namespace core
 } // namespace execution
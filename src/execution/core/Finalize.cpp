@@ -45,7 +45,8 @@ using nebula::type::Kind;
 using nebula::type::Schema;
 
 // transformers to be executed for each column if it needs a transformer
-using TransformerVector = std::vector<std::function<void(const int128_t& v, void* t)>>;
+// it reads store value of the column from given row and writes its native value into target
+using TransformerVector = std::vector<std::function<void(const RowData&, IndexType, void*)>>;
 
 class ForwardRowData : public nebula::surface::SchemaRow {
 public:
@@ -72,7 +73,6 @@ public:
     return row_->isNull(i);
   }
 
-  // TODO(cao): only support int128 for now
   // TOOD(cao): flatrow supports string key only, should support int key too
 #define DISPATCH_TRANSFORM_TYPE(T, F)      \
   T F(IndexType i) const override {        \
@@ -83,9 +83,8 @@ public:
         LOG(INFO) << "cache hit: " << key; \
         return values_.F(key);             \
       }                                    \
-      auto i128 = row_->readInt128(i);     \
       T v;                                 \
-      transform(i128, &v);                 \
+      transform(*row_, i, &v);             \
       values_.write(key, v);               \
       return v;                            \
     }                                      \
@@ -173,15 +172,37 @@ private:
       transformers_.push_back({});
 
       if (different) {
+        // sketch stores such as distinct registers or digest are strings finalized into a number
+        if (iType == Kind::VARCHAR) {
+#define DISPATCH_TYPE_FROM_STRING(K)                                                                       \
+  case Kind::K: {                                                                                          \
+    transformers_[i] = [&udaf = static_cast<UDAF<Kind::K, Kind::VARCHAR>&>(*fields_.at(i))](               \
+                         const RowData& row, IndexType index, void* t) {                                   \
+      *static_cast<nebula::type::TypeTraits<Kind::K>::CppType*>(t) = udaf.finalize(row.readString(index)); \
+    };                                                                                                     \
+    break;                                                                                                 \
+  }
+
+          switch (oType) {
+            DISPATCH_TYPE_FROM_STRING(BIGINT)
+            DISPATCH_TYPE_FROM_STRING(DOUBLE)
+          default:
+            throw NException(fmt::format("type {0} not supported.", nebula::type::TypeBase::kname(oType)));
+          }
+#undef DISPATCH_TYPE_FROM_STRING
+          continue;
+        }
+
         N_ENSURE_EQ(iType, Kind::INT128, "support transform from int128 to other types only");
         // TODO(cao): ideally this should be a entry point for ValueEval - the base for all expressions
         // However, so far I don't see any cases more than UDAF could have this, so jump directly to it for now
-#define DISPATCH_TYPE_FROM_I128(K)                                                                                        \
-  case Kind::K: {                                                                                                         \
-    transformers_[i] = [& udaf = static_cast<UDAF<Kind::K, Kind::INT128>&>(*fields_.at(i))](const int128_t& v, void* t) { \
-      *static_cast<nebula::type::TypeTraits<Kind::K>::CppType*>(t) = udaf.finalize(v);                                    \
-    };                                                                                                                    \
-    break;                                                                                                                \
+#define DISPATCH_TYPE_FROM_I128(K)                                                                         \
+  case Kind::K: {                                                                                          \
+    transformers_[i] = [&udaf = static_cast<UDAF<Kind::K, Kind::INT128>&>(*fields_.at(i))](                \
+                         const RowData& row, IndexType index, void* t) {                                   \
+      *static_cast<nebula::type::TypeTraits<Kind::K>::CppType*>(t) = udaf.finalize(row.readInt128(index)); \
+    };                                                                                                     \
+    break;                                                                                                 \
   }
 
         switch (oType) {
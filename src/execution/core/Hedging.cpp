@@ -0,0 +1,149 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "Hedging.h"
+
+#include <algorithm>
+
+/**
+ * Implement hedging routes and latency tracking.
+ */
+namespace nebula {
+namespace execution {
+namespace core {
+
+using nebula::meta::NNode;
+
+void Latency::record(const std::string& node, size_t ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& samples = samples_[node];
+  samples.push_back(ms);
+  if (samples.size() > window_) {
+    samples.pop_front();
+  }
+}
+
+size_t Latency::percentile(const std::string& node, double p, size_t min) const {
+  std::vector<size_t> values;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr = samples_.find(node);
+    if (itr == samples_.end() || itr->second.size() < std::max<size_t>(min, 1)) {
+      return 0;
+    }
+
+    values.assign(itr->second.begin(), itr->second.end());
+  }
+
+  auto nth = values.begin() + std::min<size_t>(values.size() - 1, p * values.size());
+  std::nth_element(values.begin(), nth, values.end());
+  return *nth;
+}
+
+Routes Routes::make(
+  const std::vector<NNode>& nodes,
+  const std::unordered_map<std::string, std::vector<std::pair<NNode, size_t>>>& holders) {
+  const auto size = nodes.size();
+  Routes routes;
+  routes.skip.resize(size, false);
+  routes.specs.resize(size);
+  routes.blocks.resize(size, 0);
+  routes.hedges.resize(size);
+
+  std::unordered_map<std::string, size_t> index;
+  for (size_t i = 0; i < size; ++i) {
+    index.emplace(nodes[i].toString(), i);
+  }
+
+  // holders of each spec among the given nodes with their number of blocks
+  std::vector<std::string> names;
+  std::unordered_map<std::string, std::vector<std::pair<size_t, size_t>>> candidates;
+  std::vector<bool> holds(size, false);
+  for (const auto& h : holders) {
+    std::vector<std::pair<size_t, size_t>> list;
+    for (const auto& n : h.second) {
+      auto itr = index.find(n.first.toString());
+      if (itr != index.end()) {
+        list.emplace_back(itr->second, n.second);
+        holds[itr->second] = true;
+      }
+    }
+
+    if (!list.empty()) {
+      names.push_back(h.first);
+      candidates.emplace(h.first, std::move(list));
+    }
+  }
+
+  // assign specs of single holder first so that replicated specs go to the least loaded holders
+  std::sort(names.begin(), names.end(), [&candidates](const std::string& a, const std::string& b) {
+    auto ca = candidates.at(a).size();
+    auto cb = candidates.at(b).size();
+    return ca == cb ? a < b : ca < cb;
+  });
+
+  for (const auto& name : names) {
+    const auto& list = candidates.at(name);
+    auto owner = list.front();
+    for (const auto& c : list) {
+      if (routes.blocks[c.first] < routes.blocks[owner.first]) {
+        owner = c;
+      }
+    }
+
+    routes.scoped = routes.scoped || list.size() > 1;
+    routes.specs[owner.first].push_back(name);
+    routes.blocks[owner.first] += owner.second;
+  }
+
+  // hedge every spec of a node to its least used replica, a node is hedged only if all its specs have one
+  std::vector<size_t> used(size, 0);
+  for (size_t i = 0; i < size; ++i) {
+    routes.skip[i] = holds[i] && routes.specs[i].empty();
+
+    std::unordered_map<size_t, std::vector<std::string>> targets;
+    auto covered = !routes.specs[i].empty();
+    for (const auto& spec : routes.specs[i]) {
+      auto target = size;
+      for (const auto& c : candidates.at(spec)) {
+        if (c.first != i && (target == size || used[c.first] < used[target])) {
+          target = c.first;
+        }
+      }
+
+      if (target == size) {
+        covered = false;
+        break;
+      }
+
+      ++used[target];
+      targets[target].push_back(spec);
+    }
+
+    if (covered) {
+      for (auto& t : targets) {
+        routes.hedges[i].emplace_back(t.first, std::move(t.second));
+      }
+    }
+  }
+
+  return routes;
+}
+
+} // namespace core
+} // namespace execution
+} // namespace nebula
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "meta/NNode.h"
+
+/**
+ * Hedging of node queries to replicas of their specs.
+ * Every spec held by more than one node is queried on one of them only, the other holders are standby
+ * replicas, a node query running longer than the usual latency of the node or failing is re-issued to them.
+ */
+namespace nebula {
+namespace execution {
+namespace core {
+
+// recent latencies of queries on each node
+class Latency {
+public:
+  explicit Latency(size_t window = 128) : window_{ window } {}
+  Latency(Latency&) = delete;
+  Latency(Latency&&) = delete;
+  virtual ~Latency() = default;
+
+  static Latency& singleton() {
+    static Latency latency;
+    return latency;
+  }
+
+public:
+  void record(const std::string&, size_t);
+
+  // given percentile in [0, 1] of recent latencies of the node in ms, 0 if it has less samples than required
+  size_t percentile(const std::string&, double, size_t) const;
+
+private:
+  const size_t window_;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::deque<size_t>> samples_;
+};
+
+// how a query fans out to its nodes, indexed by positions of the nodes in the plan
+struct Routes {
+  // routes of given nodes holding blocks of specs, holders are listed by spec as BlockManager::holders.
+  // nodes not holding any spec (eg. in proc) query all their blocks and can't be hedged.
+  static Routes make(const std::vector<nebula::meta::NNode>&,
+                     const std::unordered_map<std::string, std::vector<std::pair<nebula::meta::NNode, size_t>>>&);
+
+  // some spec is held by more than one node, so nodes are scoped to specs assigned to them
+  bool scoped = false;
+
+  // a node is skipped if all its specs are assigned to other nodes
+  std::vector<bool> skip;
+
+  // specs assigned to each node and number of their blocks on it
+  std::vector<std::vector<std::string>> specs;
+  std::vector<size_t> blocks;
+
+  // replica nodes to hedge each node with and specs to scope them to, empty if some spec has no replica
+  std::vector<std::vector<std::pair<size_t, std::vector<std::string>>>> hedges;
+};
+
+} // namespace core
+} // namespace execution
+} // namespace nebula
@@ -31,10 +31,28 @@ using nebula::surface::RowData;
 folly::Future<RowCursorPtr> NodeClient::execute(const ExecutionPlan& plan) {
   auto p = std::make_shared<folly::Promise<RowCursorPtr>>();
 
-  // start to full fill the future
-  pool_.add([&plan, &pool = pool_, p]() {
-    NodeExecutor nodeExec(BlockManager::init(), true);
-    p->setValue(nodeExec.execute(pool, plan));
+  // start to full fill the future, the plan is shared since the caller may give up waiting and release it
+  pool_.add([plan = plan.share(), pool = &pool_, p]() {
+    p->setWith([&]() {
+      NodeExecutor nodeExec(BlockManager::init(), true);
+      return nodeExec.execute(*pool, *plan);
+    });
+  });
+
+  return p->getFuture();
+}
+
+folly::Future<bool> NodeClient::stream(const ExecutionPlan& plan, Sink sink, const std::vector<std::string>&) {
+  auto p = std::make_shared<folly::Promise<bool>>();
+
+  // in-process node result is a single chunk, specs are never replicated in proc so it has no scope.
+  // the plan is shared since the server may time out and release it while the node is still executing it.
+  pool_.add([plan = plan.share(), pool = &pool_, p, sink = std::move(sink)]() {
+    p->setWith([&]() {
+      NodeExecutor nodeExec(BlockManager::init(), true);
+      sink(nodeExec.execute(*pool, *plan));
+      return true;
+    });
   });
 
   return p->getFuture();
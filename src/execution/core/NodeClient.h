@@ -30,6 +30,9 @@ namespace nebula {
 namespace execution {
 namespace core {
 
+// receives result chunks of a plan from a node as they arrive, it may be called from any thread
+using Sink = std::function<void(nebula::surface::RowCursorPtr)>;
+
 class NodeClient {
 public:
   NodeClient(const nebula::meta::NNode& node, folly::ThreadPoolExecutor& pool)
@@ -38,6 +41,11 @@ public:
 
   virtual folly::Future<nebula::surface::RowCursorPtr> execute(const ExecutionPlan& plan);
 
+  // execute a plan and push its result in chunks into the sink,
+  // the future is fulfilled with true when all chunks are delivered.
+  // the node can be scoped to blocks of given specs, empty for all its blocks.
+  virtual folly::Future<bool> stream(const ExecutionPlan& plan, Sink sink, const std::vector<std::string>& specs = {});
+
   // state is used to pull state of a node - do nothing for inproc node client
   virtual void state() {}
 
@@ -16,10 +16,15 @@
 
 #include "NodeExecutor.h"
 
+#include <algorithm>
+#include <cmath>
 #include <gflags/gflags.h>
 
 #include "AggregationMerge.h"
+#include "Approximate.h"
+#include "BlockCache.h"
 #include "BlockExecutor.h"
+#include "SelectionCache.h"
 #include "TopSort.h"
 #include "execution/meta/TableService.h"
 #include "surface/eval/UDF.h"
@@ -30,6 +35,10 @@ DEFINE_uint64(TOP_SORT_SCALE,
               "However, many times we want fast return so that we don't need to serialize massive data back to server,"
               "instead we return scale times of sorting result back to server and this may result in wrong answer!");
 
+DEFINE_uint64(SAMPLE_STRATA,
+              10,
+              "number of time buckets samples are stratified by in stratified sampling mode");
+
 DEFINE_uint64(NODE_TIMEOUT,
               30000,
               "maximum time nebula can torelate for each query in miliseconds");
@@ -41,30 +50,167 @@ namespace nebula {
 namespace execution {
 namespace core {
 
+using nebula::common::Cancellation;
 using nebula::execution::meta::TableService;
 using nebula::memory::Batch;
+using nebula::memory::serde::IntHistogram;
+using nebula::meta::Table;
 using nebula::surface::EmptyRowCursor;
 using nebula::surface::RowCursorPtr;
 
 // set 10 seconds for now as max time to complete a query
 static const auto NODE_TIMEOUT = std::chrono::milliseconds(FLAGS_NODE_TIMEOUT);
 
+// a block task still queued when its query is cancelled is dropped without scan
+static inline void check(const Cancellation& cancel) {
+  if (cancel.cancelled()) {
+    throw NException("query cancelled");
+  }
+}
+
 // distribute the compute task into a promise
 folly::Future<RowCursorPtr> dist(
   folly::ThreadPoolExecutor& pool,
   const Batch& block,
-  const BlockPhase& phase) {
+  const BlockPhase& phase,
+  const QueryWindow& window,
+  size_t quota,
+  std::string selection,
+  std::shared_ptr<Cancellation> cancel) {
   auto p = std::make_shared<folly::Promise<RowCursorPtr>>();
   pool.addWithPriority(
-    [&block, &phase, p]() {
+    [&block, &phase, window, quota, selection = std::move(selection), cancel, p]() {
       // compute phase on block and return the result
-      p->setValue(nebula::execution::core::compute(block, phase));
+      p->setWith([&]() -> RowCursorPtr {
+        check(*cancel);
+        return nebula::execution::core::compute(block, phase, quota, selection, cancel.get(), &window);
+      });
+    },
+    folly::Executor::HI_PRI);
+
+  return p->getFuture();
+}
+
+// serve aggregation of a block from block cache, or compute and cache it for plans of the same cache key
+folly::Future<RowCursorPtr> distCached(
+  folly::ThreadPoolExecutor& pool,
+  const Batch& block,
+  const BlockPhase& phase,
+  const std::string& key,
+  std::string selection,
+  std::shared_ptr<Cancellation> cancel) {
+  auto& cache = BlockCache::singleton();
+  auto cached = cache.get(&block, key);
+  if (cached) {
+    return folly::makeFuture<RowCursorPtr>(std::move(cached));
+  }
+
+  auto p = std::make_shared<folly::Promise<RowCursorPtr>>();
+  pool.addWithPriority(
+    [&block, &phase, &cache, key, selection = std::move(selection), cancel, p]() {
+      p->setWith([&]() -> RowCursorPtr {
+        check(*cancel);
+        auto result = std::make_shared<BlockExecutor>(block, phase, selection, cancel.get());
+        cache.put(&block, key, result->result());
+        return result;
+      });
     },
     folly::Executor::HI_PRI);
 
   return p->getFuture();
 }
 
+// allocate samples of a random sampling query to every block by block metadata.
+// uniform mode splits samples by block rows, stratified mode splits samples evenly into time buckets of the window
+// and splits samples of a bucket by rows of blocks overlapping it (rows are assumed evenly spread in block time range).
+// quota a block can't fill with its rows in the window goes to blocks having more rows than their quota.
+std::vector<size_t> sampleQuotas(const std::vector<Batch*>& blocks, const BlockPhase& phase, const QueryWindow& window) {
+  const auto mode = phase.sampleMode();
+  const auto top = phase.top();
+  if (mode == nebula::execution::SampleMode::FIRST || phase.hasAggregation() || top == 0) {
+    return std::vector<size_t>(blocks.size(), 0);
+  }
+
+  // buckets cover the window as far as blocks have rows in it, uniform mode has single bucket
+  const size_t strata = mode == nebula::execution::SampleMode::STRATIFIED ? std::max<size_t>(FLAGS_SAMPLE_STRATA, 1) : 1;
+  std::vector<IntHistogram> times;
+  times.reserve(blocks.size());
+  int64_t min = std::numeric_limits<int64_t>::max();
+  int64_t max = std::numeric_limits<int64_t>::min();
+  for (const auto block : blocks) {
+    times.push_back(block->histogram<IntHistogram>(Table::TIME_COLUMN));
+    if (times.back().count > 0) {
+      min = std::min(min, times.back().min());
+      max = std::max(max, times.back().max());
+    }
+  }
+
+  const double start = std::max<double>(window.first, min);
+  const double end = std::min<double>(window.second, max) + 1.0;
+  const double width = std::max<double>(end - start, 1) / strata;
+  std::vector<std::vector<double>> weights(blocks.size(), std::vector<double>(strata, 0));
+  std::vector<double> totals(strata, 0);
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    const double rows = blocks.at(b)->getRows();
+    if (times.at(b).count == 0) {
+      weights[b][0] = rows;
+      totals[0] += rows;
+      continue;
+    }
+
+    // split rows of the block by its overlap with every bucket, rows out of the window are left out
+    const double bs = times.at(b).min();
+    const double be = times.at(b).max() + 1.0;
+    for (size_t s = 0; s < strata; ++s) {
+      const double ss = start + s * width;
+      const double overlap = std::min(be, ss + width) - std::max(bs, ss);
+      if (overlap > 0) {
+        weights[b][s] = rows * overlap / (be - bs);
+        totals[s] += weights[b][s];
+      }
+    }
+  }
+
+  // samples are split evenly into buckets having rows
+  const auto buckets = std::count_if(totals.begin(), totals.end(), [](double t) { return t > 0; });
+  if (buckets == 0) {
+    return std::vector<size_t>(blocks.size(), 1);
+  }
+
+  const double perStratum = static_cast<double>(top) / buckets;
+  std::vector<double> quotas(blocks.size(), 0);
+  std::vector<double> rows(blocks.size(), 0);
+  double shortfall = 0;
+  double spare = 0;
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    for (size_t s = 0; s < strata; ++s) {
+      rows[b] += weights[b][s];
+      if (totals[s] > 0) {
+        quotas[b] += perStratum * weights[b][s] / totals[s];
+      }
+    }
+
+    if (quotas[b] > rows[b]) {
+      shortfall += quotas[b] - rows[b];
+      quotas[b] = rows[b];
+    } else {
+      spare += rows[b] - quotas[b];
+    }
+  }
+
+  // shortfall is split by spare rows of blocks, which fills all of them if it exceeds the spare rows
+  std::vector<size_t> result;
+  result.reserve(blocks.size());
+  const double ratio = spare > 0 ? std::min(shortfall / spare, 1.0) : 0;
+  for (size_t b = 0; b < blocks.size(); ++b) {
+    const auto quota = quotas[b] + (rows[b] - quotas[b]) * ratio;
+    const auto cap = std::max<size_t>(blocks.at(b)->getRows(), 1);
+    result.push_back(std::min<size_t>(std::max<size_t>(std::ceil(quota), 1), cap));
+  }
+
+  return result;
+}
+
 /**
  * Execute a plan on a node level.
  * 
@@ -78,36 +224,96 @@ RowCursorPtr NodeExecutor::execute(folly::ThreadPoolExecutor& pool, const Execut
   // launch block executor on each in parallel
   // TODO(cao): this table service instance potentially can be carried by a query context on each node
   auto ts = TableService::singleton();
-  const std::vector<Batch*> blocks = blockManager_->query(*ts->query(blockPhase.table()), plan);
+  const std::vector<Batch*> hits = blockManager_->query(*ts->query(blockPhase.table()), plan);
 
-  LOG(INFO) << "Processing total blocks: " << blocks.size();
+  // an approximate aggregation executes on a random fraction of the blocks
+  const NodePhase& phase = plan.fetch<PhaseType::PARTIAL>();
+  const auto approximate = blockPhase.approximate() && blockPhase.hasAggregation();
+  Approximate approx(blockPhase, phase.outputSchema());
+  const std::vector<Batch*> blocks = approximate ? approx.sample(hits) : hits;
+
+  LOG(INFO) << "Processing total blocks: " << blocks.size() << " of " << hits.size();
   std::vector<folly::Future<RowCursorPtr>> results;
   results.reserve(blocks.size());
-  std::transform(blocks.begin(), blocks.end(), std::back_inserter(results),
-                 [&blockPhase, &pool](const auto block) {
-                   return dist(pool, *block, blockPhase);
-                 });
+  const auto& window = plan.getWindow();
+  const auto samples = sampleQuotas(blocks, blockPhase, window);
+
+  // aggregation of a sealed block inside the window of the plan is the same for all windows covering it
+  const auto& cacheKey = plan.cacheKey();
+  const auto cacheable = !approximate && blockPhase.hasAggregation() && !cacheKey.empty()
+                         && BlockCache::singleton().enabled();
 
-  // compile the results into a single row cursor
-  auto x = folly::collectAll(results).get(NODE_TIMEOUT);
+  // selected rows of a sealed block inside the window are shared by aggregations of the same filter.
+  // the filter key without time comparisons is used if the plan has one, otherwise the filter signature.
+  const auto filter = blockPhase.filter().signature();
+  const auto selective = blockPhase.hasAggregation() && filter != "C:true" && SelectionCache::singleton().enabled();
+  const auto selection = [&](bool within) -> std::string {
+    if (!selective || !within) {
+      return {};
+    }
+
+    if (!plan.filterKey().empty()) {
+      return "R" + plan.filterKey();
+    }
+
+    return "S" + std::string(filter);
+  };
+
+  // block tasks stop at node timeout or when the query is cancelled by its caller
+  const auto& cancel = plan.cancellation();
+  cancel->expire(std::chrono::steady_clock::now() + NODE_TIMEOUT);
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    const auto& block = *blocks.at(i);
+    const auto within = BlockCache::within(block, window);
+    if (cacheable && within) {
+      results.push_back(distCached(pool, block, blockPhase, cacheKey, selection(within), cancel));
+      continue;
+    }
+
+    results.push_back(dist(pool, block, blockPhase, window, samples.at(i), selection(within), cancel));
+  }
+
+  // compile the results into a single row cursor.
+  // block tasks reference the plan, so they are all waited for, they stop by themselves once past node timeout.
+  auto x = folly::collectAll(results).get();
+  check(*cancel);
+
+  // block totals are taken before merge which may update block results in place
+  if (approximate) {
+    for (size_t i = 0; i < x.size(); ++i) {
+      // a failed block is left out of the sample as it is left out of the merge
+      if (x.at(i).hasValue() && x.at(i).value()) {
+        approx.observe(*blocks.at(i), x.at(i).value());
+      }
+    }
+  }
 
   // single response optimization
   if (x.size() == 1) {
-    return x.at(0).value();
+    auto single = x.at(0).value();
+    return approximate ? approx.scale(single, *plan.estimates()) : single;
   }
 
   // depends on the query plan, if there is no aggregation
   // the results set from different block exeuction can be simply composite together
   // but the query needs to aggregate on keys, then we have to merge the results based on partial aggregatin plan
-  const NodePhase& phase = plan.fetch<PhaseType::PARTIAL>();
-  auto merged = merge(pool, phase.outputSchema(), phase.keys(), phase.fields(), phase.hasAggregation(), x);
+  // a sorted top query may degrade to keep top rows only when aggregation table is too large
+  Prune prune = nullptr;
+  if (phase.top() > 0 && phase.sorts().size() > 0) {
+    prune = [&phase](RowCursorPtr input) {
+      return topSort<>(input, phase, std::max<size_t>(FLAGS_TOP_SORT_SCALE, 1));
+    };
+  }
+
+  auto merged = merge(pool, phase.outputSchema(), phase.keys(), phase.fields(), phase.hasAggregation(), x, prune);
 
   // if scale is 0 or this query has no limit on it
-  if (local_ || FLAGS_TOP_SORT_SCALE == 0 || phase.top() == 0) {
-    return merged;
+  if (!local_ && FLAGS_TOP_SORT_SCALE > 0 && phase.top() > 0) {
+    merged = topSort<>(merged, phase, FLAGS_TOP_SORT_SCALE);
   }
 
-  return topSort<>(merged, phase, FLAGS_TOP_SORT_SCALE);
+  // scale additive columns of sampled result up to all blocks
+  return approximate ? approx.scale(merged, *plan.estimates()) : merged;
 }
 
 } // namespace core
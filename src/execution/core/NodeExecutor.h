@@ -30,6 +30,10 @@
 namespace nebula {
 namespace execution {
 namespace core {
+
+// split samples of a random sampling query into quotas of the blocks by their rows in the query window
+std::vector<size_t> sampleQuotas(const std::vector<nebula::memory::Batch*>&, const BlockPhase&, const QueryWindow&);
+
 // This will sit behind the service interface and do the real work.
 class NodeExecutor {
 public:
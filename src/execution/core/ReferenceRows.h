@@ -20,6 +20,7 @@
 #include "common/Cursor.h"
 #include "execution/ExecutionPlan.h"
 #include "memory/Batch.h"
+#include "meta/Table.h"
 #include "surface/DataSurface.h"
 #include "surface/eval/ValueEval.h"
 
@@ -29,18 +30,25 @@ namespace core {
 
 class ReferenceRows : public nebula::surface::RowCursor {
 public:
-  explicit ReferenceRows(const BlockPhase& plan, const nebula::memory::Batch& data)
+  // rows out of the time window are not referenced, nullptr for all rows
+  explicit ReferenceRows(const BlockPhase& plan, const nebula::memory::Batch& data, const QueryWindow* window = nullptr)
     : nebula::surface::RowCursor(0),
       data_{ data },
       accessor_{ data.makeAccessor() },
       ctx_{ plan.cacheEval() },
       filter_{ plan.filter() },
+      window_{ window },
       runtime_{ plan.outputSchema(), ctx_, plan.fields() } {}
 
   virtual ~ReferenceRows() = default;
 
   size_t check(size_t index) {
-    ctx_.reset(accessor_->seek(index));
+    const auto& row = accessor_->seek(index);
+    if (window_ && !inWindow(*window_, row.readLong(nebula::meta::Table::TIME_COLUMN))) {
+      return size_;
+    }
+
+    ctx_.reset(row);
 
     // if not fullfil the condition
     // ignore valid here - if system can't determine how to act on NULL value
@@ -72,6 +80,7 @@ private:
   std::unique_ptr<nebula::memory::RowAccessor> accessor_;
   nebula::surface::eval::EvalContext ctx_;
   const nebula::surface::eval::ValueEval& filter_;
+  const QueryWindow* window_;
   ComputedRow runtime_;
 };
 
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "SelectionCache.h"
+
+#include <gflags/gflags.h>
+
+DEFINE_uint64(SELECTION_CACHE_MB, 256, "memory budget in MB of filter selection bitmaps cached on a node, 0 to disable");
+
+namespace nebula {
+namespace execution {
+namespace core {
+
+using nebula::memory::Batch;
+
+SelectionCache::SelectionCache() : SelectionCache(FLAGS_SELECTION_CACHE_MB << 20) {}
+
+std::string SelectionCache::key(const Batch* block, const std::string& filter) {
+  const auto generation = block->generation();
+  std::string key(reinterpret_cast<const char*>(&generation), sizeof(generation));
+  key.append(filter);
+  return key;
+}
+
+std::shared_ptr<const Roaring> SelectionCache::get(const Batch* block, const std::string& filter) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr = cache_.find(key(block, filter));
+  if (itr == cache_.end()) {
+    ++misses_;
+    return nullptr;
+  }
+
+  ++hits_;
+  return itr->second.rows;
+}
+
+void SelectionCache::put(const Batch* block, const std::string& filter, Roaring rows) {
+  // selected rows are usually in runs, such as rows of the same value in a sorted column
+  rows.runOptimize();
+  rows.shrinkToFit();
+
+  auto k = key(block, filter);
+  const size_t bytes = k.size() + rows.getSizeInBytes();
+  if (bytes > budget_) {
+    return;
+  }
+
+  auto shared = std::make_shared<const Roaring>(std::move(rows));
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (cache_.exists(k)) {
+    erase(k);
+  }
+
+  blocks_[block->generation()].insert(k);
+  cache_.set(k, Entry{ block->generation(), bytes, std::move(shared) });
+  bytes_ += bytes;
+
+  // evict least recently used bitmaps
+  while (bytes_ > budget_) {
+    const auto evict = cache_.rbegin()->first;
+    erase(evict);
+  }
+}
+
+void SelectionCache::invalidate(const Batch* block) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr = blocks_.find(block->generation());
+  if (itr == blocks_.end()) {
+    return;
+  }
+
+  for (const auto& k : itr->second) {
+    auto entry = cache_.find(k);
+    if (entry != cache_.end()) {
+      bytes_ -= entry->second.bytes;
+      cache_.erase(k);
+    }
+  }
+
+  blocks_.erase(itr);
+}
+
+void SelectionCache::erase(const std::string& k) {
+  auto itr = cache_.find(k);
+  if (itr == cache_.end()) {
+    return;
+  }
+
+  bytes_ -= itr->second.bytes;
+  auto block = blocks_.find(itr->second.block);
+  if (block != blocks_.end()) {
+    block->second.erase(k);
+    if (block->second.empty()) {
+      blocks_.erase(block);
+    }
+  }
+
+  cache_.erase(k);
+}
+
+} // namespace core
+} // namespace execution
+} // namespace nebula
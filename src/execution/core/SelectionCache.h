@@ -0,0 +1,113 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <folly/container/EvictingCacheMap.h>
+#include <mutex>
+#include <roaring.hh>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "memory/Batch.h"
+
+/**
+ * A LRU cache of rows selected by filters on sealed blocks within a memory budget.
+ * Selected rows of a block are kept in a compressed roaring bitmap keyed by the block and the filter,
+ * queries of the same filter with different keys or metrics scan selected rows without evaluating it.
+ * Bitmaps of a block are dropped when the block leaves the node.
+ */
+namespace nebula {
+namespace execution {
+namespace core {
+
+class SelectionCache {
+public:
+  // memory budget is given by flag SELECTION_CACHE_MB
+  SelectionCache();
+  explicit SelectionCache(size_t budget) : budget_{ budget }, bytes_{ 0 }, cache_{ 0 } {}
+  SelectionCache(SelectionCache&) = delete;
+  SelectionCache(SelectionCache&&) = delete;
+  virtual ~SelectionCache() = default;
+
+  static SelectionCache& singleton() {
+    static SelectionCache cache;
+    return cache;
+  }
+
+public:
+  inline bool enabled() const {
+    return budget_ > 0;
+  }
+
+  // rows of given block selected by the filter key, nullptr if not cached
+  std::shared_ptr<const Roaring> get(const nebula::memory::Batch*, const std::string&);
+
+  // cache rows of given block selected by the filter key, bitmap is compressed before cached.
+  // least recently used bitmaps are evicted to keep total size in budget.
+  void put(const nebula::memory::Batch*, const std::string&, Roaring);
+
+  // drop all bitmaps of given block
+  void invalidate(const nebula::memory::Batch*);
+
+  inline size_t hits() const {
+    return hits_;
+  }
+
+  inline size_t misses() const {
+    return misses_;
+  }
+
+  inline size_t bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+  }
+
+  inline size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cache_.size();
+  }
+
+private:
+  struct Entry {
+    // generation of the block
+    uint64_t block;
+    size_t bytes;
+    std::shared_ptr<const Roaring> rows;
+  };
+
+  // keyed by generation of the block rather than its address which may be reused by a later block
+  static std::string key(const nebula::memory::Batch*, const std::string&);
+
+  // remove an entry along with its index by block, caller holds the lock
+  void erase(const std::string&);
+
+  const size_t budget_;
+  size_t bytes_;
+  mutable std::mutex mutex_;
+  // evicting by memory budget rather than number of entries
+  folly::EvictingCacheMap<std::string, Entry> cache_;
+  // keys of cached bitmaps of every block
+  std::unordered_map<uint64_t, std::unordered_set<std::string>> blocks_;
+  std::atomic<size_t> hits_{ 0 };
+  std::atomic<size_t> misses_{ 0 };
+};
+
+} // namespace core
+} // namespace execution
+} // namespace nebula
@@ -15,8 +15,14 @@
  */
 
 #include "ServerExecutor.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
 #include "AggregationMerge.h"
 #include "Finalize.h"
+#include "Hedging.h"
 #include "NodeConnector.h"
 #include "TopSort.h"
 #include "common/Folly.h"
@@ -27,6 +33,16 @@ DEFINE_uint64(RPC_TIMEOUT,
               35000,
               "maximum time nebula can torelate for each query in miliseconds");
 
+DEFINE_bool(HEDGE_REQUESTS,
+            true,
+            "re-issue a node query running longer than p95 latency of the node to replicas of its specs");
+DEFINE_uint64(HEDGE_MIN_MS,
+              100,
+              "minimum time in miliseconds to wait for a node before hedging its query");
+DEFINE_uint64(HEDGE_MIN_SAMPLES,
+              20,
+              "minimum number of latency samples of a node to hedge its slow queries");
+
 /**
  * Nebula runtime / online meta data.
  */
@@ -41,39 +57,215 @@ using nebula::surface::RowCursorPtr;
 // set 10 seconds for now as max time to complete a query
 static const auto RPC_TIMEOUT = std::chrono::milliseconds(FLAGS_RPC_TIMEOUT);
 
+using Clock = std::chrono::steady_clock;
+
+// interval to check if the query is cancelled by its client while waiting for nodes
+static constexpr auto CANCEL_POLL = std::chrono::milliseconds(100);
+
+// query of a plan on one node, it is covered by its first attempt succeeding on the node or its replicas
+struct NodeTask {
+  // time to hedge the query if it is not covered yet
+  Clock::time_point hedgeAt;
+  // streams in flight
+  size_t running = 0;
+  bool covered = false;
+  bool failed = false;
+  bool hedged = false;
+};
+
+// an attempt to cover a node task by one or more streams.
+// chunks of an attempt are buffered and merged only when all its streams succeed,
+// so a node failing in the middle of its stream leaves none of its rows in the result.
+struct Attempt {
+  Attempt(size_t t, size_t s, bool h) : task{ t }, streams{ s }, hedge{ h } {}
+
+  size_t task;
+  size_t streams;
+  bool hedge;
+  bool failed = false;
+  std::vector<RowCursorPtr> chunks;
+};
+
+// merging state shared by all node streams of a query, chunks arriving after close are dropped
+struct StreamMerge {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::unique_ptr<Merger> merger;
+  std::vector<NodeTask> tasks;
+  size_t chunks = 0;
+};
+
 RowCursorPtr ServerExecutor::execute(
   folly::ThreadPoolExecutor& pool,
   const ExecutionPlan& plan,
   const std::shared_ptr<NodeConnector> connector) {
-  std::vector<folly::Future<RowCursorPtr>> results;
-  for (const NNode& node : plan.getNodes()) {
-    auto c = connector->makeClient(node, pool);
-    auto f = c->execute(plan)
-               // set time out handling
-               // TODO(cao) - add error handling too via thenError
-               .onTimeout(RPC_TIMEOUT, [&]() -> RowCursorPtr { 
-                 LOG(WARNING) << "RPC Timeout: " << FLAGS_RPC_TIMEOUT;
-                 return EmptyRowCursor::instance(); });
-
-    results.push_back(std::move(f));
+  // a single node result doesn't need any aggregation, its chunks are chained only
+  const auto& phase = plan.fetch<PhaseType::GLOBAL>();
+  const auto& nodes = plan.getNodes();
+  const auto aggregate = phase.hasAggregation() && nodes.size() > 1;
+
+  // specs replicated on more than one node are queried on one of them, the others can take over
+  const auto& table = plan.fetch<PhaseType::COMPUTE>().table();
+  const auto routes = Routes::make(nodes, BlockManager::init()->holders(table, plan.getWindow()));
+
+  // multiple results using input schema as output schema used by finalize only
+  auto state = std::make_shared<StreamMerge>();
+  state->merger = std::make_unique<Merger>(phase.inputSchema(), phase.keys(), phase.fields(), aggregate);
+  state->tasks.resize(nodes.size());
+
+  // start a stream on a node for an attempt, streams are counted as running before they start
+  auto launch = [&pool, &plan, &connector, state](const NNode& node, const std::vector<std::string>& specs,
+                                                  std::shared_ptr<Attempt> attempt) {
+    auto sink = [state, attempt](RowCursorPtr chunk) {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (!state->merger || state->tasks[attempt->task].covered) {
+        return;
+      }
+
+      attempt->chunks.push_back(chunk);
+    };
+
+    const auto start = Clock::now();
+    auto f = connector->makeClient(node, pool)
+      ->stream(plan, sink, specs)
+      .thenTry([state, attempt, addr = node.toString(), start](folly::Try<bool>&& t) {
+        const auto ok = t.hasValue() && t.value();
+        if (ok && !attempt->hedge) {
+          Latency::singleton().record(
+            addr, std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count());
+        }
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        auto& task = state->tasks[attempt->task];
+        --task.running;
+        if (!ok) {
+          attempt->failed = true;
+          task.failed = task.failed || !attempt->hedge;
+        } else if (--attempt->streams == 0 && !attempt->failed && !task.covered) {
+          // first attempt completing covers the task
+          task.covered = true;
+          if (state->merger) {
+            for (auto& chunk : attempt->chunks) {
+              state->merger->add(chunk);
+              ++state->chunks;
+            }
+          }
+        }
+
+        attempt->chunks.clear();
+        state->cv.notify_all();
+      });
+
+    // completion is reported through the state, the future is not waited
+    (void)f;
+  };
+
+  // merge node results as soon as each node completes rather than waiting for all nodes
+  const auto start = Clock::now();
+  const auto deadline = start + RPC_TIMEOUT;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    auto& task = state->tasks[i];
+    if (routes.skip[i]) {
+      task.covered = true;
+      continue;
+    }
+
+    // hedge after p95 latency of the node if it has enough history, otherwise on failure only
+    const auto& node = nodes[i];
+    const auto hedge = FLAGS_HEDGE_REQUESTS && !routes.hedges[i].empty();
+    task.hedgeAt = deadline;
+    if (hedge) {
+      auto p95 = Latency::singleton().percentile(node.toString(), 0.95, FLAGS_HEDGE_MIN_SAMPLES);
+      if (p95 > 0) {
+        task.hedgeAt = start + std::chrono::milliseconds(std::max<size_t>(p95, FLAGS_HEDGE_MIN_MS));
+      }
+    }
+
+    task.running = 1;
+    launch(node, routes.scoped ? routes.specs[i] : std::vector<std::string>{},
+           std::make_shared<Attempt>(i, 1, false));
   }
 
-  // collect all returns and turn it into a future
-  auto x = folly::collectAll(results).get();
+  // wait for all tasks to be covered or given up, hedge late or failed ones on the way
+  const auto& cancel = plan.cancellation();
+  size_t hedges = 0;
+  std::vector<size_t> missing;
+  RowCursorPtr result;
+  {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (!cancel->cancelled()) {
+      const auto now = Clock::now();
+      auto wake = std::min(deadline, now + CANCEL_POLL);
+      auto pending = false;
+      std::vector<size_t> late;
+      for (size_t i = 0; i < nodes.size(); ++i) {
+        auto& task = state->tasks[i];
+        const auto hedge = FLAGS_HEDGE_REQUESTS && !task.hedged && !routes.hedges[i].empty();
+        if (task.covered || (task.running == 0 && !hedge)) {
+          continue;
+        }
 
-  // only one result - don't need any aggregation or composite
-  const auto& phase = plan.fetch<PhaseType::GLOBAL>();
-  if (x.size() == 1) {
-    const auto& op = x.at(0);
-    if (op.hasException() || !op.hasValue()) {
-      return EmptyRowCursor::instance();
+        pending = true;
+        if (hedge) {
+          if (task.failed || now >= task.hedgeAt) {
+            late.push_back(i);
+          } else {
+            wake = std::min(wake, task.hedgeAt);
+          }
+        }
+      }
+
+      if (!pending || now >= deadline) {
+        break;
+      }
+
+      // issue hedges out of lock since their streams report back through it
+      if (!late.empty()) {
+        for (auto i : late) {
+          auto& task = state->tasks[i];
+          task.hedged = true;
+          task.running += routes.hedges[i].size();
+        }
+
+        lock.unlock();
+        for (auto i : late) {
+          const auto& targets = routes.hedges[i];
+          LOG(WARNING) << "Hedging query on node " << nodes[i].toString() << " to " << targets.size() << " replicas";
+          auto attempt = std::make_shared<Attempt>(i, targets.size(), true);
+          for (const auto& target : targets) {
+            launch(nodes[target.first], target.second, attempt);
+          }
+        }
+
+        hedges += late.size();
+        lock.lock();
+        continue;
+      }
+
+      state->cv.wait_until(lock, wake);
+    }
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      if (!state->tasks[i].covered) {
+        missing.push_back(i);
+      }
     }
 
-    return topSort(finalize(op.value(), phase), phase);
+    // close the stream merge in the same lock, late chunks of timed out nodes will be dropped
+    LOG(INFO) << "Merged chunks: " << state->chunks << ", hedged nodes: " << hedges
+              << ", error or timeout nodes: " << missing.size();
+    result = state->merger->result();
+    state->merger = nullptr;
   }
 
-  // multiple results using input schema as output schema used by finalize only
-  auto result = merge(pool, phase.inputSchema(), phase.keys(), phase.fields(), phase.hasAggregation(), x);
+  // streams still running are timed out or lost to hedges, cancel them on their nodes
+  cancel->cancel();
+
+  // nodes not covered in time are reported as missing from the result
+  auto& coverage = plan.coverage();
+  for (auto i : missing) {
+    coverage->miss(nodes[i].toString(), routes.blocks[i]);
+  }
 
   // apply sorting and limit if available
   return topSort(finalize(result, phase), phase);
@@ -15,7 +15,9 @@
  */
 
 #include "BlockLoader.h"
+#include <sstream>
 #include "common/Evidence.h"
+#include "memory/serde/Binary.h"
 #include "surface/MockSurface.h"
 
 /**
@@ -28,6 +30,10 @@ namespace io {
 using nebula::common::Evidence;
 using nebula::execution::io::BatchBlock;
 using nebula::memory::Batch;
+using nebula::memory::serde::readBytes;
+using nebula::memory::serde::readValue;
+using nebula::memory::serde::writeBytes;
+using nebula::memory::serde::writeValue;
 using nebula::meta::BlockSignature;
 using nebula::meta::BlockState;
 using nebula::meta::NBlock;
@@ -36,10 +42,47 @@ using nebula::surface::MockRowData;
 
 BatchBlock BlockLoader::from(const BlockSignature& sign, std::shared_ptr<nebula::memory::Batch> b) {
   N_ENSURE_NOT_NULL(b, "requires a solid batch");
+  // a block is immutable once built, seal it to fit its metadata and bloom filters to the data
+  b->seal();
   BlockState state{ b->getRows(), b->getRawSize() };
   return BatchBlock(sign, b, state);
 }
 
+std::string BlockLoader::save(const BatchBlock& block, const std::string& dir) {
+  const auto& batch = block.data();
+  N_ENSURE_NOT_NULL(batch, "only in-proc block can be saved");
+
+  // block signature is stored as header of the batch file
+  const auto& sign = block.signature();
+  std::ostringstream header;
+  writeBytes(header, sign.table);
+  writeValue(header, sign.id);
+  writeValue(header, sign.start);
+  writeValue(header, sign.end);
+  writeBytes(header, sign.spec);
+
+  // blocks are sealed when built (see from), live blocks are never sealed again here
+  const auto file = fmt::format("{0}/{1}.nb", dir, sign.toString());
+  batch->save(file, header.str());
+  return file;
+}
+
+BatchBlock BlockLoader::restore(const std::string& file) {
+  std::string header;
+  auto batch = Batch::restore(file, header);
+
+  const NByte* cursor = (const NByte*)header.data();
+  const std::string table{ readBytes(cursor) };
+  const auto id = readValue<size_t>(cursor);
+  const auto start = readValue<size_t>(cursor);
+  const auto end = readValue<size_t>(cursor);
+  const std::string spec{ readBytes(cursor) };
+
+  auto block = from(BlockSignature{ table, id, start, end, spec }, batch);
+  block.setStorage(file);
+  return block;
+}
+
 BatchBlock BlockLoader::load(const BlockSignature& block) {
   if (block.table == test_.name()) {
     return loadTestBlock(block);
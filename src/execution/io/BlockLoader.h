@@ -36,6 +36,12 @@ class BlockLoader {
 public:
   static BatchBlock from(const nebula::meta::BlockSignature&, std::shared_ptr<nebula::memory::Batch>);
 
+  // persist a block into given local directory, return the file path as storage of the block
+  static std::string save(const BatchBlock&, const std::string&);
+
+  // restore a block from a file persisted by save
+  static BatchBlock restore(const std::string&);
+
 public:
   BatchBlock load(const nebula::meta::BlockSignature&);
 
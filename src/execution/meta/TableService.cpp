@@ -53,6 +53,12 @@ void TableService::enroll(const ClusterInfo& ci) {
   const auto& tsp = ci.tables();
   std::for_each(tsp.cbegin(), tsp.cend(), [this](auto itr) {
     enroll(itr->to());
+
+    // rollup cube is queried as a table too
+    auto cube = itr->cube();
+    if (cube) {
+      enroll(cube);
+    }
   });
 }
 
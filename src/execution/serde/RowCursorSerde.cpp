@@ -108,6 +108,26 @@ void init() {
 }
 
 #endif
+
+size_t asBuffers(nebula::surface::RowCursor& cursor,
+                 nebula::type::Schema schema,
+                 size_t rows,
+                 const std::function<void(FlatBufferPtr)>& consumer) {
+  N_ENSURE_GT(rows, 0, "chunk requires at least one row");
+  size_t count = 0;
+  while (cursor.hasNext()) {
+    auto buffer = std::make_unique<nebula::memory::keyed::FlatBuffer>(schema);
+    while (buffer->getRows() < rows && cursor.hasNext()) {
+      buffer->add(cursor.next());
+    }
+
+    consumer(std::move(buffer));
+    ++count;
+  }
+
+  return count;
+}
+
 } // namespace serde
 } // namespace execution
 } // namespace nebula
\ No newline at end of file
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include "memory/keyed/FlatBuffer.h"
 
 #include "surface/DataSurface.h"
@@ -34,6 +36,13 @@ namespace serde {
 using FlatBufferPtr = std::unique_ptr<nebula::memory::keyed::FlatBuffer>;
 
 FlatBufferPtr asBuffer(nebula::surface::RowCursor& cursor, nebula::type::Schema schema);
+
+// split a cursor into flat buffers of at most given rows, each buffer is handed over once it is full.
+// return number of buffers produced.
+size_t asBuffers(nebula::surface::RowCursor& cursor,
+                 nebula::type::Schema schema,
+                 size_t rows,
+                 const std::function<void(FlatBufferPtr)>& consumer);
 void init();
 
 } // namespace serde
@@ -15,24 +15,43 @@
  */
 
 #include <fmt/format.h>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <map>
 #include <yorel/yomm2/cute.hpp>
 
+#include "common/Folly.h"
 #include "execution/ExecutionPlan.h"
+#include "execution/core/AggregationMerge.h"
+#include "execution/core/Approximate.h"
+#include "execution/core/BlockCache.h"
 #include "execution/core/BlockExecutor.h"
+#include "execution/core/Hedging.h"
+#include "execution/core/NodeExecutor.h"
+#include "execution/core/SelectionCache.h"
 #include "execution/serde/RowCursorSerde.h"
 #include "memory/Batch.h"
+#include "memory/keyed/FlatRowCursor.h"
 #include "meta/TestTable.h"
 #include "surface/MockSurface.h"
+#include "surface/StaticData.h"
 #include "surface/eval/UDF.h"
 #include "surface/eval/ValueEval.h"
 
+DECLARE_uint64(AGG_MEMORY_CAP);
+DECLARE_uint64(DIRECT_AGG_SLOTS);
+DECLARE_uint64(SAMPLE_STRATA);
+
 namespace nebula {
 namespace execution {
 namespace test {
 
+using nebula::execution::core::BlockCache;
 using nebula::execution::core::BlockExecutor;
+using nebula::execution::core::Latency;
+using nebula::execution::core::Routes;
+using nebula::execution::core::SelectionCache;
 using nebula::memory::Batch;
 using nebula::surface::MockRowData;
 using nebula::surface::RowData;
@@ -155,6 +174,678 @@ TEST(ExecutionTest, TestRowCursorSerde) {
   }
 }
 
+TEST(ExecutionTest, TestDirectAggregation) {
+  nebula::meta::TestTable test;
+  auto size = 1000;
+  Batch batch(test, size);
+  MockRowData row;
+  for (auto i = 0; i < size; ++i) {
+    batch.add(row);
+  }
+  batch.seal();
+
+  auto outputSchema = TypeSerializer::from("ROW<flag:bool, value:tinyint, agg:int>");
+  auto run = [&](uint64_t slots) {
+    gflags::FlagSaver saver;
+    FLAGS_DIRECT_AGG_SLOTS = slots;
+    nebula::execution::BlockPhase plan(test.schema(), outputSchema);
+    nebula::surface::eval::Fields selects;
+    selects.reserve(3);
+    selects.push_back(column<bool>("flag"));
+    selects.push_back(column<int8_t>("value"));
+    selects.push_back(std::make_unique<TestUdaf>());
+    plan.scan(test.name())
+      .compute(std::move(selects))
+      .filter(constant<bool>(true))
+      .keys({ 0, 1 })
+      .aggregate(2, { false, false, true });
+
+    auto cursor = nebula::execution::core::compute(batch, plan);
+    auto fb = nebula::execution::serde::asBuffer(*cursor, outputSchema);
+    std::map<std::pair<bool, int8_t>, int32_t> groups;
+    for (size_t i = 0; i < fb->getRows(); ++i) {
+      const auto& r = fb->row(i);
+      groups[{ r.readBool("flag"), r.readByte("value") }] = r.readInt("agg");
+    }
+
+    return groups;
+  };
+
+  // direct address table and hash lookup should produce the same groups
+  auto direct = run(65536);
+  auto hash = run(0);
+  EXPECT_EQ(direct, hash);
+
+  auto total = 0;
+  for (const auto& g : direct) {
+    total += g.second;
+  }
+  EXPECT_EQ(total, size);
+}
+
+TEST(ExecutionTest, TestAccumulatedStates) {
+  nebula::meta::TestTable test;
+  auto size = 3000;
+  Batch batch(test, size);
+  MockRowData row;
+  for (auto i = 0; i < size; ++i) {
+    batch.add(row);
+  }
+
+  // expected count, sum and max of id for each flag
+  std::map<bool, std::tuple<int32_t, int64_t, int32_t>> expected;
+  auto accessor = batch.makeAccessor();
+  for (auto i = 0; i < size; ++i) {
+    const auto& r = accessor->seek(i);
+    auto flag = r.isNull("flag") ? false : r.readBool("flag");
+    auto id = r.isNull("id") ? 0 : r.readInt("id");
+    auto itr = expected.find(flag);
+    if (itr == expected.end()) {
+      expected[flag] = { 1, id, id };
+      continue;
+    }
+
+    auto& e = itr->second;
+    std::get<0>(e) += 1;
+    std::get<1>(e) += id;
+    std::get<2>(e) = std::max(std::get<2>(e), id);
+  }
+
+  // count by generic merge, sum and max by inlined merge in accumulators
+  auto outputSchema = TypeSerializer::from("ROW<flag:bool, cnt:int, total:bigint, top:int>");
+  nebula::execution::BlockPhase plan(test.schema(), outputSchema);
+  nebula::surface::eval::Fields selects;
+  selects.reserve(4);
+  selects.push_back(column<bool>("flag"));
+  selects.push_back(std::make_unique<TestUdaf>());
+  using SumType = UDAF<nebula::type::Kind::BIGINT, nebula::type::Kind::BIGINT, nebula::type::Kind::INTEGER>;
+  selects.push_back(std::make_unique<SumType>(
+    "SUM", column<int32_t>("id"), {}, {}, [](int64_t a, int64_t b) { return a + b; }, {}));
+  selects.push_back(std::make_unique<UDAF<nebula::type::Kind::INTEGER>>(
+    "MAX", column<int32_t>("id"), {}, {}, [](int32_t a, int32_t b) { return std::max(a, b); }, {}));
+  plan.scan(test.name())
+    .compute(std::move(selects))
+    .filter(constant<bool>(true))
+    .keys({ 0 })
+    .aggregate(3, { false, true, true, true });
+
+  auto cursor = nebula::execution::core::compute(batch, plan);
+  auto fb = nebula::execution::serde::asBuffer(*cursor, outputSchema);
+  EXPECT_EQ(fb->getRows(), expected.size());
+  for (size_t i = 0; i < fb->getRows(); ++i) {
+    const auto& r = fb->row(i);
+    const auto& e = expected.at(r.readBool("flag"));
+    EXPECT_EQ(r.readInt("cnt"), std::get<0>(e));
+    EXPECT_EQ(r.readLong("total"), std::get<1>(e));
+    EXPECT_EQ(r.readInt("top"), std::get<2>(e));
+  }
+}
+
+TEST(ExecutionTest, TestAggregationSpill) {
+  nebula::meta::TestTable test;
+  auto size = 10000;
+  Batch batch(test, size);
+  MockRowData row;
+  for (auto i = 0; i < size; ++i) {
+    batch.add(row);
+  }
+
+  // count rows by a high cardinality key
+  auto outputSchema = TypeSerializer::from("ROW<key:int, agg:int>");
+  nebula::execution::BlockPhase plan(test.schema(), outputSchema);
+  nebula::surface::eval::Fields selects;
+  selects.reserve(2);
+  selects.push_back(column<int32_t>("id"));
+  selects.push_back(std::make_unique<TestUdaf>());
+  plan.scan(test.name())
+    .compute(std::move(selects))
+    .filter(constant<bool>(true))
+    .keys({ 0 })
+    .aggregate(1, { false, true });
+
+  // merge two block results of the same block with or without memory cap
+  folly::CPUThreadPoolExecutor pool{ 1 };
+  auto run = [&](uint64_t cap) {
+    gflags::FlagSaver saver;
+    FLAGS_AGG_MEMORY_CAP = cap;
+    std::vector<folly::Try<nebula::surface::RowCursorPtr>> sources;
+    sources.emplace_back(nebula::execution::core::compute(batch, plan));
+    sources.emplace_back(nebula::execution::core::compute(batch, plan));
+    auto merged = nebula::execution::core::merge(pool, outputSchema, plan.keys(), plan.fields(), true, sources);
+    std::map<int32_t, int32_t> groups;
+    std::vector<int32_t> keys;
+    while (merged->hasNext()) {
+      const auto& r = merged->next();
+      EXPECT_EQ(groups.count(r.readInt("key")), 0);
+      groups[r.readInt("key")] = r.readInt("agg");
+      keys.push_back(r.readInt("key"));
+    }
+
+    // random access reads the same rows in reverse order
+    EXPECT_EQ(keys.size(), merged->size());
+    for (size_t i = keys.size(); i > 0; --i) {
+      EXPECT_EQ(merged->item(i - 1)->readInt("key"), keys.at(i - 1));
+    }
+
+    return groups;
+  };
+
+  auto memory = run(0);
+  auto spilled = run(1);
+  EXPECT_EQ(memory, spilled);
+
+  auto total = 0;
+  for (const auto& g : spilled) {
+    total += g.second;
+  }
+  EXPECT_EQ(total, 2 * size);
+}
+
+TEST(ExecutionTest, TestStreamedChunks) {
+  nebula::meta::TestTable test;
+  auto size = 10000;
+  Batch batch(test, size);
+  MockRowData row;
+  for (auto i = 0; i < size; ++i) {
+    batch.add(row);
+  }
+
+  auto outputSchema = TypeSerializer::from("ROW<key:int, agg:int>");
+  nebula::execution::BlockPhase plan(test.schema(), outputSchema);
+  nebula::surface::eval::Fields selects;
+  selects.reserve(2);
+  selects.push_back(column<int32_t>("id"));
+  selects.push_back(std::make_unique<TestUdaf>());
+  plan.scan(test.name())
+    .compute(std::move(selects))
+    .filter(constant<bool>(true))
+    .keys({ 0 })
+    .aggregate(1, { false, true });
+
+  // merge two block results in one shot
+  folly::CPUThreadPoolExecutor pool{ 1 };
+  std::vector<folly::Try<nebula::surface::RowCursorPtr>> sources;
+  sources.emplace_back(nebula::execution::core::compute(batch, plan));
+  sources.emplace_back(nebula::execution::core::compute(batch, plan));
+  auto merged = nebula::execution::core::merge(pool, outputSchema, plan.keys(), plan.fields(), true, sources);
+  std::map<int32_t, int32_t> expected;
+  while (merged->hasNext()) {
+    const auto& r = merged->next();
+    expected[r.readInt("key")] = r.readInt("agg");
+  }
+
+  // split the same results into small chunks and merge them one by one as they arrive
+  nebula::execution::core::Merger merger(outputSchema, plan.keys(), plan.fields(), true);
+  size_t chunks = 0;
+  for (auto i = 0; i < 2; ++i) {
+    auto cursor = nebula::execution::core::compute(batch, plan);
+    chunks += nebula::execution::serde::asBuffers(*cursor, outputSchema, 100, [&merger](auto buffer) {
+      EXPECT_LE(buffer->getRows(), 100);
+      merger.add(std::make_shared<nebula::memory::keyed::FlatRowCursor>(std::move(buffer)));
+    });
+  }
+
+  auto result = merger.result();
+  std::map<int32_t, int32_t> groups;
+  while (result->hasNext()) {
+    const auto& r = result->next();
+    EXPECT_EQ(groups.count(r.readInt("key")), 0);
+    groups[r.readInt("key")] = r.readInt("agg");
+  }
+
+  EXPECT_GT(chunks, 2);
+  EXPECT_EQ(groups, expected);
+}
+
+TEST(ExecutionTest, TestRandomSamples) {
+  nebula::meta::TestTable test;
+  auto size = 1000;
+  Batch batch(test, size);
+  MockRowData row;
+  for (auto i = 0; i < size; ++i) {
+    batch.add(row);
+  }
+
+  auto outputSchema = TypeSerializer::from("ROW<id:int, flag:bool>");
+  nebula::execution::BlockPhase plan(test.schema(), outputSchema);
+  nebula::surface::eval::Fields selects;
+  selects.reserve(2);
+  selects.push_back(column<int32_t>("id"));
+  selects.push_back(column<bool>("flag"));
+  plan.scan(test.name())
+    .compute(std::move(selects))
+    .filter(column<bool>("flag"))
+    .aggregate(0, { false, false })
+    .limit(10)
+    .sample(nebula::execution::SampleMode::UNIFORM);
+
+  // quota decides number of samples rather than top
+  auto cursor = nebula::execution::core::compute(batch, plan, 30);
+  EXPECT_EQ(cursor->size(), 30);
+  while (cursor->hasNext()) {
+    EXPECT_TRUE(cursor->next().readBool("flag"));
+  }
+
+  // quota larger than matched rows returns all of them
+  auto trues = 0;
+  auto accessor = batch.makeAccessor();
+  for (auto i = 0; i < size; ++i) {
+    const auto& r = accessor->seek(i);
+    if (!r.isNull("flag") && r.readBool("flag")) {
+      ++trues;
+    }
+  }
+
+  auto all = nebula::execution::core::compute(batch, plan, size);
+  EXPECT_EQ(all->size(), trues);
+}
+
+TEST(ExecutionTest, TestSampleQuotas) {
+  nebula::meta::TestTable test;
+  auto outputSchema = TypeSerializer::from("ROW<id:int, flag:bool>");
+  nebula::execution::BlockPhase plan(test.schema(), outputSchema);
+  nebula::surface::eval::Fields selects;
+  selects.reserve(2);
+  selects.push_back(column<int32_t>("id"));
+  selects.push_back(column<bool>("flag"));
+  plan.scan(test.name())
+    .compute(std::move(selects))
+    .filter(constant<bool>(true))
+    .aggregate(0, { false, false })
+    .limit(90)
+    .sample(nebula::execution::SampleMode::STRATIFIED);
+
+  // a block of given rows evenly spread in time range [start, end)
+  std::vector<std::unique_ptr<Batch>> batches;
+  auto make = [&test, &batches](int64_t start, int64_t end, size_t rows) {
+    batches.push_back(std::make_unique<Batch>(test, rows));
+    for (size_t i = 0; i < rows; ++i) {
+      const auto time = start + static_cast<int64_t>(i * (end - start) / rows);
+      batches.back()->add(nebula::surface::StaticRow(time, i, "e", nullptr, true, 'a', 0, 1.0));
+    }
+    return batches.back().get();
+  };
+
+  // buckets split the window rather than time range of the blocks,
+  // so the block with twice the rows in the window gets twice the samples
+  gflags::FlagSaver saver;
+  FLAGS_SAMPLE_STRATA = 10;
+  auto half = make(0, 1000, 1000);
+  auto full = make(500, 1000, 1000);
+  auto quotas = nebula::execution::core::sampleQuotas({ half, full }, plan, { 500, 999 });
+  EXPECT_NEAR(quotas.at(0), 30, 1);
+  EXPECT_NEAR(quotas.at(1), 60, 1);
+
+  // a sparse block can't fill its quota, the shortfall goes to the other block
+  plan.limit(100);
+  auto dense = make(0, 500, 1000);
+  auto sparse = make(500, 1000, 5);
+  quotas = nebula::execution::core::sampleQuotas({ dense, sparse }, plan, { 0, 999 });
+  EXPECT_EQ(quotas.at(1), 5);
+  EXPECT_NEAR(quotas.at(0), 95, 1);
+
+  // every block returns all its rows when they are fewer than the samples
+  plan.limit(2000);
+  quotas = nebula::execution::core::sampleQuotas({ dense, sparse }, plan, { 0, 999 });
+  EXPECT_EQ(quotas.at(0), 1000);
+  EXPECT_EQ(quotas.at(1), 5);
+
+  // first rows mode has no quota
+  plan.sample(nebula::execution::SampleMode::FIRST);
+  quotas = nebula::execution::core::sampleQuotas({ dense, sparse }, plan, { 0, 999 });
+  EXPECT_EQ(quotas, std::vector<size_t>(2, 0));
+}
+
+TEST(ExecutionTest, TestApproximateQuery) {
+  nebula::meta::TestTable test;
+  auto size = 1000;
+  std::vector<std::unique_ptr<Batch>> batches;
+  std::vector<Batch*> blocks;
+  for (auto b = 0; b < 4; ++b) {
+    batches.push_back(std::make_unique<Batch>(test, size));
+    MockRowData row;
+    for (auto i = 0; i < size; ++i) {
+      batches.back()->add(row);
+    }
+    blocks.push_back(batches.back().get());
+  }
+
+  auto outputSchema = TypeSerializer::from("ROW<total:bigint>");
+  nebula::execution::BlockPhase plan(test.schema(), outputSchema);
+  nebula::surface::eval::Fields selects;
+  using SumType = UDAF<nebula::type::Kind::BIGINT, nebula::type::Kind::BIGINT, nebula::type::Kind::INTEGER>;
+  selects.push_back(std::make_unique<SumType>(
+    "SUM", column<int32_t>("id"), {}, {}, [](int64_t a, int64_t b) { return a + b; }, {}));
+  plan.scan(test.name())
+    .compute(std::move(selects))
+    .filter(constant<bool>(true))
+    .aggregate(1, { true })
+    .fraction(0.5);
+
+  // half of the blocks are picked and the sum is scaled up by ratio of rows
+  nebula::execution::core::Approximate approx(plan, outputSchema);
+  auto picks = approx.sample(blocks);
+  EXPECT_EQ(picks.size(), 2);
+  EXPECT_EQ(approx.factor(), 2);
+
+  int64_t sampled = 0;
+  std::vector<nebula::surface::RowCursorPtr> results;
+  for (auto block : picks) {
+    auto result = nebula::execution::core::compute(*block, plan);
+    approx.observe(*block, result);
+    sampled += result->item(0)->readLong("total");
+    results.push_back(result);
+  }
+
+  Estimates estimates;
+  auto scaled = approx.scale(results.at(0), estimates);
+  const auto original = results.at(0)->item(0)->readLong("total");
+  EXPECT_EQ(scaled->next().readLong("total"), original * 2);
+
+  auto e = estimates.get();
+  EXPECT_EQ(e.size(), 1);
+  EXPECT_EQ(e.at("total").total, sampled * 2);
+  EXPECT_GE(e.at("total").variance, 0);
+
+  // exact query runs on all blocks
+  plan.fraction(0);
+  nebula::execution::core::Approximate exact(plan, outputSchema);
+  EXPECT_EQ(exact.sample(blocks).size(), blocks.size());
+}
+
+TEST(ExecutionTest, TestBlockCache) {
+  nebula::meta::TestTable test;
+  auto size = 1000;
+  Batch batch(test, size);
+  MockRowData row;
+  for (auto i = 0; i < size; ++i) {
+    batch.add(row);
+  }
+
+  auto outputSchema = TypeSerializer::from("ROW<total:bigint>");
+  nebula::execution::BlockPhase plan(test.schema(), outputSchema);
+  nebula::surface::eval::Fields selects;
+  using SumType = UDAF<nebula::type::Kind::BIGINT, nebula::type::Kind::BIGINT, nebula::type::Kind::INTEGER>;
+  selects.push_back(std::make_unique<SumType>(
+    "SUM", column<int32_t>("id"), {}, {}, [](int64_t a, int64_t b) { return a + b; }, {}));
+  plan.scan(test.name())
+    .compute(std::move(selects))
+    .filter(constant<bool>(true))
+    .aggregate(1, { true });
+
+  // only a sealed block fully inside the range is eligible
+  const QueryWindow all{ 0, std::numeric_limits<int64_t>::max() };
+  EXPECT_FALSE(BlockCache::within(batch, all));
+  batch.seal();
+  EXPECT_TRUE(BlockCache::within(batch, all));
+  auto times = batch.histogram<nebula::memory::serde::IntHistogram>(nebula::meta::Table::TIME_COLUMN);
+  EXPECT_TRUE(BlockCache::within(batch, QueryWindow(times.min(), times.max())));
+  EXPECT_FALSE(BlockCache::within(batch, QueryWindow(times.min() + 1, times.max())));
+  EXPECT_FALSE(BlockCache::within(batch, QueryWindow(1, 0)));
+
+  BlockCache cache(1 << 20);
+  EXPECT_EQ(cache.get(&batch, "plan"), nullptr);
+
+  BlockExecutor executor(batch, plan);
+  const auto total = executor.item(0)->readLong("total");
+  cache.put(&batch, "plan", executor.result());
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_GT(cache.bytes(), 0);
+
+  // every hit has its own cursor over the same result
+  for (auto i = 0; i < 2; ++i) {
+    auto cached = cache.get(&batch, "plan");
+    ASSERT_NE(cached, nullptr);
+    EXPECT_EQ(cached->size(), 1);
+    EXPECT_EQ(cached->next().readLong("total"), total);
+  }
+  EXPECT_EQ(cache.hits(), 2);
+  EXPECT_EQ(cache.misses(), 1);
+  EXPECT_EQ(cache.get(&batch, "other"), nullptr);
+
+  // results of a block are dropped along with it
+  cache.put(&batch, "other", executor.result());
+  EXPECT_EQ(cache.size(), 2);
+  cache.invalidate(&batch);
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(cache.bytes(), 0);
+
+  // least recently used results are evicted to keep in budget
+  const auto bytes = [&]() {
+    BlockCache one(1 << 20);
+    one.put(&batch, "p0", executor.result());
+    return one.bytes();
+  }();
+  BlockCache small(bytes * 2);
+  small.put(&batch, "p0", executor.result());
+  small.put(&batch, "p1", executor.result());
+  EXPECT_NE(small.get(&batch, "p0"), nullptr);
+  small.put(&batch, "p2", executor.result());
+  EXPECT_EQ(small.size(), 2);
+  EXPECT_EQ(small.bytes(), bytes * 2);
+  EXPECT_EQ(small.get(&batch, "p1"), nullptr);
+  EXPECT_NE(small.get(&batch, "p0"), nullptr);
+
+  // a block released without invalidation doesn't leak its results to a later block at the same address
+  auto stale = std::make_unique<Batch>(test, size);
+  const auto generation = stale->generation();
+  cache.put(stale.get(), "plan", executor.result());
+  EXPECT_NE(cache.get(stale.get(), "plan"), nullptr);
+  stale.reset();
+  auto fresh = std::make_unique<Batch>(test, size);
+  EXPECT_NE(fresh->generation(), generation);
+  EXPECT_EQ(cache.get(fresh.get(), "plan"), nullptr);
+}
+
+TEST(ExecutionTest, TestWindowBinding) {
+  nebula::meta::TestTable test;
+  auto size = 1000;
+  Batch batch(test, size);
+  MockRowData row;
+  for (auto i = 0; i < size; ++i) {
+    batch.add(row);
+  }
+  batch.seal();
+
+  auto outputSchema = TypeSerializer::from("ROW<total:bigint>");
+  nebula::execution::BlockPhase plan(test.schema(), outputSchema);
+  nebula::surface::eval::Fields selects;
+  using SumType = UDAF<nebula::type::Kind::BIGINT, nebula::type::Kind::BIGINT, nebula::type::Kind::INTEGER>;
+  selects.push_back(std::make_unique<SumType>(
+    "SUM", constant<int32_t>(1), {}, {}, [](int64_t a, int64_t b) { return a + b; }, {}));
+  plan.scan(test.name())
+    .compute(std::move(selects))
+    .filter(constant<bool>(true))
+    .aggregate(1, { true });
+
+  // rows out of the window are dropped at run time, the filter has no time comparison
+  auto times = batch.histogram<nebula::memory::serde::IntHistogram>(nebula::meta::Table::TIME_COLUMN);
+  const QueryWindow window(times.min(), times.min() + (times.max() - times.min()) / 2);
+  int64_t expected = 0;
+  auto accessor = batch.makeAccessor();
+  for (auto i = 0; i < size; ++i) {
+    if (nebula::execution::inWindow(window, accessor->seek(i).readLong(nebula::meta::Table::TIME_COLUMN))) {
+      ++expected;
+    }
+  }
+
+  BlockExecutor executor(batch, plan, "", nullptr, &window);
+  EXPECT_EQ(executor.item(0)->readLong("total"), expected);
+
+  // a window covering the block selects all rows
+  const QueryWindow all{ 0, std::numeric_limits<int64_t>::max() };
+  BlockExecutor full(batch, plan, "", nullptr, &all);
+  EXPECT_EQ(full.item(0)->readLong("total"), size);
+}
+
+TEST(ExecutionTest, TestSelectionCache) {
+  nebula::meta::TestTable test;
+  auto size = 1000;
+  Batch batch(test, size);
+  MockRowData row;
+  for (auto i = 0; i < size; ++i) {
+    batch.add(row);
+  }
+  batch.seal();
+
+  // the same filter with different metrics
+  auto outputSchema = TypeSerializer::from("ROW<total:bigint>");
+  auto setup = [&](nebula::execution::BlockPhase& plan, std::unique_ptr<nebula::surface::eval::ValueEval> input) {
+    nebula::surface::eval::Fields selects;
+    using SumType = UDAF<nebula::type::Kind::BIGINT, nebula::type::Kind::BIGINT, nebula::type::Kind::INTEGER>;
+    selects.push_back(std::make_unique<SumType>(
+      "SUM", std::move(input), {}, {}, [](int64_t a, int64_t b) { return a + b; }, {}));
+    plan.scan(test.name())
+      .compute(std::move(selects))
+      .filter(column<bool>("flag"))
+      .aggregate(1, { true });
+  };
+
+  auto sum = [&](const nebula::execution::BlockPhase& plan, const std::string& selection) {
+    BlockExecutor executor(batch, plan, selection);
+    return executor.item(0)->readLong("total");
+  };
+
+  auto& cache = SelectionCache::singleton();
+  const auto hits = cache.hits();
+  nebula::execution::BlockPhase p1(test.schema(), outputSchema);
+  nebula::execution::BlockPhase p2(test.schema(), outputSchema);
+  setup(p1, column<int32_t>("id"));
+  setup(p2, constant<int32_t>(1));
+  auto expected1 = sum(p1, "");
+  EXPECT_EQ(cache.hits(), hits);
+
+  // the first run records selected rows and later runs of the same filter scan them only
+  EXPECT_EQ(sum(p1, "flag"), expected1);
+  EXPECT_EQ(cache.hits(), hits);
+  auto rows = cache.get(&batch, "flag");
+  ASSERT_NE(rows, nullptr);
+  EXPECT_LE(rows->cardinality(), size);
+  EXPECT_EQ(sum(p1, "flag"), expected1);
+  EXPECT_EQ(sum(p2, "flag"), sum(p2, ""));
+  EXPECT_EQ(cache.hits(), hits + 3);
+
+  // bitmaps of a block are dropped along with it
+  cache.invalidate(&batch);
+  EXPECT_EQ(cache.get(&batch, "flag"), nullptr);
+
+  // least recently used bitmaps are evicted to keep in budget
+  Roaring all;
+  all.addRange(0, size);
+  SelectionCache one(1 << 20);
+  one.put(&batch, "f0", all);
+  const auto bytes = one.bytes();
+  EXPECT_LT(bytes, 100);
+
+  SelectionCache small(bytes * 2);
+  small.put(&batch, "f0", all);
+  small.put(&batch, "f1", all);
+  EXPECT_NE(small.get(&batch, "f0"), nullptr);
+  small.put(&batch, "f2", all);
+  EXPECT_EQ(small.size(), 2);
+  EXPECT_EQ(small.get(&batch, "f1"), nullptr);
+  EXPECT_NE(small.get(&batch, "f0"), nullptr);
+
+  // a block released without invalidation doesn't leak its selections to a later block at the same address
+  auto stale = std::make_unique<Batch>(test, size);
+  one.put(stale.get(), "flag", all);
+  EXPECT_NE(one.get(stale.get(), "flag"), nullptr);
+  stale.reset();
+  auto fresh = std::make_unique<Batch>(test, size);
+  EXPECT_EQ(one.get(fresh.get(), "flag"), nullptr);
+}
+
+TEST(ExecutionTest, TestHedgingRoutes) {
+  using nebula::meta::NNode;
+  using nebula::meta::NRole;
+  std::vector<NNode> nodes{
+    NNode{ NRole::NODE, "n0", 9199 }, NNode{ NRole::NODE, "n1", 9199 }, NNode{ NRole::NODE, "n2", 9199 }, NNode::inproc()
+  };
+
+  // no replicas, every node queries all its blocks and none can be hedged
+  auto routes = Routes::make(nodes, { { "a", { { nodes[0], 10 } } }, { "c", { { nodes[1], 2 } } } });
+  EXPECT_FALSE(routes.scoped);
+  EXPECT_EQ(routes.blocks, std::vector<size_t>({ 10, 2, 0, 0 }));
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    EXPECT_FALSE(routes.skip[i]);
+    EXPECT_TRUE(routes.hedges[i].empty());
+  }
+
+  // replicated specs go to the least loaded holders and hedge to the others
+  routes = Routes::make(nodes, { { "a", { { nodes[0], 10 } } },
+                                 { "b", { { nodes[0], 5 }, { nodes[1], 5 } } },
+                                 { "c", { { nodes[1], 2 } } },
+                                 { "d", { { nodes[2], 3 }, { nodes[1], 3 } } } });
+  EXPECT_TRUE(routes.scoped);
+  EXPECT_EQ(routes.specs[0], std::vector<std::string>({ "a" }));
+  EXPECT_EQ(routes.specs[1], std::vector<std::string>({ "c", "b" }));
+  EXPECT_EQ(routes.specs[2], std::vector<std::string>({ "d" }));
+  EXPECT_TRUE(routes.specs[3].empty());
+  EXPECT_EQ(routes.blocks, std::vector<size_t>({ 10, 7, 3, 0 }));
+
+  // a node is hedged only when every spec of it has a replica
+  EXPECT_TRUE(routes.hedges[0].empty());
+  EXPECT_TRUE(routes.hedges[1].empty());
+  ASSERT_EQ(routes.hedges[2].size(), 1);
+  EXPECT_EQ(routes.hedges[2][0].first, 1);
+  EXPECT_EQ(routes.hedges[2][0].second, std::vector<std::string>({ "d" }));
+  EXPECT_TRUE(routes.hedges[3].empty());
+
+  // a node whose specs are all served by other nodes is skipped
+  routes = Routes::make(nodes, { { "x", { { nodes[0], 4 }, { nodes[1], 4 } } } });
+  EXPECT_TRUE(routes.skip[1]);
+  EXPECT_FALSE(routes.skip[0]);
+  EXPECT_FALSE(routes.skip[3]);
+  ASSERT_EQ(routes.hedges[0].size(), 1);
+  EXPECT_EQ(routes.hedges[0][0].first, 1);
+}
+
+TEST(ExecutionTest, TestNodeLatency) {
+  Latency latency(10);
+  EXPECT_EQ(latency.percentile("n0", 0.95, 1), 0);
+  for (size_t i = 1; i <= 20; ++i) {
+    latency.record("n0", i);
+  }
+
+  // only the most recent samples are kept
+  EXPECT_EQ(latency.percentile("n0", 0, 1), 11);
+  EXPECT_EQ(latency.percentile("n0", 0.95, 5), 20);
+  EXPECT_EQ(latency.percentile("n0", 0.5, 5), 16);
+
+  // not enough samples to tell
+  EXPECT_EQ(latency.percentile("n0", 0.95, 20), 0);
+  EXPECT_EQ(latency.percentile("n1", 0.95, 1), 0);
+}
+
+TEST(ExecutionTest, TestCancelledScan) {
+  nebula::meta::TestTable test;
+  auto size = 10000;
+  Batch batch(test, size);
+  MockRowData row;
+  for (auto i = 0; i < size; ++i) {
+    batch.add(row);
+  }
+
+  auto outputSchema = TypeSerializer::from("ROW<id:int>");
+  nebula::execution::BlockPhase plan(test.schema(), outputSchema);
+  nebula::surface::eval::Fields selects;
+  selects.push_back(column<int32_t>("id"));
+  plan.scan(test.name())
+    .compute(std::move(selects))
+    .filter(constant<bool>(true))
+    .aggregate(0, { false })
+    .limit(size);
+
+  // scan runs through without cancellation
+  nebula::common::Cancellation cancel;
+  auto cursor = nebula::execution::core::compute(batch, plan, 0, "", &cancel);
+  EXPECT_EQ(cursor->size(), size);
+
+  // a cancelled query stops scanning blocks
+  cancel.cancel();
+  EXPECT_THROW(nebula::execution::core::compute(batch, plan, 0, "", &cancel), nebula::common::NebulaException);
+}
+
 } // namespace test
 } // namespace execution
 } // namespace nebula
\ No newline at end of file
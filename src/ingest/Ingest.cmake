@@ -6,6 +6,7 @@ set(NEBULA_INGEST NIngest)
 # build nebula.ingest library
 add_library(${NEBULA_INGEST} STATIC 
     ${NEBULA_SRC}/ingest/IngestSpec.cpp
+    ${NEBULA_SRC}/ingest/Rollup.cpp
     ${NEBULA_SRC}/ingest/SpecRepo.cpp)
 target_link_libraries(${NEBULA_INGEST}
     PUBLIC ${NEBULA_COMMON}
@@ -18,6 +18,7 @@
 
 #include <gflags/gflags.h>
 
+#include "Rollup.h"
 #include "common/Evidence.h"
 #include "execution/BlockManager.h"
 #include "execution/meta/TableService.h"
@@ -138,11 +139,38 @@ bool IngestSpec::load(BlockList& blocks) noexcept {
   // https://stackoverflow.com/questions/32445579/when-a-file-created-with-mkstemp-is-deleted
   unlink(tmpFile.c_str());
 
+  // cube blocks are swapped in along with raw blocks
+  if (result) {
+    this->rollup(blocks);
+  }
+
   // swap each of the blocks into block manager
   // as long as they share the same table / spec
   return result;
 }
 
+void IngestSpec::rollup(BlockList& blocks) const noexcept {
+  try {
+    Rollup rollup(*table_);
+    if (rollup.cube() == nullptr) {
+      return;
+    }
+
+    // a cube covers all raw blocks or none of them
+    BlockList cubes;
+    cubes.reserve(blocks.size());
+    for (const auto& block : blocks) {
+      cubes.push_back(rollup.build(block));
+    }
+
+    TableService::singleton()->enroll(rollup.cube());
+    std::move(cubes.begin(), cubes.end(), std::back_inserter(blocks));
+  } catch (const std::exception& exp) {
+    // raw blocks still serve all queries without cube
+    LOG(ERROR) << "Failed to build rollup cube for " << table_->name << ": " << exp.what();
+  }
+}
+
 bool IngestSpec::loadSwap() noexcept {
   if (table_->source == DataSource::S3) {
     // TODO(cao) - make a better size estimation to understand total blocks to have
@@ -230,10 +258,13 @@ bool IngestSpec::loadKafka() noexcept {
     batch->add(row);
   }
 
-  // build a block and add it to block manager
-  BlockManager::init()->add(
+  // build a block along with its rollup cube and add them to block manager
+  BlockList blocks;
+  blocks.push_back(
     BlockLoader::from(
       BlockSignature{ table->name(), 0, lowTime, highTime, signature_ }, batch));
+  this->rollup(blocks);
+  BlockManager::init()->add(std::move(blocks));
 
   // iterate this read until it reaches end of the segment - blocking queue?
   return true;
@@ -291,6 +322,12 @@ private:
   const RowData* row_;
 };
 
+// Note: time column can not be NULL
+// unfortunately if the data has it as null, we return 1 as indicator
+// we can not use 0, because Nebula doesn't allow query time range fall into 0 start/end.
+static constexpr size_t NULL_TIME = 1;
+static constexpr auto UNIX_TS = "UNIXTIME";
+
 bool IngestSpec::ingest(const std::string& file, BlockList& blocks) noexcept {
   // TODO(cao) - support column selection in ingestion and expand time column
   // to other columns for simple transformation
@@ -316,11 +353,6 @@ bool IngestSpec::ingest(const std::string& file, BlockList& blocks) noexcept {
     // and unix time stamp value as bigint if pattern is absent.
     // ts.pattern is required: time string pattern or special value such as UNIXTIME
 
-    // Note: time column can not be NULL
-    // unfortunately if the data has it as null, we return 1 as indicator
-    // we can not use 0, because Nebula doesn't allow query time range fall into 0 start/end.
-    static constexpr size_t NULL_TIME = 1;
-    constexpr auto UNIX_TS = "UNIXTIME";
     if (ts.pattern == UNIX_TS) {
       timeFunc = [&ts](const RowData* r) {
         if (UNLIKELY(r->isNull(ts.colName))) {
@@ -391,7 +423,7 @@ bool IngestSpec::ingest(const std::string& file, BlockList& blocks) noexcept {
   // limit at 1b on single host
   const size_t bRows = FLAGS_NBLOCK_MAX_ROWS;
   auto batch = std::make_shared<Batch>(*table, bRows);
-  RowWrapperWithTime rw{ std::move(timeFunc) };
+  RowWrapperWithTime rw{ timeFunc };
   std::pair<size_t, size_t> range{ std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::min() };
 
   // a lambda to build batch block
@@ -407,6 +439,58 @@ bool IngestSpec::ingest(const std::string& file, BlockList& blocks) noexcept {
       b);
   };
 
+  // columnar source is ingested by column chunks unless time value is derived from other value per row
+  const auto& ts = table_->timeSpec;
+  auto parquet = dynamic_cast<ParquetReader*>(source.get());
+  auto timeColumn = timeType == TimeType::COLUMN;
+  auto columnar = parquet != nullptr;
+  if (timeColumn) {
+    auto timeKind = nebula::type::Kind::INVALID;
+    schema->onChild(ts.colName, [&timeKind](const nebula::type::TypeNode& node) {
+      timeKind = node->k();
+    });
+    columnar = columnar && ts.pattern == UNIX_TS && timeKind == nebula::type::Kind::BIGINT;
+  }
+
+  nebula::common::Evidence::Duration duration;
+  size_t rows = 0;
+  std::vector<int64_t> times;
+  while (columnar && source->hasNext()) {
+    // if this is already full
+    if (batch->getRows() >= bRows) {
+      blocks.push_back(makeBlock(blockId++, batch));
+      batch = std::make_shared<Batch>(*table, bRows);
+      range = { std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::min() };
+    }
+
+    times.clear();
+    auto read = parquet->nextChunk(
+      bRows - batch->getRows(),
+      [&batch, &times, &ts, timeColumn](const std::string& name, nebula::type::Kind, const void* values, const uint8_t* validity, size_t count) {
+        batch->appendChunk(name, values, count, validity);
+        if (timeColumn && name == ts.colName) {
+          auto longs = static_cast<const int64_t*>(values);
+          for (size_t i = 0; i < count; ++i) {
+            times.push_back(nebula::memory::serde::isValid(validity, i) ? longs[i] : NULL_TIME);
+          }
+        }
+      });
+
+    if (!timeColumn) {
+      times.assign(read, timeFunc(nullptr));
+    }
+
+    for (auto time : times) {
+      range.first = std::min<size_t>(range.first, time);
+      range.second = std::max<size_t>(range.second, time);
+    }
+
+    // time column is appended as the last chunk before rows committed
+    batch->append(Table::TIME_COLUMN, times.data(), read, nullptr);
+    batch->commit(read);
+    rows += read;
+  }
+
   while (source->hasNext()) {
     auto& row = source->next();
     rw.set(&row);
@@ -434,8 +518,13 @@ bool IngestSpec::ingest(const std::string& file, BlockList& blocks) noexcept {
 
     // add a new entry
     batch->add(rw);
+    rows++;
   }
 
+  const auto ms = duration.elapsedMs();
+  LOG(INFO) << fmt::format("Ingested {0} rows from {1} via {2} path in {3}ms: {4} rows/sec",
+                           rows, file, columnar ? "column" : "row", ms, rows * 1000 / std::max<size_t>(ms, 1));
+
   // move all blocks in map into block manager
   if (batch->getRows() > 0) {
     blocks.push_back(makeBlock(blockId++, batch));
@@ -75,6 +75,7 @@ public:
       state_{ state },
       mdate_{ date },
       node_{ nebula::meta::NNode::invalid() },
+      replica_{ nebula::meta::NNode::invalid() },
       signature_{ fmt::format("{0}@{1}@{2}", table_->name, id_, size_) } {}
   virtual ~IngestSpec() = default;
 
@@ -116,6 +117,19 @@ public:
     return !node_.isInvalid();
   }
 
+  // a second node holding the same data to serve queries when the first one is slow or down
+  inline void setReplica(const nebula::meta::NNode& node) {
+    replica_ = node;
+  }
+
+  inline const nebula::meta::NNode& replica() const {
+    return replica_;
+  }
+
+  inline bool replicated() const {
+    return !replica_.isInvalid();
+  }
+
   inline bool needSync() const {
     return state_ != SpecState::READY;
   }
@@ -156,6 +170,9 @@ private:
   // load current spec as blocks
   bool load(BlockList&) noexcept;
 
+  // append rollup cube blocks of raw blocks if the table defines rollup
+  void rollup(BlockList&) const noexcept;
+
 private:
   nebula::meta::TableSpecPtr table_;
   std::string version_;
@@ -170,6 +187,9 @@ private:
   // node info if the spec has affinity on a node
   nebula::meta::NNode node_;
 
+  // replica node of the spec if any
+  nebula::meta::NNode replica_;
+
   // global unique identifier.
   // not like id which is unique for a given table
   std::string signature_;
@@ -0,0 +1,256 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "Rollup.h"
+
+#include <unordered_map>
+
+/**
+ * Build rollup cube blocks at ingestion.
+ */
+namespace nebula {
+namespace ingest {
+
+using nebula::execution::io::BatchBlock;
+using nebula::execution::io::BlockLoader;
+using nebula::memory::Batch;
+using nebula::memory::RowAccessor;
+using nebula::meta::BlockSignature;
+using nebula::meta::Table;
+using nebula::meta::TableSpec;
+using nebula::surface::RowData;
+using nebula::type::Kind;
+
+namespace {
+
+// a metric column summed up in a cube, read in its raw kind
+struct Metric {
+  std::string name;
+  Kind kind;
+};
+
+// aggregated values of one cube row
+struct Group {
+  // a raw row to read dimension values from
+  size_t row;
+  int64_t time;
+  int64_t count;
+  std::vector<int64_t> longs;
+  std::vector<double> doubles;
+};
+
+// a cube row reads dimensions from its raw row and aggregated values from its group
+class CubeRow : public RowData {
+public:
+  CubeRow(RowAccessor& raw, const std::unordered_map<std::string, size_t>& slots)
+    : raw_{ raw }, slots_{ slots }, group_{ nullptr } {}
+
+  void set(const Group& group) {
+    group_ = &group;
+    raw_.seek(group.row);
+  }
+
+  bool isNull(const std::string& field) const override {
+    return slots_.count(field) == 0 && field != Table::TIME_COLUMN && field != Table::COUNT_COLUMN && raw_.isNull(field);
+  }
+
+  bool readBool(const std::string& field) const override {
+    return raw_.readBool(field);
+  }
+
+  int8_t readByte(const std::string& field) const override {
+    return raw_.readByte(field);
+  }
+
+  int16_t readShort(const std::string& field) const override {
+    return raw_.readShort(field);
+  }
+
+  int32_t readInt(const std::string& field) const override {
+    return raw_.readInt(field);
+  }
+
+  int64_t readLong(const std::string& field) const override {
+    if (field == Table::TIME_COLUMN) {
+      return group_->time;
+    }
+
+    if (field == Table::COUNT_COLUMN) {
+      return group_->count;
+    }
+
+    auto itr = slots_.find(field);
+    return itr == slots_.end() ? raw_.readLong(field) : group_->longs.at(itr->second);
+  }
+
+  float readFloat(const std::string& field) const override {
+    return raw_.readFloat(field);
+  }
+
+  double readDouble(const std::string& field) const override {
+    auto itr = slots_.find(field);
+    return itr == slots_.end() ? raw_.readDouble(field) : group_->doubles.at(itr->second);
+  }
+
+  int128_t readInt128(const std::string& field) const override {
+    return raw_.readInt128(field);
+  }
+
+  std::string_view readString(const std::string& field) const override {
+    return raw_.readString(field);
+  }
+
+  std::unique_ptr<nebula::surface::ListData> readList(const std::string& field) const override {
+    return raw_.readList(field);
+  }
+
+  std::unique_ptr<nebula::surface::MapData> readMap(const std::string& field) const override {
+    return raw_.readMap(field);
+  }
+
+private:
+  RowAccessor& raw_;
+  const std::unordered_map<std::string, size_t>& slots_;
+  const Group* group_;
+};
+
+template <typename T>
+inline void append(std::string& key, T value) {
+  key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+} // namespace
+
+Rollup::Rollup(const TableSpec& spec)
+  : cube_{ spec.cube() }, dimensions_{ spec.rollup() } {}
+
+std::shared_ptr<Batch> Rollup::build(const Batch& raw) const {
+  N_ENSURE_NOT_NULL(cube_, "rollup is not defined");
+  const auto schema = raw.schema();
+  const auto cube = cube_->schema();
+
+  // dimensions and metrics in cube order with their raw kinds
+  std::vector<std::pair<std::string, Kind>> dimensions;
+  std::vector<Metric> metrics;
+  std::unordered_map<std::string, size_t> slots;
+  for (size_t i = 0, size = cube->size(); i < size; ++i) {
+    const auto& name = cube->childType(i)->name();
+    if (name == Table::TIME_COLUMN || name == Table::COUNT_COLUMN) {
+      continue;
+    }
+
+    Kind kind = Kind::INVALID;
+    schema->onChild(name, [&kind](const nebula::type::TypeNode& node) {
+      kind = node->k();
+    });
+
+    if (dimensions_.count(name) > 0) {
+      dimensions.emplace_back(name, kind);
+      continue;
+    }
+
+    slots[name] = metrics.size();
+    metrics.push_back({ name, kind });
+  }
+
+  // group rows by minute and dimension values
+  std::unordered_map<std::string, size_t> index;
+  std::vector<Group> groups;
+  auto accessor = raw.makeAccessor();
+  std::string key;
+  for (size_t r = 0, rows = raw.getRows(); r < rows; ++r) {
+    const auto& row = accessor->seek(r);
+    auto time = row.readLong(Table::TIME_COLUMN);
+    time -= ((time % Table::ROLLUP_BUCKET) + Table::ROLLUP_BUCKET) % Table::ROLLUP_BUCKET;
+
+    key.clear();
+    append(key, time);
+    for (const auto& d : dimensions) {
+      const auto& name = d.first;
+      const auto null = row.isNull(name);
+      append(key, null);
+      if (null) {
+        continue;
+      }
+
+      switch (d.second) {
+      case Kind::BOOLEAN: append(key, row.readBool(name)); break;
+      case Kind::TINYINT: append(key, row.readByte(name)); break;
+      case Kind::SMALLINT: append(key, row.readShort(name)); break;
+      case Kind::INTEGER: append(key, row.readInt(name)); break;
+      case Kind::BIGINT: append(key, row.readLong(name)); break;
+      case Kind::REAL: append(key, row.readFloat(name)); break;
+      case Kind::DOUBLE: append(key, row.readDouble(name)); break;
+      case Kind::INT128: append(key, row.readInt128(name)); break;
+      case Kind::VARCHAR: {
+        auto str = row.readString(name);
+        append(key, str.size());
+        key.append(str.data(), str.size());
+        break;
+      }
+      default: throw NException(fmt::format("rollup dimension {0} should be a scalar column", name));
+      }
+    }
+
+    auto itr = index.find(key);
+    if (itr == index.end()) {
+      itr = index.emplace(key, groups.size()).first;
+      groups.push_back({ r, time, 0, std::vector<int64_t>(metrics.size(), 0), std::vector<double>(metrics.size(), 0) });
+    }
+
+    auto& group = groups.at(itr->second);
+    group.count += 1;
+    for (size_t m = 0; m < metrics.size(); ++m) {
+      const auto& metric = metrics.at(m);
+      if (row.isNull(metric.name)) {
+        continue;
+      }
+
+      switch (metric.kind) {
+      case Kind::TINYINT: group.longs[m] += row.readByte(metric.name); break;
+      case Kind::SMALLINT: group.longs[m] += row.readShort(metric.name); break;
+      case Kind::INTEGER: group.longs[m] += row.readInt(metric.name); break;
+      case Kind::BIGINT: group.longs[m] += row.readLong(metric.name); break;
+      case Kind::REAL: group.doubles[m] += row.readFloat(metric.name); break;
+      case Kind::DOUBLE: group.doubles[m] += row.readDouble(metric.name); break;
+      default: break;
+      }
+    }
+  }
+
+  // write every group as a cube row
+  auto batch = std::make_shared<Batch>(*cube_, std::max<size_t>(groups.size(), 1));
+  auto reader = raw.makeAccessor();
+  CubeRow cr{ *reader, slots };
+  for (const auto& group : groups) {
+    cr.set(group);
+    batch->add(cr);
+  }
+
+  return batch;
+}
+
+BatchBlock Rollup::build(const BatchBlock& block) const {
+  const auto& sign = block.signature();
+  const auto start = sign.start - sign.start % Table::ROLLUP_BUCKET;
+  return BlockLoader::from(
+    BlockSignature{ cube_->name(), sign.id, start, sign.end, sign.spec },
+    build(*block.data()));
+}
+
+} // namespace ingest
+} // namespace nebula
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <unordered_set>
+
+#include "execution/io/BlockLoader.h"
+#include "memory/Batch.h"
+#include "meta/TableSpec.h"
+
+/**
+ * Rollup aggregates rows of a raw block into a block of its rollup cube.
+ * Rows are grouped by minute of their time and values of rollup dimensions,
+ * numeric columns are summed up and rows are counted per group.
+ */
+namespace nebula {
+namespace ingest {
+
+class Rollup {
+public:
+  explicit Rollup(const nebula::meta::TableSpec&);
+  virtual ~Rollup() = default;
+
+  // cube table, nullptr if the table has no rollup defined
+  inline const std::shared_ptr<nebula::meta::Table>& cube() const {
+    return cube_;
+  }
+
+  // aggregate a raw batch into a cube batch
+  std::shared_ptr<nebula::memory::Batch> build(const nebula::memory::Batch&) const;
+
+  // build the cube block of a raw block, it shares id and spec of the raw block
+  nebula::execution::io::BatchBlock build(const nebula::execution::io::BatchBlock&) const;
+
+private:
+  std::shared_ptr<nebula::meta::Table> cube_;
+  std::unordered_set<std::string> dimensions_;
+};
+
+} // namespace ingest
+} // namespace nebula
@@ -27,6 +27,7 @@ DEFINE_uint64(KAFKA_SPEC_ROWS,
               "rows per sepc for kafka ingestion"
               "this value is used in spec identifier so do not modify");
 DEFINE_uint64(KAFKA_TIMEOUT_MS, 5000, "Timeout of each Kafka API call");
+DEFINE_uint64(SPEC_REPLICAS, 1, "number of nodes every spec is assigned to (1 or 2), replicas serve queries of a late or failed node");
 
 /**
  * We will sync etcd configs for cluster info into this memory object
@@ -229,6 +230,7 @@ void SpecRepo::update(const std::vector<std::shared_ptr<IngestSpec>>& specs) noe
       // by default, we carry over existing spec's properties
       const auto& node = prev->affinity();
       specPtr->setAffinity(node);
+      specPtr->setReplica(prev->replica());
       specPtr->setState(prev->state());
 
       // TODO(cao) - use only size for the checker for now, may extend to other properties
@@ -242,6 +244,10 @@ void SpecRepo::update(const std::vector<std::shared_ptr<IngestSpec>>& specs) noe
       if (!node.isActive()) {
         specPtr->setAffinity(NNode::invalid());
       }
+
+      if (!prev->replica().isActive()) {
+        specPtr->setReplica(NNode::invalid());
+      }
     }
 
     // move to the next version
@@ -278,8 +284,18 @@ bool SpecRepo::assign(const std::string& spec, const nebula::meta::NNode& node)
     return true;
   }
 
-  // not in the same node
+  // the replica holding the same spec
+  if (sp->replica().equals(node)) {
+    return true;
+  }
+
   auto& assignment = sp->affinity();
+  if (!assignment.equals(node) && FLAGS_SPEC_REPLICAS > 1 && !sp->replicated()) {
+    sp->setReplica(node);
+    return true;
+  }
+
+  // not in the same node
   if (!assignment.equals(node)) {
     LOG(INFO) << "Spec [" << spec << "] moves from " << node.server << " to " << assignment.server;
     return false;
@@ -303,28 +319,42 @@ void SpecRepo::assign(const std::vector<NNode>& nodes) noexcept {
 
   size_t idx = 0;
 
+  // next active node from idx in round-robin order other than the excluded one, nullptr if none
+  auto next = [&nodes, &idx, size](const NNode& exclude) -> const NNode* {
+    for (size_t i = 0; i < size; ++i) {
+      auto& n = nodes.at(idx);
+      idx = (idx + 1) % size;
+      if (n.isActive() && !n.equals(exclude)) {
+        return &n;
+      }
+    }
+
+    return nullptr;
+  };
+
   // for each spec
   // TODO(cao): should we do hash-based shuffling here to ensure a stable assignment?
   // Round-robin is easy to break the position affinity whenever new spec is coming
   // Or we can keep order of the specs so that any old spec is associated.
+  const auto replicas = FLAGS_SPEC_REPLICAS > 1;
   for (auto& spec : specs_) {
     // not assigned yet
     auto sp = spec.second;
     if (!sp->assigned()) {
-      auto startId = idx;
-      while (true) {
-        auto& n = nodes.at(idx);
-        if (n.isActive()) {
-          sp->setAffinity(n);
-          idx = (idx + 1) % size;
-          break;
-        }
-
-        idx = (idx + 1) % size;
-        if (idx == startId) {
-          LOG(ERROR) << "No active node found to assign spec.";
-          return;
-        }
+      auto n = next(NNode::invalid());
+      if (n == nullptr) {
+        LOG(ERROR) << "No active node found to assign spec.";
+        return;
+      }
+
+      sp->setAffinity(*n);
+    }
+
+    // replica goes to a different node, it is skipped in single node cluster
+    if (replicas && !sp->replicated()) {
+      auto n = next(sp->affinity());
+      if (n != nullptr) {
+        sp->setReplica(*n);
       }
     }
   }
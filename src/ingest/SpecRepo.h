@@ -35,6 +35,9 @@
  * 
  * A spec may produce multiple data blocks, if anything failing in the middle, 
  * the data node will clean them up and tell server it doesn't finish the task. Server will re-assign later.
+ *
+ * A spec may be assigned to a second node as its replica (SPEC_REPLICAS), so that queries can be served
+ * by the replica when the first node is slow or down.
  */
 namespace nebula {
 namespace ingest {
@@ -58,7 +61,7 @@ public:
   }
 
   // try to assign a node to a spec
-  // assign the spec for given node
+  // assign the spec for given node, or as its replica if SPEC_REPLICAS allows
   bool assign(const std::string& spec, const nebula::meta::NNode& node) noexcept;
 
 private:
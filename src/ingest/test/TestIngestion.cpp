@@ -17,11 +17,14 @@
 #include <fmt/format.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <map>
 
 #include "ingest/IngestSpec.h"
+#include "ingest/Rollup.h"
 #include "ingest/SpecRepo.h"
 #include "meta/ClusterInfo.h"
 #include "meta/TableSpec.h"
+#include "surface/StaticData.h"
 
 namespace nebula {
 namespace ingest {
@@ -59,6 +62,61 @@ TEST(IngestTest, TestSpecGeneration) {
   }
 #endif
 }
+TEST(IngestTest, TestRollupCube) {
+  nebula::meta::TimeSpec ts;
+  nebula::meta::AccessSpec as;
+  nebula::meta::ColumnProps cp;
+  nebula::meta::KafkaSerde sd;
+  std::unordered_map<std::string, std::string> settings{ { nebula::meta::TableSpec::ROLLUP, "event,flag" } };
+  nebula::meta::TableSpec spec(
+    "test", 1000, 10, "ROW<id:int, event:string, flag:bool, value:tinyint, weight:double>",
+    nebula::meta::DataSource::S3, "swap", "s3://test", "s3://bak", "csv",
+    std::move(sd), std::move(cp), std::move(ts), std::move(as), std::move(settings));
+
+  // cube keeps dimensions, time, sums of numeric columns and row count
+  auto cube = spec.cube();
+  ASSERT_TRUE(cube != nullptr);
+  EXPECT_EQ(cube->name(), "test.rollup");
+  EXPECT_EQ(nebula::type::TypeSerializer::to(cube->schema()),
+            "STRUCT<event:VARCHAR,flag:BOOLEAN,_time_:BIGINT,id:BIGINT,value:BIGINT,weight:DOUBLE,_count_:BIGINT>");
+
+  // 5 minutes of rows over 2 events and 2 flags
+  const auto size = 3000;
+  auto table = spec.to();
+  nebula::memory::Batch batch(*table, size);
+  std::vector<std::string> events{ "a", "b" };
+  using Key = std::tuple<int64_t, std::string, bool>;
+  std::map<Key, std::tuple<int64_t, int64_t, int64_t, double>> expected;
+  for (auto i = 0; i < size; ++i) {
+    const int64_t time = i % 300;
+    const auto& event = events.at(i % 2);
+    const bool flag = i % 3 == 0;
+    const char value = i % 7;
+    const double weight = i * 0.5;
+    nebula::surface::StaticRow row(time, i, event, nullptr, flag, value, 0, weight);
+    batch.add(row);
+
+    auto& e = expected[{ time - time % 60, event, flag }];
+    std::get<0>(e) += 1;
+    std::get<1>(e) += i;
+    std::get<2>(e) += row.isNull("value") ? 0 : value;
+    std::get<3>(e) += weight;
+  }
+
+  Rollup rollup(spec);
+  auto result = rollup.build(batch);
+  EXPECT_EQ(result->getRows(), expected.size());
+  auto accessor = result->makeAccessor();
+  for (size_t i = 0; i < result->getRows(); ++i) {
+    const auto& r = accessor->seek(i);
+    const auto& e = expected.at({ r.readLong("_time_"), std::string(r.readString("event")), r.readBool("flag") });
+    EXPECT_EQ(r.readLong("_count_"), std::get<0>(e));
+    EXPECT_EQ(r.readLong("id"), std::get<1>(e));
+    EXPECT_EQ(r.readLong("value"), std::get<2>(e));
+    EXPECT_DOUBLE_EQ(r.readDouble("weight"), std::get<3>(e));
+  }
+}
+
 } // namespace test
 } // namespace ingest
 } // namespace nebula
\ No newline at end of file
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "ArrowExporter.h"
+#include <arrow/io/memory.h>
+#include <arrow/ipc/writer.h>
+#include <fmt/format.h>
+#include <functional>
+#include "common/Errors.h"
+
+/**
+ * Export nebula rows as arrow record batch and arrow IPC stream.
+ */
+namespace nebula {
+namespace memory {
+
+using nebula::surface::RowData;
+using nebula::type::Kind;
+using nebula::type::Schema;
+
+#define ARROW_ENSURE(expr)                    \
+  {                                           \
+    auto status = (expr);                     \
+    N_ENSURE(status.ok(), status.ToString()); \
+  }
+
+// build arrow arrays from rows column by column
+class RecordBatchBuilder {
+  using Appender = std::function<::arrow::Status(const RowData&)>;
+
+public:
+  RecordBatchBuilder(const Schema& schema) : rows_{ 0 } {
+    auto pool = ::arrow::default_memory_pool();
+
+#define BUILD_COLUMN(K, B, T, R)                                                   \
+  case Kind::K: {                                                                  \
+    auto builder = std::make_unique<::arrow::B>(pool);                             \
+    appenders_.push_back([b = builder.get(), name](const RowData& row) {           \
+      return row.isNull(name) ? b->AppendNull() : b->Append(row.R(name));          \
+    });                                                                            \
+    fields_.push_back(::arrow::field(name, ::arrow::T()));                         \
+    builders_.push_back(std::move(builder));                                       \
+    break;                                                                         \
+  }
+
+    for (size_t i = 0, size = schema->size(); i < size; ++i) {
+      auto type = schema->childType(i);
+      const auto name = type->name();
+      switch (type->k()) {
+        BUILD_COLUMN(BOOLEAN, BooleanBuilder, boolean, readBool)
+        BUILD_COLUMN(TINYINT, Int8Builder, int8, readByte)
+        BUILD_COLUMN(SMALLINT, Int16Builder, int16, readShort)
+        BUILD_COLUMN(INTEGER, Int32Builder, int32, readInt)
+        BUILD_COLUMN(BIGINT, Int64Builder, int64, readLong)
+        BUILD_COLUMN(REAL, FloatBuilder, float32, readFloat)
+        BUILD_COLUMN(DOUBLE, DoubleBuilder, float64, readDouble)
+      case Kind::VARCHAR: {
+        auto builder = std::make_unique<::arrow::StringBuilder>(pool);
+        appenders_.push_back([b = builder.get(), name](const RowData& row) {
+          if (row.isNull(name)) {
+            return b->AppendNull();
+          }
+
+          auto str = row.readString(name);
+          return b->Append(str.data(), str.size());
+        });
+        fields_.push_back(::arrow::field(name, ::arrow::utf8()));
+        builders_.push_back(std::move(builder));
+        break;
+      }
+      case Kind::INT128: {
+        // int128 is exported as 16 bytes fixed size binary
+        auto t = ::arrow::fixed_size_binary(sizeof(int128_t));
+        auto builder = std::make_unique<::arrow::FixedSizeBinaryBuilder>(t, pool);
+        appenders_.push_back([b = builder.get(), name](const RowData& row) {
+          if (row.isNull(name)) {
+            return b->AppendNull();
+          }
+
+          auto v = row.readInt128(name);
+          return b->Append(reinterpret_cast<const uint8_t*>(&v));
+        });
+        fields_.push_back(::arrow::field(name, t));
+        builders_.push_back(std::move(builder));
+        break;
+      }
+      default:
+        throw NException(fmt::format("Arrow export not supported for column: {0}", name));
+      }
+    }
+
+#undef BUILD_COLUMN
+  }
+
+  void add(const RowData& row) {
+    for (auto& appender : appenders_) {
+      ARROW_ENSURE(appender(row))
+    }
+    ++rows_;
+  }
+
+  std::shared_ptr<::arrow::RecordBatch> finish() {
+    std::vector<std::shared_ptr<::arrow::Array>> arrays;
+    arrays.reserve(builders_.size());
+    for (auto& builder : builders_) {
+      std::shared_ptr<::arrow::Array> array;
+      ARROW_ENSURE(builder->Finish(&array))
+      arrays.push_back(array);
+    }
+
+    return ::arrow::RecordBatch::Make(std::make_shared<::arrow::Schema>(fields_), rows_, arrays);
+  }
+
+private:
+  size_t rows_;
+  std::vector<std::unique_ptr<::arrow::ArrayBuilder>> builders_;
+  std::vector<std::shared_ptr<::arrow::Field>> fields_;
+  std::vector<Appender> appenders_;
+};
+
+std::shared_ptr<::arrow::RecordBatch> ArrowExporter::convert(const Schema& schema, nebula::surface::RowCursor& cursor) {
+  RecordBatchBuilder builder(schema);
+  while (cursor.hasNext()) {
+    builder.add(cursor.next());
+  }
+
+  return builder.finish();
+}
+
+std::shared_ptr<::arrow::RecordBatch> ArrowExporter::convert(const nebula::memory::keyed::FlatBuffer& fb) {
+  RecordBatchBuilder builder(fb.schema());
+  for (size_t i = 0, size = fb.getRows(); i < size; ++i) {
+    builder.add(*fb.crow(i));
+  }
+
+  return builder.finish();
+}
+
+std::shared_ptr<::arrow::RecordBatch> ArrowExporter::convert(nebula::memory::keyed::HashFlat& hf) {
+  hf.flush();
+  return convert(static_cast<const nebula::memory::keyed::FlatBuffer&>(hf));
+}
+
+std::shared_ptr<::arrow::Buffer> ArrowExporter::stream(const std::vector<std::shared_ptr<::arrow::RecordBatch>>& batches) {
+  N_ENSURE(!batches.empty(), "at least one record batch expected");
+  auto pool = ::arrow::default_memory_pool();
+  std::shared_ptr<::arrow::io::BufferOutputStream> sink;
+  ARROW_ENSURE(::arrow::io::BufferOutputStream::Create(4096, pool, &sink))
+
+  std::shared_ptr<::arrow::ipc::RecordBatchWriter> writer;
+  ARROW_ENSURE(::arrow::ipc::RecordBatchStreamWriter::Open(sink.get(), batches.front()->schema(), &writer))
+  for (auto& rb : batches) {
+    ARROW_ENSURE(writer->WriteRecordBatch(*rb))
+  }
+  ARROW_ENSURE(writer->Close())
+
+  std::shared_ptr<::arrow::Buffer> buffer;
+  ARROW_ENSURE(sink->Finish(&buffer))
+  return buffer;
+}
+
+#undef ARROW_ENSURE
+
+} // namespace memory
+} // namespace nebula
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <arrow/api.h>
+#include "memory/keyed/FlatBuffer.h"
+#include "memory/keyed/HashFlat.h"
+#include "surface/DataSurface.h"
+#include "type/Type.h"
+
+/**
+ * Export nebula rows (such as query results in flat buffer or hash flat) as arrow record batch
+ * and arrow IPC stream, so that arrow consumers can read them without row parsing.
+ */
+namespace nebula {
+namespace memory {
+
+class ArrowExporter {
+public:
+  // convert all remaining rows of a cursor into a record batch of given schema
+  static std::shared_ptr<::arrow::RecordBatch> convert(const nebula::type::Schema&, nebula::surface::RowCursor&);
+
+  // convert all rows of a flat buffer into a record batch
+  static std::shared_ptr<::arrow::RecordBatch> convert(const nebula::memory::keyed::FlatBuffer&);
+
+  // convert all rows of a hash flat into a record batch, accumulated states are flushed into rows first
+  static std::shared_ptr<::arrow::RecordBatch> convert(nebula::memory::keyed::HashFlat&);
+
+  // serialize record batches in arrow IPC stream format
+  static std::shared_ptr<::arrow::Buffer> stream(const std::vector<std::shared_ptr<::arrow::RecordBatch>>&);
+};
+
+} // namespace memory
+} // namespace nebula
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "ArrowImporter.h"
+#include <fmt/format.h>
+#include "common/Errors.h"
+
+/**
+ * Import arrow record batches into nebula batch through column chunk append.
+ */
+namespace nebula {
+namespace memory {
+
+using nebula::type::Kind;
+
+// arrow validity bitmap starts at bit offset of the array, realign it when needed
+static const uint8_t* validity(const ::arrow::Array& array, std::vector<uint8_t>& buffer) {
+  if (array.null_count() == 0) {
+    return nullptr;
+  }
+
+  const auto bits = array.null_bitmap_data();
+  const auto offset = array.offset();
+  if ((offset & 7) == 0) {
+    return bits + (offset >> 3);
+  }
+
+  const size_t size = array.length();
+  buffer.assign((size + 7) >> 3, 0);
+  for (size_t i = 0; i < size; ++i) {
+    const size_t bit = offset + i;
+    if ((bits[bit >> 3] >> (bit & 7)) & 1) {
+      buffer[i >> 3] |= (1 << (i & 7));
+    }
+  }
+
+  return buffer.data();
+}
+
+// append a column chunk converted from given arrow array
+static void appendColumn(const std::string& name, Kind kind, const ::arrow::Array& array, Batch& batch, std::vector<uint8_t>& bits) {
+  const size_t rows = array.length();
+
+#define IMPORT_NUMBER_CHUNK(K, AT, AA)                                               \
+  case Kind::K: {                                                                    \
+    N_ENSURE_EQ(array.type_id(), ::arrow::Type::AT, "arrow type mismatch");          \
+    const auto& typed = static_cast<const ::arrow::AA&>(array);                      \
+    batch.append(name, typed.raw_values(), rows, validity(array, bits));             \
+    break;                                                                           \
+  }
+
+  switch (kind) {
+    IMPORT_NUMBER_CHUNK(TINYINT, INT8, Int8Array)
+    IMPORT_NUMBER_CHUNK(SMALLINT, INT16, Int16Array)
+    IMPORT_NUMBER_CHUNK(INTEGER, INT32, Int32Array)
+    IMPORT_NUMBER_CHUNK(BIGINT, INT64, Int64Array)
+    IMPORT_NUMBER_CHUNK(REAL, FLOAT, FloatArray)
+    IMPORT_NUMBER_CHUNK(DOUBLE, DOUBLE, DoubleArray)
+  case Kind::BOOLEAN: {
+    // arrow packs booleans in bits
+    N_ENSURE_EQ(array.type_id(), ::arrow::Type::BOOL, "arrow type mismatch");
+    const auto& typed = static_cast<const ::arrow::BooleanArray&>(array);
+    std::unique_ptr<bool[]> values(new bool[rows]);
+    for (size_t r = 0; r < rows; ++r) {
+      values[r] = typed.Value(r);
+    }
+
+    batch.append(name, values.get(), rows, validity(array, bits));
+    break;
+  }
+  case Kind::VARCHAR: {
+    N_ENSURE_EQ(array.type_id(), ::arrow::Type::STRING, "arrow type mismatch");
+    const auto& typed = static_cast<const ::arrow::StringArray&>(array);
+    std::vector<std::string_view> values;
+    values.reserve(rows);
+    for (size_t r = 0; r < rows; ++r) {
+      const auto view = typed.GetView(r);
+      values.emplace_back(view.data(), view.size());
+    }
+
+    batch.append(name, values.data(), rows, validity(array, bits));
+    break;
+  }
+  default:
+    throw NException(fmt::format("Arrow import not supported for column: {0}", name));
+  }
+
+#undef IMPORT_NUMBER_CHUNK
+}
+
+size_t ArrowImporter::append(const ::arrow::RecordBatch& rb, Batch& batch) {
+  const auto& schema = batch.schema();
+  std::vector<uint8_t> bits;
+  for (size_t i = 0, size = schema->size(); i < size; ++i) {
+    auto type = schema->childType(i);
+    auto array = rb.GetColumnByName(type->name());
+    if (array != nullptr) {
+      appendColumn(type->name(), type->k(), *array, batch, bits);
+    }
+  }
+
+  return rb.num_rows();
+}
+
+size_t ArrowImporter::import(const ::arrow::RecordBatch& rb, Batch& batch) {
+  const auto rows = append(rb, batch);
+  batch.commit(rows);
+  return rows;
+}
+
+size_t ArrowImporter::adopt(const std::shared_ptr<::arrow::RecordBatch>& rb, Batch& batch) {
+  N_ENSURE_EQ(batch.getRows(), 0, "only empty batch can adopt arrow buffers");
+  const size_t rows = rb->num_rows();
+  const auto& schema = batch.schema();
+  std::vector<uint8_t> bits;
+
+  // nebula keeps a slot for null value as arrow does, so numbers share the same layout
+#define ADOPT_NUMBER_CHUNK(K, AT, AA)                                                              \
+  case Kind::K: {                                                                                  \
+    if (array->type_id() == ::arrow::Type::AT && array->offset() == 0) {                           \
+      const auto& typed = static_cast<const ::arrow::AA&>(*array);                                 \
+      batch.adopt(name, typed.raw_values(), rows, validity(*array, bits), rb);                     \
+      continue;                                                                                    \
+    }                                                                                              \
+    break;                                                                                         \
+  }
+
+  for (size_t i = 0, size = schema->size(); i < size; ++i) {
+    auto type = schema->childType(i);
+    const auto& name = type->name();
+    auto array = rb->GetColumnByName(name);
+    N_ENSURE_NOT_NULL(array, fmt::format("column missing in arrow record batch: {0}", name));
+
+    switch (type->k()) {
+      ADOPT_NUMBER_CHUNK(TINYINT, INT8, Int8Array)
+      ADOPT_NUMBER_CHUNK(SMALLINT, INT16, Int16Array)
+      ADOPT_NUMBER_CHUNK(INTEGER, INT32, Int32Array)
+      ADOPT_NUMBER_CHUNK(BIGINT, INT64, Int64Array)
+      ADOPT_NUMBER_CHUNK(REAL, FLOAT, FloatArray)
+      ADOPT_NUMBER_CHUNK(DOUBLE, DOUBLE, DoubleArray)
+    default:
+      break;
+    }
+
+    // layout doesn't match, copy it
+    appendColumn(name, type->k(), *array, batch, bits);
+  }
+
+#undef ADOPT_NUMBER_CHUNK
+
+  batch.commit(rows);
+  return rows;
+}
+
+} // namespace memory
+} // namespace nebula
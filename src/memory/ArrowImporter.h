@@ -0,0 +1,45 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <arrow/api.h>
+#include "Batch.h"
+
+/**
+ * Import arrow record batches into nebula batch through column chunk append.
+ */
+namespace nebula {
+namespace memory {
+
+class ArrowImporter {
+public:
+  // append all rows of given record batch into the batch column by column.
+  // columns are matched by name, batch columns absent in the record batch are left to the caller
+  // to fill before commit. return number of rows appended.
+  static size_t append(const ::arrow::RecordBatch&, Batch&);
+
+  // append and commit a record batch which has all columns of the batch
+  static size_t import(const ::arrow::RecordBatch&, Batch&);
+
+  // import a record batch into an empty batch and commit. fixed width columns adopt arrow buffers
+  // without copy when layouts match, others are appended by copy. batch retains the record batch.
+  static size_t adopt(const std::shared_ptr<::arrow::RecordBatch>&, Batch&);
+};
+
+} // namespace memory
+} // namespace nebula
@@ -15,28 +15,110 @@
  */
 
 #include "Batch.h"
+#include <atomic>
+#include <fcntl.h>
+#include <fstream>
 #include <numeric>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "serde/Binary.h"
+#include "type/Serde.h"
 
 namespace nebula {
 namespace memory {
 
+using nebula::memory::serde::readBytes;
+using nebula::memory::serde::readValue;
+using nebula::memory::serde::writeBytes;
+using nebula::memory::serde::writeValue;
+using nebula::meta::Column;
+using nebula::meta::ColumnProps;
 using nebula::meta::Table;
 using nebula::surface::RowData;
+using nebula::type::Kind;
 using nebula::type::Schema;
 using nebula::type::TreeBase;
 using nebula::type::TypeBase;
+using nebula::type::TypeSerializer;
+
+// generations of batches created in this process
+static std::atomic<uint64_t> GENERATION{ 0 };
+
+// batch file: [magic, version, meta section] [data section at page boundary]
+static constexpr uint32_t FILE_MAGIC = 0x4E424C4B;
+static constexpr uint32_t FILE_VERSION = 2;
+static constexpr size_t FILE_PAGE = 4096;
+// every node's data is aligned in data section
+static constexpr size_t DATA_ALIGN = 8;
+
+static inline size_t align(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+static inline void pad(std::ostream& os, size_t bytes) {
+  static const char zeros[FILE_PAGE] = { 0 };
+  os.write(zeros, bytes);
+}
+
+// map a whole file as read-only memory
+static std::pair<void*, size_t> mapFile(const std::string& file) {
+  auto fd = open(file.c_str(), O_RDONLY);
+  N_ENSURE(fd >= 0, fmt::format("failed to open file: {0}", file));
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    throw NException(fmt::format("invalid file to map: {0}", file));
+  }
+
+  const size_t size = st.st_size;
+  auto map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  N_ENSURE(map != MAP_FAILED, fmt::format("failed to map file: {0}", file));
+  return { map, size };
+}
+
+// the data section offset of a batch file
+static const NByte* dataSection(const NByte* base, std::string_view& meta) {
+  const NByte* cursor = base;
+  N_ENSURE_EQ(readValue<uint32_t>(cursor), FILE_MAGIC, "not a batch file");
+  N_ENSURE_EQ(readValue<uint32_t>(cursor), FILE_VERSION, "batch file version not supported");
+  meta = readBytes(cursor);
+  return base + align(cursor - base, FILE_PAGE);
+}
 
 Batch::Batch(const Table& table, size_t capacity)
-  : schema_{ table.schema() },
+  : table_{ table.name() },
+    schema_{ table.schema() },
     data_{ DataNode::buildDataTree(table, capacity) },
     rows_{ 0 },
     fields_{ schema_->size() },
-    sealed_{ false } {
+    sealed_{ false },
+    map_{ nullptr },
+    mapSize_{ 0 },
+    generation_{ ++GENERATION } {
   // build a field name to data node
   for (size_t i = 0, size = schema_->size(); i < size; ++i) {
     auto f = dynamic_cast<TypeBase*>(schema_->childAt(i).get());
     fields_[f->name()] = data_->childAt<PDataNode>(i).value();
   }
+
+  // keep column properties of all nodes to describe the table
+  schema_->treeWalk<size_t>(
+    [this, &table](const auto& v) {
+      const auto& name = dynamic_cast<const TypeBase&>(v).name();
+      columns_.emplace(name, table.column(name));
+    },
+    {});
+}
+
+Batch::~Batch() {
+  // release the memory map, the file is owned by whoever saved it
+  if (map_ != nullptr) {
+    munmap(map_, mapSize_);
+  }
 }
 
 // add a row into current batch
@@ -53,6 +135,41 @@ size_t Batch::add(const RowData& row) {
   return rows_++;
 }
 
+size_t Batch::appendChunk(const std::string& col, const void* values, size_t count, const uint8_t* validity) {
+#define APPEND_CHUNK_KIND(K)                                                                               \
+  case Kind::K: {                                                                                          \
+    using T = nebula::type::TypeTraits<Kind::K>::CppType;                                                  \
+    return append(col, static_cast<const T*>(values), count, validity);                                    \
+  }
+
+  switch (fields_.at(col)->kind()) {
+    APPEND_CHUNK_KIND(BOOLEAN)
+    APPEND_CHUNK_KIND(TINYINT)
+    APPEND_CHUNK_KIND(SMALLINT)
+    APPEND_CHUNK_KIND(INTEGER)
+    APPEND_CHUNK_KIND(BIGINT)
+    APPEND_CHUNK_KIND(REAL)
+    APPEND_CHUNK_KIND(DOUBLE)
+    APPEND_CHUNK_KIND(INT128)
+  case Kind::VARCHAR:
+    return append(col, static_cast<const std::string_view*>(values), count, validity);
+  default:
+    throw NException(fmt::format("Chunk append not supported for column: {0}", col));
+  }
+
+#undef APPEND_CHUNK_KIND
+}
+
+// complete rows appended column by column
+size_t Batch::commit(size_t rows) {
+  N_ENSURE(!sealed_, "can not add rows into sealed batch");
+  auto result = data_->commit(rows_, rows);
+  VLOG(1) << "Total chunk size  = " << result;
+
+  rows_ += rows;
+  return rows_;
+}
+
 // random access to a row - may require internal seek
 std::unique_ptr<RowAccessor> Batch::makeAccessor() const {
   return std::make_unique<RowAccessor>(const_cast<const Batch&>(*this));
@@ -62,31 +179,166 @@ std::string Batch::state() const {
   // tree walk the whole data tree to collect all storage size
   // raw size is already accumulated during writing path
   // storage size is dynamic depending on adopted encoders
-  // SizeMeta: size, allocation
-  using SizeMeta = std::tuple<size_t, size_t>;
+  // SizeMeta: size, allocation, metadata allocation
+  using SizeMeta = std::tuple<size_t, size_t, size_t>;
   auto s = data_->treeWalk<SizeMeta, DataNode>(
     [](const DataNode&) {},
     [](const DataNode& v, std::vector<SizeMeta>& children) {
       size_t allocation = v.storageAllocation();
       size_t size = v.storageSize();
+      size_t meta = v.metaAllocation();
       for (const auto& c : children) {
         allocation += std::get<0>(c);
         size += std::get<1>(c);
+        meta += std::get<2>(c);
       }
 
-      return std::make_tuple(allocation, size);
+      return std::make_tuple(allocation, size, meta);
     });
 
   // TODO(cao): output a JSON string
-  return fmt::format("[raw: {0}, size: {1}, allocation: {2}, rows: {3}]",
-                     data_->rawSize(), std::get<1>(s), std::get<0>(s), rows_);
+  return fmt::format("[raw: {0}, size: {1}, allocation: {2}, meta: {3}, rows: {4}]",
+                     data_->rawSize(), std::get<1>(s), std::get<0>(s), std::get<2>(s), rows_);
 }
 
 void Batch::seal() {
+  // a sealed batch may be read by queries, sealing it again would rebuild metadata under them
+  if (sealed_) {
+    return;
+  }
+
   sealed_ = true;
 
   // seal every node
-  data_->seal();
+  data_->treeWalk<size_t, DataNode>(
+    [](const DataNode& v) {
+      const_cast<DataNode&>(v).seal();
+    },
+    {});
+}
+
+std::vector<std::pair<DataNode*, size_t>> Batch::layout() const {
+  std::vector<std::pair<DataNode*, size_t>> nodes;
+  size_t offset = 0;
+  data_->treeWalk<size_t, DataNode>(
+    [&nodes, &offset](const DataNode& v) {
+      nodes.emplace_back(const_cast<DataNode*>(&v), offset);
+      offset = align(offset + v.storageSize(), DATA_ALIGN);
+    },
+    {});
+
+  return nodes;
+}
+
+void Batch::save(const std::string& file, const std::string& header) const {
+  N_ENSURE(sealed_, "only sealed batch can be saved");
+  const auto nodes = layout();
+
+  // meta section: owner header, table definition and state of every node
+  std::ostringstream meta;
+  writeBytes(meta, header);
+  writeBytes(meta, table_);
+  writeBytes(meta, TypeSerializer::to(schema_));
+  writeValue(meta, columns_.size());
+  for (const auto& column : columns_) {
+    writeBytes(meta, column.first);
+    writeValue(meta, column.second.withBloomFilter);
+    writeValue(meta, column.second.withDict);
+    writeBytes(meta, column.second.defaultValue);
+  }
+
+  writeValue(meta, rows_);
+  writeValue(meta, nodes.size());
+  for (const auto& node : nodes) {
+    node.first->save(meta, node.second);
+  }
+
+  std::ofstream os(file, std::ios::binary | std::ios::trunc);
+  N_ENSURE(os.good(), fmt::format("failed to open file to save batch: {0}", file));
+  writeValue(os, FILE_MAGIC);
+  writeValue(os, FILE_VERSION);
+  const auto position = sizeof(FILE_MAGIC) + sizeof(FILE_VERSION) + writeBytes(os, meta.str());
+  pad(os, align(position, FILE_PAGE) - position);
+
+  // data section
+  size_t cursor = 0;
+  for (const auto& node : nodes) {
+    pad(os, node.second - cursor);
+    cursor = node.second + node.first->spill(os);
+  }
+
+  os.flush();
+  N_ENSURE(os.good(), fmt::format("failed to write batch file: {0}", file));
+}
+
+std::shared_ptr<Batch> Batch::restore(const std::string& file, std::string& header) {
+  auto mapped = mapFile(file);
+  try {
+    std::string_view meta;
+    const auto data = dataSection(static_cast<const NByte*>(mapped.first), meta);
+
+    const NByte* cursor = (const NByte*)meta.data();
+    header = readBytes(cursor);
+    const std::string name{ readBytes(cursor) };
+    const auto schema = TypeSerializer::from(std::string(readBytes(cursor)));
+
+    ColumnProps columns;
+    const auto numColumns = readValue<size_t>(cursor);
+    for (size_t i = 0; i < numColumns; ++i) {
+      const std::string column{ readBytes(cursor) };
+      const auto bf = readValue<bool>(cursor);
+      const auto dict = readValue<bool>(cursor);
+      const std::string dv{ readBytes(cursor) };
+      columns.emplace(column, Column{ bf, dict, dv });
+    }
+
+    const auto rows = readValue<size_t>(cursor);
+    auto batch = std::make_shared<Batch>(Table{ name, schema, std::move(columns), {} }, std::max<size_t>(rows, 1));
+
+    // restore every node in the same order as saved
+    const auto nodes = batch->layout();
+    N_ENSURE_EQ(readValue<size_t>(cursor), nodes.size(), "data tree mismatches the schema");
+    for (const auto& node : nodes) {
+      cursor = node.first->load(cursor, data);
+    }
+
+    batch->rows_ = rows;
+    batch->sealed_ = true;
+    batch->map_ = mapped.first;
+    batch->mapSize_ = mapped.second;
+    return batch;
+  } catch (const std::exception&) {
+    munmap(mapped.first, mapped.second);
+    throw;
+  }
+}
+
+size_t Batch::spill(const std::string& file) {
+  N_ENSURE(sealed_, "only sealed batch can be spilled");
+  N_ENSURE(map_ == nullptr, "batch is already spilled");
+
+  auto mapped = mapFile(file);
+  std::string_view meta;
+  const auto data = dataSection(static_cast<const NByte*>(mapped.first), meta);
+
+  // switch every node to read from the mapped file and release their memory
+  for (auto& node : layout()) {
+    node.first->attach(data + node.second);
+  }
+
+  map_ = mapped.first;
+  mapSize_ = mapped.second;
+  return mapSize_;
+}
+
+void Batch::pageIn() const {
+  if (map_ != nullptr) {
+    madvise(map_, mapSize_, MADV_WILLNEED);
+  }
+}
+
+std::shared_ptr<Table> Batch::table() const {
+  return std::make_shared<Table>(table_, schema_, columns_, nebula::meta::AccessSpec{});
 }
 
 } // namespace memory
@@ -38,11 +38,36 @@ class RowAccessor;
 class Batch {
 public: // read row from and write row to
   Batch(const nebula::meta::Table&, size_t capacity);
-  virtual ~Batch() = default;
+  virtual ~Batch();
 
   // add a row into current batch
   size_t add(const nebula::surface::RowData& row);
 
+  // bulk append a chunk of values into a top level column, validity bitmap is in LSB bit order
+  // and nullptr means all values are valid. Rows are visible only after commit.
+  template <typename T>
+  inline size_t append(const std::string& col, const T* values, size_t count, const uint8_t* validity) {
+    N_ENSURE(!sealed_, "can not add rows into sealed batch");
+    return fields_.at(col)->append(values, count, validity);
+  }
+
+  // adopt a column chunk as the whole data of an empty column without copy, see DataNode::adopt.
+  // the owner of the values is retained by this batch.
+  template <typename T>
+  inline size_t adopt(const std::string& col, const T* values, size_t count, const uint8_t* validity,
+                      std::shared_ptr<void> owner) {
+    N_ENSURE(!sealed_, "can not add rows into sealed batch");
+    auto size = fields_.at(col)->adopt(values, count, validity);
+    owners_.push_back(std::move(owner));
+    return size;
+  }
+
+  // type erased version of chunk append, values are laid out as c++ type of the column kind
+  size_t appendChunk(const std::string& col, const void* values, size_t count, const uint8_t* validity);
+
+  // commit given number of rows appended by column chunks, every column should have received them.
+  size_t commit(size_t rows);
+
   // random access to a row - may require internal seek
   std::unique_ptr<RowAccessor> makeAccessor() const;
 
@@ -56,19 +81,38 @@ public: // basic metrics / meta of the batch
     return data_->rawSize();
   }
 
+  inline const nebula::type::Schema& schema() const {
+    return schema_;
+  }
+
   // basic metrics in JSON
   std::string state() const;
 
+  // unique id of this batch in the process, unlike its address it is never reused by a later batch
+  inline uint64_t generation() const {
+    return generation_;
+  }
+
   // Place seal on current batch when building
-  // This helps release some necessary memory used in batch building
+  // This helps release some necessary memory used in batch building, it is a no-op once sealed
   void seal();
 
+  // a sealed batch is immutable
+  inline bool sealed() const {
+    return sealed_;
+  }
+
   // a bloom filter tester
   template <typename T>
   inline bool probably(const std::string& col, const T& value) const {
     return fields_.at(col)->probably(value);
   }
 
+  // batch probe a list of value hashes (eg. IN list) computed once by BloomFilter<T>::hash
+  inline bool probably(const std::string& col, const std::vector<uint64_t>& hashes) const {
+    return fields_.at(col)->probably(hashes.data(), hashes.size());
+  }
+
   // get a const reference of the histogram object for given column
   template <typename T = nebula::memory::serde::Histogram>
   inline auto histogram(const std::string& col) const ->
@@ -77,7 +121,44 @@ public: // basic metrics / meta of the batch
     return fields_.at(col)->histogram<T>();
   }
 
+  // distinct values sketch of given column built at seal, nullptr if not available
+  inline const nebula::common::HyperLogLog* sketch(const std::string& col) const {
+    auto itr = fields_.find(col);
+    return itr == fields_.end() ? nullptr : itr->second->sketch();
+  }
+
+public: // tiered storage
+  // persist this sealed batch into a self-describing file whose data section is mmap-able.
+  // an opaque header (eg. block signature) given by the owner is stored along.
+  void save(const std::string& file, const std::string& header = "") const;
+
+  // restore a batch from a file written by save, data is served from memory map of the file.
+  // the header stored along is returned through the reference.
+  static std::shared_ptr<Batch> restore(const std::string& file, std::string& header);
+
+  // serve reads of this batch from memory map of given file which is saved from it
+  // and release its data memory. Metadata (nulls, offsets, histograms and bloom filters)
+  // stays in memory for pruning.
+  // NOTE: thread-unsafe~! no reader should be scanning this batch while spilling.
+  size_t spill(const std::string& file);
+
+  inline bool spilled() const {
+    return map_ != nullptr;
+  }
+
+  // advise OS to bring spilled data back into memory before a scan
+  void pageIn() const;
+
+  // definition of the table this batch is built for
+  std::shared_ptr<nebula::meta::Table> table() const;
+
+private:
+  // data nodes in depth-first order with offset of their data in data section
+  std::vector<std::pair<DataNode*, size_t>> layout() const;
+
 private:
+  std::string table_;
+  nebula::meta::ColumnProps columns_;
   nebula::type::Schema schema_;
   nebula::memory::DataTree data_;
   size_t rows_;
@@ -89,6 +170,15 @@ private:
   DnMap fields_;
 
   bool sealed_;
+
+  // external buffers adopted as column data
+  std::vector<std::shared_ptr<void>> owners_;
+
+  // memory mapped file if the batch data is spilled
+  void* map_;
+  size_t mapSize_;
+
+  const uint64_t generation_;
 };
 
 class RowAccessor : public nebula::surface::RowData {
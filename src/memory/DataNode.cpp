@@ -18,6 +18,7 @@
 
 #include "common/Hash.h"
 #include "common/Likely.h"
+#include "serde/Binary.h"
 #include "type/Type.h"
 
 /**
@@ -28,7 +29,10 @@ namespace nebula {
 namespace memory {
 
 using nebula::common::Hasher;
+using nebula::common::HyperLogLog;
+using nebula::memory::serde::readValue;
 using nebula::memory::serde::TypeMetadata;
+using nebula::memory::serde::writeValue;
 using nebula::meta::Table;
 using nebula::surface::ListData;
 using nebula::surface::MapData;
@@ -56,6 +60,44 @@ DataTree DataNode::buildDataTree(const Table& table, size_t capacity) {
   return std::static_pointer_cast<DataNode>(dataTree);
 }
 
+void DataNode::save(std::ostream& os, size_t offset) const {
+  writeValue(os, count_);
+  writeValue(os, rawSize_);
+  writeValue(os, offset);
+  writeValue(os, storageSize());
+  meta_->save(os);
+}
+
+const NByte* DataNode::load(const NByte* cursor, const NByte* data) {
+  count_ = readValue<size_t>(cursor);
+  rawSize_ = readValue<size_t>(cursor);
+  const auto offset = readValue<size_t>(cursor);
+  const auto size = readValue<size_t>(cursor);
+  if (data_ == nullptr) {
+    return meta_->load(cursor);
+  }
+
+  data_->attach(data + offset, size);
+  cursor = meta_->load(cursor);
+
+  // strings are not laid out by width, index them through metadata
+  if (type_.k() == Kind::VARCHAR) {
+    if (data_->hasBloomFilter()) {
+      for (size_t i = 0; i < count_; ++i) {
+        if (!isNull(i)) {
+          data_->index(read<std::string_view>(i));
+        }
+      }
+    }
+  } else {
+    data_->reindex();
+  }
+
+  data_->seal();
+  buildSketch();
+  return cursor;
+}
+
 #define INCREMENT_RAW_SIZE_AND_RETURN() \
   rawSize_ += size;                     \
   return size;
@@ -146,6 +188,66 @@ size_t DataNode::append(std::string_view str) {
   INCREMENT_RAW_SIZE_AND_RETURN()
 }
 
+#define APPEND_SOLID_CHUNK(K, N)                                                                                \
+  template <>                                                                                                   \
+  size_t DataNode::append(const nebula::type::TypeTraits<Kind::K>::CppType* values, size_t count, const uint8_t* validity) { \
+    N_ENSURE(type_.k() == Kind::K, #N "type expected");                                                         \
+    constexpr size_t width = nebula::type::Type<Kind::K>::width;                                                \
+    const auto nulls = meta_->setNulls(count_, count, validity);                                                \
+    data_->add(count_, values, count, validity);                                                                \
+    meta_->histogram(values, count, validity);                                                                  \
+    count_ += count;                                                                                            \
+    const size_t size = (count - nulls) * width + nulls * NULL_SIZE;                                           \
+    rawSize_ += size;                                                                                           \
+    return size;                                                                                                \
+  }
+
+APPEND_SOLID_CHUNK(BOOLEAN, bool)
+APPEND_SOLID_CHUNK(TINYINT, byte)
+APPEND_SOLID_CHUNK(SMALLINT, short)
+APPEND_SOLID_CHUNK(INTEGER, int)
+APPEND_SOLID_CHUNK(BIGINT, long)
+APPEND_SOLID_CHUNK(REAL, float)
+APPEND_SOLID_CHUNK(DOUBLE, double)
+APPEND_SOLID_CHUNK(INT128, int128)
+
+#undef APPEND_SOLID_CHUNK
+
+#define ADOPT_SOLID_CHUNK(K, N)                                                                                 \
+  template <>                                                                                                   \
+  size_t DataNode::adopt(const nebula::type::TypeTraits<Kind::K>::CppType* values, size_t count, const uint8_t* validity) { \
+    N_ENSURE(type_.k() == Kind::K, #N "type expected");                                                         \
+    N_ENSURE(count_ == 0, "only empty node can adopt a buffer");                                                 \
+    constexpr size_t width = nebula::type::Type<Kind::K>::width;                                                \
+    const auto nulls = meta_->setNulls(0, count, validity);                                                     \
+    data_->attach(reinterpret_cast<const NByte*>(values), count * width);                                      \
+    data_->reindex();                                                                                           \
+    meta_->histogram(values, count, validity);                                                                  \
+    count_ = count;                                                                                             \
+    rawSize_ = (count - nulls) * width + nulls * NULL_SIZE;                                                     \
+    return rawSize_;                                                                                            \
+  }
+
+ADOPT_SOLID_CHUNK(TINYINT, byte)
+ADOPT_SOLID_CHUNK(SMALLINT, short)
+ADOPT_SOLID_CHUNK(INTEGER, int)
+ADOPT_SOLID_CHUNK(BIGINT, long)
+ADOPT_SOLID_CHUNK(REAL, float)
+ADOPT_SOLID_CHUNK(DOUBLE, double)
+
+#undef ADOPT_SOLID_CHUNK
+
+// strings go through dictionary check item by item
+template <>
+size_t DataNode::append(const std::string_view* values, size_t count, const uint8_t* validity) {
+  size_t size = 0;
+  for (size_t i = 0; i < count; ++i) {
+    size += nebula::memory::serde::isValid(validity, i) ? append(values[i]) : appendNull();
+  }
+
+  return size;
+}
+
 #define DISPATCH_KIND(KIND, lambda, object, func)                          \
   case Kind::KIND: {                                                       \
     lambda = [&object, &list](auto i) { return object->append(func(i)); }; \
@@ -279,6 +381,25 @@ size_t DataNode::append(const nebula::surface::RowData& row) {
 
 #undef DISPATCH_KIND
 
+size_t DataNode::commit(size_t committed, size_t rows) {
+  N_ENSURE(type_.k() == Kind::STRUCT, "struct type expected");
+
+  size_t size = 0;
+  for (size_t i = 0, count = this->size(); i < count; ++i) {
+    const auto& child = this->childAt<PDataNode>(i).value();
+    N_ENSURE_EQ(child->entries(), committed + rows, "column chunks misaligned");
+    size += child->rawSize();
+  }
+
+  for (size_t i = 0; i < rows; ++i) {
+    meta_->histogram(nullptr);
+  }
+
+  // raw size of a struct node is sum of its children
+  size -= rawSize_;
+  INCREMENT_RAW_SIZE_AND_RETURN()
+}
+
 #undef INCREMENT_RAW_SIZE_AND_RETURN
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -316,5 +437,47 @@ std::string_view DataNode::read(size_t index) {
 
 #undef TYPE_READ_DELEGATE
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DataNode::seal() {
+  meta_->seal();
+  if (data_ != nullptr) {
+    data_->seal();
+    buildSketch();
+  }
+}
+
+void DataNode::buildSketch() {
+  auto sketch = std::make_unique<HyperLogLog>();
+
+#define TYPE_SKETCH(KIND, TYPE)           \
+  case Kind::KIND: {                      \
+    for (size_t i = 0; i < count_; ++i) { \
+      if (!isNull(i)) {                   \
+        sketch->add(read<TYPE>(i));       \
+      }                                   \
+    }                                     \
+    break;                                \
+  }
+
+  switch (type_.k()) {
+    TYPE_SKETCH(BOOLEAN, bool)
+    TYPE_SKETCH(TINYINT, int8_t)
+    TYPE_SKETCH(SMALLINT, int16_t)
+    TYPE_SKETCH(INTEGER, int32_t)
+    TYPE_SKETCH(BIGINT, int64_t)
+    TYPE_SKETCH(REAL, float)
+    TYPE_SKETCH(DOUBLE, double)
+    TYPE_SKETCH(INT128, int128_t)
+    TYPE_SKETCH(VARCHAR, std::string_view)
+  default:
+    return;
+  }
+
+#undef TYPE_SKETCH
+
+  sketch_ = std::move(sketch);
+}
+
 } // namespace memory
 } // namespace nebula
\ No newline at end of file
@@ -20,6 +20,7 @@
 #include <glog/logging.h>
 
 #include "common/Errors.h"
+#include "common/HyperLogLog.h"
 #include "common/Memory.h"
 #include "meta/Table.h"
 #include "serde/TypeData.h"
@@ -82,6 +83,20 @@ public: // data appending API
   template <typename T>
   size_t append(T v);
 
+  // bulk append a chunk of values with validity bitmap (LSB bit order, nullptr means all valid)
+  // values of invalid items are ignored, return raw size of the chunk
+  template <typename T>
+  size_t append(const T*, size_t, const uint8_t*);
+
+  // adopt an external buffer of fixed width values as data of this empty node without copy.
+  // the buffer is not owned, its owner should outlive this node. node turns read-only.
+  template <typename T>
+  size_t adopt(const T*, size_t, const uint8_t*);
+
+  // complete rows appended column by column into this struct node
+  // every child should have exactly (committed + rows) entries
+  size_t commit(size_t committed, size_t rows);
+
 public: // data reading API
   // use std::optional to simplify the interface
   // instead of
@@ -102,6 +117,11 @@ public: // data reading API
     return data_->probably(v);
   }
 
+  // check if any of given value hashes is probably present, see BloomFilter::hash
+  inline bool probably(const uint64_t* hashes, size_t size) const {
+    return data_ == nullptr || data_->probably(hashes, size);
+  }
+
   // get a const reference of the histogram object for given column
   template <typename T = nebula::memory::serde::Histogram>
   inline auto histogram() const ->
@@ -110,6 +130,10 @@ public: // data reading API
   }
 
 public: // basic metadata exposure
+  inline nebula::type::Kind kind() const {
+    return type_.k();
+  }
+
   inline size_t entries() const {
     return count_;
   }
@@ -128,16 +152,48 @@ public: // basic metadata exposure
     return data_ == nullptr ? 0 : data_->capacity();
   }
 
+  // memory used by metadata such as nulls, offsets and dictionary
+  inline size_t metaAllocation() const {
+    return meta_->memory();
+  }
+
   // list/map retrieve child's offset and length at some position
   inline std::pair<IndexType, IndexType> offsetSize(IndexType index) {
     return meta_->offsetSizeDirect(index);
   }
 
-  inline void seal() {
-    meta_->seal();
+  // no more data will be added, fit metadata and indices, build sketch of distinct values
+  void seal();
+
+  // sketch of distinct values in this node, only available for sealed scalar node
+  inline const nebula::common::HyperLogLog* sketch() const {
+    return sketch_.get();
+  }
+
+public: // tiered storage
+  // spill data of current node (not including children) into given stream
+  inline size_t spill(std::ostream& os) const {
+    return data_ == nullptr ? 0 : data_->write(os);
+  }
+
+  // read data from given buffer which holds the same bytes spilled
+  inline void attach(const NByte* buffer) {
+    if (data_ != nullptr) {
+      data_->attach(buffer, data_->size());
+    }
   }
 
+  // persist node state (counters and metadata) along with offset of its spilled data
+  void save(std::ostream&, size_t) const;
+
+  // restore node state from cursor and attach its data in given data section
+  // return cursor after consumed bytes
+  const NByte* load(const NByte*, const NByte*);
+
 private:
+  // build distinct values sketch of all non-null values
+  void buildSketch();
+
   // called for every single value added in current node
   inline size_t cursorAndAdvance() {
     return count_++;
@@ -159,6 +215,9 @@ private:
 
   // raw size of data accumulation
   size_t rawSize_;
+
+  // distinct values sketch built at seal
+  std::unique_ptr<nebula::common::HyperLogLog> sketch_;
 };
 } // namespace memory
 } // namespace nebula
\ No newline at end of file
@@ -7,6 +7,8 @@ add_library(${NEBULA_MEMORY} STATIC
     ${NEBULA_SRC}/memory/DataNode.cpp
     ${NEBULA_SRC}/memory/Batch.cpp
     ${NEBULA_SRC}/memory/Accessor.cpp
+    ${NEBULA_SRC}/memory/ArrowExporter.cpp
+    ${NEBULA_SRC}/memory/ArrowImporter.cpp
     ${NEBULA_SRC}/memory/encode/RleEncoder.cpp
     ${NEBULA_SRC}/memory/encode/RleDecoder.cpp
     ${NEBULA_SRC}/memory/keyed/FlatBuffer.cpp
@@ -19,6 +21,7 @@ target_link_libraries(${NEBULA_MEMORY}
     PUBLIC ${NEBULA_TYPE}
     PUBLIC ${NEBULA_SURFACE}
     PUBLIC ${NEBULA_META}
+    PUBLIC ${ARROW_LIBRARY}
     PUBLIC ${FOLLY_LIBRARY})
 
 # build test binary
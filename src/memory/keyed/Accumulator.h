@@ -0,0 +1,191 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "common/Memory.h"
+#include "surface/eval/ValueEval.h"
+
+/**
+ * Accumulator keeps aggregate states of one fixed width column in a typed array indexed by group id,
+ * the array is allocated in cache lines (64 bytes) so that merges do not touch row bytes.
+ * Values to merge are staged and applied in batches by a tight typed loop,
+ * common merges (sum/count/max/min) are inlined instead of calling the UDAF merge function.
+ */
+namespace nebula {
+namespace memory {
+namespace keyed {
+
+class Accumulator {
+public:
+  static constexpr size_t INVALID = std::numeric_limits<size_t>::max();
+
+  virtual ~Accumulator() = default;
+
+  // append state of a new group whose value is at given position, INVALID if value is null
+  virtual void append(const nebula::common::PagedSlice&, size_t) = 0;
+
+  // stage value at given position to be merged into given group
+  virtual void stage(size_t, const nebula::common::PagedSlice&, size_t) = 0;
+
+  // merge all staged values into their group states
+  virtual void apply() = 0;
+
+  // write state of given group at given position
+  virtual void store(size_t, nebula::common::PagedSlice&, size_t) const = 0;
+};
+
+template <typename T>
+class TypedAccumulator : public Accumulator {
+  static constexpr size_t LINE = 64;
+  static constexpr size_t ITEMS = LINE / sizeof(T);
+  static constexpr size_t BATCH = 1024;
+
+  struct alignas(LINE) Line {
+    T items[ITEMS];
+  };
+
+  // merge operations inlined in the loop, GENERIC calls the UDAF merge
+  enum class Op {
+    GENERIC,
+    ADD,
+    MAX,
+    MIN
+  };
+
+public:
+  TypedAccumulator(const nebula::surface::eval::ValueEval& field)
+    : field_{ field }, op_{ op(field.signature()) }, size_{ 0 } {
+    groups_.reserve(BATCH);
+    values_.reserve(BATCH);
+  }
+  virtual ~TypedAccumulator() = default;
+
+  void append(const nebula::common::PagedSlice& slice, size_t position) override {
+    if (size_ == lines_.size() * ITEMS) {
+      lines_.emplace_back();
+    }
+
+    states()[size_++] = position == INVALID ? T{} : slice.read<T>(position);
+  }
+
+  void stage(size_t group, const nebula::common::PagedSlice& slice, size_t position) override {
+    groups_.push_back(group);
+    values_.push_back(slice.read<T>(position));
+    if (groups_.size() == BATCH) {
+      apply();
+    }
+  }
+
+  void apply() override {
+    const auto size = groups_.size();
+    const auto groups = groups_.data();
+    const auto values = values_.data();
+    auto s = states();
+
+#define MERGE_LOOP(EXPR)             \
+  for (size_t i = 0; i < size; ++i) { \
+    auto& x = s[groups[i]];          \
+    const auto v = values[i];        \
+    x = EXPR;                        \
+  }
+
+    switch (op_) {
+    case Op::ADD: {
+      if constexpr (std::is_same_v<T, bool>) {
+        MERGE_LOOP(x || v)
+      } else {
+        MERGE_LOOP(static_cast<T>(x + v))
+      }
+      break;
+    }
+    case Op::MAX: {
+      MERGE_LOOP(std::max<T>(x, v))
+      break;
+    }
+    case Op::MIN: {
+      MERGE_LOOP(std::min<T>(x, v))
+      break;
+    }
+    default: {
+      MERGE_LOOP(field_.merge<T>(x, v))
+      break;
+    }
+    }
+
+#undef MERGE_LOOP
+
+    groups_.clear();
+    values_.clear();
+  }
+
+  void store(size_t group, nebula::common::PagedSlice& slice, size_t position) const override {
+    slice.write<T>(position, states()[group]);
+  }
+
+private:
+  inline T* states() {
+    return reinterpret_cast<T*>(lines_.data());
+  }
+
+  inline const T* states() const {
+    return reinterpret_cast<const T*>(lines_.data());
+  }
+
+  static Op op(std::string_view sign) {
+    // bool values do not add up
+    if constexpr (std::is_same_v<T, bool>) {
+      return Op::GENERIC;
+    }
+
+    auto starts = [&sign](std::string_view name) {
+      return sign.size() > name.size() && sign.substr(0, name.size()) == name && sign[name.size()] == '(';
+    };
+
+    if (starts("SUM") || starts("COUNT")) {
+      return Op::ADD;
+    }
+
+    if (starts("MAX")) {
+      return Op::MAX;
+    }
+
+    if (starts("MIN")) {
+      return Op::MIN;
+    }
+
+    return Op::GENERIC;
+  }
+
+private:
+  const nebula::surface::eval::ValueEval& field_;
+  const Op op_;
+  std::vector<Line> lines_;
+  size_t size_;
+
+  // staged values to merge and their group
+  std::vector<size_t> groups_;
+  std::vector<std::conditional_t<std::is_same_v<T, bool>, uint8_t, T>> values_;
+};
+
+} // namespace keyed
+} // namespace memory
+} // namespace nebula
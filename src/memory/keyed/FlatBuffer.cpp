@@ -57,16 +57,20 @@ FlatBuffer::FlatBuffer(const nebula::type::Schema& schema)
     main_{ std::make_unique<Buffer>(FLAGS_FB_MAIN_PAGE) },
     data_{ std::make_unique<Buffer>(FLAGS_FB_DATA_PAGE) },
     list_{ std::make_unique<Buffer>(FLAGS_FB_LIST_PAGE) },
-    chunk_{ nullptr } {
+    chunk_{ nullptr },
+    owner_{ nullptr } {
   this->initSchema();
 }
 
-// initialize a read-only flat buffer with given serialized data
-// NOTE: This read-only object doesn't own the data buffer neither copy, it only references it.
-//       Hence external buffer holder needs to be live the same scope this object,
-//       We can improve this interface later.
+// initialize a read-only flat buffer with given serialized data allocated from default pool
 FlatBuffer::FlatBuffer(const nebula::type::Schema& schema, NByte* data)
-  : schema_{ schema }, chunk_{ data } {
+  : FlatBuffer(schema, data, std::shared_ptr<void>(data, [](void* p) { nebula::common::Pool::getDefault().free(p); })) {}
+
+// initialize a read-only flat buffer with given serialized data
+// NOTE: This read-only object doesn't copy the data buffer, it only references it.
+//       The owner is held to keep the data alive as long as this object or any one sharing it.
+FlatBuffer::FlatBuffer(const nebula::type::Schema& schema, const NByte* data, std::shared_ptr<void> owner)
+  : schema_{ schema }, chunk_{ data }, owner_{ std::move(owner) } {
   this->initSchema();
 
   // deserialize data for rows and all data blocks
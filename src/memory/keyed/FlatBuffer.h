@@ -93,13 +93,14 @@ using Parser = std::function<void(const nebula::surface::RowData&)>;
 class FlatBuffer {
 public:
   FlatBuffer(const nebula::type::Schema&);
+
+  // read-only flat buffer over serialized data allocated from default pool, it takes ownership of the data.
   FlatBuffer(const nebula::type::Schema&, NByte*);
 
-  virtual ~FlatBuffer() {
-    if (chunk_) {
-      nebula::common::Pool::getDefault().free(chunk_);
-    }
-  }
+  // read-only flat buffer over serialized data in place, the data is kept alive by given owner.
+  FlatBuffer(const nebula::type::Schema&, const NByte*, std::shared_ptr<void>);
+
+  virtual ~FlatBuffer() = default;
 
   // add a row into current batch
   size_t add(const nebula::surface::RowData&);
@@ -136,10 +137,14 @@ public:
     return schema_;
   }
 
-  inline void* chunk() const {
+  inline const NByte* chunk() const {
     return chunk_;
   }
 
+  inline const std::shared_ptr<void>& owner() const {
+    return owner_;
+  }
+
 private:
   bool appendNull(bool, nebula::type::Kind, Buffer&);
 
@@ -169,8 +174,11 @@ protected:
   std::unique_ptr<Buffer> data_;
   std::unique_ptr<Buffer> list_;
 
-  // an owned data buffer passed in - need to free it in destructor
-  void* chunk_;
+  // serialized data this buffer reads in place, nullptr if it is built by adding rows
+  const NByte* chunk_;
+
+  // shared ownership of the serialized data, such as a pool allocation or a message holding it
+  std::shared_ptr<void> owner_;
 
   // A row accessor cursor to read data of given row
   friend class RowAccessor;
@@ -16,15 +16,24 @@
 
 #include "HashFlat.h"
 
+#include <algorithm>
+
 #include "surface/eval/UDF.h"
 
 namespace nebula {
 namespace memory {
 namespace keyed {
 
+using nebula::surface::RowData;
 using nebula::type::Kind;
 
+// seed of row hash and the value mixed in for null
+static constexpr size_t HASH_START = 0xC6A4A7935BD1E995UL;
+static constexpr size_t HASH_NULL = 0x3600ABC35871E005UL;
+
 void HashFlat::init() {
+  hashKeys_.assign(keys_.begin(), keys_.end());
+  std::sort(hashKeys_.begin(), hashKeys_.end());
   values_.reserve(numColumns_ - keys_.size());
   ops_.reserve(numColumns_);
 
@@ -37,6 +46,36 @@ void HashFlat::init() {
     ops_.emplace_back(genComparator(i), genHasher(i), genCopier(i));
   }
 
+  // fixed width values are aggregated in accumulators, the others such as strings by copiers
+#define ACCUMULATOR_KIND(KIND, TYPE)                                                         \
+  case Kind::KIND: {                                                                         \
+    accumulators_.emplace_back(i, std::make_unique<TypedAccumulator<TYPE>>(*fields_.at(i))); \
+    break;                                                                                   \
+  }
+
+  for (auto i : values_) {
+    switch (kw_.at(i).first) {
+      ACCUMULATOR_KIND(BOOLEAN, bool)
+      ACCUMULATOR_KIND(TINYINT, int8_t)
+      ACCUMULATOR_KIND(SMALLINT, int16_t)
+      ACCUMULATOR_KIND(INTEGER, int32_t)
+      ACCUMULATOR_KIND(BIGINT, int64_t)
+      ACCUMULATOR_KIND(REAL, float)
+      ACCUMULATOR_KIND(DOUBLE, double)
+      ACCUMULATOR_KIND(INT128, int128_t)
+    default:
+      copied_.push_back(i);
+      break;
+    }
+  }
+
+#undef ACCUMULATOR_KIND
+
+  // rows loaded from existing buffer
+  for (size_t row = 0, size = getRows(); row < size; ++row) {
+    accumulate(row);
+  }
+
   // set a max load factor to reduce rehash
   rowKeys_.max_load_factor(0.5);
 }
@@ -117,8 +156,6 @@ Comparator HashFlat::genComparator(size_t i) noexcept {
 }
 
 Hasher HashFlat::genHasher(size_t i) noexcept {
-  static constexpr size_t flip = 0x3600ABC35871E005UL;
-
   // only need for key
   if (keys_.find(i) == keys_.end()) {
     return {};
@@ -130,7 +167,7 @@ Hasher HashFlat::genHasher(size_t i) noexcept {
   auto rowOffset = rowProps.offset;               \
   const auto& colProps = rowProps.colProps.at(i); \
   if (colProps.isNull) {                          \
-    return (hash ^ flip) >> 32;                   \
+    return (hash ^ HASH_NULL) >> 32;              \
   }
 
 #define TYPE_HASH(KIND, TYPE)                                        \
@@ -184,16 +221,7 @@ Hasher HashFlat::genHasher(size_t i) noexcept {
 #undef TYPE_HASH
 }
 
-// TODO(cao): I spent a couple of days trying to nail down which GCC optimization
-// causing the SIGSEGV on the returned function from this method
-// CMakeList.txt has more details in the problem.
-// So now, we disable optimizations higher than level 1 on this method
-// we may dig more in the future to understand this problem better. (CLANG need no this)
-#ifndef __clang__
-__attribute__((optimize("O1")))
-#endif
-Copier
-  HashFlat::genCopier(size_t i) noexcept {
+Copier HashFlat::genCopier(size_t i) noexcept {
   // only need for value
   if (keys_.find(i) != keys_.end()) {
     return {};
@@ -230,6 +258,34 @@ Copier
     UPDATE_COLUMN(REAL, float)
     UPDATE_COLUMN(DOUBLE, double)
     UPDATE_COLUMN(INT128, int128_t)
+  case Kind::VARCHAR: {
+    // string store such as sketch registers is merged in place if merged value fits in the old slot
+    // otherwise, merged value is relocated to the end of data buffer after the new row is rolled back
+    return [this, i](size_t row1, size_t row2) {
+      const auto& row1Props = rows_.at(row1);
+      const auto& row2Props = rows_.at(row2);
+      const auto& colProps1 = row1Props.colProps.at(i);
+      const auto& colProps2 = row2Props.colProps.at(i);
+      if (colProps1.isNull) {
+        return;
+      }
+      auto so1 = row1Props.offset + colProps1.offset;
+      auto so2 = row2Props.offset + colProps2.offset;
+      auto nv = data_->slice.read(main_->slice.read<int32_t>(so1), main_->slice.read<int32_t>(so1 + 4));
+      auto offset = main_->slice.read<int32_t>(so2);
+      auto ov = data_->slice.read(offset, main_->slice.read<int32_t>(so2 + 4));
+      auto x = fields_.at(i)->merge(ov, nv);
+      if (x.size() > ov.size()) {
+        relocations_.emplace_back(so2, x);
+        return;
+      }
+
+      if (x.data() != ov.data()) {
+        data_->slice.write(offset, x.data(), x.size());
+      }
+      main_->slice.write<int32_t>(so2 + 4, x.size());
+    };
+  }
   default:
     return [i](size_t, size_t) {
       LOG(ERROR) << "This column can not be copy-updated: " << i;
@@ -242,17 +298,69 @@ Copier
 // compute hash value of given row and column list
 // The function has very similar logic as row accessor, we inline it for perf
 size_t HashFlat::hash(size_t rowId) const {
-  static constexpr size_t start = 0xC6A4A7935BD1E995UL;
-  size_t hvalue = start;
+  size_t hvalue = HASH_START;
 
   // hash on every column
-  for (auto index : keys_) {
+  for (auto index : hashKeys_) {
     hvalue = ops_.at(index).hasher(rowId, hvalue);
   }
 
   return hvalue;
 }
 
+// NOTE: keep it in sync with hashers which hash stored bytes of each value
+size_t HashFlat::hash(const RowData& row, const std::vector<std::pair<std::string, Kind>>& keys) {
+#define VALUE_HASH(KIND, TYPE, FUNC)                                                \
+  case Kind::KIND: {                                                                \
+    TYPE value = row.FUNC(name);                                                    \
+    hvalue = (hvalue ^ nebula::common::Hasher::hash64(&value, sizeof(TYPE))) >> 32; \
+    break;                                                                          \
+  }
+
+  size_t hvalue = HASH_START;
+  for (const auto& [name, kind] : keys) {
+    if (row.isNull(name)) {
+      hvalue = (hvalue ^ HASH_NULL) >> 32;
+      continue;
+    }
+
+    switch (kind) {
+      VALUE_HASH(BOOLEAN, bool, readBool)
+      VALUE_HASH(TINYINT, int8_t, readByte)
+      VALUE_HASH(SMALLINT, int16_t, readShort)
+      VALUE_HASH(INTEGER, int32_t, readInt)
+      VALUE_HASH(BIGINT, int64_t, readLong)
+      VALUE_HASH(REAL, float, readFloat)
+      VALUE_HASH(DOUBLE, double, readDouble)
+      VALUE_HASH(INT128, int128_t, readInt128)
+    case Kind::VARCHAR: {
+      auto value = row.readString(name);
+      if (!value.empty()) {
+        hvalue = (hvalue ^ nebula::common::Hasher::hash64(value.data(), value.size())) >> 32;
+      }
+      break;
+    }
+    default:
+      LOG(ERROR) << "Hash a non-supported column: " << name;
+      hvalue = 0;
+    }
+  }
+
+  return hvalue;
+
+#undef VALUE_HASH
+}
+
+std::vector<std::pair<std::string, Kind>> HashFlat::hashKeys() const {
+  std::vector<std::pair<std::string, Kind>> keys;
+  keys.reserve(hashKeys_.size());
+  for (auto index : hashKeys_) {
+    keys.emplace_back(schema_->childType(index)->name(), kw_.at(index).first);
+  }
+
+  return keys;
+}
+
 // check if two rows are equal to each other on given columns
 bool HashFlat::equal(size_t row1, size_t row2) const {
   for (auto index : keys_) {
@@ -265,6 +373,24 @@ bool HashFlat::equal(size_t row1, size_t row2) const {
 }
 
 bool HashFlat::update(const nebula::surface::RowData& row) {
+  // direct address table lookup for keys in range
+  if (!slots_.empty()) {
+    auto slot = address(row);
+    if (slot != std::string::npos) {
+      this->add(row);
+      auto newRow = getRows() - 1;
+      auto& target = slots_[slot];
+      if (target >= 0) {
+        merge(newRow, target);
+        return true;
+      }
+
+      target = newRow;
+      accumulate(newRow);
+      return false;
+    }
+  }
+
   // add a new row to the buffer may be expensive
   // if there are object values to be created such as customized aggregation
   // to have consistent way - we're taking this approach
@@ -274,28 +400,231 @@ bool HashFlat::update(const nebula::surface::RowData& row) {
   this->add(row);
 
   auto newRow = getRows() - 1;
-  auto hValue = hash(newRow);
+  return upsert(newRow, hash(newRow));
+}
+
+bool HashFlat::update(const RowData& row, size_t hValue) {
+  // direct address table doesn't use hash
+  if (!slots_.empty()) {
+    return update(row);
+  }
+
+  this->add(row);
+  return upsert(getRows() - 1, hValue);
+}
+
+bool HashFlat::upsert(size_t newRow, size_t hValue) {
   Key key{ *this, newRow, hValue };
   auto itr = rowKeys_.find(key);
   if (itr != rowKeys_.end()) {
-    // copy the new row data into target for non-keys
-    auto oldRow = std::get<1>(*itr);
-    for (size_t i : values_) {
-      ops_.at(i).copier(newRow, oldRow);
-    }
-
-    // rollback the new added row
-    rollback();
-
+    merge(newRow, std::get<1>(*itr));
     return true;
   }
 
   // resume all values population and add a new row key
   // this->resume(row, values_, newRow);
   rowKeys_.insert(key);
+  accumulate(newRow);
   return false;
 }
 
+void HashFlat::merge(size_t newRow, size_t oldRow) {
+  // stage fixed width values into accumulators without touching the old row
+  for (const auto& acc : accumulators_) {
+    auto pos = position(newRow, acc.first);
+    if (pos != Accumulator::INVALID) {
+      acc.second->stage(oldRow, main_->slice, pos);
+    }
+  }
+
+  // copy the new row data into target for other non-keys
+  for (size_t i : copied_) {
+    ops_.at(i).copier(newRow, oldRow);
+  }
+
+  // rollback the new added row
+  rollback();
+
+  // move grown string values into holes or the end and point the old row to them,
+  // old slots are released first so that a slot at the end grows in place
+  for (const auto& r : relocations_) {
+    release(main_->slice.read<int32_t>(r.first), main_->slice.read<int32_t>(r.first + 4));
+    const auto offset = reserve(r.second.size());
+    data_->slice.write(offset, r.second.data(), r.second.size());
+    main_->slice.write<int32_t>(r.first, offset);
+    main_->slice.write<int32_t>(r.first + 4, r.second.size());
+  }
+  relocations_.clear();
+}
+
+void HashFlat::release(size_t offset, size_t size) {
+  if (size == 0) {
+    return;
+  }
+
+  // drop a hole from both indices
+  auto drop = [this](std::map<size_t, size_t>::iterator hole) {
+    auto range = fits_.equal_range(hole->second);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == hole->first) {
+        fits_.erase(it);
+        break;
+      }
+    }
+    holes_.erase(hole);
+  };
+
+  // coalesce with the holes right after and before it
+  auto next = holes_.find(offset + size);
+  if (next != holes_.end()) {
+    size += next->second;
+    drop(next);
+  }
+
+  auto prev = holes_.lower_bound(offset);
+  if (prev != holes_.begin()) {
+    --prev;
+    if (prev->first + prev->second == offset) {
+      offset = prev->first;
+      size += prev->second;
+      drop(prev);
+    }
+  }
+
+  // a hole at the end shrinks the data buffer instead
+  if (offset + size == data_->offset) {
+    data_->offset = offset;
+    return;
+  }
+
+  holes_.emplace(offset, size);
+  fits_.emplace(size, offset);
+}
+
+size_t HashFlat::reserve(size_t size) {
+  auto fit = fits_.lower_bound(size);
+  if (fit == fits_.end()) {
+    const auto offset = data_->offset;
+    data_->offset += size;
+    return offset;
+  }
+
+  // rest of the hole stays free
+  const auto offset = fit->second;
+  const auto rest = fit->first - size;
+  fits_.erase(fit);
+  holes_.erase(offset);
+  if (rest > 0) {
+    holes_.emplace(offset + size, rest);
+    fits_.emplace(rest, offset + size);
+  }
+
+  return offset;
+}
+
+void HashFlat::accumulate(size_t row) {
+  for (const auto& acc : accumulators_) {
+    acc.second->append(main_->slice, position(row, acc.first));
+  }
+}
+
+void HashFlat::flush() {
+  for (const auto& acc : accumulators_) {
+    acc.second->apply();
+    for (size_t row = 0, size = getRows(); row < size; ++row) {
+      auto pos = position(row, acc.first);
+      if (pos != Accumulator::INVALID) {
+        acc.second->store(row, main_->slice, pos);
+      }
+    }
+  }
+}
+
+bool HashFlat::direct(const std::vector<DirectKey>& keys) {
+  if (getRows() > 0 || keys.size() != keys_.size()) {
+    return false;
+  }
+
+  size_t size = 1;
+  for (const auto& key : keys) {
+    if (keys_.find(key.column) == keys_.end() || key.slots == 0) {
+      return false;
+    }
+
+    // only integral keys can be addressed by value
+    switch (kw_.at(key.column).first) {
+    case Kind::BOOLEAN:
+    case Kind::TINYINT:
+    case Kind::SMALLINT:
+    case Kind::INTEGER:
+    case Kind::BIGINT:
+      break;
+    default:
+      return false;
+    }
+
+    size *= key.slots;
+  }
+
+  direct_ = keys;
+  slots_.assign(size, -1);
+  return true;
+}
+
+void HashFlat::rehash() {
+  if (slots_.empty()) {
+    return;
+  }
+
+  for (auto row : slots_) {
+    if (row >= 0) {
+      rowKeys_.emplace(*this, row, hash(row));
+    }
+  }
+
+  direct_.clear();
+  slots_.clear();
+  slots_.shrink_to_fit();
+}
+
+size_t HashFlat::address(const nebula::surface::RowData& row) const {
+#define READ_KEY(KIND, FUNC)  \
+  case Kind::KIND: {          \
+    value = row.FUNC(column); \
+    break;                    \
+  }
+
+  size_t slot = 0;
+  for (const auto& key : direct_) {
+    const auto column = key.column;
+    size_t offset = key.slots - 1;
+    if (!row.isNull(column)) {
+      int64_t value = 0;
+      switch (kw_.at(column).first) {
+        READ_KEY(BOOLEAN, readBool)
+        READ_KEY(TINYINT, readByte)
+        READ_KEY(SMALLINT, readShort)
+        READ_KEY(INTEGER, readInt)
+        READ_KEY(BIGINT, readLong)
+      default:
+        return std::string::npos;
+      }
+
+      // unsigned difference covers values less than base
+      offset = static_cast<uint64_t>(value) - static_cast<uint64_t>(key.base);
+      if (offset >= key.slots - 1) {
+        return std::string::npos;
+      }
+    }
+
+    slot = slot * key.slots + offset;
+  }
+
+  return slot;
+
+#undef READ_KEY
+}
+
 } // namespace keyed
 } // namespace memory
 } // namespace nebula
\ No newline at end of file
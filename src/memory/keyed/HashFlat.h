@@ -17,8 +17,10 @@
 #pragma once
 
 // #include <folly/container/F14Set.h>
+#include <map>
 #include <unordered_set>
 
+#include "Accumulator.h"
 #include "FlatBuffer.h"
 #include "surface/DataSurface.h"
 #include "surface/eval/ValueEval.h"
@@ -40,6 +42,13 @@ using Hasher = std::function<size_t(size_t, size_t)>;
 // Copier on one column from given row1 to row2 which using external updater
 using Copier = std::function<void(size_t, size_t)>;
 
+// a key column addressed by its value in [base, base + slots - 1), the last slot is for NULL
+struct DirectKey {
+  size_t column;
+  int64_t base;
+  size_t slots;
+};
+
 struct ColOps {
   explicit ColOps(Comparator c, Hasher h, Copier o)
     : comparator{ std::move(c) },
@@ -66,7 +75,7 @@ public:
   HashFlat(FlatBuffer* in,
            const std::vector<size_t>& keys,
            const nebula::surface::eval::Fields& fields)
-    : FlatBuffer(in->schema(), (NByte*)in->chunk()),
+    : FlatBuffer(in->schema(), in->chunk(), in->owner()),
       keys_{ keys.begin(), keys.end() },
       fields_{ fields } {
     init();
@@ -77,6 +86,13 @@ public:
   // compute hash value of given row and column list
   size_t hash(size_t rowId) const;
 
+  // compute from values of a row the same hash as it is stored in a hash flat with given keys,
+  // key columns are listed as name and kind in ascending order of their index, see hashKeys.
+  static size_t hash(const nebula::surface::RowData&, const std::vector<std::pair<std::string, nebula::type::Kind>>&);
+
+  // key columns to hash on in ascending order of their index
+  std::vector<std::pair<std::string, nebula::type::Kind>> hashKeys() const;
+
   // check if two rows are equal to each other on given columns
   bool equal(size_t row1, size_t row2) const;
 
@@ -87,6 +103,29 @@ public:
   // otherwise we get a new row, return false
   bool update(const nebula::surface::RowData&);
 
+  // update a row whose key hash is computed already, such as by the static hash of its values
+  bool update(const nebula::surface::RowData&, size_t);
+
+  // look up rows by a direct address table instead of hashing keys, slot of a row is the
+  // mixed radix number of its key values. It works only on an empty hash flat with every key listed.
+  // key values out of the ranges still go through hash lookup.
+  bool direct(const std::vector<DirectKey>&);
+
+  // drop the direct address table and index all its rows by hash for regular updates
+  void rehash();
+
+  // estimated memory in bytes held by this hash flat including its row index
+  inline size_t memory() const {
+    return binSize() +
+           rows_.size() * (sizeof(RowProps) + numColumns_ * sizeof(ColumnProps)) +
+           rowKeys_.size() * 2 * sizeof(Key) +
+           slots_.size() * sizeof(int32_t);
+  }
+
+  // fixed width aggregate states are kept in accumulators during updates,
+  // flush writes them back into rows, it has to be called before reading or serializing rows.
+  void flush();
+
   struct Hash {
     inline size_t operator()(const Key& key) const noexcept {
       return std::get<2>(key);
@@ -108,23 +147,81 @@ private:
   Hasher genHasher(size_t) noexcept;
   Copier genCopier(size_t) noexcept;
 
+  // merge values of the new row into the old row and roll back the new row
+  void merge(size_t, size_t);
+
+  // merge the new row into existing row of the same keys or index it with given hash
+  bool upsert(size_t, size_t);
+
+  // start aggregate states of a new row in accumulators
+  void accumulate(size_t);
+
+  // give a slot of a relocated string back, it is coalesced with adjacent holes or returned to the data buffer end
+  void release(size_t offset, size_t size);
+
+  // offset of a slot of given size from the smallest hole fitting it, or from the data buffer end
+  size_t reserve(size_t size);
+
+  // position of given column of given row in main buffer, INVALID if it is null
+  inline size_t position(size_t row, size_t column) const {
+    const auto& rowProps = rows_[row];
+    const auto& colProps = rowProps.colProps[column];
+    return colProps.isNull ? Accumulator::INVALID : rowProps.offset + colProps.offset;
+  }
+
+  // slot of given row in direct address table, npos if any key value is out of range
+  size_t address(const nebula::surface::RowData&) const;
+
 private:
   // referenced keys and fields for this hash flat
   const std::unordered_set<size_t> keys_;
   const nebula::surface::eval::Fields& fields_;
 
+  // keys in ascending order so that hash doesn't depend on set iteration
+  std::vector<size_t> hashKeys_;
+
   // computed non keys column index according to keys
   std::unordered_set<size_t> values_;
 
+  // non keys columns with states in accumulators and the others merged by copiers
+  std::vector<std::pair<size_t, std::unique_ptr<Accumulator>>> accumulators_;
+  std::vector<size_t> copied_;
+
   // customized operations for each column
   std::vector<ColOps> ops_;
 
+  // string values grown out of their slots in current update: position in main and new value
+  std::vector<std::pair<size_t, std::string>> relocations_;
+
+  // holes left by relocated strings in data buffer: offset to size, and size to offset for best fit
+  std::map<size_t, size_t> holes_;
+  std::multimap<size_t, size_t> fits_;
+
+  // direct address table of row id for each slot (-1 as empty slot) if enabled
+  std::vector<DirectKey> direct_;
+  std::vector<int32_t> slots_;
+
   // TODO(cao):
   // build error Undefined symbols for architecture x86_64: "folly::f14::detail::F14LinkCheck
   // https://engineering.fb.com/developer-tools/f14/
   // folly::F14FastSet<Key, Hash, Equal> rowKeys_;
   std::unordered_set<Key, Hash, Equal> rowKeys_;
 };
+
+// a row cursor carrying key hash of every row which is computed by HashFlat::hash of its values,
+// so that a hash flat with the same keys can update the rows without hashing them again.
+class HashedRowCursor : public nebula::surface::RowCursor {
+public:
+  explicit HashedRowCursor(size_t size) : nebula::surface::RowCursor(size) {}
+  virtual ~HashedRowCursor() = default;
+
+  // key columns the hashes are computed on, see HashFlat::hashKeys
+  virtual const std::vector<std::pair<std::string, nebula::type::Kind>>& hashKeys() const = 0;
+
+  // key hash of the row returned by last next
+  virtual size_t hash() const = 0;
+};
+
 } // namespace keyed
 } // namespace memory
 } // namespace nebula
\ No newline at end of file
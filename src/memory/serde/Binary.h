@@ -0,0 +1,64 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstring>
+#include <ostream>
+#include <string_view>
+
+#include "common/Memory.h"
+
+/**
+ * Plain binary read/write helpers used to persist in-memory structures.
+ * Writers append to a binary stream, readers consume from a raw buffer cursor and advance it.
+ */
+namespace nebula {
+namespace memory {
+namespace serde {
+
+template <typename T>
+inline auto writeValue(std::ostream& os, const T& value) -> typename std::enable_if_t<std::is_scalar_v<T>, size_t> {
+  os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  return sizeof(T);
+}
+
+// length prefixed bytes
+inline size_t writeBytes(std::ostream& os, std::string_view bytes) {
+  const size_t size = bytes.size();
+  writeValue(os, size);
+  os.write(bytes.data(), size);
+  return sizeof(size_t) + size;
+}
+
+template <typename T>
+inline auto readValue(const NByte*& cursor) -> typename std::enable_if_t<std::is_scalar_v<T>, T> {
+  T value;
+  std::memcpy(&value, cursor, sizeof(T));
+  cursor += sizeof(T);
+  return value;
+}
+
+inline std::string_view readBytes(const NByte*& cursor) {
+  const auto size = readValue<size_t>(cursor);
+  std::string_view bytes((const char*)cursor, size);
+  cursor += size;
+  return bytes;
+}
+
+} // namespace serde
+} // namespace memory
+} // namespace nebula
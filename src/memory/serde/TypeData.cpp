@@ -78,11 +78,9 @@ void StringData::addVoid(IndexType) {
 template <>
 void StringData::add(IndexType, std::string_view value) {
   size_ += slice_.write(size_, value.data(), value.size());
-  // TODO(cao) - disable bloom filter string type for now
-  // Due to hash function missing for string_view type
-  // if (UNLIKELY(bf_ != nullptr)) {
-  //   bf_->add(value.);
-  // }
+  if (UNLIKELY(bf_ != nullptr)) {
+    bf_->add(value);
+  }
 }
 
 #define TYPE_PROBABLY(DT, VT, BE)    \
@@ -102,6 +100,7 @@ TYPE_PROBABLY(LongData, int64_t, LIKELY)
 TYPE_PROBABLY(FloatData, float, UNLIKELY)
 TYPE_PROBABLY(DoubleData, double, UNLIKELY)
 TYPE_PROBABLY(Int128Data, int128_t, UNLIKELY)
+TYPE_PROBABLY(StringData, std::string_view, UNLIKELY)
 
 #undef TYPE_PROBABLY
 
@@ -153,6 +152,22 @@ TYPE_ADD_PROXY(int128_t, i128d_)
 TYPE_ADD_PROXY(std::string_view, std_)
 #undef TYPE_ADD_PROXY
 
+#define TYPE_BULK_ADD_PROXY(TYPE, OBJ)                                                                  \
+  template <>                                                                                           \
+  void TypeDataProxy::add(IndexType index, const TYPE* values, size_t count, const uint8_t* validity) { \
+    OBJ->add(index, values, count, validity);                                                           \
+  }
+
+TYPE_BULK_ADD_PROXY(bool, bd_)
+TYPE_BULK_ADD_PROXY(int8_t, btd_)
+TYPE_BULK_ADD_PROXY(int16_t, sd_)
+TYPE_BULK_ADD_PROXY(int32_t, id_)
+TYPE_BULK_ADD_PROXY(int64_t, ld_)
+TYPE_BULK_ADD_PROXY(float, fd_)
+TYPE_BULK_ADD_PROXY(double, dd_)
+TYPE_BULK_ADD_PROXY(int128_t, i128d_)
+#undef TYPE_BULK_ADD_PROXY
+
 #define TYPE_PROBABLY_PROXY(TYPE, OBJ)             \
   template <>                                      \
   bool TypeDataProxy::probably(TYPE value) const { \
@@ -167,6 +182,7 @@ TYPE_PROBABLY_PROXY(int64_t, ld_)
 TYPE_PROBABLY_PROXY(float, fd_)
 TYPE_PROBABLY_PROXY(double, dd_)
 TYPE_PROBABLY_PROXY(int128_t, i128d_)
+TYPE_PROBABLY_PROXY(std::string_view, std_)
 
 #undef TYPE_PROBABLY_PROXY
 
@@ -18,6 +18,7 @@
 
 #include <cmath>
 #include <glog/logging.h>
+#include <ostream>
 #include "common/BloomFilter.h"
 #include "common/Likely.h"
 #include "common/Memory.h"
@@ -30,6 +31,12 @@ namespace serde {
 
 using IndexType = size_t;
 
+// check validity bit of item i in a validity bitmap (LSB bit order as Arrow)
+// nullptr bitmap means all items are valid
+inline bool isValid(const uint8_t* validity, size_t i) {
+  return validity == nullptr || ((validity[i >> 3] >> (i & 7)) & 1);
+}
+
 // type metadata implementation for each type kind
 template <nebula::type::Kind KIND>
 class TypeDataImpl;
@@ -50,6 +57,21 @@ public:
 
   virtual size_t capacity() const = 0;
 
+  // write all data bytes into given stream, return number of bytes written
+  virtual size_t write(std::ostream&) const = 0;
+
+  // serve data from an external buffer (eg. memory mapped file) holding bytes written before
+  virtual void attach(const NByte*, size_t) = 0;
+
+  // rebuild indices such as bloom filter from data, used after data restored from a file
+  virtual void reindex() = 0;
+
+  // no more data will be added, fit indices such as bloom filter to the data
+  virtual void seal() = 0;
+
+  // check if any value of given hashes is probably present, hashes are computed by BloomFilter::hash
+  virtual bool probably(const uint64_t*, size_t) const = 0;
+
 protected:
   // data size in slice_
   size_t size_;
@@ -90,6 +112,18 @@ public:
     }
   }
 
+  // bulk add a chunk of values, slots of invalid items are kept as they are
+  void add(IndexType, const NType* values, size_t count, const uint8_t* validity) {
+    size_ += slice_.write(size_, reinterpret_cast<const NByte*>(values), count * Width);
+    if (UNLIKELY(bf_ != nullptr)) {
+      for (size_t i = 0; i < count; ++i) {
+        if (isValid(validity, i)) {
+          bf_->add(values[i]);
+        }
+      }
+    }
+  }
+
   void addVoid(IndexType) {
     size_ += slice_.write(size_, (NType)0);
   }
@@ -106,6 +140,44 @@ public:
     return slice_.capacity();
   }
 
+  size_t write(std::ostream& os) const override {
+    const auto bytes = slice_.read(0, size_);
+    os.write(bytes.data(), bytes.size());
+    return bytes.size();
+  }
+
+  void attach(const NByte* buffer, size_t size) override {
+    size_ = size;
+    slice_.attach(buffer, size);
+  }
+
+  void reindex() override {
+    if constexpr (std::is_scalar_v<NType> && Width > 0) {
+      if (bf_ != nullptr) {
+        for (size_t i = 0, items = size_ / Width; i < items; ++i) {
+          bf_->add(read(i));
+        }
+      }
+    }
+  }
+
+  // add a value into indices only, used to reindex values not laid out by width such as strings
+  inline void index(NType value) {
+    if (bf_ != nullptr) {
+      bf_->add(value);
+    }
+  }
+
+  void seal() override {
+    if (bf_ != nullptr) {
+      bf_->seal();
+    }
+  }
+
+  bool probably(const uint64_t* hashes, size_t size) const override {
+    return bf_ == nullptr || bf_->probably(hashes, size);
+  }
+
   inline bool hasBloomFilter() const {
     return bf_ != nullptr;
   }
@@ -141,6 +213,9 @@ public:
   template <typename T>
   void add(IndexType, T);
 
+  template <typename T>
+  void add(IndexType, const T*, size_t, const uint8_t*);
+
   inline void addVoid(IndexType index) {
     if (LIKELY(void_ != nullptr)) {
       void_(index);
@@ -170,6 +245,30 @@ public:
     return data_->capacity();
   }
 
+  inline size_t write(std::ostream& os) const {
+    return data_->write(os);
+  }
+
+  inline void attach(const NByte* buffer, size_t size) {
+    data_->attach(buffer, size);
+  }
+
+  inline void reindex() {
+    data_->reindex();
+  }
+
+  inline void index(std::string_view value) {
+    std_->index(value);
+  }
+
+  inline void seal() {
+    data_->seal();
+  }
+
+  inline bool probably(const uint64_t* hashes, size_t size) const {
+    return data_->probably(hashes, size);
+  }
+
   inline bool hasBloomFilter() const {
     return hasBf_;
   }
@@ -15,6 +15,7 @@
  */
 
 #include "TypeMetadata.h"
+#include "Binary.h"
 
 namespace nebula {
 namespace memory {
@@ -75,6 +76,192 @@ NUMBER_TYPE_HISTO(double, rh_)
 
 #undef NUMBER_TYPE_HISTO
 
+template <>
+size_t TypeMetadata::histogram(const bool* values, size_t count, const uint8_t* validity) {
+  size_t valid = 0;
+  size_t trues = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const size_t v = isValid(validity, i);
+    valid += v;
+    trues += v & values[i];
+  }
+
+  bh_->trueValues += trues;
+  return histo_->count += valid;
+}
+
+// tight loops on local variables without validity bitmap to let compiler vectorize them
+#define NUMBER_TYPE_HISTO_BULK(T, P)                                                     \
+  template <>                                                                            \
+  size_t TypeMetadata::histogram(const T* values, size_t count, const uint8_t* validity) { \
+    using V = decltype(P->v_sum);                                                        \
+    V vmin = P->v_min;                                                                   \
+    V vmax = P->v_max;                                                                   \
+    V vsum = 0;                                                                          \
+    size_t valid = count;                                                                \
+    if (validity == nullptr) {                                                           \
+      for (size_t i = 0; i < count; ++i) {                                               \
+        const V v = values[i];                                                           \
+        vmin = std::min(vmin, v);                                                        \
+        vmax = std::max(vmax, v);                                                        \
+        vsum += v;                                                                       \
+      }                                                                                  \
+    } else {                                                                             \
+      valid = 0;                                                                         \
+      for (size_t i = 0; i < count; ++i) {                                               \
+        if (isValid(validity, i)) {                                                      \
+          const V v = values[i];                                                         \
+          vmin = std::min(vmin, v);                                                      \
+          vmax = std::max(vmax, v);                                                      \
+          vsum += v;                                                                     \
+          ++valid;                                                                       \
+        }                                                                                \
+      }                                                                                  \
+    }                                                                                    \
+                                                                                         \
+    P->v_min = vmin;                                                                     \
+    P->v_max = vmax;                                                                     \
+    P->v_sum += vsum;                                                                    \
+    return histo_->count += valid;                                                       \
+  }
+
+NUMBER_TYPE_HISTO_BULK(int8_t, ih_)
+NUMBER_TYPE_HISTO_BULK(int16_t, ih_)
+NUMBER_TYPE_HISTO_BULK(int32_t, ih_)
+NUMBER_TYPE_HISTO_BULK(int64_t, ih_)
+NUMBER_TYPE_HISTO_BULK(float, rh_)
+NUMBER_TYPE_HISTO_BULK(double, rh_)
+
+#undef NUMBER_TYPE_HISTO_BULK
+
+template <>
+size_t TypeMetadata::histogram(const int128_t*, size_t count, const uint8_t* validity) {
+  size_t valid = 0;
+  for (size_t i = 0; i < count; ++i) {
+    valid += isValid(validity, i);
+  }
+
+  return histo_->count += valid;
+}
+
+size_t TypeMetadata::setNulls(size_t index, size_t count, const uint8_t* validity) {
+  if (validity == nullptr) {
+    return 0;
+  }
+
+  std::vector<uint32_t> nulls;
+  for (size_t i = 0; i < count; ++i) {
+    // skip a whole byte of valid items
+    if ((i & 7) == 0 && i + 8 <= count && validity[i >> 3] == 0xFF) {
+      i += 7;
+      continue;
+    }
+
+    if (!isValid(validity, i)) {
+      nulls.push_back(index + i);
+    }
+  }
+
+  nulls_.addMany(nulls.size(), nulls.data());
+  return nulls.size();
+}
+
+size_t TypeMetadata::memory() const {
+  // rough per-entry cost of a hash node: key, value, next pointer and bucket slot
+  static constexpr size_t HASH_NODE = 32;
+  size_t bytes = nulls_.getSizeInBytes(false);
+  if (offsetSize_ != nullptr) {
+    bytes += offsetSize_->capacity() * sizeof(CompoundItems::value_type);
+  }
+
+  if (dict_ != nullptr) {
+    bytes += dict_->size() * HASH_NODE;
+  }
+
+  if (hashItems_ != nullptr) {
+    bytes += hashItems_->size() * HASH_NODE;
+  }
+
+  return bytes;
+}
+
+void TypeMetadata::save(std::ostream& os) const {
+  // nulls in portable roaring format
+  std::string nulls(nulls_.getSizeInBytes(true), 0);
+  nulls_.write(nulls.data(), true);
+  writeBytes(os, nulls);
+
+  // offset and size items
+  const size_t items = offsetSize_ == nullptr ? 0 : offsetSize_->size();
+  writeValue(os, items);
+  if (items > 0) {
+    os.write(reinterpret_cast<const char*>(offsetSize_->data()), items * sizeof(CompoundItems::value_type));
+  }
+
+  // dictionary links
+  const size_t links = dict_ == nullptr ? 0 : dict_->size();
+  writeValue(os, links);
+  if (dict_ != nullptr) {
+    for (const auto& link : *dict_) {
+      writeValue(os, link.first);
+      writeValue(os, link.second);
+    }
+  }
+
+  // histogram
+  writeValue(os, histo_->count);
+  if (bh_ != nullptr) {
+    writeValue(os, bh_->trueValues);
+  } else if (ih_ != nullptr) {
+    writeValue(os, ih_->v_min);
+    writeValue(os, ih_->v_max);
+    writeValue(os, ih_->v_sum);
+  } else if (rh_ != nullptr) {
+    writeValue(os, rh_->v_min);
+    writeValue(os, rh_->v_max);
+    writeValue(os, rh_->v_sum);
+  }
+}
+
+const NByte* TypeMetadata::load(const NByte* cursor) {
+  const auto nulls = readBytes(cursor);
+  nulls_ = Roaring::read(nulls.data(), true);
+
+  const auto items = readValue<size_t>(cursor);
+  if (items > 0) {
+    N_ENSURE_NOT_NULL(offsetSize_, "scalar type has no offset size items");
+    offsetSize_->resize(items);
+    std::memcpy(offsetSize_->data(), cursor, items * sizeof(CompoundItems::value_type));
+    cursor += items * sizeof(CompoundItems::value_type);
+  }
+
+  const auto links = readValue<size_t>(cursor);
+  for (size_t i = 0; i < links; ++i) {
+    const auto index = readValue<uint32_t>(cursor);
+    const auto target = readValue<uint32_t>(cursor);
+    if (dict_ != nullptr) {
+      dict_->emplace(index, target);
+    }
+  }
+
+  histo_->count = readValue<uint64_t>(cursor);
+  if (bh_ != nullptr) {
+    bh_->trueValues = readValue<uint64_t>(cursor);
+  } else if (ih_ != nullptr) {
+    ih_->v_min = readValue<int64_t>(cursor);
+    ih_->v_max = readValue<int64_t>(cursor);
+    ih_->v_sum = readValue<int64_t>(cursor);
+  } else if (rh_ != nullptr) {
+    rh_->v_min = readValue<double>(cursor);
+    rh_->v_max = readValue<double>(cursor);
+    rh_->v_sum = readValue<double>(cursor);
+  }
+
+  // restored metadata is sealed
+  seal();
+  return cursor;
+}
+
 } // namespace serde
 } // namespace memory
 } // namespace nebula
\ No newline at end of file
@@ -35,7 +35,8 @@ namespace serde {
  * Eventually this metadata can be serailized into a flat buffer to persistence.
  */
 class TypeMetadata {
-  using CompoundItems = std::vector<IndexType>;
+  // offset/size items are stored in 32 bits, a batch never holds 4G items or bytes in one node
+  using CompoundItems = std::vector<uint32_t>;
   using HashItems = std::unordered_multimap<size_t, IndexType>;
   // Note we're using uint32 to represent index in a batch to save 8 bytes
   // with assumption it is big enough for number of rows a batch is allowed.
@@ -102,6 +103,9 @@ public:
     nulls_.add(index);
   }
 
+  // mark invalid items of a chunk starting at given index as nulls, return number of nulls
+  size_t setNulls(size_t index, size_t count, const uint8_t* validity);
+
   inline bool isNull(size_t index) {
     // column/node with default value will never be null
     if (default_) {
@@ -118,6 +122,9 @@ public:
   void setOffsetSize(size_t index, IndexType items) {
     auto size = offsetSize_->size();
     auto last = offsetSize_->at(size - 1);
+    if (UNLIKELY(last + items > std::numeric_limits<uint32_t>::max())) {
+      throw NException("offset overflows 32 bits, reduce the batch size");
+    }
 
     // NULLS in the hole
     if (LIKELY(index >= size)) {
@@ -181,12 +188,28 @@ public:
   inline void seal() {
     // release hash items for lookup
     hashItems_ = nullptr;
+
+    // compact nulls and offsets as no more items will be added
+    nulls_.runOptimize();
+    nulls_.shrinkToFit();
+    if (offsetSize_ != nullptr) {
+      offsetSize_->shrink_to_fit();
+    }
   }
 
+  // memory allocated by this metadata in bytes (estimation on hash containers)
+  size_t memory() const;
+
   inline bool hasDefault() const {
     return default_;
   }
 
+  // persist metadata into a binary stream
+  void save(std::ostream&) const;
+
+  // restore metadata from a buffer written by save, return cursor after consumed bytes
+  const NByte* load(const NByte*);
+
 public:
   // build up histogram in metadata for supported types
   // including:
@@ -196,6 +219,10 @@ public:
   template <typename T>
   size_t histogram(T);
 
+  // bulk version to record valid items of a chunk
+  template <typename T>
+  size_t histogram(const T*, size_t, const uint8_t*);
+
   // get a const reference of the histogram object used internally
   template <typename T = Histogram>
   inline auto histogram() const ->
@@ -216,9 +243,7 @@ private:
   // we have 6 entry with each entry having items: 5, 1, 0, 2, 6, 6
   // last entry contains total items
   // string/binary type data node will use it for the same purpose to track offset/size of each item
-  // call shrink_to_fit to compress the vector when finalizing
-  // this can be futher compressed to storage efficiency.
-  // uint32_t should be big enough for number of items in each object
+  // shrink_to_fit is called to compact the vector in seal
   std::unique_ptr<CompoundItems> offsetSize_;
 
   // build a hash map from value hash to value index serving as dictionary purpose.
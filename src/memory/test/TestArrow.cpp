@@ -24,9 +24,12 @@
 #include "arrow/io/api.h"
 #include "common/Memory.h"
 #include "fmt/format.h"
+#include "memory/ArrowExporter.h"
+#include "memory/ArrowImporter.h"
 #include "memory/Batch.h"
 #include "memory/DataNode.h"
 #include "memory/FlatRow.h"
+#include "memory/keyed/FlatBuffer.h"
 #include "meta/TestTable.h"
 #include "surface/DataSurface.h"
 #include "surface/MockSurface.h"
@@ -183,6 +186,78 @@ TEST(ArrowTest, BasicArrowData) {
   EXPECT_EQ(rows.size(), expected_rows.size());
 }
 
+TEST(ArrowTest, TestImportExport) {
+  constexpr auto rows = 100;
+  auto schema = std::make_shared<arrow::Schema>(std::vector<std::shared_ptr<arrow::Field>>{
+    arrow::field("id", arrow::int32()), arrow::field("event", arrow::utf8()), arrow::field("weight", arrow::float64()) });
+  auto make = [&schema]() {
+    arrow::MemoryPool* pool = arrow::default_memory_pool();
+    arrow::Int32Builder idBuilder(pool);
+    arrow::StringBuilder eventBuilder(pool);
+    DoubleBuilder weightBuilder(pool);
+    for (auto i = 0; i < rows; ++i) {
+      EXPECT_TRUE((i % 10 == 0 ? idBuilder.AppendNull() : idBuilder.Append(i)).ok());
+      EXPECT_TRUE(eventBuilder.Append(fmt::format("e{0}", i % 3)).ok());
+      EXPECT_TRUE(weightBuilder.Append(0.5 * i).ok());
+    }
+
+    std::shared_ptr<arrow::Array> ids, events, weights;
+    EXPECT_TRUE(idBuilder.Finish(&ids).ok());
+    EXPECT_TRUE(eventBuilder.Finish(&events).ok());
+    EXPECT_TRUE(weightBuilder.Finish(&weights).ok());
+    return arrow::RecordBatch::Make(schema, rows, { ids, events, weights });
+  };
+
+  // import into a batch, number columns adopt arrow buffers
+  auto rb = make();
+  auto ids = const_cast<int32_t*>(static_cast<const arrow::Int32Array&>(*rb->column(0)).raw_values());
+  auto nschema = TypeSerializer::from("ROW<id:int, event:string, weight:double>");
+  nebula::meta::Table table("arrow", nschema);
+  Batch batch(table, rows);
+  EXPECT_EQ(ArrowImporter::adopt(rb, batch), rows);
+  EXPECT_EQ(batch.getRows(), rows);
+  EXPECT_EQ(batch.histogram<nebula::memory::serde::RealHistogram>("weight").max(), 0.5 * 99);
+
+  // the batch keeps adopted buffers alive after arrow side releases them,
+  // and they are shared rather than copied: a write into the arrow buffer is read by the batch
+  rb = nullptr;
+  auto accessor = batch.makeAccessor();
+  ids[1] = 1001;
+  EXPECT_EQ(accessor->seek(1).readInt("id"), 1001);
+  ids[1] = 1;
+
+  for (auto i = 0; i < rows; ++i) {
+    const auto& r = accessor->seek(i);
+    EXPECT_EQ(r.isNull("id"), i % 10 == 0);
+    if (i % 10 != 0) {
+      EXPECT_EQ(r.readInt("id"), i);
+    }
+    EXPECT_EQ(r.readString("event"), fmt::format("e{0}", i % 3));
+    EXPECT_EQ(r.readDouble("weight"), 0.5 * i);
+  }
+
+  // export rows of a flat buffer as arrow IPC stream and read it back
+  nebula::memory::keyed::FlatBuffer fb(nschema);
+  for (auto i = 0; i < rows; ++i) {
+    fb.add(accessor->seek(i));
+  }
+
+  auto buffer = ArrowExporter::stream({ ArrowExporter::convert(fb) });
+  arrow::io::BufferReader reader(buffer);
+  std::shared_ptr<arrow::RecordBatchReader> stream;
+  EXPECT_TRUE(arrow::ipc::RecordBatchStreamReader::Open(&reader, &stream).ok());
+  std::shared_ptr<arrow::RecordBatch> result;
+  EXPECT_TRUE(stream->ReadNext(&result).ok());
+  EXPECT_EQ(result->num_rows(), rows);
+  EXPECT_TRUE(result->Equals(*make()));
+
+  // columns read from the IPC stream point into the exported buffer without copy
+  const auto values = static_cast<const arrow::DoubleArray&>(*result->column(2)).raw_values();
+  const auto begin = reinterpret_cast<const uint8_t*>(values);
+  EXPECT_GE(begin, buffer->data());
+  EXPECT_LE(begin + rows * sizeof(double), buffer->data() + buffer->size());
+}
+
 } // namespace test
 } // namespace memory
 } // namespace nebula
\ No newline at end of file
@@ -16,12 +16,15 @@
 
 #include "gtest/gtest.h"
 #include <glog/logging.h>
+#include <limits>
+#include <sstream>
 #include <valarray>
 #include "common/Memory.h"
 #include "fmt/format.h"
 #include "memory/Batch.h"
 #include "memory/DataNode.h"
 #include "memory/FlatRow.h"
+#include "memory/serde/TypeMetadata.h"
 #include "meta/TestTable.h"
 #include "surface/DataSurface.h"
 #include "surface/MockSurface.h"
@@ -144,12 +147,201 @@ TEST(BatchTest, TestBatchRead) {
   }
 }
 
+TEST(BatchTest, TestSpill) {
+  nebula::meta::TestTable test;
+  auto count = 5000;
+  Batch batch(test, count);
+
+  std::vector<nebula::surface::StaticRow> rows;
+  rows.reserve(count);
+  MockRowData row;
+  for (auto i = 0; i < count; ++i) {
+    rows.push_back({ row.readLong("_time_"),
+                     row.readInt("id"),
+                     row.readString("event"),
+                     i % 3 != 0 ? nullptr : row.readList("items"),
+                     row.readBool("flag"),
+                     row.readByte("value"),
+                     row.readInt128("i128"),
+                     row.readDouble("weight") });
+    batch.add(rows[i]);
+  }
+
+  batch.seal();
+  const auto file = "/tmp/nebula.spill.test";
+  batch.save(file);
+  EXPECT_GT(batch.spill(file), 0);
+  EXPECT_TRUE(batch.spilled());
+  batch.pageIn();
+
+  // data read from the spilled file should be the same
+  auto accessor = batch.makeAccessor();
+  for (auto i = 0; i < count; ++i) {
+    const auto& r1 = rows[i];
+    const auto& r2 = accessor->seek(i);
+    EXPECT_EQ(r1.readInt("id"), r2.readInt("id"));
+    EXPECT_EQ(r1.readString("event"), r2.readString("event"));
+    EXPECT_EQ(r1.readBool("flag"), r2.readBool("flag"));
+    EXPECT_EQ(r1.isNull("items"), r2.isNull("items"));
+    if (!r1.isNull("items")) {
+      auto l1 = r1.readList("items");
+      auto l2 = r2.readList("items");
+      EXPECT_EQ(l1->getItems(), l2->getItems());
+      for (auto k = 0; k < l1->getItems(); ++k) {
+        EXPECT_EQ(l1->readString(k), l2->readString(k));
+      }
+    }
+  }
+
+  std::remove(file);
+}
+
+TEST(BatchTest, TestSaveRestore) {
+  nebula::meta::TestTable test;
+  int32_t count = 1000;
+  Batch batch(test, count);
+
+  std::vector<nebula::surface::StaticRow> rows;
+  rows.reserve(count);
+  for (int32_t i = 0; i < count; ++i) {
+    rows.push_back({ i, i, i % 2 == 0 ? "nebula" : "events", nullptr, i % 3 == 0, (int8_t)(i % 100), i, 1.5 * i });
+    batch.add(rows[i]);
+  }
+
+  batch.seal();
+  const auto file = "/tmp/nebula.batch.test";
+  batch.save(file, "header");
+
+  std::string header;
+  auto restored = Batch::restore(file, header);
+  EXPECT_EQ(header, "header");
+  EXPECT_EQ(restored->getRows(), batch.getRows());
+  EXPECT_EQ(restored->getRawSize(), batch.getRawSize());
+  EXPECT_TRUE(restored->spilled());
+  EXPECT_EQ(restored->table()->name(), test.name());
+
+  // histogram and bloom filter are restored
+  auto h1 = batch.histogram<nebula::memory::serde::IntHistogram>("id");
+  auto h2 = restored->histogram<nebula::memory::serde::IntHistogram>("id");
+  EXPECT_EQ(h1.min(), h2.min());
+  EXPECT_EQ(h1.max(), h2.max());
+  EXPECT_EQ(h1.sum(), h2.sum());
+  EXPECT_TRUE(restored->probably("id", 10));
+
+  auto accessor = restored->makeAccessor();
+  for (auto i = 0; i < count; ++i) {
+    const auto& r1 = rows[i];
+    const auto& r2 = accessor->seek(i);
+    EXPECT_EQ(r1.readInt("id"), r2.readInt("id"));
+    EXPECT_EQ(r1.readString("event"), r2.readString("event"));
+    EXPECT_EQ(r1.readBool("flag"), r2.readBool("flag"));
+    EXPECT_EQ(r1.readByte("value"), r2.readByte("value"));
+    EXPECT_EQ(r1.readDouble("weight"), r2.readDouble("weight"));
+  }
+
+  std::remove(file);
+}
+
+TEST(BatchTest, TestChunkAppend) {
+  nebula::meta::Table table("chunk", TypeSerializer::from("ROW<id:int, event:string, flag:bool, weight:double>"));
+  constexpr size_t count = 1000;
+  Batch batch(table, count);
+
+  // every 7th id is null
+  std::vector<int32_t> ids(count);
+  std::vector<uint8_t> validity((count + 7) / 8, 0);
+  std::vector<std::string_view> events(count);
+  std::unique_ptr<bool[]> flags(new bool[count]);
+  std::vector<double> weights(count);
+  for (size_t i = 0; i < count; ++i) {
+    ids[i] = i;
+    if (i % 7 != 0) {
+      validity[i / 8] |= (1 << (i % 8));
+    }
+    events[i] = i % 2 == 0 ? "nebula" : "events";
+    flags[i] = i % 3 == 0;
+    weights[i] = 1.5 * i;
+  }
+
+  // two chunks for each column, validity bitmap of a chunk starts at byte boundary
+  for (auto [offset, size] : { std::make_pair<size_t, size_t>(0, 496), std::make_pair<size_t, size_t>(496, count - 496) }) {
+    batch.append("id", ids.data() + offset, size, validity.data() + offset / 8);
+    batch.append("event", events.data() + offset, size, nullptr);
+    batch.append("flag", flags.get() + offset, size, nullptr);
+    batch.appendChunk("weight", weights.data() + offset, size, nullptr);
+    EXPECT_EQ(batch.commit(size), offset + size);
+  }
+
+  EXPECT_EQ(batch.getRows(), count);
+  auto accessor = batch.makeAccessor();
+  for (size_t i = 0; i < count; ++i) {
+    const auto& r = accessor->seek(i);
+    EXPECT_EQ(r.isNull("id"), i % 7 == 0);
+    if (i % 7 != 0) {
+      EXPECT_EQ(r.readInt("id"), ids[i]);
+    }
+    EXPECT_EQ(r.readString("event"), events[i]);
+    EXPECT_EQ(r.readBool("flag"), flags[i]);
+    EXPECT_EQ(r.readDouble("weight"), weights[i]);
+  }
+
+  // histogram and bloom filter are maintained by chunk append
+  auto h = batch.histogram<nebula::memory::serde::IntHistogram>("id");
+  EXPECT_EQ(h.count, count - (count + 6) / 7);
+  EXPECT_EQ(h.min(), 1);
+  EXPECT_EQ(h.max(), 999);
+  auto w = batch.histogram<nebula::memory::serde::RealHistogram>("weight");
+  EXPECT_EQ(w.max(), 1.5 * 999);
+
+  // chunks of different size can not be committed
+  Batch bad(table, count);
+  bad.append("id", ids.data(), 10, nullptr);
+  EXPECT_THROW(bad.commit(10), NException);
+}
+
 TEST(DataTreeTest, TestBuildDataTree) {
   nebula::meta::TestTable test;
   auto dataTree = nebula::memory::DataNode::buildDataTree(test, 10);
   EXPECT_EQ(dataTree->size(), test.schema()->size());
 }
 
+TEST(BatchTest, TestOffsetSize) {
+  using OffsetSize = std::pair<IndexType, IndexType>;
+  nebula::memory::serde::TypeMetadata meta(nebula::type::Kind::VARCHAR, nebula::meta::Column{});
+
+  // null items in the hole have zero size
+  meta.setOffsetSize(0, 5);
+  meta.setOffsetSize(3, 7);
+  EXPECT_EQ(meta.offsetSize(0), OffsetSize(0, 5));
+  EXPECT_EQ(meta.offsetSize(1), OffsetSize(5, 0));
+  EXPECT_EQ(meta.offsetSize(2), OffsetSize(5, 0));
+  EXPECT_EQ(meta.offsetSize(3), OffsetSize(5, 7));
+
+  // offsets fill up all 32 bits
+  constexpr IndexType max = std::numeric_limits<uint32_t>::max();
+  meta.setOffsetSize(4, max - 12);
+  EXPECT_EQ(meta.offsetSize(4), OffsetSize(12, max - 12));
+
+  // an item overflowing 32 bits is rejected without touching existing items
+  EXPECT_THROW(meta.setOffsetSize(5, 1), NException);
+  EXPECT_THROW(meta.setOffsetSize(8, max), NException);
+  EXPECT_EQ(meta.offsetSize(4), OffsetSize(12, max - 12));
+  meta.setOffsetSize(5, 0);
+  EXPECT_EQ(meta.offsetSize(5), OffsetSize(max, 0));
+
+  // items are persisted in 32 bits and restored the same
+  meta.seal();
+  std::ostringstream os;
+  meta.save(os);
+  const auto bytes = os.str();
+  nebula::memory::serde::TypeMetadata restored(nebula::type::Kind::VARCHAR, nebula::meta::Column{});
+  auto cursor = reinterpret_cast<const NByte*>(bytes.data());
+  EXPECT_EQ(restored.load(cursor), cursor + bytes.size());
+  for (size_t i = 0; i < 6; ++i) {
+    EXPECT_EQ(restored.offsetSize(i), meta.offsetSize(i));
+  }
+}
+
 TEST(BatchTest, TestBloomFilter) {
   nebula::meta::TestTable test;
   int32_t count = 1000;
@@ -213,6 +405,12 @@ TEST(BatchTest, TestStringDictionary) {
   }
 
   batch.seal();
+
+  // sealing again keeps metadata that readers may hold
+  const auto sketch = batch.sketch("id");
+  batch.seal();
+  EXPECT_EQ(batch.sketch("id"), sketch);
+
   LOG(INFO) << "Batch State: " << batch.state();
   auto accessor = batch.makeAccessor();
   for (auto i = 0; i < count; ++i) {
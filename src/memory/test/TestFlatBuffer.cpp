@@ -183,6 +183,35 @@ TEST(FlatBufferTest, TestSerde) {
   // delete[] buffer;
 }
 
+TEST(FlatBufferTest, TestSharedOwner) {
+  nebula::meta::TestTable test;
+  FlatBuffer fb(test.schema());
+  constexpr auto rows2test = 1024;
+  MockRowData row(Evidence::unix_timestamp());
+  for (auto i = 0; i < rows2test; ++i) {
+    fb.add(row);
+  }
+
+  // serialized data is held by an external owner, such as a message
+  auto owner = std::make_shared<std::vector<NByte>>(fb.binSize());
+  fb.serialize(owner->data());
+  std::weak_ptr<std::vector<NByte>> watch = owner;
+
+  // read in place, flat buffers reading the data keep the owner alive
+  auto fb2 = std::make_unique<FlatBuffer>(test.schema(), owner->data(), owner);
+  owner = nullptr;
+  EXPECT_FALSE(watch.expired());
+  EXPECT_EQ(fb2->chunk(), watch.lock()->data());
+
+  FlatBuffer fb3(test.schema(), fb2->chunk(), fb2->owner());
+  fb2 = nullptr;
+  EXPECT_FALSE(watch.expired());
+  EXPECT_EQ(fb3.getRows(), rows2test);
+  for (auto i = 0; i < rows2test; ++i) {
+    EXPECT_EQ(line(fb.row(i)), line(fb3.row(i)));
+  }
+}
+
 } // namespace test
 } // namespace memory
 } // namespace nebula
\ No newline at end of file
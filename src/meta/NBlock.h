@@ -139,6 +139,11 @@ public:
     return storage_;
   }
 
+  // set location where the block data is persisted, eg. a local spill file
+  inline void setStorage(const std::string& storage) {
+    storage_ = storage;
+  }
+
 private:
   NBlock(const BlockSignature& sign, const NNode& node, std::shared_ptr<T> data, const BlockState& state)
     : sign_{ sign }, data_{ data }, residence_{ std::move(node) }, state_{ state } {
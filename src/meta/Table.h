@@ -86,6 +86,12 @@ public:
   // window column is produced from time window based on windowing algorithm
   static constexpr auto WINDOW_COLUMN = "_window_";
 
+  // row count column of a rollup cube
+  static constexpr auto COUNT_COLUMN = "_count_";
+
+  // time bucket in seconds of a rollup cube
+  static constexpr int64_t ROLLUP_BUCKET = 60;
+
 public:
   virtual Schema schema() const {
     N_ENSURE_NOT_NULL(schema_, fmt::format("invalid table not found = {0}", name_));
@@ -18,6 +18,7 @@
 
 #include <unordered_set>
 
+#include "common/Chars.h"
 #include "common/Hash.h"
 #include "meta/Table.h"
 #include "type/Serde.h"
@@ -152,6 +153,69 @@ struct TableSpec {
     // build up a new table from this spec
     return std::make_shared<Table>(name, schemaPtr, columnProps, accessSpec);
   }
+
+  // setting of rollup cube as comma separated dimensions.
+  // a cube keeps sum of every numeric column and row count by minute for each combination of the dimensions,
+  // it is built along with raw blocks at ingestion and serves eligible timeline queries.
+  static constexpr auto ROLLUP = "rollup";
+
+  // name of the cube table of a table
+  static inline std::string cubeName(const std::string& table) {
+    return fmt::format("{0}.rollup", table);
+  }
+
+  // rollup dimensions, empty if rollup is not defined
+  std::unordered_set<std::string> rollup() const {
+    auto itr = settings.find(ROLLUP);
+    if (itr == settings.end()) {
+      return {};
+    }
+
+    return nebula::common::Chars::split(itr->second.data(), itr->second.size());
+  }
+
+  // cube table of this table: dimensions, time, metric sums and row count. nullptr if rollup is not defined
+  std::shared_ptr<Table> cube() const {
+    const auto dimensions = rollup();
+    if (dimensions.empty()) {
+      return nullptr;
+    }
+
+    auto raw = to()->schema();
+    auto schemaPtr = nebula::type::TypeSerializer::from(nebula::type::TypeSerializer::to(raw));
+    std::vector<nebula::type::TreeNode> metrics;
+    for (size_t i = 0, size = raw->size(); i < size; ++i) {
+      auto column = raw->childType(i);
+      const auto& n = column->name();
+      if (n == Table::TIME_COLUMN || dimensions.count(n) > 0) {
+        continue;
+      }
+
+      // numeric columns are summed up in widest type, others are dropped
+      schemaPtr->remove(n);
+      switch (column->k()) {
+      case nebula::type::Kind::TINYINT:
+      case nebula::type::Kind::SMALLINT:
+      case nebula::type::Kind::INTEGER:
+      case nebula::type::Kind::BIGINT:
+        metrics.push_back(nebula::type::LongType::createTree(n));
+        break;
+      case nebula::type::Kind::REAL:
+      case nebula::type::Kind::DOUBLE:
+        metrics.push_back(nebula::type::DoubleType::createTree(n));
+        break;
+      default:
+        break;
+      }
+    }
+
+    for (auto& m : metrics) {
+      schemaPtr->addChild(m);
+    }
+    schemaPtr->addChild(nebula::type::LongType::createTree(Table::COUNT_COLUMN));
+
+    return std::make_shared<Table>(cubeName(name), schemaPtr, columnProps, accessSpec);
+  }
 };
 
 // define table spec pointer
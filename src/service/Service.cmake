@@ -65,12 +65,16 @@ set(nodegrpc_srcs "${NODE_GEN_DIR}/node.grpc.fb.cc")
 
 # build everything else as library except executable of NebulaServer and NebulaClient
 add_library(${NEBULA_SERVICE} STATIC 
+    ${NEBULA_SRC}/service/base/Columnar.cpp
+    ${NEBULA_SRC}/service/base/Compression.cpp
     ${NEBULA_SRC}/service/base/NebulaService.cpp
     ${NEBULA_SRC}/service/node/ConnectionPool.cpp
     ${NEBULA_SRC}/service/node/NodeClient.cpp
+    ${NEBULA_SRC}/service/node/PlanCache.cpp
     ${NEBULA_SRC}/service/node/TaskExecutor.cpp
     ${NEBULA_SRC}/service/server/NodeSync.cpp
     ${NEBULA_SRC}/service/server/QueryHandler.cpp
+    ${NEBULA_SRC}/service/server/ResultCache.cpp
     ${nproto_srcs}
     ${ngrpc_srcs}
     ${nodegrpc_srcs})
@@ -85,6 +89,8 @@ target_link_libraries(${NEBULA_SERVICE}
     PUBLIC ${FLATBUFFERS_LIBRARY}
     PUBLIC ${THRIFT_LIBRARY}
     PUBLIC ${SNAPPY_LIBRARY}
+    PUBLIC ${LZ4_LIBRARY}
+    PUBLIC ${ZSTD_LIBRARY}
     PUBLIC ${BOOST_REGEX_LIBRARY}
     PUBLIC ${ROARING_LIBRARY})
 if(APPLE)
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "Columnar.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "common/Errors.h"
+
+/**
+ * Columnar format of batch data transferred between node and server.
+ */
+namespace nebula {
+namespace service {
+namespace base {
+
+using nebula::memory::keyed::FlatBuffer;
+using nebula::memory::keyed::HashFlat;
+using nebula::surface::IndexType;
+using nebula::surface::ListData;
+using nebula::surface::MapData;
+using nebula::surface::RowCursorPtr;
+using nebula::type::Kind;
+using nebula::type::Schema;
+
+// width of a fixed width value in columnar layout, 0 for string
+static size_t width(Kind kind) {
+  switch (kind) {
+  case Kind::BOOLEAN: return sizeof(bool);
+  case Kind::TINYINT: return sizeof(int8_t);
+  case Kind::SMALLINT: return sizeof(int16_t);
+  case Kind::INTEGER: return sizeof(int32_t);
+  case Kind::BIGINT: return sizeof(int64_t);
+  case Kind::REAL: return sizeof(float);
+  case Kind::DOUBLE: return sizeof(double);
+  case Kind::INT128: return sizeof(int128_t);
+  default: return 0;
+  }
+}
+
+bool ColumnarSerde::supports(const Schema& schema) {
+  for (size_t i = 0, size = schema->size(); i < size; ++i) {
+    auto kind = schema->childType(i)->k();
+    if (kind != Kind::VARCHAR && width(kind) == 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// a column being built from rows
+struct ColumnBuilder {
+  std::string name;
+  Kind kind;
+  size_t width;
+  bool nulls;
+  std::vector<uint8_t> validity;
+  std::vector<int8_t> values;
+  std::unordered_map<std::string_view, uint32_t> codes;
+  std::vector<std::string_view> dict;
+  std::vector<uint32_t> indices;
+};
+
+flatbuffers::Offset<ColumnarRows> ColumnarSerde::serialize(
+  flatbuffers::FlatBufferBuilder& builder, const FlatBuffer& fb, const std::vector<size_t>& keys) {
+  const auto& schema = fb.schema();
+  const size_t rows = fb.getRows();
+  const size_t numColumns = schema->size();
+
+  std::vector<ColumnBuilder> columns(numColumns);
+  for (size_t i = 0; i < numColumns; ++i) {
+    auto& column = columns.at(i);
+    auto type = schema->childType(i);
+    column.name = type->name();
+    column.kind = type->k();
+    column.width = width(column.kind);
+    column.nulls = false;
+    column.validity.resize((rows + 7) / 8, 0);
+    if (column.kind == Kind::VARCHAR) {
+      column.indices.resize(rows, 0);
+    } else {
+      column.values.resize(rows * column.width, 0);
+    }
+  }
+
+  // key columns are hashed in ascending order of their index as hash flat does
+  std::vector<uint32_t> sorted(keys.begin(), keys.end());
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<std::pair<std::string, Kind>> hashKeys;
+  hashKeys.reserve(sorted.size());
+  for (auto index : sorted) {
+    hashKeys.emplace_back(columns.at(index).name, columns.at(index).kind);
+  }
+
+  std::vector<uint64_t> hashes;
+  hashes.reserve(sorted.empty() ? 0 : rows);
+
+#define COPY_VALUE(KIND, TYPE, FUNC)                                            \
+  case Kind::KIND: {                                                            \
+    TYPE value = row->FUNC(column.name);                                        \
+    std::memcpy(column.values.data() + r * sizeof(TYPE), &value, sizeof(TYPE)); \
+    break;                                                                      \
+  }
+
+  for (size_t r = 0; r < rows; ++r) {
+    auto row = fb.crow(r);
+    for (auto& column : columns) {
+      if (row->isNull(column.name)) {
+        column.nulls = true;
+        continue;
+      }
+
+      column.validity[r >> 3] |= (1 << (r & 7));
+      switch (column.kind) {
+        COPY_VALUE(BOOLEAN, bool, readBool)
+        COPY_VALUE(TINYINT, int8_t, readByte)
+        COPY_VALUE(SMALLINT, int16_t, readShort)
+        COPY_VALUE(INTEGER, int32_t, readInt)
+        COPY_VALUE(BIGINT, int64_t, readLong)
+        COPY_VALUE(REAL, float, readFloat)
+        COPY_VALUE(DOUBLE, double, readDouble)
+        COPY_VALUE(INT128, int128_t, readInt128)
+      case Kind::VARCHAR: {
+        // string view points to data of the flat buffer which outlives this call
+        auto value = row->readString(column.name);
+        auto itr = column.codes.find(value);
+        if (itr == column.codes.end()) {
+          itr = column.codes.emplace(value, column.dict.size()).first;
+          column.dict.push_back(value);
+        }
+        column.indices[r] = itr->second;
+        break;
+      }
+      default:
+        throw NException("Unsupported column type in columnar format");
+      }
+    }
+
+    if (!hashKeys.empty()) {
+      hashes.push_back(HashFlat::hash(*row, hashKeys));
+    }
+  }
+
+#undef COPY_VALUE
+
+  std::vector<flatbuffers::Offset<ColumnVector>> vectors;
+  vectors.reserve(numColumns);
+  for (auto& column : columns) {
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> validity;
+    if (column.nulls) {
+      validity = builder.CreateVector(column.validity);
+    }
+
+    if (column.kind == Kind::VARCHAR) {
+      std::vector<flatbuffers::Offset<flatbuffers::String>> dict;
+      dict.reserve(column.dict.size());
+      for (auto value : column.dict) {
+        dict.push_back(builder.CreateString(value.data(), value.size()));
+      }
+
+      auto dictOffset = builder.CreateVector(dict);
+      auto indices = builder.CreateVector(column.indices);
+      vectors.push_back(CreateColumnVector(builder, validity, 0, dictOffset, indices));
+      continue;
+    }
+
+    auto values = builder.CreateVector(column.values);
+    vectors.push_back(CreateColumnVector(builder, validity, values));
+  }
+
+  auto columnsOffset = builder.CreateVector(vectors);
+  flatbuffers::Offset<flatbuffers::Vector<uint32_t>> keysOffset;
+  flatbuffers::Offset<flatbuffers::Vector<uint64_t>> hashesOffset;
+  if (!hashKeys.empty()) {
+    keysOffset = builder.CreateVector(sorted);
+    hashesOffset = builder.CreateVector(hashes);
+  }
+
+  return CreateColumnarRows(builder, rows, columnsOffset, keysOffset, hashesOffset);
+}
+
+RowCursorPtr ColumnarSerde::deserialize(const Schema& schema, const ColumnarRows* data, std::shared_ptr<void> owner) {
+  return std::make_shared<ColumnarCursor>(schema, data, std::move(owner));
+}
+
+ColumnarCursor::ColumnarCursor(const Schema& schema, const ColumnarRows* data, std::shared_ptr<void> owner)
+  : HashedRowCursor(data->rows()),
+    owner_{ std::move(owner) },
+    hashes_{ nullptr },
+    row_{ columns_, fields_, 0 } {
+  const size_t numColumns = schema->size();
+  auto vectors = data->columns();
+  N_ENSURE_EQ(vectors->size(), numColumns, "columnar batch should have every column");
+
+  columns_.reserve(numColumns);
+  fields_.reserve(numColumns);
+  for (size_t i = 0; i < numColumns; ++i) {
+    auto type = schema->childType(i);
+    auto vector = vectors->Get(i);
+    fields_[type->name()] = i;
+    columns_.push_back({ type->k(),
+                         vector->validity() ? vector->validity()->data() : nullptr,
+                         vector->values() ? vector->values()->data() : nullptr,
+                         vector->dict(),
+                         vector->indices() ? vector->indices()->data() : nullptr });
+  }
+
+  // key hashes carried along
+  if (data->keys() && data->hashes()) {
+    N_ENSURE_EQ(data->hashes()->size(), size_, "every row should have a key hash");
+    auto keys = data->keys();
+    keys_.reserve(keys->size());
+    for (uint32_t i = 0, size = keys->size(); i < size; ++i) {
+      auto index = keys->Get(i);
+      keys_.emplace_back(schema->childType(index)->name(), columns_.at(index).kind);
+    }
+    hashes_ = data->hashes();
+  }
+}
+
+bool ColumnarRow::isNull(IndexType index) const {
+  const auto validity = columns_[index].validity;
+  return validity != nullptr && ((validity[row_ >> 3] >> (row_ & 7)) & 1) == 0;
+}
+
+#define READ_VALUE(TYPE, FUNC)                                                       \
+  TYPE ColumnarRow::FUNC(IndexType index) const {                                    \
+    TYPE value;                                                                      \
+    std::memcpy(&value, columns_[index].values + row_ * sizeof(TYPE), sizeof(TYPE)); \
+    return value;                                                                    \
+  }
+
+READ_VALUE(bool, readBool)
+READ_VALUE(int8_t, readByte)
+READ_VALUE(int16_t, readShort)
+READ_VALUE(int32_t, readInt)
+READ_VALUE(int64_t, readLong)
+READ_VALUE(float, readFloat)
+READ_VALUE(double, readDouble)
+READ_VALUE(int128_t, readInt128)
+
+#undef READ_VALUE
+
+std::string_view ColumnarRow::readString(IndexType index) const {
+  if (isNull(index)) {
+    return {};
+  }
+
+  const auto& column = columns_[index];
+  auto value = column.dict->Get(column.indices[row_]);
+  return std::string_view(value->c_str(), value->size());
+}
+
+#define READ_FIELD(TYPE, FUNC)                             \
+  TYPE ColumnarRow::FUNC(const std::string& field) const { \
+    return FUNC(fields_.at(field));                        \
+  }
+
+READ_FIELD(bool, isNull)
+READ_FIELD(bool, readBool)
+READ_FIELD(int8_t, readByte)
+READ_FIELD(int16_t, readShort)
+READ_FIELD(int32_t, readInt)
+READ_FIELD(int64_t, readLong)
+READ_FIELD(float, readFloat)
+READ_FIELD(double, readDouble)
+READ_FIELD(int128_t, readInt128)
+READ_FIELD(std::string_view, readString)
+
+#undef READ_FIELD
+
+std::unique_ptr<ListData> ColumnarRow::readList(const std::string&) const {
+  throw NException("List is not supported by columnar format");
+}
+
+std::unique_ptr<MapData> ColumnarRow::readMap(const std::string&) const {
+  throw NException("Map is not supported by columnar format");
+}
+
+} // namespace base
+} // namespace service
+} // namespace nebula
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "memory/keyed/FlatBuffer.h"
+#include "memory/keyed/HashFlat.h"
+#include "node/node_generated.h"
+#include "surface/DataSurface.h"
+#include "type/Type.h"
+
+/**
+ * Columnar format of batch data transferred between node and server.
+ * Values of a column are laid out together, strings are dictionary encoded,
+ * and key hash of every row is carried along so that the receiver can merge rows without hashing.
+ */
+namespace nebula {
+namespace service {
+namespace base {
+
+class ColumnarSerde {
+public:
+  // only scalar columns are supported
+  static bool supports(const nebula::type::Schema&);
+
+  // write all rows of the flat buffer in columnar format, key hashes are computed on given key columns
+  static flatbuffers::Offset<ColumnarRows> serialize(
+    flatbuffers::FlatBufferBuilder&, const nebula::memory::keyed::FlatBuffer&, const std::vector<size_t>&);
+
+  // read columnar rows in place, the owner keeps the underlying data alive
+  static nebula::surface::RowCursorPtr deserialize(
+    const nebula::type::Schema&, const ColumnarRows*, std::shared_ptr<void>);
+};
+
+// a column vector resolved for reading
+struct ColumnSlice {
+  nebula::type::Kind kind;
+  const uint8_t* validity;
+  const int8_t* values;
+  const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>* dict;
+  const uint32_t* indices;
+};
+
+class ColumnarRow : public nebula::surface::RowData {
+public:
+  ColumnarRow(const std::vector<ColumnSlice>& columns, const std::unordered_map<std::string, size_t>& fields, size_t row)
+    : columns_{ columns }, fields_{ fields }, row_{ row } {}
+  virtual ~ColumnarRow() = default;
+
+public:
+  bool isNull(const std::string& field) const override;
+  bool readBool(const std::string& field) const override;
+  int8_t readByte(const std::string& field) const override;
+  int16_t readShort(const std::string& field) const override;
+  int32_t readInt(const std::string& field) const override;
+  int64_t readLong(const std::string& field) const override;
+  float readFloat(const std::string& field) const override;
+  double readDouble(const std::string& field) const override;
+  int128_t readInt128(const std::string& field) const override;
+  std::string_view readString(const std::string& field) const override;
+
+  // compound types are not supported by columnar format
+  std::unique_ptr<nebula::surface::ListData> readList(const std::string& field) const override;
+  std::unique_ptr<nebula::surface::MapData> readMap(const std::string& field) const override;
+
+  bool isNull(nebula::surface::IndexType) const override;
+  bool readBool(nebula::surface::IndexType) const override;
+  int8_t readByte(nebula::surface::IndexType) const override;
+  int16_t readShort(nebula::surface::IndexType) const override;
+  int32_t readInt(nebula::surface::IndexType) const override;
+  int64_t readLong(nebula::surface::IndexType) const override;
+  float readFloat(nebula::surface::IndexType) const override;
+  double readDouble(nebula::surface::IndexType) const override;
+  int128_t readInt128(nebula::surface::IndexType) const override;
+  std::string_view readString(nebula::surface::IndexType) const override;
+
+public:
+  inline ColumnarRow& seek(size_t row) {
+    row_ = row;
+    return *this;
+  }
+
+private:
+  const std::vector<ColumnSlice>& columns_;
+  const std::unordered_map<std::string, size_t>& fields_;
+  size_t row_;
+};
+
+class ColumnarCursor : public nebula::memory::keyed::HashedRowCursor {
+public:
+  ColumnarCursor(const nebula::type::Schema&, const ColumnarRows*, std::shared_ptr<void>);
+  virtual ~ColumnarCursor() = default;
+
+  virtual const nebula::surface::RowData& next() override {
+    return row_.seek(index_++);
+  }
+
+  virtual std::unique_ptr<nebula::surface::RowData> item(size_t index) const override {
+    return std::make_unique<ColumnarRow>(columns_, fields_, index);
+  }
+
+  virtual const std::vector<std::pair<std::string, nebula::type::Kind>>& hashKeys() const override {
+    return keys_;
+  }
+
+  virtual size_t hash() const override {
+    return hashes_->Get(index_ - 1);
+  }
+
+private:
+  std::shared_ptr<void> owner_;
+  std::vector<ColumnSlice> columns_;
+  std::unordered_map<std::string, size_t> fields_;
+  std::vector<std::pair<std::string, nebula::type::Kind>> keys_;
+  const flatbuffers::Vector<uint64_t>* hashes_;
+  ColumnarRow row_;
+};
+
+} // namespace base
+} // namespace service
+} // namespace nebula
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "Compression.h"
+
+#include <gflags/gflags.h>
+#include <cstring>
+#include <lz4.h>
+#include <zstd.h>
+
+#include "common/Errors.h"
+
+DEFINE_uint64(COMPRESS_MIN_BYTES, 65536, "batch data smaller than this size is sent without compression");
+DEFINE_uint64(ZSTD_MIN_BYTES, 4194304, "batch data not smaller than this size uses zstd if accepted, otherwise lz4");
+DEFINE_int32(ZSTD_LEVEL, 1, "zstd compression level used for batch data");
+
+/**
+ * Block compression of batch data transferred between node and server.
+ */
+namespace nebula {
+namespace service {
+namespace base {
+
+using nebula::service::Compression;
+
+Compression Codec::from(const std::string& name) {
+  if (name == "lz4") {
+    return Compression::Compression_Lz4;
+  }
+
+  if (name == "zstd") {
+    return Compression::Compression_Zstd;
+  }
+
+  N_ENSURE(name.empty() || name == "none", "unknown compression codec");
+  return Compression::Compression_None;
+}
+
+Compression Codec::choose(size_t size, Compression max) {
+  if (max == Compression::Compression_None || size < FLAGS_COMPRESS_MIN_BYTES) {
+    return Compression::Compression_None;
+  }
+
+  if (max == Compression::Compression_Zstd && size >= FLAGS_ZSTD_MIN_BYTES) {
+    return Compression::Compression_Zstd;
+  }
+
+  // lz4 works on int sizes only
+  if (size > LZ4_MAX_INPUT_SIZE) {
+    return max == Compression::Compression_Zstd ? Compression::Compression_Zstd : Compression::Compression_None;
+  }
+
+  return Compression::Compression_Lz4;
+}
+
+size_t Codec::bound(Compression codec, size_t size) {
+  switch (codec) {
+  case Compression::Compression_Lz4: return LZ4_compressBound(size);
+  case Compression::Compression_Zstd: return ZSTD_compressBound(size);
+  default: return size;
+  }
+}
+
+size_t Codec::compress(Compression codec, const void* src, size_t size, void* dest, size_t capacity) {
+  switch (codec) {
+  case Compression::Compression_Lz4: {
+    auto bytes = LZ4_compress_default(
+      static_cast<const char*>(src), static_cast<char*>(dest), size, capacity);
+    N_ENSURE_GT(bytes, 0, "lz4 compression failed");
+    return bytes;
+  }
+  case Compression::Compression_Zstd: {
+    auto bytes = ZSTD_compress(dest, capacity, src, size, FLAGS_ZSTD_LEVEL);
+    N_ENSURE(!ZSTD_isError(bytes), ZSTD_getErrorName(bytes));
+    return bytes;
+  }
+  default:
+    N_ENSURE_GE(capacity, size, "not enough capacity to copy");
+    std::memcpy(dest, src, size);
+    return size;
+  }
+}
+
+void Codec::decompress(Compression codec, const void* src, size_t size, void* dest, size_t raw) {
+  switch (codec) {
+  case Compression::Compression_Lz4: {
+    auto bytes = LZ4_decompress_safe(
+      static_cast<const char*>(src), static_cast<char*>(dest), size, raw);
+    N_ENSURE_EQ((size_t)bytes, raw, "lz4 decompression failed");
+    return;
+  }
+  case Compression::Compression_Zstd: {
+    auto bytes = ZSTD_decompress(dest, raw, src, size);
+    N_ENSURE(!ZSTD_isError(bytes), ZSTD_getErrorName(bytes));
+    N_ENSURE_EQ(bytes, raw, "zstd decompression size mismatch");
+    return;
+  }
+  default:
+    N_ENSURE_EQ(size, raw, "raw data size mismatch");
+    std::memcpy(dest, src, size);
+  }
+}
+
+} // namespace base
+} // namespace service
+} // namespace nebula
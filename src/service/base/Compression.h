@@ -0,0 +1,51 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <string>
+#include "node/node_generated.h"
+
+/**
+ * Block compression of batch data transferred between node and server.
+ */
+namespace nebula {
+namespace service {
+namespace base {
+
+class Codec {
+public:
+  // parse codec name: none, lz4 or zstd
+  static nebula::service::Compression from(const std::string&);
+
+  // choose a codec by payload size, no stronger than the given one which requester accepts.
+  // small payload is not compressed, large payload uses zstd for better ratio.
+  static nebula::service::Compression choose(size_t, nebula::service::Compression);
+
+  // max size of compressed data for raw data of given size
+  static size_t bound(nebula::service::Compression, size_t);
+
+  // compress source bytes into dest buffer of given capacity, return compressed size
+  static size_t compress(nebula::service::Compression, const void*, size_t, void*, size_t);
+
+  // decompress source bytes into dest buffer which is exactly sized as raw data
+  static void decompress(nebula::service::Compression, const void*, size_t, void*, size_t);
+};
+
+} // namespace base
+} // namespace service
+} // namespace nebula
@@ -16,9 +16,15 @@
 
 #include "NebulaService.h"
 
+#include <cstdint>
+#include <folly/Conv.h>
+#include <gflags/gflags.h>
+#include <limits>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 
+#include "Columnar.h"
+#include "Compression.h"
 #include "api/dsl/Serde.h"
 #include "common/Evidence.h"
 #include "common/Int128.h"
@@ -30,6 +36,9 @@
 #include "meta/TestTable.h"
 #include "type/Serde.h"
 
+DEFINE_string(RESULT_COMPRESSION, "zstd", "strongest codec accepted for query results sent by nodes: none, lz4 or zstd");
+DEFINE_bool(COLUMNAR_RESULT, true, "accept query results sent by nodes in columnar format");
+
 /**
  * provide common data operations for service
  */
@@ -37,7 +46,12 @@ namespace nebula {
 namespace service {
 namespace base {
 
+using nebula::api::dsl::ArthmeticOp;
+using nebula::api::dsl::ConstExpression;
 using nebula::api::dsl::Expression;
+using nebula::api::dsl::ExpressionData;
+using nebula::api::dsl::ExpressionType;
+using nebula::api::dsl::LogicalOp;
 using nebula::api::dsl::Query;
 using nebula::api::dsl::QueryContext;
 using nebula::api::dsl::Serde;
@@ -47,7 +61,10 @@ using nebula::common::SingleCommandTask;
 using nebula::common::Task;
 using nebula::common::TaskState;
 using nebula::common::TaskType;
+using nebula::execution::EstimateMap;
+using nebula::execution::Estimates;
 using nebula::execution::QueryWindow;
+using nebula::execution::Transfer;
 using nebula::ingest::BlockExpire;
 using nebula::ingest::IngestSpec;
 using nebula::ingest::SpecState;
@@ -57,12 +74,14 @@ using nebula::meta::AccessSpec;
 using nebula::meta::Column;
 using nebula::meta::ColumnProps;
 using nebula::meta::DataSource;
+using nebula::meta::Table;
 using nebula::meta::TableSpec;
 using nebula::meta::TimeSpec;
 using nebula::meta::TimeType;
 using nebula::surface::EmptyRowCursor;
 using nebula::surface::RowCursorPtr;
 using nebula::surface::RowData;
+using nebula::surface::eval::UDFType;
 using nebula::type::Kind;
 using nebula::type::Schema;
 
@@ -174,15 +193,194 @@ const std::string ServiceProperties::jsonify(const RowCursorPtr data, const Sche
   return buffer.GetString();
 }
 
+// write an expression tree in binary form, children are built ahead of their parent
+static flatbuffers::Offset<Expr> toExpr(flatbuffers::FlatBufferBuilder& fbb, const ExpressionData& data) {
+  auto str = [&fbb](const std::string& s) {
+    return s.empty() ? flatbuffers::Offset<flatbuffers::String>() : fbb.CreateString(s);
+  };
+
+  flatbuffers::Offset<Expr> left, right, inner;
+  int8_t op = 0;
+  int8_t udf = 0;
+  switch (data.type) {
+  case ExpressionType::LOGICAL: {
+    op = static_cast<int8_t>(data.b_lop);
+    left = toExpr(fbb, *data.b_left);
+    right = toExpr(fbb, *data.b_right);
+    break;
+  }
+  case ExpressionType::ARTHMETIC: {
+    op = static_cast<int8_t>(data.b_aop);
+    left = toExpr(fbb, *data.b_left);
+    right = toExpr(fbb, *data.b_right);
+    break;
+  }
+  case ExpressionType::UDF: {
+    udf = static_cast<int8_t>(data.u_type);
+    inner = toExpr(fbb, *data.inner);
+    break;
+  }
+  default:
+    break;
+  }
+
+  const bool flag = data.type == ExpressionType::UDF && data.flag;
+  return CreateExpr(fbb, static_cast<int8_t>(data.type), str(data.alias), str(data.c_type), str(data.c_value),
+                    str(data.c_name), op, left, right, udf, inner, str(data.custom), flag);
+}
+
+// narrow the range by a comparison of time column to a constant, false if it is not such a comparison
+static bool timeRange(const Expr* expr, QueryWindow& range) {
+  if (expr->type() != ExpressionType::LOGICAL || expr->left() == nullptr || expr->right() == nullptr) {
+    return false;
+  }
+
+  auto column = expr->left();
+  auto constant = expr->right();
+  if (column->type() != ExpressionType::COLUMN || constant->type() != ExpressionType::CONSTANT
+      || flatbuffers::GetString(column->c_name()) != Table::TIME_COLUMN) {
+    return false;
+  }
+
+  auto value = folly::tryTo<int64_t>(flatbuffers::GetString(constant->c_value()));
+  if (!value.hasValue()) {
+    return false;
+  }
+
+  // narrow in signed values since time is never negative
+  const auto c = value.value();
+  int64_t lower = range.first;
+  int64_t upper = std::min<size_t>(range.second, std::numeric_limits<int64_t>::max());
+  switch (static_cast<LogicalOp>(expr->op())) {
+  case LogicalOp::GT: {
+    if (c == std::numeric_limits<int64_t>::max()) {
+      return false;
+    }
+    lower = std::max(lower, c + 1);
+    break;
+  }
+  case LogicalOp::GE: {
+    lower = std::max(lower, c);
+    break;
+  }
+  case LogicalOp::LT: {
+    if (c == std::numeric_limits<int64_t>::min()) {
+      return false;
+    }
+    upper = std::min(upper, c - 1);
+    break;
+  }
+  case LogicalOp::LE: {
+    upper = std::min(upper, c);
+    break;
+  }
+  default:
+    return false;
+  }
+
+  // an empty range has first greater than second
+  range = upper < lower ? QueryWindow{ 1, 0 } : QueryWindow(lower, upper);
+  return true;
+}
+
+// conjuncts of a filter are the filter itself or operands of its AND chain
+static inline bool conjunction(const Expr* expr) {
+  return expr->type() == ExpressionType::LOGICAL && static_cast<LogicalOp>(expr->op()) == LogicalOp::AND;
+}
+
+static bool constantTrue(const ExpressionData& data) {
+  static const auto t = ConstExpression<bool>(true).serialize();
+  return data.type == ExpressionType::CONSTANT && data.c_type == t->c_type && data.c_value == t->c_value;
+}
+
+// read an expression tree from its binary form.
+// if a range is given, time comparisons in conjuncts are left out and narrow the range instead.
+static std::unique_ptr<ExpressionData> fromExpr(const Expr* expr, QueryWindow* range = nullptr) {
+  if (range && timeRange(expr, *range)) {
+    return ConstExpression<bool>(true).serialize();
+  }
+
+  range = range && conjunction(expr) ? range : nullptr;
+  auto data = std::make_unique<ExpressionData>();
+  data->type = static_cast<ExpressionType>(expr->type());
+  data->alias = flatbuffers::GetString(expr->alias());
+  data->c_type = flatbuffers::GetString(expr->c_type());
+  data->c_value = flatbuffers::GetString(expr->c_value());
+  data->c_name = flatbuffers::GetString(expr->c_name());
+  data->b_lop = static_cast<LogicalOp>(expr->op());
+  data->b_aop = static_cast<ArthmeticOp>(expr->op());
+  data->u_type = static_cast<UDFType>(expr->udf());
+  data->custom = flatbuffers::GetString(expr->custom());
+  data->flag = expr->flag();
+  if (expr->left()) {
+    data->b_left = fromExpr(expr->left(), range);
+  }
+  if (expr->right()) {
+    data->b_right = fromExpr(expr->right(), range);
+  }
+  if (expr->inner()) {
+    data->inner = fromExpr(expr->inner());
+  }
+
+  // a conjunct left out is a constant true
+  if (range && constantTrue(*data->b_left)) {
+    return std::move(data->b_right);
+  }
+
+  if (range && constantTrue(*data->b_right)) {
+    return std::move(data->b_left);
+  }
+
+  return data;
+}
+
+// append every field of an expression tree to the shape, time comparisons in conjuncts are left out if range is given
+static void exprShape(std::string& key, const Expr* expr, QueryWindow* range) {
+  auto str = [&key](const flatbuffers::String* s) {
+    const uint32_t size = s == nullptr ? 0 : s->size();
+    key.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    if (size > 0) {
+      key.append(s->data(), size);
+    }
+  };
+
+  if (expr == nullptr) {
+    key.push_back(-1);
+    return;
+  }
+
+  // the comparison holds for every row in the range, so it is seen as a constant true
+  if (range && timeRange(expr, *range)) {
+    key.push_back(-2);
+    return;
+  }
+
+  range = range && conjunction(expr) ? range : nullptr;
+
+  key.push_back(expr->type());
+  str(expr->alias());
+  str(expr->c_type());
+  str(expr->c_value());
+  str(expr->c_name());
+  key.push_back(expr->op());
+  key.push_back(expr->udf());
+  str(expr->custom());
+  key.push_back(expr->flag());
+  exprShape(key, expr->left(), range);
+  exprShape(key, expr->right(), range);
+  exprShape(key, expr->inner(), nullptr);
+}
+
 // serialize a query and meta data
-flatbuffers::grpc::Message<QueryPlan> QuerySerde::serialize(const Query& q, const std::string& id, const QueryWindow& window) {
+flatbuffers::grpc::Message<QueryPlan> QuerySerde::serialize(
+  const Query& q, const std::string& id, const QueryWindow& window, const std::vector<std::string>& specs) {
   flatbuffers::grpc::MessageBuilder mb;
   auto tbl = q.table_->name();
-  auto filter = Serde::serialize(*q.filter_);
-  std::vector<flatbuffers::Offset<flatbuffers::String>> fields;
+  auto filter = toExpr(mb, *q.filter_->serialize());
+  std::vector<flatbuffers::Offset<Expr>> fields;
   fields.reserve(q.selects_.size());
   for (auto& f : q.selects_) {
-    fields.push_back(mb.CreateString(Serde::serialize(*f)));
+    fields.push_back(toExpr(mb, *f->serialize()));
   }
 
   std::vector<uint32_t> groups;
@@ -197,16 +395,26 @@ flatbuffers::grpc::Message<QueryPlan> QuerySerde::serialize(const Query& q, cons
     sorts.push_back(i);
   }
 
+  // scope is left absent when the query covers all blocks of the node
+  std::vector<flatbuffers::Offset<flatbuffers::String>> scope;
+  scope.reserve(specs.size());
+  for (auto& spec : specs) {
+    scope.push_back(mb.CreateString(spec));
+  }
+
   auto request_offset = CreateQueryPlanDirect(
-    mb, id.c_str(), tbl.c_str(), filter.c_str(), &fields, &groups, &sorts,
-    q.sortType_ == SortType::DESC, q.limit_, window.first, window.second);
+    mb, id.c_str(), tbl.c_str(), &groups, &sorts,
+    q.sortType_ == SortType::DESC, q.limit_, window.first, window.second, static_cast<int8_t>(q.sampleMode_),
+    q.fraction_, Codec::from(FLAGS_RESULT_COMPRESSION), FLAGS_COLUMNAR_RESULT, filter, &fields,
+    scope.empty() ? nullptr : &scope);
   mb.Finish(request_offset);
   return mb.ReleaseMessage<QueryPlan>();
 }
 
 nebula::api::dsl::Query QuerySerde::deserialize(
   const std::shared_ptr<nebula::meta::MetaService> ms,
-  const flatbuffers::grpc::Message<QueryPlan>* query) {
+  const flatbuffers::grpc::Message<QueryPlan>* query,
+  QueryWindow* range) {
   auto plan = query->GetRoot();
 
   const auto table = flatbuffers::GetString(plan->tbl());
@@ -214,17 +422,17 @@ nebula::api::dsl::Query QuerySerde::deserialize(
 
   // set filter
   {
-    q.filter_ = Serde::deserialize(plan->filter()->c_str());
+    q.filter_ = Serde::deserialize(*fromExpr(plan->predicate(), range));
   }
 
   // set fields
   {
-    auto fs = plan->fields();
+    auto fs = plan->selects();
     auto size = fs->size();
     std::vector<std::shared_ptr<Expression>> fields;
     fields.reserve(size);
     for (uint32_t i = 0; i < size; ++i) {
-      fields.push_back(Serde::deserialize(fs->Get(i)->c_str()));
+      fields.push_back(Serde::deserialize(*fromExpr(fs->Get(i))));
     }
     q.selects_ = std::move(fields);
   }
@@ -259,14 +467,77 @@ nebula::api::dsl::Query QuerySerde::deserialize(
   // set limit
   q.limit_ = plan->limit();
 
+  // sampling mode
+  q.sampleMode_ = static_cast<nebula::execution::SampleMode>(plan->sample());
+
+  // fraction of blocks for approximate query
+  q.fraction_ = plan->fraction();
+
   // return this deserialized query
   return q;
 }
 
+std::string QuerySerde::filter(const QueryPlan* plan, QueryWindow* range) {
+  std::string key = flatbuffers::GetString(plan->tbl());
+  key.push_back(0);
+  exprShape(key, plan->predicate(), range);
+  return key;
+}
+
+std::string QuerySerde::shape(const QueryPlan* plan, QueryWindow* range) {
+  std::string key = filter(plan, range);
+
+  auto fs = plan->selects();
+  const uint32_t numFields = fs->size();
+  key.append(reinterpret_cast<const char*>(&numFields), sizeof(numFields));
+  for (uint32_t i = 0; i < numFields; ++i) {
+    exprShape(key, fs->Get(i), nullptr);
+  }
+
+  auto append = [&key](const auto& value) {
+    key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  };
+
+  for (auto list : { plan->groups(), plan->sorts() }) {
+    const uint32_t size = list == nullptr ? 0 : list->size();
+    append(size);
+    for (uint32_t i = 0; i < size; ++i) {
+      append(list->Get(i));
+    }
+  }
+
+  append(plan->desc());
+  append(plan->limit());
+  append(plan->sample());
+  append(plan->fraction());
+  return key;
+}
+
+QueryWindow QuerySerde::window(const QueryPlan* plan, const QueryWindow& range) {
+  const size_t start = std::max<size_t>(plan->tstart(), range.first);
+  const size_t end = std::min<size_t>(plan->tend(), range.second);
+  return start > end ? QueryWindow{ 1, 0 } : QueryWindow{ start, end };
+}
+
+std::unordered_set<std::string> QuerySerde::specs(const QueryPlan* plan) {
+  std::unordered_set<std::string> specs;
+  auto scope = plan->specs();
+  if (scope) {
+    for (auto s : *scope) {
+      specs.emplace(s->str());
+    }
+  }
+
+  return specs;
+}
+
 std::unique_ptr<nebula::execution::ExecutionPlan> QuerySerde::from(
   const std::shared_ptr<nebula::meta::MetaService> ms,
   const flatbuffers::grpc::Message<QueryPlan>* msg) {
-  auto query = QuerySerde::deserialize(ms, msg);
+  // time comparisons of the filter are bound at run time through the window of the plan,
+  // so the compiled plan is the same for all windows
+  QueryWindow range{ 0, std::numeric_limits<int64_t>::max() };
+  auto query = QuerySerde::deserialize(ms, msg, &range);
 
   // TODO(cao): serialize query context to nodes and mark compile method as const
   QueryContext ctx{ "nebula", { "nebula-users" } };
@@ -274,31 +545,138 @@ std::unique_ptr<nebula::execution::ExecutionPlan> QuerySerde::from(
 
   // set a few other properties associated with execution plan
   auto p = msg->GetRoot();
-  plan->setWindow({ p->tstart(), p->tend() });
+  plan->setWindow(window(p, range));
+  plan->setSpecs(specs(p));
+
+  // blocks within the window may share results and selected rows across windows
+  if (range.first <= range.second) {
+    auto full = range;
+    plan->setCacheKey(shape(p, &full), filter(p, &full));
+  }
 
   // return this compiled plan
   return plan;
 }
 
-flatbuffers::grpc::Message<BatchRows> BatchSerde::serialize(const FlatBuffer& fb) {
+flatbuffers::grpc::Message<BatchRows> BatchSerde::serialize(
+  const FlatBuffer& fb, const EstimateMap& estimates, Compression max) {
+  flatbuffers::grpc::MessageBuilder mb;
+  auto schema = mb.CreateString(nebula::type::TypeSerializer::to(fb.schema()));
+  const auto raw = fb.binSize();
+  auto codec = Codec::choose(raw, max);
+  flatbuffers::Offset<flatbuffers::Vector<int8_t>> bytes;
+  // align data so that it can be read in place from an aligned message
+  if (codec == Compression::Compression_None) {
+    int8_t* buffer;
+    mb.ForceVectorAlignment(raw, sizeof(int8_t), alignof(size_t));
+    bytes = mb.CreateUninitializedVector<int8_t>(raw, &buffer);
+    fb.serialize(buffer);
+  } else {
+    // compress serialized data and send it raw if it doesn't get smaller
+    auto buffer = std::make_unique<NByte[]>(raw);
+    fb.serialize(buffer.get());
+    auto capacity = Codec::bound(codec, raw);
+    auto packed = std::make_unique<NByte[]>(capacity);
+    auto size = Codec::compress(codec, buffer.get(), raw, packed.get(), capacity);
+    if (size < raw) {
+      bytes = mb.CreateVector(packed.get(), size);
+    } else {
+      codec = Compression::Compression_None;
+      mb.ForceVectorAlignment(raw, sizeof(int8_t), alignof(size_t));
+      bytes = mb.CreateVector(buffer.get(), raw);
+    }
+  }
+
+  // estimates of approximate query
+  std::vector<flatbuffers::Offset<nebula::service::Estimate>> es;
+  es.reserve(estimates.size());
+  for (const auto& e : estimates) {
+    es.push_back(CreateEstimate(mb, mb.CreateString(e.first), e.second.total, e.second.variance));
+  }
+
+  auto batch = CreateBatchRows(mb, schema, BatchType::BatchType_Flat, bytes, mb.CreateVector(es), codec, raw);
+  mb.Finish(batch);
+  return mb.ReleaseMessage<BatchRows>();
+}
+
+flatbuffers::grpc::Message<BatchRows> BatchSerde::columnar(
+  const FlatBuffer& fb, const std::vector<size_t>& keys, const EstimateMap& estimates, Compression max) {
+  if (!ColumnarSerde::supports(fb.schema())) {
+    return serialize(fb, estimates, max);
+  }
+
+  // compressed columnar rows are a nested buffer in data, it is sent uncompressed if it doesn't get smaller
+  std::unique_ptr<NByte[]> packed;
+  size_t raw = 0;
+  size_t size = 0;
+  flatbuffers::FlatBufferBuilder cb;
+  cb.Finish(ColumnarSerde::serialize(cb, fb, keys));
+  auto codec = Codec::choose(cb.GetSize(), max);
+  if (codec != Compression::Compression_None) {
+    raw = cb.GetSize();
+    auto capacity = Codec::bound(codec, raw);
+    packed = std::make_unique<NByte[]>(capacity);
+    size = Codec::compress(codec, cb.GetBufferPointer(), raw, packed.get(), capacity);
+    if (size >= raw) {
+      codec = Compression::Compression_None;
+    }
+  }
+
   flatbuffers::grpc::MessageBuilder mb;
   auto schema = mb.CreateString(nebula::type::TypeSerializer::to(fb.schema()));
-  int8_t* buffer;
-  auto bytes = mb.CreateUninitializedVector<int8_t>(fb.binSize(), &buffer);
-  fb.serialize(buffer);
+  flatbuffers::Offset<flatbuffers::Vector<int8_t>> bytes;
+  flatbuffers::Offset<ColumnarRows> data;
+  if (codec == Compression::Compression_None) {
+    // raw size is size of the columnar rows in the message, so that transfer stats count the same bytes as flat data
+    const auto before = mb.GetSize();
+    data = ColumnarSerde::serialize(mb, fb, keys);
+    raw = mb.GetSize() - before;
+  } else {
+    bytes = mb.CreateVector(packed.get(), size);
+  }
+
+  std::vector<flatbuffers::Offset<nebula::service::Estimate>> es;
+  es.reserve(estimates.size());
+  for (const auto& e : estimates) {
+    es.push_back(CreateEstimate(mb, mb.CreateString(e.first), e.second.total, e.second.variance));
+  }
 
-  auto batch = CreateBatchRows(mb, schema, BatchType::BatchType_Flat, bytes);
+  auto batch = CreateBatchRows(mb, schema, BatchType::BatchType_Columnar, bytes, mb.CreateVector(es), codec, raw, data);
   mb.Finish(batch);
   return mb.ReleaseMessage<BatchRows>();
 }
 
+// compressed columnar rows are decompressed into a buffer owned by the cursor reading them
+static RowCursorPtr inflate(const BatchRows* ptr) {
+  const auto schema = nebula::type::TypeSerializer::from(flatbuffers::GetString(ptr->schema()));
+  auto data = ptr->data();
+  auto buffer = std::make_shared<std::vector<NByte>>(ptr->raw());
+  Codec::decompress(ptr->codec(), data->data(), data->size(), buffer->data(), buffer->size());
+  return ColumnarSerde::deserialize(schema, flatbuffers::GetRoot<ColumnarRows>(buffer->data()), buffer);
+}
+
 RowCursorPtr BatchSerde::deserialize(const flatbuffers::grpc::Message<BatchRows>* batch) {
   auto ptr = batch->GetRoot();
 
   const auto schema = nebula::type::TypeSerializer::from(flatbuffers::GetString(ptr->schema()));
-  N_ENSURE(ptr->type() == BatchType::BatchType_Flat, "only support flat for now");
 
-  // TODO(cao) - can we avoid this allocation?
+  // decompressed columnar rows are owned by their cursor
+  if (ptr->type() == BatchType::BatchType_Columnar && ptr->codec() != Compression::Compression_None) {
+    return inflate(ptr);
+  }
+
+  // columnar rows are copied into a flat buffer since the message is not owned here
+  if (ptr->type() == BatchType::BatchType_Columnar) {
+    auto fb = std::make_unique<FlatBuffer>(schema);
+    auto cursor = ColumnarSerde::deserialize(schema, ptr->columnar(), nullptr);
+    while (cursor->hasNext()) {
+      fb->add(cursor->next());
+    }
+
+    return std::make_shared<FlatRowCursor>(std::move(fb));
+  }
+
+  N_ENSURE(ptr->type() == BatchType::BatchType_Flat, "only support flat and columnar for now");
   auto data = ptr->data();
   auto size = data->size();
   // short circuit of zero size data
@@ -307,14 +685,78 @@ RowCursorPtr BatchSerde::deserialize(const flatbuffers::grpc::Message<BatchRows>
     return EmptyRowCursor::instance();
   }
 
-  auto bytes = static_cast<NByte*>(Pool::getDefault().allocate(size));
-  std::memcpy(bytes, data->data(), size);
+  // data is copied out since the message is not owned here, see the shared message version for zero copy.
+  // compressed data is decompressed into the buffer directly
+  const auto codec = ptr->codec();
+  const size_t raw = codec == Compression::Compression_None ? size : ptr->raw();
+  auto bytes = static_cast<NByte*>(Pool::getDefault().allocate(raw));
+  Codec::decompress(codec, data->data(), size, bytes, raw);
 
-  // TODO(cao) - It is not good, we're reference some data from batch but actually not owning it.
+  // flat buffer takes ownership of the pool allocated bytes
   auto fb = std::make_unique<FlatBuffer>(schema, bytes);
   return std::make_shared<FlatRowCursor>(std::move(fb));
 }
 
+// flatbuffers aligns data relative to the end of the message, which is only aligned in memory
+// when the message is, a message received in a slice may be at any address
+static inline bool aligned(const void* p) {
+  return reinterpret_cast<std::uintptr_t>(p) % alignof(size_t) == 0;
+}
+
+RowCursorPtr BatchSerde::deserialize(std::shared_ptr<flatbuffers::grpc::Message<BatchRows>> batch) {
+  auto ptr = batch->GetRoot();
+  if (ptr->type() == BatchType::BatchType_Columnar && ptr->codec() != Compression::Compression_None) {
+    return inflate(ptr);
+  }
+
+  // misaligned columns are copied out instead of read in place
+  if (ptr->type() == BatchType::BatchType_Columnar && !aligned(batch->data())) {
+    return deserialize(batch.get());
+  }
+
+  if (ptr->type() == BatchType::BatchType_Columnar) {
+    const auto schema = nebula::type::TypeSerializer::from(flatbuffers::GetString(ptr->schema()));
+    return ColumnarSerde::deserialize(schema, ptr->columnar(), batch);
+  }
+
+  // misaligned data is copied out instead of read in place
+  auto data = ptr->data();
+  if (ptr->codec() != Compression::Compression_None || data->size() == 0 || !aligned(data->data())) {
+    return deserialize(batch.get());
+  }
+
+  N_ENSURE(ptr->type() == BatchType::BatchType_Flat, "only support flat and columnar for now");
+  const auto schema = nebula::type::TypeSerializer::from(flatbuffers::GetString(ptr->schema()));
+
+  // flat buffer reads the data in place and shares ownership of the message holding it
+  auto fb = std::make_unique<FlatBuffer>(schema, data->data(), batch);
+  return std::make_shared<FlatRowCursor>(std::move(fb));
+}
+
+void BatchSerde::estimates(const flatbuffers::grpc::Message<BatchRows>* batch, Estimates& estimates) {
+  auto es = batch->GetRoot()->estimates();
+  if (es == nullptr) {
+    return;
+  }
+
+  for (uint32_t i = 0, size = es->size(); i < size; ++i) {
+    auto e = es->Get(i);
+    estimates.add(e->column()->str(), { e->total(), e->variance() });
+  }
+}
+
+void BatchSerde::transfer(const flatbuffers::grpc::Message<BatchRows>* batch, Transfer& stats) {
+  // uncompressed columnar rows are not in data but their size is given by raw
+  auto ptr = batch->GetRoot();
+  if (ptr->type() == BatchType::BatchType_Columnar && ptr->codec() == Compression::Compression_None) {
+    stats.add(ptr->raw(), ptr->raw());
+    return;
+  }
+
+  const size_t wire = ptr->data()->size();
+  stats.add(ptr->codec() == Compression::Compression_None ? wire : ptr->raw(), wire);
+}
+
 // serialize a ingest spec into a task spec to be sent over
 flatbuffers::grpc::Message<TaskSpec> TaskSerde::serialize(const Task& task) {
   flatbuffers::grpc::MessageBuilder mb;
@@ -123,9 +123,28 @@ public:
  */
 class QuerySerde {
 public:
-  static flatbuffers::grpc::Message<QueryPlan> serialize(const nebula::api::dsl::Query&, const std::string&, const nebula::execution::QueryWindow&);
-  static nebula::api::dsl::Query deserialize(const std::shared_ptr<nebula::meta::MetaService>, const flatbuffers::grpc::Message<QueryPlan>*);
+  // a node query can be scoped to blocks of given specs, empty for all blocks on the node
+  static flatbuffers::grpc::Message<QueryPlan> serialize(const nebula::api::dsl::Query&, const std::string&, const nebula::execution::QueryWindow&,
+                                                         const std::vector<std::string>& = {});
+  // if a range is given, time comparisons in conjuncts of the filter are left out and narrow the range instead
+  static nebula::api::dsl::Query deserialize(const std::shared_ptr<nebula::meta::MetaService>, const flatbuffers::grpc::Message<QueryPlan>*,
+                                             nebula::execution::QueryWindow* = nullptr);
   static std::unique_ptr<nebula::execution::ExecutionPlan> from(const std::shared_ptr<nebula::meta::MetaService>, const flatbuffers::grpc::Message<QueryPlan>*);
+
+  // normalized form of a query plan without its id, time window and result transfer options.
+  // plans of the same shape compile into the same execution phases.
+  // if a range is given, comparisons of time column to constants are left out of the shape
+  // and the range is narrowed to time values satisfying all of them.
+  static std::string shape(const QueryPlan*, nebula::execution::QueryWindow* = nullptr);
+
+  // normalized form of the table and predicate of a query plan, it is the leading part of its shape.
+  static std::string filter(const QueryPlan*, nebula::execution::QueryWindow* = nullptr);
+
+  // time window of a query plan narrowed by the range of time comparisons left out of its filter
+  static nebula::execution::QueryWindow window(const QueryPlan*, const nebula::execution::QueryWindow&);
+
+  // specs a query plan is scoped to, empty for all blocks
+  static std::unordered_set<std::string> specs(const QueryPlan*);
 };
 
 /**
@@ -133,8 +152,30 @@ public:
  */
 class BatchSerde {
 public:
-  static flatbuffers::grpc::Message<BatchRows> serialize(const nebula::memory::keyed::FlatBuffer&);
+  // data is compressed by a codec chosen by its size, no stronger than the given one
+  static flatbuffers::grpc::Message<BatchRows> serialize(
+    const nebula::memory::keyed::FlatBuffer&,
+    const nebula::execution::EstimateMap& = {},
+    nebula::service::Compression = nebula::service::Compression::Compression_None);
+
+  // write data in columnar format carrying key hashes of given key columns, compressed the same way as serialize.
+  // it falls back to flat format if the schema is not supported by columnar format
+  static flatbuffers::grpc::Message<BatchRows> columnar(
+    const nebula::memory::keyed::FlatBuffer&,
+    const std::vector<size_t>&,
+    const nebula::execution::EstimateMap& = {},
+    nebula::service::Compression = nebula::service::Compression::Compression_None);
+
   static nebula::surface::RowCursorPtr deserialize(const flatbuffers::grpc::Message<BatchRows>*);
+
+  // read batch data in place without copy unless it is misaligned in memory, the message is kept alive by the returned cursor
+  static nebula::surface::RowCursorPtr deserialize(std::shared_ptr<flatbuffers::grpc::Message<BatchRows>>);
+
+  // collect estimates of approximate query carried by the batch
+  static void estimates(const flatbuffers::grpc::Message<BatchRows>*, nebula::execution::Estimates&);
+
+  // record data size of the batch before and after compression
+  static void transfer(const flatbuffers::grpc::Message<BatchRows>*, nebula::execution::Transfer&);
 };
 
 /**
@@ -24,11 +24,13 @@ namespace nebula {
 namespace service {
 namespace node {
 
+using nebula::common::Subscription;
 using nebula::common::Task;
 using nebula::common::TaskState;
 using nebula::execution::BlockManager;
 using nebula::execution::BlockSet;
 using nebula::execution::ExecutionPlan;
+using nebula::execution::core::Sink;
 using nebula::execution::io::BatchBlock;
 using nebula::meta::BlockSignature;
 using nebula::service::base::BatchSerde;
@@ -89,26 +91,41 @@ folly::Future<RowCursorPtr> NodeClient::execute(const ExecutionPlan& plan) {
 
   // pass values since we reutrn the whole lambda - don't reference temporary things
   // such as local stack allocated variables, including "this" the client itself.
-  pool_.add([p, addr, q = query_, id = plan.id(), w = plan.getWindow()]() {
-    // a response message placeholder
-    flatbuffers::grpc::Message<BatchRows> qr;
-
-    auto qp = QuerySerde::serialize(*q, id, w);
-    grpc::ClientContext context;
-    auto channel = ConnectionPool::init()->connection(addr);
-    N_ENSURE(channel != nullptr, "requires a valid channel");
-    auto stub = nebula::service::NodeServer::NewStub(channel);
-    auto status = stub->Query(&context, qp, &qr);
-    if (status.ok()) {
-      auto fb = BatchSerde::deserialize(&qr);
-      VLOG(1) << "Received batch as number of rows: " << fb->size();
-
-      // update into current server block management
-      p->setValue(fb);
-      return;
+  pool_.add([p, addr, q = query_, id = plan.id(), w = plan.getWindow(), e = plan.estimates(), t = plan.transfer(),
+             c = plan.cancellation()]() {
+    // the promise is always fulfilled, a failure in this thread makes an empty result
+    try {
+      // a response message placeholder
+      flatbuffers::grpc::Message<BatchRows> qr;
+
+      auto qp = QuerySerde::serialize(*q, id, w);
+      grpc::ClientContext context;
+      auto channel = ConnectionPool::init()->connection(addr);
+      N_ENSURE(channel != nullptr, "requires a valid channel");
+      auto stub = nebula::service::NodeServer::NewStub(channel);
+      auto status = [&]() {
+        Subscription subscription(*c, [&context]() { context.TryCancel(); });
+        return stub->Query(&context, qp, &qr);
+      }();
+
+      if (status.ok()) {
+        BatchSerde::estimates(&qr, *e);
+        BatchSerde::transfer(&qr, *t);
+
+        // read the batch in place, the message is moved into its cursor
+        auto fb = BatchSerde::deserialize(std::make_shared<flatbuffers::grpc::Message<BatchRows>>(std::move(qr)));
+        VLOG(1) << "Received batch as number of rows: " << fb->size();
+
+        // update into current server block management
+        p->setValue(fb);
+        return;
+      }
+
+      LOG(ERROR) << "Node failure: " << status.error_message();
+    } catch (const std::exception& ex) {
+      LOG(ERROR) << "Node failure: " << ex.what();
     }
 
-    LOG(ERROR) << "Node failure: " << status.error_message();
     // else return empty result set
     p->setValue(EmptyRowCursor::instance());
   });
@@ -116,6 +133,67 @@ folly::Future<RowCursorPtr> NodeClient::execute(const ExecutionPlan& plan) {
   return p->getFuture();
 }
 
+folly::Future<bool> NodeClient::stream(const ExecutionPlan& plan, Sink sink, const std::vector<std::string>& specs) {
+  auto p = std::make_shared<folly::Promise<bool>>();
+  auto addr = node_.toString();
+
+  // same as execute, capture values only
+  pool_.add([p, addr, sink = std::move(sink), specs, q = query_, id = plan.id(), w = plan.getWindow(),
+             e = plan.estimates(), t = plan.transfer(), c = plan.cancellation()]() {
+    // the promise is always fulfilled, a failure in this thread fails the stream
+    try {
+      auto qp = QuerySerde::serialize(*q, id, w, specs);
+      grpc::ClientContext context;
+      auto channel = ConnectionPool::init()->connection(addr);
+      N_ENSURE(channel != nullptr, "requires a valid channel");
+      auto stub = nebula::service::NodeServer::NewStub(channel);
+
+      // cancel the node query once server gives it up, node stops its block tasks in turn.
+      // the subscription is gone before the context it references.
+      Subscription subscription(*c, [&context]() { context.TryCancel(); });
+      auto reader = stub->QueryStream(&context, qp);
+
+      // hand over every chunk to the sink once it arrives, it is decompressed in this pool thread
+      flatbuffers::grpc::Message<BatchRows> qr;
+      size_t rows = 0;
+      auto failed = false;
+      try {
+        while (reader->Read(&qr)) {
+          BatchSerde::estimates(&qr, *e);
+          BatchSerde::transfer(&qr, *t);
+
+          // read the chunk in place, the message is moved into its cursor
+          auto fb = BatchSerde::deserialize(std::make_shared<flatbuffers::grpc::Message<BatchRows>>(std::move(qr)));
+          rows += fb->size();
+          sink(fb);
+        }
+      } catch (const std::exception& ex) {
+        // a chunk failing to read or merge fails the stream, the node query is cancelled and the call finished
+        LOG(ERROR) << "Failed to take a chunk from node " << addr << ": " << ex.what();
+        context.TryCancel();
+        while (reader->Read(&qr)) {
+        }
+        failed = true;
+      }
+
+      auto status = reader->Finish();
+      if (status.ok() && !failed) {
+        VLOG(1) << "Received streamed rows: " << rows;
+        p->setValue(true);
+        return;
+      }
+
+      LOG(ERROR) << "Node failure: " << status.error_message();
+    } catch (const std::exception& ex) {
+      LOG(ERROR) << "Node failure: " << ex.what();
+    }
+
+    p->setValue(false);
+  });
+
+  return p->getFuture();
+}
+
 void NodeClient::state() {
   // build request message through fb builder
   flatbuffers::grpc::MessageBuilder mb;
@@ -60,6 +60,11 @@ public:
   // execute a plan on remote node
   virtual folly::Future<nebula::surface::RowCursorPtr> execute(const nebula::execution::ExecutionPlan& plan) override;
 
+  // execute a plan on remote node and receive its results in chunks
+  virtual folly::Future<bool> stream(const nebula::execution::ExecutionPlan& plan,
+                                     nebula::execution::core::Sink sink,
+                                     const std::vector<std::string>& specs = {}) override;
+
   // pull node state
   virtual void state() override;
 
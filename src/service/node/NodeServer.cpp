@@ -19,6 +19,7 @@
 // #endif
 
 #include <gflags/gflags.h>
+#include <optional>
 
 #include "NodeServer.h"
 #include "TaskExecutor.h"
@@ -29,6 +30,8 @@
 #include "surface/DataSurface.h"
 
 DEFINE_int32(MAX_MSG_SIZE, 1073741824, "max message size sending between node and server, default to 1G");
+DEFINE_uint64(STREAM_CHUNK_ROWS, 65536, "max number of rows in a result chunk streamed from node to server");
+DEFINE_uint64(SPILL_INTERVAL_MS, 60000, "interval to check and spill cold blocks into local storage");
 
 /**
  * Define node server that does the work as nebula server asks.
@@ -37,15 +40,16 @@ namespace nebula {
 namespace service {
 namespace node {
 
+using nebula::common::Cancellation;
 using nebula::common::TaskState;
 using nebula::common::TaskType;
 using nebula::execution::BlockManager;
 using nebula::execution::PhaseType;
 using nebula::execution::core::NodeExecutor;
 using nebula::execution::io::BatchBlock;
+using nebula::execution::serde::FlatBufferPtr;
 using nebula::memory::keyed::FlatBuffer;
 using nebula::service::base::BatchSerde;
-using nebula::service::base::QuerySerde;
 using nebula::service::base::TaskSerde;
 using nebula::surface::RowCursorPtr;
 
@@ -101,28 +105,42 @@ grpc::Status NodeServerImpl::Echos(
   return grpc::Status::OK;
 }
 
-// TODO(cao) - we may want to change this endpoint as streaming
-// So that we don't need to do aggregation here, instead push all block executor results to server for aggregation.
-// Single aggregation - perf?
+// a query stops when its rpc is cancelled by the server, its client is gone or its deadline passes
+static void watch(grpc::ServerContext* context, Cancellation& cancel) {
+  cancel.watch([context]() { return context->IsCancelled(); });
+  const auto deadline = context->deadline();
+  if (deadline != std::chrono::system_clock::time_point::max()) {
+    cancel.expire(std::chrono::steady_clock::now() + (deadline - std::chrono::system_clock::now()));
+  }
+}
+
+// Single reply of the whole result, server uses QueryStream instead.
 grpc::Status NodeServerImpl::Query(
-  grpc::ServerContext*,
+  grpc::ServerContext* context,
   const flatbuffers::grpc::Message<QueryPlan>* query,
   flatbuffers::grpc::Message<BatchRows>* batch) {
 #ifdef PPROF
   ProfilerStart("/tmp/ns_query.out");
 #endif
   try {
-    auto plan = QuerySerde::from(tableService_, query);
+    auto plan = plans_.get(tableService_, query);
+    watch(context, *plan->cancellation());
 
-    // execute this plan and get results
-    NodeExecutor executor(BlockManager::init());
+    // execute this plan and get results, blocks are not spilled until its result is serialized
+    auto bm = BlockManager::init();
+    auto scan = bm->scan();
+    NodeExecutor executor(bm);
     auto cursor = executor.execute(threadPool_, *plan);
     const auto& phase = plan->fetch<PhaseType::PARTIAL>();
     const auto& buffer = nebula::execution::serde::asBuffer(*cursor, phase.outputSchema());
 
-    // serialize row cursor back
-    *batch = BatchSerde::serialize(*buffer);
+    // serialize row cursor back along with estimates if it is an approximate query
+    *batch = BatchSerde::serialize(*buffer, plan->estimates()->get(), query->GetRoot()->codec());
   } catch (const std::exception& exp) {
+    if (context->IsCancelled()) {
+      return grpc::Status::CANCELLED;
+    }
+
     return grpc::Status(grpc::StatusCode::INTERNAL, exp.what());
   }
 
@@ -133,6 +151,85 @@ grpc::Status NodeServerImpl::Query(
   return grpc::Status::OK;
 }
 
+// Stream node result back in chunks so that server merges them as they arrive,
+// and neither side holds the whole result in one message.
+grpc::Status NodeServerImpl::QueryStream(
+  grpc::ServerContext* context,
+  const flatbuffers::grpc::Message<QueryPlan>* query,
+  grpc::ServerWriter<flatbuffers::grpc::Message<BatchRows>>* writer) {
+  try {
+    auto plan = plans_.get(tableService_, query);
+    watch(context, *plan->cancellation());
+
+    // execute this plan and get results, blocks are not spilled while they are scanned
+    auto bm = BlockManager::init();
+    auto scan = bm->scan();
+    NodeExecutor executor(bm);
+    auto cursor = executor.execute(threadPool_, *plan);
+    const auto& phase = plan->fetch<PhaseType::PARTIAL>();
+
+    // estimates of approximate query go along with the first chunk.
+    // chunks are serialized and compressed in the pool while next chunk is being built.
+    // columnar chunks carry key hashes of aggregation so that server merges them without hashing.
+    const auto codec = query->GetRoot()->codec();
+    const auto columnar = query->GetRoot()->columnar();
+    const auto keys = phase.hasAggregation() ? phase.keys() : std::vector<size_t>{};
+    auto estimates = plan->estimates()->get();
+    std::optional<folly::Future<flatbuffers::grpc::Message<BatchRows>>> pending;
+    auto flush = [&writer, &pending]() {
+      if (pending) {
+        N_ENSURE(writer->Write(std::move(*pending).get()), "stream closed by server");
+        pending.reset();
+      }
+    };
+
+    auto send = [this, &flush, &pending, &estimates, &keys, codec, columnar](FlatBufferPtr buffer) {
+      flush();
+      auto p = std::make_shared<folly::Promise<flatbuffers::grpc::Message<BatchRows>>>();
+      pending = p->getFuture();
+      threadPool_.add([p, buffer = std::move(buffer), estimates, keys, codec, columnar]() {
+        p->setWith([&]() {
+          return columnar ? BatchSerde::columnar(*buffer, keys, estimates, codec) : BatchSerde::serialize(*buffer, estimates, codec);
+        });
+      });
+      estimates.clear();
+    };
+
+    // writing to a slow server should not hold blocks from spill.
+    // aggregated results own their rows, sampled rows reference block data and are copied out first.
+    size_t chunks = 0;
+    if (phase.hasAggregation()) {
+      scan.unlock();
+      chunks = nebula::execution::serde::asBuffers(*cursor, phase.outputSchema(), FLAGS_STREAM_CHUNK_ROWS, send);
+    } else {
+      std::vector<FlatBufferPtr> buffers;
+      chunks = nebula::execution::serde::asBuffers(
+        *cursor, phase.outputSchema(), FLAGS_STREAM_CHUNK_ROWS, [&buffers](FlatBufferPtr buffer) {
+          buffers.push_back(std::move(buffer));
+        });
+      cursor = nullptr;
+      scan.unlock();
+      for (auto& buffer : buffers) {
+        send(std::move(buffer));
+      }
+    }
+    flush();
+
+    // an empty result still replies with one chunk
+    if (chunks == 0) {
+      writer->Write(BatchSerde::serialize(FlatBuffer(phase.outputSchema()), estimates));
+    }
+  } catch (const std::exception& exp) {
+    if (context->IsCancelled()) {
+      return grpc::Status::CANCELLED;
+    }
+
+    return grpc::Status(grpc::StatusCode::INTERNAL, exp.what());
+  }
+
+  return grpc::Status::OK;
+}
+
 // poll block status of a node
 grpc::Status NodeServerImpl::Poll(
   grpc::ServerContext*,
@@ -152,7 +249,11 @@ grpc::Status NodeServerImpl::Poll(
   // usage is the same as usual.
   const auto bm = BlockManager::init();
   flatbuffers::grpc::MessageBuilder mb;
-  auto blocks = bm->all();
+  nebula::execution::BlockSet blocks;
+  {
+    auto scan = bm->scan();
+    blocks = bm->all();
+  }
 
   std::vector<flatbuffers::Offset<DataBlock>> db;
   db.reserve(blocks.size());
@@ -197,6 +298,9 @@ grpc::Status NodeServerImpl::Task(
 } // namespace nebula
 
 void RunServer() {
+  // bring back blocks persisted in local storage by last run before serving
+  nebula::execution::BlockManager::init()->restore();
+
   // launch the server
   std::string server_address = fmt::format(
     "0.0.0.0:{0}", nebula::service::base::ServiceProperties::NPORT);
@@ -231,6 +335,13 @@ void RunServer() {
       nebula::service::node::TaskExecutor::singleton().process(shutdownHandler, priorityPool);
     });
 
+  // tiered storage: spill cold blocks into local storage when memory is tight
+  taskScheduler.setInterval(
+    FLAGS_SPILL_INTERVAL_MS,
+    [] {
+      nebula::execution::BlockManager::init()->spill();
+    });
+
   // NOTE that, this is blocking main thread to wait for server down
   // this may prevent system to exit properly, will revisit and revise.
   // run the loop.
@@ -21,6 +21,7 @@
 #include "common/Folly.h"
 #include "execution/meta/TableService.h"
 #include "node/node.grpc.fb.h"
+#include "PlanCache.h"
 #include "node/node_generated.h"
 #include "service/base/NebulaService.h"
 
@@ -49,6 +50,12 @@ class NodeServerImpl final : public NodeServer::Service {
     flatbuffers::grpc::Message<BatchRows>*)
     override;
 
+  virtual grpc::Status QueryStream(
+    grpc::ServerContext*,
+    const flatbuffers::grpc::Message<QueryPlan>*,
+    grpc::ServerWriter<flatbuffers::grpc::Message<BatchRows>>*)
+    override;
+
   virtual grpc::Status Poll(
     grpc::ServerContext*,
     const flatbuffers::grpc::Message<NodeStateRequest>*,
@@ -74,6 +81,9 @@ public:
 private:
   std::shared_ptr<nebula::execution::meta::TableService> tableService_;
 
+  // compiled plans of recent query shapes
+  PlanCache plans_;
+
   // by default if not specified, CPUThreadPoolExecutor will use UnboundedBlockingQueue
   // so we can add as many task as we want.
   // Initialize this pool with two priority queues:
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "PlanCache.h"
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <limits>
+
+#include "service/base/NebulaService.h"
+
+DEFINE_uint64(PLAN_CACHE_SIZE, 1024, "max number of compiled query plans cached on a node, 0 to disable");
+
+namespace nebula {
+namespace service {
+namespace node {
+
+using nebula::execution::ExecutionPlan;
+using nebula::execution::QueryWindow;
+using nebula::meta::MetaService;
+using nebula::service::base::QuerySerde;
+
+PlanCache::PlanCache() : PlanCache(FLAGS_PLAN_CACHE_SIZE) {}
+
+std::unique_ptr<ExecutionPlan> PlanCache::get(
+  const std::shared_ptr<MetaService> ms, const flatbuffers::grpc::Message<QueryPlan>* msg) {
+  // evicting cache map takes 0 as unlimited
+  if (capacity_ == 0) {
+    return QuerySerde::from(ms, msg);
+  }
+
+  // time comparisons are not compiled into the plan, so they are left out of the key
+  auto p = msg->GetRoot();
+  QueryWindow range{ 0, std::numeric_limits<int64_t>::max() };
+  auto key = QuerySerde::shape(p, &range);
+  auto table = ms->query(flatbuffers::GetString(p->tbl()));
+  std::shared_ptr<const ExecutionPlan> compiled;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto itr = cache_.find(key);
+    if (itr != cache_.end() && itr->second.table == table) {
+      compiled = itr->second.plan;
+    }
+  }
+
+  if (compiled) {
+    ++hits_;
+    VLOG(1) << "Query plan served from plan cache, hit rate: " << hitRate();
+  } else {
+    ++misses_;
+    // compile out of lock, concurrent misses of the same shape may compile more than once
+    std::shared_ptr<const ExecutionPlan> plan = QuerySerde::from(ms, msg);
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_.set(key, { table, plan });
+    compiled = plan;
+  }
+
+  auto plan = compiled->copy();
+  plan->setWindow(QuerySerde::window(p, range));
+  plan->setSpecs(QuerySerde::specs(p));
+  return plan;
+}
+
+} // namespace node
+} // namespace service
+} // namespace nebula
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <folly/container/EvictingCacheMap.h>
+#include <mutex>
+
+#include "execution/ExecutionPlan.h"
+#include "meta/MetaService.h"
+#include "meta/Table.h"
+#include "node/node.grpc.fb.h"
+#include "node/node_generated.h"
+
+namespace nebula {
+namespace service {
+namespace node {
+
+/**
+ * A LRU cache of compiled execution plans on a node keyed by query shape (see QuerySerde::shape).
+ * A hit skips parsing and compiling, the query executes on its own copy of the cached plan.
+ *
+ * Time comparisons in conjuncts of the filter are left out of the shape and the compiled plan,
+ * they are bound at run time through the window of the plan. So queries of a sliding window share
+ * one plan. Other constants are compiled into expressions and stay in the key, such as the origin
+ * of timeline buckets.
+ */
+class PlanCache {
+public:
+  // capacity is given by flag PLAN_CACHE_SIZE
+  PlanCache();
+  explicit PlanCache(size_t capacity) : capacity_{ capacity }, cache_{ capacity } {}
+  PlanCache(PlanCache&) = delete;
+  PlanCache(PlanCache&&) = delete;
+  virtual ~PlanCache() = default;
+
+public:
+  // execution plan of the query, compiled only if no plan of the same shape is cached.
+  // a cached plan is not reused if its table definition has changed since.
+  std::unique_ptr<nebula::execution::ExecutionPlan> get(
+    const std::shared_ptr<nebula::meta::MetaService>, const flatbuffers::grpc::Message<QueryPlan>*);
+
+  inline size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cache_.size();
+  }
+
+  inline size_t hits() const {
+    return hits_;
+  }
+
+  inline size_t misses() const {
+    return misses_;
+  }
+
+  inline double hitRate() const {
+    const size_t hits = hits_;
+    const size_t total = hits + misses_;
+    return total == 0 ? 0 : (double)hits / total;
+  }
+
+private:
+  struct Entry {
+    std::shared_ptr<nebula::meta::Table> table;
+    std::shared_ptr<const nebula::execution::ExecutionPlan> plan;
+  };
+
+  const size_t capacity_;
+  mutable std::mutex mutex_;
+  folly::EvictingCacheMap<std::string, Entry> cache_;
+  std::atomic<size_t> hits_{ 0 };
+  std::atomic<size_t> misses_{ 0 };
+};
+
+} // namespace node
+} // namespace service
+} // namespace nebula
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <cmath>
 #include <cstdlib>
 #include <fmt/format.h>
 #include <gflags/gflags.h>
@@ -27,6 +28,7 @@
 
 #include "NebulaServer.h"
 #include "NodeSync.h"
+#include "ResultCache.h"
 #include "common/Chars.h"
 #include "common/Evidence.h"
 #include "common/Folly.h"
@@ -50,6 +52,10 @@ DEFINE_string(CLS_CONF, "configs/cluster.yml", "cluster config file");
 DEFINE_uint64(CLS_CONF_UPDATE_INTERVAL, 5000, "interval in milliseconds to update cluster config");
 DEFINE_uint64(NODE_SYNC_INTERVAL, 5000, "interval in ms to conduct node sync");
 DEFINE_uint32(MAX_TABLES_RETURN, 500, "max tables to fetch to display");
+DEFINE_double(APPROX_ERROR_TARGET, 0.05, "relative error of 95% confidence interval an approximate query refines to");
+DEFINE_uint64(APPROX_TIME_BUDGET_MS, 10000, "time budget in ms a refined approximate query is expected to fit in");
+DEFINE_uint32(APPROX_REFINE_STEP, 4, "fraction of blocks suggested to refine an approximate query grows by this factor");
+DEFINE_uint64(RESULT_CACHE_ALIGN_SECONDS, 0, "align query window to multiple of these seconds so that cached results are shared");
 
 /**
  * A cursor template that help iterating a container.
@@ -67,6 +73,7 @@ using nebula::common::SingleCommandTask;
 using nebula::common::Task;
 using nebula::common::TaskType;
 using nebula::execution::BlockManager;
+using nebula::execution::EstimateMap;
 using nebula::execution::io::BlockLoader;
 using nebula::execution::meta::TableService;
 using nebula::memory::Batch;
@@ -127,6 +134,31 @@ grpc::Status V1ServiceImpl::State(grpc::ServerContext*, const TableStateRequest*
   return Status::OK;
 }
 
+// z score of 95% confidence interval
+static constexpr auto Z95 = 1.96;
+
+// an approximate answer needs refining if the largest relative error of its estimates is above target
+// and a refined query, which takes about refine step times longer, still fits in the time budget
+static bool refine(double fraction, const EstimateMap& estimates, size_t roundMs) {
+  if (fraction <= 0 || fraction >= 1) {
+    return false;
+  }
+
+  double worst = 0;
+  for (const auto& e : estimates) {
+    const auto error = Z95 * std::sqrt(e.second.variance);
+    if (error > 0) {
+      worst = std::max(worst, e.second.total == 0 ? 1 : error / std::abs(e.second.total));
+    }
+  }
+
+  if (worst <= FLAGS_APPROX_ERROR_TARGET) {
+    return false;
+  }
+
+  return roundMs * FLAGS_APPROX_REFINE_STEP <= FLAGS_APPROX_TIME_BUDGET_MS;
+}
+
 grpc::Status V1ServiceImpl::Query(grpc::ServerContext* ctx, const QueryRequest* request, QueryResponse* reply) {
   // validate the query request and build the call
   nebula::common::Evidence::Duration tick;
@@ -150,12 +182,6 @@ grpc::Status V1ServiceImpl::Query(grpc::ServerContext* ctx, const QueryRequest*
   // get the table
   auto table = TableService::singleton()->query(tableName);
 
-  // build the query
-  auto query = handler_.build(*table, *request, error);
-  if (error != ErrorCode::NONE) {
-    return replyError(error, reply, 0);
-  }
-
   // build query context
   const auto& metadata = ctx->client_metadata();
 
@@ -176,24 +202,79 @@ grpc::Status V1ServiceImpl::Query(grpc::ServerContext* ctx, const QueryRequest*
     }
   }
 
-  // compile the query into a plan
+  // serve the same request of the same access groups from cache while no block in its window has changed
+  QueryRequest req{ *request };
+  std::string cacheKey;
+  size_t fingerprint = 0;
+  if (results_.enabled()) {
+    ResultCache::align(req, FLAGS_RESULT_CACHE_ALIGN_SECONDS);
+    cacheKey = ResultCache::key(req, groups, user != "unauth");
+    fingerprint = BlockManager::init()->fingerprint(table->name(), { req.start(), req.end() });
+    if (results_.get(cacheKey, fingerprint, *reply)) {
+      auto stats = reply->mutable_stats();
+      stats->set_querytimems(tick.elapsedMs());
+      stats->set_cached(true);
+      LOG(INFO) << "Served a query from result cache, hit rate: " << results_.hitRate();
+      return Status::OK;
+    }
+  }
+
+  // an approximate query runs once on requested fraction of blocks and returns right away with its error bounds,
+  // the client asks again with the suggested fraction if it needs a more accurate result
   LOG(INFO) << "Started a query for user: " << user << ", with groups:" << groups.size();
-  QueryContext queryContext{ user, std::move(groups) };
-  auto plan = handler_.compile(
-    query, { request->start(), request->end() }, queryContext, error);
+  const auto fraction = request->fraction();
+  auto query = handler_.build(*table, req, error);
   if (error != ErrorCode::NONE) {
-    return replyError(error, reply, 0);
+    return replyError(error, reply, tick.elapsedMs());
+  }
+
+  // compile the query into a plan
+  QueryContext queryContext{ user, groups };
+  auto plan = handler_.compile(query, handler_.window(req, *query), queryContext, error);
+  if (error != ErrorCode::NONE) {
+    return replyError(error, reply, tick.elapsedMs());
   }
   N_ENSURE_NOT_NULL(plan, "Incorrect query compile");
 
-  // create a remote connector and execute the query plan
+  // create a remote connector and execute the query plan, it is cancelled on nodes if the client is gone
   auto connector = std::make_shared<RemoteNodeConnector>(query);
-  RowCursorPtr result = handler_.query(threadPool_, *plan, connector, error);
-  auto durationMs = tick.elapsedMs();
+  plan->cancellation()->watch([ctx]() { return ctx->IsCancelled(); });
+  auto result = handler_.query(threadPool_, *plan, connector, error);
+  if (ctx->IsCancelled()) {
+    LOG(INFO) << "Query cancelled by client after " << tick.elapsedMs() << "ms";
+    return grpc::Status::CANCELLED;
+  }
+
+  if (error != ErrorCode::NONE) {
+    return replyError(error, reply, tick.elapsedMs());
+  }
+
+  // a query served by rollup cube leaves out the end second, whose raw rows are scanned by a tail query
+  auto tail = handler_.tail(*table, req, *query, error);
+  if (tail) {
+    QueryContext tailContext{ user, groups };
+    auto tailPlan = handler_.compile(tail, { req.end(), req.end() }, tailContext, error);
+    if (error != ErrorCode::NONE) {
+      return replyError(error, reply, tick.elapsedMs());
+    }
+
+    tailPlan->cancellation()->watch([ctx]() { return ctx->IsCancelled(); });
+    auto rows = handler_.query(threadPool_, *tailPlan, std::make_shared<RemoteNodeConnector>(tail), error);
+    if (ctx->IsCancelled()) {
+      LOG(INFO) << "Query cancelled by client after " << tick.elapsedMs() << "ms";
+      return grpc::Status::CANCELLED;
+    }
+
+    if (error == ErrorCode::NONE) {
+      result = handler_.merge(*plan, result, *tailPlan, rows, error);
+    }
+  }
+
   if (error != ErrorCode::NONE) {
-    return replyError(error, reply, durationMs);
+    return replyError(error, reply, tick.elapsedMs());
   }
 
+  auto durationMs = tick.elapsedMs();
   LOG(INFO) << "Finished a query in " << durationMs;
 
   // return normal serialized data
@@ -201,12 +282,46 @@ grpc::Status V1ServiceImpl::Query(grpc::ServerContext* ctx, const QueryRequest*
   stats->set_querytimems(durationMs);
   // TODO(cao) - read it from underlying execution
   stats->set_rowsscanned(0);
+  stats->set_compression(plan->transfer()->ratio());
+
+  // nodes not covered by any replica in time make a partial result
+  const auto& coverage = plan->coverage();
+  const auto partial = coverage->partial();
+  stats->set_partial(partial);
+  if (partial) {
+    for (const auto& node : coverage->nodes()) {
+      stats->add_missingnodes(node);
+    }
+    stats->set_missingblocks(coverage->blocks());
+  }
+
+  // error bounds of estimated metrics, and a larger fraction to ask again with if they are too wide
+  const auto approximate = fraction > 0 && fraction < 1;
+  stats->set_fraction(approximate ? fraction : 1);
+  if (approximate) {
+    const auto estimates = plan->estimates()->get();
+    if (refine(fraction, estimates, durationMs)) {
+      stats->set_refine(std::min(fraction * FLAGS_APPROX_REFINE_STEP, 1.0));
+    }
+
+    for (const auto& e : estimates) {
+      auto bound = stats->add_bound();
+      bound->set_column(e.first);
+      bound->set_estimate(e.second.total);
+      bound->set_error(Z95 * std::sqrt(e.second.variance));
+    }
+  }
 
   // TODO(cao) - use JSON for now, this should come from message request
   // User/client can specify what kind of format of result it expects
   reply->set_type(DataType::JSON);
   reply->set_data(ServiceProperties::jsonify(result, plan->getOutputSchema()));
 
+  // a partial result is not cached so that later queries get the chance to be complete
+  if (results_.enabled() && !partial) {
+    results_.put(cacheKey, fingerprint, *reply);
+  }
+
   return Status::OK;
 }
 
@@ -17,6 +17,7 @@
 
 #include <grpcpp/grpcpp.h>
 #include "QueryHandler.h"
+#include "ResultCache.h"
 #include "meta/TestTable.h"
 #include "nebula.grpc.pb.h"
 
@@ -36,6 +37,9 @@ class V1ServiceImpl final : public V1::Service {
   // query handler to handle all the queries
   QueryHandler handler_;
 
+  // results of recent queries
+  ResultCache results_;
+
 public:
   V1ServiceImpl() : threadPool_{ std::thread::hardware_concurrency() } {}
   virtual ~V1ServiceImpl() = default;
@@ -154,6 +154,17 @@ void NodeSync::sync(
           LOG(WARNING) << "Task " << t.signature() << " state: " << (char)state;
         }
       }
+
+      // replica ingests the same spec until it reports blocks of it, node ignores a task it already has
+      if (sp->replicated() && !bm->hasSpec(sp->replica(), sp->signature())) {
+        taskNotified++;
+        auto client = connector->makeClient(sp->replica(), pool);
+        Task t(TaskType::INGESTION, std::static_pointer_cast<Signable>(sp));
+        TaskState state = client->task(t);
+        if (state == TaskState::FAILED || state == TaskState::QUEUE) {
+          LOG(WARNING) << "Replica task " << t.signature() << " state: " << (char)state;
+        }
+      }
     }
   }
 
@@ -19,9 +19,13 @@
 #include <folly/Conv.h>
 #include <gflags/gflags.h>
 
+#include "execution/BlockManager.h"
+#include "execution/core/AggregationMerge.h"
 #include "execution/core/ServerExecutor.h"
+#include "execution/core/TopSort.h"
 #include "service/node/NodeClient.h"
 #include "service/node/RemoteNodeConnector.h"
+#include "type/Serde.h"
 
 DEFINE_uint32(AUTO_WINDOW_SIZE, 1000, "maximum data point when selecting auto window");
 
@@ -53,7 +57,9 @@ using nebula::api::dsl::SortType;
 using nebula::api::dsl::starts;
 using nebula::api::dsl::table;
 using nebula::execution::ExecutionPlan;
+using nebula::execution::PhaseType;
 using nebula::execution::QueryWindow;
+using nebula::execution::core::Merger;
 using nebula::execution::core::NodeConnector;
 using nebula::execution::core::ServerExecutor;
 using nebula::meta::NNode;
@@ -66,6 +72,7 @@ using nebula::surface::RowCursorPtr;
 using nebula::type::Kind;
 using nebula::type::Schema;
 using nebula::type::TypeNode;
+using nebula::type::TypeSerializer;
 using nebula::type::TypeTraits;
 
 std::unique_ptr<ExecutionPlan> QueryHandler::compile(
@@ -130,6 +137,17 @@ inline SortType orderTypeConvert(OrderType type) {
   return type == OrderType::DESC ? SortType::DESC : SortType::ASC;
 }
 
+inline nebula::execution::SampleMode sampleModeConvert(SampleMode mode) {
+  switch (mode) {
+  case SampleMode::UNIFORM:
+    return nebula::execution::SampleMode::UNIFORM;
+  case SampleMode::STRATIFIED:
+    return nebula::execution::SampleMode::STRATIFIED;
+  default:
+    return nebula::execution::SampleMode::FIRST;
+  }
+}
+
 // build the query object to execute
 std::shared_ptr<Query> QueryHandler::build(const Table& tb, const QueryRequest& req, ErrorCode& err) const noexcept {
   // 1. validate the query request, if failed, we can return right away
@@ -138,8 +156,13 @@ std::shared_ptr<Query> QueryHandler::build(const Table& tb, const QueryRequest&
   }
 
   try {
-    // create a node connector for this executor
-    return buildQuery(tb, req);
+    // an eligible timeline query scans rollup cube of the table instead of its raw rows
+    const auto cube = rollup(req);
+    if (!cube.empty()) {
+      LOG(INFO) << "Serving timeline query from rollup cube: " << cube;
+    }
+
+    return buildQuery(tb, req, cube);
   } catch (const std::exception& exp) {
     LOG(ERROR) << "Error in building query: " << exp.what();
     err = ErrorCode::FAIL_BUILD_QUERY;
@@ -147,9 +170,150 @@ std::shared_ptr<Query> QueryHandler::build(const Table& tb, const QueryRequest&
   }
 }
 
-std::shared_ptr<Query> QueryHandler::buildQuery(const Table& tb, const QueryRequest& req) const {
+std::shared_ptr<Query> QueryHandler::tail(const Table& tb, const QueryRequest& req, const Query& query, ErrorCode& err) const noexcept {
+  if (query.table_->name() == req.table()) {
+    return {};
+  }
+
+  try {
+    // raw metrics of the end second sum up into the same columns as the cube metrics, it is always exact
+    QueryRequest raw{ req };
+    raw.set_fraction(1);
+    return buildQuery(tb, raw, {});
+  } catch (const std::exception& exp) {
+    LOG(ERROR) << "Error in building tail query: " << exp.what();
+    err = ErrorCode::FAIL_BUILD_QUERY;
+    return {};
+  }
+}
+
+RowCursorPtr QueryHandler::merge(
+  const ExecutionPlan& plan,
+  RowCursorPtr result,
+  const ExecutionPlan& tail,
+  RowCursorPtr rows,
+  ErrorCode& err) const noexcept {
+  try {
+    // final values of cube metrics (sums) are their merge values, so both results merge as node results do
+    const auto& phase = plan.fetch<PhaseType::GLOBAL>();
+    N_ENSURE(!phase.diffInputOutput(), "cube query results are merged as they are");
+    N_ENSURE_EQ(TypeSerializer::to(plan.getOutputSchema()),
+                TypeSerializer::to(tail.getOutputSchema()),
+                "tail query has the same schema as its cube query");
+
+    Merger merger(phase.inputSchema(), phase.keys(), phase.fields(), phase.hasAggregation());
+    merger.add(result);
+    merger.add(rows);
+
+    // nodes missed by the tail query make the result partial too
+    plan.coverage()->add(*tail.coverage());
+    return topSort(merger.result(), phase);
+  } catch (const std::exception& exp) {
+    LOG(ERROR) << "Error in merging tail query: " << exp.what();
+    err = ErrorCode::FAIL_EXECUTE_QUERY;
+    return EmptyRowCursor::instance();
+  }
+}
+
+// time window of a timeline query in seconds and number of buckets
+static std::pair<int32_t, size_t> timelineWindow(const QueryRequest& req) {
+  // we have minimum size of window as 1 second to be enforced
+  // so if buckets is smaller than range (seconds), we use each range as
+  auto range = req.end() - req.start();
+  N_ENSURE_GT(range, 0, "timeline requires end time greater than start time");
+
+  int32_t window = (int32_t)req.window();
+  size_t buckets = window == 0 ? FLAGS_AUTO_WINDOW_SIZE : range / window;
+  if (buckets == 0 || buckets > range) {
+    buckets = range;
+  }
+
+  // recalculate window based on buckets
+  window = range / buckets;
+  N_ENSURE_GT(window, 0, "window should be at least 1 second");
+  return { window, buckets };
+}
+
+std::string QueryHandler::rollup(const QueryRequest& req) const {
+  if (req.display() != DisplayType::TIMELINE) {
+    return {};
+  }
+
+  const auto& specs = nebula::meta::ClusterInfo::singleton().tables();
+  auto spec = std::find_if(specs.begin(), specs.end(), [&req](const nebula::meta::TableSpecPtr& ts) {
+    return ts->name == req.table();
+  });
+  if (spec == specs.end()) {
+    return {};
+  }
+
+  const auto dimensions = (*spec)->rollup();
+  if (dimensions.empty()) {
+    return {};
+  }
+
+  // cube rows are whole minutes, so the time range and every bucket need to be whole minutes
+  constexpr auto bucket = Table::ROLLUP_BUCKET;
+  const auto window = timelineWindow(req);
+  if (req.start() % bucket != 0 || req.end() % bucket != 0 || (window.second > 1 && window.first % bucket != 0)) {
+    return {};
+  }
+
+  // dimensions and filters only on rollup dimensions
+  for (auto i = 0, size = req.dimension_size(); i < size; ++i) {
+    if (dimensions.count(req.dimension(i)) == 0) {
+      return {};
+    }
+  }
+
+  const auto& filter = req.filter_case() == QueryRequest::FilterCase::kFilterA ? req.filtera().expression() : req.filtero().expression();
+  for (const auto& p : filter) {
+    if (dimensions.count(p.column()) == 0) {
+      return {};
+    }
+  }
+
+  // metrics are sums of numeric columns or counts
+  const auto cube = (*spec)->cube();
+  const auto schema = cube->schema();
+  for (auto i = 0, size = req.metric_size(); i < size; ++i) {
+    const auto& m = req.metric(i);
+    if (m.method() == Rollup::COUNT) {
+      continue;
+    }
+
+    auto kind = Kind::INVALID;
+    schema->onChild(m.column(), [&kind](const TypeNode& node) {
+      kind = node->k();
+    });
+
+    if (m.method() != Rollup::SUM || dimensions.count(m.column()) > 0 || (kind != Kind::BIGINT && kind != Kind::DOUBLE)) {
+      return {};
+    }
+  }
+
+  // every raw block needs its cube block, eg. blocks ingested before rollup is defined have none
+  auto bm = nebula::execution::BlockManager::init();
+  const auto raw = std::get<0>(bm->getTableMetrics(req.table()));
+  if (raw == 0 || raw != std::get<0>(bm->getTableMetrics(cube->name()))) {
+    return {};
+  }
+
+  return cube->name();
+}
+
+QueryWindow QueryHandler::window(const QueryRequest& req, const Query& query) const noexcept {
+  // cube row of the end minute also holds rows after end, rows of the end second are scanned by tail()
+  if (query.table_->name() != req.table()) {
+    return { req.start(), req.end() - 1 };
+  }
+
+  return { req.start(), req.end() };
+}
+
+std::shared_ptr<Query> QueryHandler::buildQuery(const Table& tb, const QueryRequest& req, const std::string& cube) const {
   // build filter
-  auto q = std::make_shared<Query>(req.table(), ms_);
+  auto q = std::make_shared<Query>(cube.empty() ? req.table() : cube, ms_);
 
   std::shared_ptr<Expression> expr = nullptr;
 #define BUILD_EXPR(PREDS, LOP)                                    \
@@ -175,13 +339,11 @@ std::shared_ptr<Query> QueryHandler::buildQuery(const Table& tb, const QueryRequ
   }
 #undef BUILD_EXPR
 
-  // set filter - has normal combined filter or not
-  using LT = TypeTraits<Kind::BIGINT>::CppType;
-  auto timeFilter = (col(nebula::meta::Table::TIME_COLUMN) >= (LT)req.start()) && (col(nebula::meta::Table::TIME_COLUMN) <= (LT)req.end());
+  // set filter - time range is not part of it but bound at run time through window of the plan (see window())
   if (expr == nullptr) {
-    q->where(timeFilter);
+    q->where(ConstExpression<bool>(true));
   } else {
-    q->where(timeFilter && expr);
+    q->filter_ = expr;
   }
 
   // build all columns to be selected
@@ -197,20 +359,7 @@ std::shared_ptr<Query> QueryHandler::buildQuery(const Table& tb, const QueryRequ
   if (isTimeline) {
     columns.push_back(timeColumn);
 
-    // we have minimum size of window as 1 second to be enforced
-    // so if buckets is smaller than range (seconds), we use each range as
-    auto range = req.end() - req.start();
-    N_ENSURE_GT(range, 0, "timeline requires end time greater than start time");
-
-    int32_t window = (int32_t)req.window();
-    auto buckets = window == 0 ? FLAGS_AUTO_WINDOW_SIZE : range / window;
-    if (buckets == 0 || buckets > range) {
-      buckets = range;
-    }
-
-    // recalculate window based on buckets
-    window = range / buckets;
-    N_ENSURE_GT(window, 0, "window should be at least 1 second");
+    const auto [window, buckets] = timelineWindow(req);
 
     // only one bucket?
     std::shared_ptr<Expression> windowExpr = nullptr;
@@ -249,7 +398,7 @@ std::shared_ptr<Query> QueryHandler::buildQuery(const Table& tb, const QueryRequ
     const auto& m = req.metric(i);
     // build metric may change column name, using its alais
     columns.push_back(m.column());
-    fields.push_back(buildMetric(m));
+    fields.push_back(cube.empty() ? buildMetric(m) : buildCubeMetric(m));
   }
 
   q->select(fields).groupby(keys);
@@ -286,6 +435,16 @@ std::shared_ptr<Query> QueryHandler::buildQuery(const Table& tb, const QueryRequ
     q->limit(limit);
   }
 
+  // samples may be drawn randomly rather than first rows
+  if (req.display() == DisplayType::SAMPLES) {
+    q->sample(sampleModeConvert(req.sample()));
+  }
+
+  // aggregation may run approximately on a fraction of blocks
+  if (req.display() != DisplayType::SAMPLES) {
+    q->approximate(req.fraction());
+  }
+
   return q;
 }
 
@@ -303,11 +462,28 @@ std::shared_ptr<Expression> QueryHandler::buildMetric(const Metric& metric) cons
     BUILD_METRIC_CASE(COUNT, count)
     BUILD_METRIC_CASE(SUM, sum)
     BUILD_METRIC_CASE(AVG, avg)
+    BUILD_METRIC_CASE(APPROX_DISTINCT, approx_distinct)
+    BUILD_METRIC_CASE(EXACT_DISTINCT, exact_distinct)
+    BUILD_METRIC_CASE(P50, p50)
+    BUILD_METRIC_CASE(P90, p90)
+    BUILD_METRIC_CASE(P99, p99)
   default:
     throw NException("Rollup method not supported");
   }
 }
 
+std::shared_ptr<Expression> QueryHandler::buildCubeMetric(const Metric& metric) const {
+  // cube keeps sums and row count, so both sum and count add up the cube values
+  const auto& colName = metric.column();
+  if (metric.method() == Rollup::COUNT) {
+    auto exp = sum(col(Table::COUNT_COLUMN)).as(fmt::format("{0}.count", colName));
+    return std::make_shared<decltype(exp)>(exp);
+  }
+
+  auto exp = sum(col(colName)).as(fmt::format("{0}.sum", colName));
+  return std::make_shared<decltype(exp)>(exp);
+}
+
 #define CHAIN_AND_RET                                  \
   if (prev != nullptr) {                               \
     if (op == LogicalOp::AND) {                        \
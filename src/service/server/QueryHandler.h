@@ -41,6 +41,17 @@ public:
     const QueryRequest&,
     nebula::service::base::ErrorCode& err) const noexcept;
 
+  // time window to run a query built for the request in
+  nebula::execution::QueryWindow window(const QueryRequest&, const nebula::api::dsl::Query&) const noexcept;
+
+  // raw query of the end second left out by a query served by rollup cube, nullptr if the query scans raw rows.
+  // it runs in the window of [end, end] and its result is merged into the cube result by merge().
+  std::shared_ptr<nebula::api::dsl::Query> tail(
+    const nebula::meta::Table&,
+    const QueryRequest&,
+    const nebula::api::dsl::Query&,
+    nebula::service::base::ErrorCode& err) const noexcept;
+
   std::unique_ptr<nebula::execution::ExecutionPlan> compile(
     const std::shared_ptr<nebula::api::dsl::Query>,
     const nebula::execution::QueryWindow&,
@@ -53,11 +64,20 @@ public:
     const std::shared_ptr<nebula::execution::core::NodeConnector> connector,
     nebula::service::base::ErrorCode&) const noexcept;
 
+  // merge result of a tail query into result of its cube query, misses of the tail plan go to the cube plan
+  nebula::surface::RowCursorPtr merge(
+    const nebula::execution::ExecutionPlan&,
+    nebula::surface::RowCursorPtr,
+    const nebula::execution::ExecutionPlan&,
+    nebula::surface::RowCursorPtr,
+    nebula::service::base::ErrorCode&) const noexcept;
+
 private:
-  //  build query internally which can throw
+  //  build query internally which can throw, it scans given cube instead of raw rows if not empty
   std::shared_ptr<nebula::api::dsl::Query> buildQuery(
     const nebula::meta::Table& tb,
-    const QueryRequest& req) const;
+    const QueryRequest& req,
+    const std::string& cube) const;
 
   // build predicate into the query
   std::shared_ptr<nebula::api::dsl::Expression> buildPredicate(
@@ -69,6 +89,12 @@ private:
   // build metric into the query
   std::shared_ptr<nebula::api::dsl::Expression> buildMetric(const Metric&) const;
 
+  // build metric of a query served by rollup cube
+  std::shared_ptr<nebula::api::dsl::Expression> buildCubeMetric(const Metric&) const;
+
+  // rollup cube table to serve given query, empty if the query is not eligible
+  std::string rollup(const QueryRequest&) const;
+
   // validate the query request
   nebula::service::base::ErrorCode validate(const QueryRequest&) const noexcept;
 
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "ResultCache.h"
+
+#include <algorithm>
+#include <gflags/gflags.h>
+#include <vector>
+
+DEFINE_uint64(RESULT_CACHE_MB, 256, "memory budget in MB of query results cached in server, 0 to disable");
+
+namespace nebula {
+namespace service {
+namespace server {
+
+ResultCache::ResultCache() : ResultCache(FLAGS_RESULT_CACHE_MB << 20) {}
+
+std::string ResultCache::key(QueryRequest request, const std::unordered_set<std::string>& groups, bool auth) {
+  // predicates combined by AND or OR are commutative, so are values of a predicate
+  auto sort = [](PredicateAnd* filter) {
+    auto expressions = filter->mutable_expression();
+    for (auto& p : *expressions) {
+      std::sort(p.mutable_value()->begin(), p.mutable_value()->end());
+    }
+
+    std::sort(expressions->begin(), expressions->end(), [](const Predicate& p1, const Predicate& p2) {
+      return p1.SerializeAsString() < p2.SerializeAsString();
+    });
+  };
+
+  switch (request.filter_case()) {
+  case QueryRequest::FilterCase::kFilterA: {
+    sort(request.mutable_filtera());
+    break;
+  }
+  case QueryRequest::FilterCase::kFilterO: {
+    // both filters have the same layout
+    PredicateAnd filter;
+    filter.mutable_expression()->Swap(request.mutable_filtero()->mutable_expression());
+    sort(&filter);
+    filter.mutable_expression()->Swap(request.mutable_filtero()->mutable_expression());
+    break;
+  }
+  default:
+    break;
+  }
+
+  std::string key = request.SerializeAsString();
+  key.push_back(auth);
+
+  std::vector<std::string> sorted(groups.begin(), groups.end());
+  std::sort(sorted.begin(), sorted.end());
+  for (const auto& g : sorted) {
+    key.push_back(0);
+    key.append(g);
+  }
+
+  return key;
+}
+
+void ResultCache::align(QueryRequest& request, size_t seconds) {
+  if (seconds > 1) {
+    request.set_start(request.start() / seconds * seconds);
+    request.set_end(request.end() / seconds * seconds);
+  }
+}
+
+bool ResultCache::get(const std::string& key, size_t fingerprint, QueryResponse& reply) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr = cache_.find(key);
+  if (itr == cache_.end()) {
+    ++misses_;
+    return false;
+  }
+
+  // blocks in the window have changed since
+  if (itr->second.fingerprint != fingerprint) {
+    bytes_ -= itr->second.bytes;
+    cache_.erase(key);
+    ++misses_;
+    return false;
+  }
+
+  reply = itr->second.reply;
+  ++hits_;
+  return true;
+}
+
+void ResultCache::put(const std::string& key, size_t fingerprint, const QueryResponse& reply) {
+  const size_t bytes = key.size() + reply.ByteSizeLong();
+  if (bytes > budget_) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto itr = cache_.find(key);
+  if (itr != cache_.end()) {
+    bytes_ -= itr->second.bytes;
+  }
+
+  cache_.set(key, Entry{ fingerprint, bytes, reply });
+  bytes_ += bytes;
+
+  // evict least recently used results
+  while (bytes_ > budget_) {
+    auto lru = cache_.rbegin();
+    bytes_ -= lru->second.bytes;
+    const auto evict = lru->first;
+    cache_.erase(evict);
+  }
+}
+
+} // namespace server
+} // namespace service
+} // namespace nebula
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2017-present Shawn Cao
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <folly/container/EvictingCacheMap.h>
+#include <mutex>
+#include <unordered_set>
+
+#include "nebula.pb.h"
+
+/**
+ * A LRU cache of query results in server within a memory budget.
+ * A result is keyed by canonical form of its request and access groups of the requester,
+ * and it is reused only while no block in the query window has changed since it was computed.
+ */
+namespace nebula {
+namespace service {
+namespace server {
+
+class ResultCache {
+public:
+  // memory budget is given by flag RESULT_CACHE_MB
+  ResultCache();
+  explicit ResultCache(size_t budget) : budget_{ budget }, bytes_{ 0 }, cache_{ 0 } {}
+  ResultCache(ResultCache&) = delete;
+  ResultCache(ResultCache&&) = delete;
+  virtual ~ResultCache() = default;
+
+public:
+  // canonical key of a request: predicates and their values are sorted, access groups are sorted.
+  static std::string key(QueryRequest, const std::unordered_set<std::string>&, bool);
+
+  // align time window of a request to multiple of given seconds
+  static void align(QueryRequest&, size_t);
+
+  inline bool enabled() const {
+    return budget_ > 0;
+  }
+
+  // fill the reply with cached result if it is computed on blocks of the same fingerprint
+  bool get(const std::string&, size_t, QueryResponse&);
+
+  // cache a result computed on blocks of given fingerprint, least recently used results are
+  // evicted to keep total size in budget
+  void put(const std::string&, size_t, const QueryResponse&);
+
+  inline size_t hits() const {
+    return hits_;
+  }
+
+  inline size_t misses() const {
+    return misses_;
+  }
+
+  inline double hitRate() const {
+    const size_t hits = hits_;
+    const size_t total = hits + misses_;
+    return total == 0 ? 0 : (double)hits / total;
+  }
+
+  inline size_t bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+  }
+
+  inline size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cache_.size();
+  }
+
+private:
+  struct Entry {
+    size_t fingerprint;
+    size_t bytes;
+    QueryResponse reply;
+  };
+
+  const size_t budget_;
+  size_t bytes_;
+  mutable std::mutex mutex_;
+  // evicting by memory budget rather than number of entries
+  folly::EvictingCacheMap<std::string, Entry> cache_;
+  std::atomic<size_t> hits_{ 0 };
+  std::atomic<size_t> misses_{ 0 };
+};
+
+} // namespace server
+} // namespace service
+} // namespace nebula
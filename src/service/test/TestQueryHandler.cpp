@@ -14,25 +14,40 @@
  * limitations under the License.
  */
 
+#include <fstream>
+
+#include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <grpc/slice.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include "api/test/Test.hpp"
 #include "common/Folly.h"
+#include "execution/BlockManager.h"
 #include "execution/core/NodeConnector.h"
 #include "execution/core/ServerExecutor.h"
 #include "execution/meta/TableService.h"
 #include "fmt/format.h"
+#include "ingest/Rollup.h"
+#include "memory/keyed/FlatBuffer.h"
+#include "memory/keyed/HashFlat.h"
+#include "meta/ClusterInfo.h"
 #include "meta/NBlock.h"
 #include "meta/TestTable.h"
 #include "service/base/NebulaService.h"
+#include "service/node/PlanCache.h"
 #include "service/node/RemoteNodeConnector.h"
 #include "service/server/QueryHandler.h"
+#include "service/server/ResultCache.h"
 #include "surface/DataSurface.h"
 #include "surface/MockSurface.h"
+#include "surface/StaticData.h"
 #include "type/Serde.h"
 
+DECLARE_uint64(COMPRESS_MIN_BYTES);
+DECLARE_uint64(ZSTD_MIN_BYTES);
+
 namespace nebula {
 namespace service {
 namespace test {
@@ -42,14 +57,23 @@ using nebula::common::Cursor;
 using nebula::common::Evidence;
 using nebula::execution::core::NodeConnector;
 using nebula::execution::core::ServerExecutor;
+using nebula::execution::PhaseType;
+using nebula::execution::QueryWindow;
+using nebula::execution::Transfer;
 using nebula::execution::meta::TableService;
+using nebula::memory::keyed::FlatBuffer;
+using nebula::memory::keyed::HashFlat;
+using nebula::memory::keyed::HashedRowCursor;
 using nebula::meta::BlockSignature;
 using nebula::meta::NBlock;
 using nebula::meta::TestTable;
+using nebula::service::base::BatchSerde;
 using nebula::service::base::ErrorCode;
 using nebula::service::base::QuerySerde;
 using nebula::service::base::ServiceProperties;
+using nebula::service::node::PlanCache;
 using nebula::service::server::QueryHandler;
+using nebula::service::server::ResultCache;
 using nebula::surface::RowCursorPtr;
 using nebula::surface::RowData;
 using nebula::type::Schema;
@@ -106,6 +130,114 @@ TEST(ServiceTest, TestQueryTimeline) {
   LOG(INFO) << ServiceProperties::jsonify(result, plan->getOutputSchema());
 }
 
+TEST(ServiceTest, TestRollupTail) {
+  // a table with rollup cube on event dimension
+  const auto config = "/tmp/nebula.rollup.test.yml";
+  {
+    std::ofstream out(config);
+    out << "version: 1.0\n"
+        << "server:\n  anode: false\n  auth: false\n"
+        << "nodes: []\n"
+        << "tables:\n  rollup.test:\n"
+        << "    max-mb: 100\n    max-hr: 24\n"
+        << "    schema: \"ROW<id:int, event:string>\"\n"
+        << "    data: custom\n    loader: NebulaTest\n    source: \"\"\n    backup: \"\"\n    format: none\n"
+        << "    settings:\n      rollup: event\n"
+        << "    time:\n      type: static\n      value: 1600000000\n";
+  }
+
+  auto& ci = nebula::meta::ClusterInfo::singleton();
+  ci.load(config);
+  std::remove(config);
+  auto ms = TableService::singleton();
+  ms->enroll(ci);
+
+  const auto& specs = ci.tables();
+  auto spec = std::find_if(specs.begin(), specs.end(), [](const nebula::meta::TableSpecPtr& ts) {
+    return ts->name == "rollup.test";
+  });
+  ASSERT_TRUE(spec != specs.end());
+  auto table = (*spec)->to();
+
+  // one live block with a row every 10 seconds, it covers end and rows after end
+  const int64_t start = 1599999960;
+  const int64_t end = start + 600;
+  std::vector<std::string> events{ "a", "b" };
+  auto batch = std::make_shared<nebula::memory::Batch>(*table, 100);
+  std::map<int64_t, std::pair<int64_t, int64_t>> expected;
+  auto i = 0;
+  for (auto time = start; time < end + 60; time += 10, ++i) {
+    nebula::surface::StaticRow row(time, i, events.at(i % 2), nullptr, false, 0, 0, 0);
+    batch->add(row);
+
+    // raw query counts rows in [start, end], rows of the end second fall into their own bucket
+    if (time <= end) {
+      auto& e = expected[(time - start) / 60 * 60];
+      e.first += 1;
+      e.second += i;
+    }
+  }
+
+  nebula::execution::io::BatchBlock block(
+    BlockSignature{ table->name(), 0, (size_t)start, (size_t)(end + 50) },
+    batch,
+    { batch->getRows(), batch->getRawSize() });
+  auto bm = nebula::execution::BlockManager::init();
+  ASSERT_TRUE(bm->add(block));
+  ASSERT_TRUE(bm->add(nebula::ingest::Rollup(**spec).build(block)));
+
+  QueryHandler handler;
+  QueryRequest request;
+  request.set_table(table->name());
+  request.set_start(start);
+  request.set_end(end);
+  request.set_display(DisplayType::TIMELINE);
+  request.set_window(60);
+  auto count = request.add_metric();
+  count->set_column("id");
+  count->set_method(Rollup::COUNT);
+  auto sum = request.add_metric();
+  sum->set_column("id");
+  sum->set_method(Rollup::SUM);
+
+  // the cube serves [start, end) while the tail query scans raw rows of the end second
+  ErrorCode err = ErrorCode::NONE;
+  auto query = handler.build(*table, request, err);
+  ASSERT_EQ(err, ErrorCode::NONE);
+  EXPECT_EQ(query->table_->name(), "rollup.test.rollup");
+  EXPECT_EQ(handler.window(request, *query), QueryWindow(start, end - 1));
+  auto tail = handler.tail(*table, request, *query, err);
+  ASSERT_TRUE(tail != nullptr);
+  EXPECT_EQ(tail->table_->name(), table->name());
+
+  QueryContext ctx{ "nebula", { "nebula-users" } };
+  auto plan = handler.compile(query, handler.window(request, *query), ctx, err);
+  QueryContext tailCtx{ "nebula", { "nebula-users" } };
+  auto tailPlan = handler.compile(tail, { request.end(), request.end() }, tailCtx, err);
+  ASSERT_EQ(err, ErrorCode::NONE);
+
+  folly::CPUThreadPoolExecutor pool{ 2 };
+  auto connector = std::make_shared<NodeConnector>();
+  auto result = handler.query(pool, *plan, connector, err);
+  auto rows = handler.query(pool, *tailPlan, connector, err);
+  result = handler.merge(*plan, result, *tailPlan, rows, err);
+  ASSERT_EQ(err, ErrorCode::NONE);
+  EXPECT_FALSE(plan->coverage()->partial());
+
+  // same as scanning raw rows of [start, end]
+  EXPECT_EQ(result->size(), expected.size());
+  while (result->hasNext()) {
+    const auto& r = result->next();
+    const auto& e = expected.at(r.readLong(nebula::meta::Table::WINDOW_COLUMN));
+    EXPECT_EQ(r.readLong("id.count"), e.first);
+    EXPECT_EQ(r.readLong("id.sum"), e.second);
+  }
+
+  // the end bucket has only the raw row at end, not rows after end held by the end minute of the cube
+  EXPECT_EQ(expected.at(600).first, 1);
+  EXPECT_EQ(expected.at(600).second, 60);
+}
+
 TEST(ServiceTest, TestStringFilters) {
   auto data = nebula::api::test::genData();
 
@@ -304,6 +436,179 @@ TEST(ServiceTest, TestQuerySerde) {
   LOG(INFO) << "result is " << str1;
 }
 
+TEST(ServiceTest, TestPlanCache) {
+  auto ms = TableService::singleton();
+  nebula::meta::TestTable testTable;
+  auto build = [&](size_t limit) {
+    return table(testTable.name(), ms)
+      .where(like(col("event"), "NN%"))
+      .select(col("event"), count(1).as("count"))
+      .groupby({ 1 })
+      .limit(limit);
+  };
+
+  // queries of the same shape but different windows share a compiled plan
+  auto q1 = build(10);
+  auto q2 = build(10);
+  auto q3 = build(20);
+  auto ser1 = QuerySerde::serialize(q1, "q1", { 10, 20 });
+  auto ser2 = QuerySerde::serialize(q2, "q2", { 30, 40 });
+  auto ser3 = QuerySerde::serialize(q3, "q3", { 10, 20 });
+  EXPECT_EQ(QuerySerde::shape(ser1.GetRoot()), QuerySerde::shape(ser2.GetRoot()));
+  EXPECT_NE(QuerySerde::shape(ser1.GetRoot()), QuerySerde::shape(ser3.GetRoot()));
+
+  PlanCache cache(2);
+  auto p1 = cache.get(ms, &ser1);
+  auto p2 = cache.get(ms, &ser2);
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(&p1->fetch<PhaseType::COMPUTE>(), &p2->fetch<PhaseType::COMPUTE>());
+  EXPECT_EQ(p1->getWindow(), QueryWindow(10, 20));
+  EXPECT_EQ(p2->getWindow(), QueryWindow(30, 40));
+  EXPECT_NE(p1->estimates(), p2->estimates());
+
+  // a different shape compiles its own plan
+  auto p3 = cache.get(ms, &ser3);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(p3->fetch<PhaseType::COMPUTE>().top(), 20);
+
+  // time comparisons are bound at run time through the plan window, so a sliding window shares one plan
+  auto build2 = [&](int64_t start, int64_t end) {
+    return table(testTable.name(), ms)
+      .where(col(nebula::meta::Table::TIME_COLUMN) >= start && col(nebula::meta::Table::TIME_COLUMN) < end)
+      .select(col("event"), count(1).as("count"))
+      .groupby({ 1 });
+  };
+
+  auto q4 = build2(100, 200);
+  auto q5 = build2(110, 210);
+  auto ser4 = QuerySerde::serialize(q4, "q4", { 100, 200 });
+  auto ser5 = QuerySerde::serialize(q5, "q5", { 110, 210 });
+  auto p4 = cache.get(ms, &ser4);
+  auto p5 = cache.get(ms, &ser5);
+  EXPECT_EQ(cache.hits(), 2);
+  EXPECT_EQ(cache.misses(), 3);
+  EXPECT_EQ(&p4->fetch<PhaseType::COMPUTE>(), &p5->fetch<PhaseType::COMPUTE>());
+  EXPECT_EQ(p4->fetch<PhaseType::COMPUTE>().filter().signature(), "C:true");
+  EXPECT_EQ(p4->getWindow(), QueryWindow(100, 199));
+  EXPECT_EQ(p5->getWindow(), QueryWindow(110, 209));
+  EXPECT_EQ(cache.hitRate(), 2.0 / 5);
+}
+
+TEST(ServiceTest, TestBlockCacheKey) {
+  auto ms = TableService::singleton();
+  nebula::meta::TestTable testTable;
+  auto build = [&](int64_t start, int64_t end) {
+    return table(testTable.name(), ms)
+      .where(col(nebula::meta::Table::TIME_COLUMN) >= start && col(nebula::meta::Table::TIME_COLUMN) < end && like(col("event"), "NN%"))
+      .select(col("event"), count(1).as("count"))
+      .groupby({ 1 });
+  };
+
+  // time comparisons are left out of the key and narrow the range instead
+  auto q1 = build(100, 200);
+  auto q2 = build(300, 400);
+  auto ser1 = QuerySerde::serialize(q1, "q1", { 100, 200 });
+  auto ser2 = QuerySerde::serialize(q2, "q2", { 300, 400 });
+  EXPECT_NE(QuerySerde::shape(ser1.GetRoot()), QuerySerde::shape(ser2.GetRoot()));
+
+  QueryWindow r1{ 0, std::numeric_limits<int64_t>::max() };
+  QueryWindow r2{ 0, std::numeric_limits<int64_t>::max() };
+  EXPECT_EQ(QuerySerde::shape(ser1.GetRoot(), &r1), QuerySerde::shape(ser2.GetRoot(), &r2));
+  EXPECT_EQ(r1, QueryWindow(100, 199));
+  EXPECT_EQ(r2, QueryWindow(300, 399));
+
+  auto plan = QuerySerde::from(ms, &ser1);
+  EXPECT_FALSE(plan->cacheKey().empty());
+  EXPECT_EQ(plan->getWindow(), QueryWindow(100, 199));
+  const std::string sign(plan->fetch<PhaseType::COMPUTE>().filter().signature());
+  EXPECT_EQ(sign.find(nebula::meta::Table::TIME_COLUMN), std::string::npos);
+  EXPECT_EQ(plan->copy()->cacheKey(), plan->cacheKey());
+  EXPECT_EQ(plan->copy()->filterKey(), plan->filterKey());
+
+  // queries of the same filter with different metrics share the filter key across windows
+  auto other = table(testTable.name(), ms)
+                 .where(col(nebula::meta::Table::TIME_COLUMN) >= (int64_t)300 && col(nebula::meta::Table::TIME_COLUMN) < (int64_t)400 && like(col("event"), "NN%"))
+                 .select(col("flag"), count(1).as("count"))
+                 .groupby({ 1 });
+  auto ser3 = QuerySerde::serialize(other, "q3", { 300, 400 });
+  auto plan3 = QuerySerde::from(ms, &ser3);
+  EXPECT_NE(plan3->cacheKey(), plan->cacheKey());
+  EXPECT_EQ(plan3->filterKey(), plan->filterKey());
+
+  // a contradicting time predicate has no block to cache
+  auto empty = QuerySerde::serialize(build(200, 100), "q4", { 100, 200 });
+  EXPECT_TRUE(QuerySerde::from(ms, &empty)->cacheKey().empty());
+
+  // a time comparison out of conjuncts of the filter is kept
+  auto either = table(testTable.name(), ms)
+                  .where(col(nebula::meta::Table::TIME_COLUMN) >= (int64_t)300 || like(col("event"), "NN%"))
+                  .select(col("flag"), count(1).as("count"))
+                  .groupby({ 1 });
+  auto ser5 = QuerySerde::serialize(either, "q5", { 100, 400 });
+  QueryWindow r5{ 0, std::numeric_limits<int64_t>::max() };
+  QuerySerde::shape(ser5.GetRoot(), &r5);
+  EXPECT_EQ(r5, QueryWindow(0, std::numeric_limits<int64_t>::max()));
+  EXPECT_EQ(QuerySerde::from(ms, &ser5)->getWindow(), QueryWindow(100, 400));
+}
+
+TEST(ServiceTest, TestResultCache) {
+  auto predicate = [](QueryRequest& req, const std::string& column, std::vector<std::string> values) {
+    auto p = req.mutable_filtera()->add_expression();
+    p->set_column(column);
+    p->set_op(Operation::EQ);
+    for (auto& v : values) {
+      p->add_value(v);
+    }
+  };
+
+  QueryRequest r1;
+  r1.set_table("nebula.test");
+  r1.set_start(1001);
+  r1.set_end(2009);
+  r1.add_dimension("event");
+  predicate(r1, "event", { "a", "b" });
+  predicate(r1, "tag", { "x" });
+
+  // the same request with predicates and values in different order
+  QueryRequest r2{ r1 };
+  r2.clear_filtera();
+  predicate(r2, "tag", { "x" });
+  predicate(r2, "event", { "b", "a" });
+  ResultCache::align(r1, 10);
+  ResultCache::align(r2, 10);
+  EXPECT_EQ(r1.start(), 1000);
+  EXPECT_EQ(r1.end(), 2000);
+  EXPECT_EQ(ResultCache::key(r1, { "g1", "g2" }, true), ResultCache::key(r2, { "g2", "g1" }, true));
+  EXPECT_NE(ResultCache::key(r1, { "g1" }, true), ResultCache::key(r2, { "g2" }, true));
+
+  // results are reused only on blocks of the same fingerprint
+  ResultCache cache(4096);
+  QueryResponse reply;
+  reply.set_data(std::string(1000, 'x'));
+  const auto k1 = ResultCache::key(r1, {}, false);
+  cache.put(k1, 1, reply);
+  QueryResponse cached;
+  EXPECT_TRUE(cache.get(k1, 1, cached));
+  EXPECT_EQ(cached.data(), reply.data());
+  EXPECT_FALSE(cache.get(k1, 2, cached));
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(cache.hitRate(), 0.5);
+
+  // least recently used results are evicted out of budget
+  for (auto i = 0; i < 5; ++i) {
+    r1.set_top(i);
+    cache.put(ResultCache::key(r1, {}, false), 1, reply);
+  }
+  EXPECT_EQ(cache.size(), 3);
+  EXPECT_LE(cache.bytes(), 4096);
+  r1.set_top(0);
+  EXPECT_FALSE(cache.get(ResultCache::key(r1, {}, false), 1, cached));
+  r1.set_top(4);
+  EXPECT_TRUE(cache.get(ResultCache::key(r1, {}, false), 1, cached));
+}
+
 TEST(ServiceTest, TestDataSerde) {
   // load test data to run this query
   auto data = nebula::api::test::genData();
@@ -353,6 +658,208 @@ TEST(ServiceTest, TestDataSerde) {
   LOG(INFO) << "result is " << str1;
 }
 
+TEST(ServiceTest, TestCompressedBatchSerde) {
+  gflags::FlagSaver saver;
+  FLAGS_COMPRESS_MIN_BYTES = 1024;
+  FLAGS_ZSTD_MIN_BYTES = 65536;
+
+  // aggregated results with repeated keys compress well
+  auto schema = TypeSerializer::from("ROW<id:int, event:string, flag:bool>");
+  const std::vector<std::string> events{ "nebula-event-open", "nebula-event-click", "nebula-event-close" };
+  FlatBuffer fb(schema);
+  for (auto i = 0; i < 10000; ++i) {
+    fb.add(nebula::surface::StaticRow(i, i % 10, events[i % 3], nullptr, i % 2 == 0, 'a', 0, 1.0));
+  }
+
+  auto check = [&fb](Compression max, Compression expected, size_t rows) {
+    FlatBuffer part(fb.schema());
+    for (size_t i = 0; i < rows; ++i) {
+      part.add(*fb.crow(i));
+    }
+
+    auto msg = BatchSerde::serialize(part, {}, max);
+    auto ptr = msg.GetRoot();
+    EXPECT_EQ(ptr->codec(), expected);
+    Transfer transfer;
+    BatchSerde::transfer(&msg, transfer);
+    if (expected == Compression::Compression_None) {
+      EXPECT_EQ(transfer.ratio(), 1);
+    } else {
+      EXPECT_EQ(ptr->raw(), part.binSize());
+      EXPECT_GT(transfer.ratio(), 2);
+    }
+
+    // all rows are read back the same
+    auto cursor = BatchSerde::deserialize(&msg);
+    size_t i = 0;
+    while (cursor->hasNext()) {
+      const auto& r = cursor->next();
+      auto e = part.crow(i++);
+      EXPECT_EQ(r.readInt("id"), e->readInt("id"));
+      EXPECT_EQ(r.readString("event"), e->readString("event"));
+      EXPECT_EQ(r.readBool("flag"), e->readBool("flag"));
+    }
+    EXPECT_EQ(i, rows);
+  };
+
+  // small payload is not compressed, medium one uses lz4 and large one uses zstd if accepted
+  check(Compression::Compression_Zstd, Compression::Compression_None, 10);
+  check(Compression::Compression_Zstd, Compression::Compression_Lz4, 500);
+  check(Compression::Compression_Zstd, Compression::Compression_Zstd, 10000);
+  check(Compression::Compression_Lz4, Compression::Compression_Lz4, 10000);
+  check(Compression::Compression_None, Compression::Compression_None, 10000);
+}
+
+TEST(ServiceTest, TestMisalignedBatchSerde) {
+  auto schema = TypeSerializer::from("ROW<id:int, event:string, flag:bool>");
+  const std::vector<std::string> events{ "nebula-event-open", "nebula-event-click", "nebula-event-close" };
+  nebula::surface::eval::Fields fields;
+  HashFlat hf(schema, { 2, 0, 1 }, fields);
+  for (auto i = 0; i < 1000; ++i) {
+    hf.update(nebula::surface::StaticRow(i, i % 10, events[i % 3], nullptr, i % 2 == 0, 'a', 0, 1.0));
+  }
+
+  // move a message into a slice where the given part of it is not aligned in memory
+  using Message = flatbuffers::grpc::Message<BatchRows>;
+  auto misalign = [](const Message& msg, const void* part) {
+    const auto size = msg.size();
+    const auto offset = static_cast<const uint8_t*>(part) - msg.data();
+    auto slice = grpc_slice_malloc(size + alignof(size_t));
+    auto base = GRPC_SLICE_START_PTR(slice);
+    size_t shift = 0;
+    while (reinterpret_cast<std::uintptr_t>(base + shift + offset) % alignof(size_t) == 0) {
+      ++shift;
+    }
+    std::memcpy(base + shift, msg.data(), size);
+    auto sub = grpc_slice_sub(slice, shift, shift + size);
+    grpc_slice_unref(slice);
+    return std::make_shared<Message>(sub, false);
+  };
+
+  auto check = [&hf](RowCursorPtr cursor) {
+    size_t i = 0;
+    while (cursor->hasNext()) {
+      const auto& r = cursor->next();
+      auto e = hf.crow(i++);
+      EXPECT_EQ(r.readInt("id"), e->readInt("id"));
+      EXPECT_EQ(r.readString("event"), e->readString("event"));
+      EXPECT_EQ(r.readBool("flag"), e->readBool("flag"));
+    }
+    EXPECT_EQ(i, hf.getRows());
+  };
+
+  // misaligned flat data is copied out rather than read in place
+  auto flat = BatchSerde::serialize(hf, {});
+  auto data = flat.GetRoot()->data()->data();
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(data) % alignof(size_t), 0);
+  auto shifted = misalign(flat, data);
+  EXPECT_NE(reinterpret_cast<std::uintptr_t>(shifted->GetRoot()->data()->data()) % alignof(size_t), 0);
+  check(BatchSerde::deserialize(shifted));
+
+  // misaligned columnar rows are copied into a flat buffer instead of a hashed cursor read in place
+  auto columnar = BatchSerde::columnar(hf, { 1, 0, 2 });
+  auto cursor = BatchSerde::deserialize(misalign(columnar, columnar.data()));
+  EXPECT_EQ(std::dynamic_pointer_cast<HashedRowCursor>(cursor), nullptr);
+  check(cursor);
+}
+
+TEST(ServiceTest, TestColumnarBatchSerde) {
+  auto schema = TypeSerializer::from("ROW<id:int, event:string, flag:bool>");
+  const std::vector<std::string> events{ "nebula-event-open", "nebula-event-click", "nebula-event-close" };
+  nebula::surface::eval::Fields fields;
+  HashFlat hf(schema, { 2, 0, 1 }, fields);
+  for (auto i = 0; i < 1000; ++i) {
+    hf.update(nebula::surface::StaticRow(i, i % 10, events[i % 3], nullptr, i % 2 == 0, 'a', 0, 1.0));
+  }
+
+  // strings are dictionary encoded
+  auto msg = BatchSerde::columnar(hf, { 1, 0, 2 });
+  auto ptr = msg.GetRoot();
+  EXPECT_EQ(ptr->type(), BatchType::BatchType_Columnar);
+  EXPECT_EQ(ptr->codec(), Compression::Compression_None);
+  EXPECT_EQ(ptr->columnar()->rows(), hf.getRows());
+  EXPECT_EQ(ptr->columnar()->columns()->Get(1)->dict()->size(), events.size());
+
+  // rows are read in place with the same key hash as the hash flat computes
+  auto shared = std::make_shared<flatbuffers::grpc::Message<BatchRows>>(std::move(msg));
+  auto cursor = BatchSerde::deserialize(shared);
+  auto hashed = std::dynamic_pointer_cast<HashedRowCursor>(cursor);
+  ASSERT_NE(hashed, nullptr);
+  EXPECT_EQ(hashed->hashKeys(), hf.hashKeys());
+  size_t i = 0;
+  while (cursor->hasNext()) {
+    const auto& r = cursor->next();
+    auto e = hf.crow(i);
+    EXPECT_EQ(r.readInt("id"), e->readInt("id"));
+    EXPECT_EQ(r.readString("event"), e->readString("event"));
+    EXPECT_EQ(r.readBool("flag"), e->readBool("flag"));
+    EXPECT_EQ(hashed->hash(), hf.hash(i));
+    ++i;
+  }
+  EXPECT_EQ(i, hf.getRows());
+
+  // a copy is materialized if the message is not shared
+  auto copy = BatchSerde::deserialize(shared.get());
+  EXPECT_EQ(copy->size(), hf.getRows());
+
+  // uncompressed columnar rows are counted as they are
+  Transfer plain;
+  BatchSerde::transfer(shared.get(), plain);
+  EXPECT_EQ(plain.ratio(), 1);
+}
+
+TEST(ServiceTest, TestCompressedColumnarBatchSerde) {
+  gflags::FlagSaver saver;
+  FLAGS_COMPRESS_MIN_BYTES = 1024;
+  FLAGS_ZSTD_MIN_BYTES = 65536;
+
+  auto schema = TypeSerializer::from("ROW<id:int, event:string, flag:bool>");
+  const std::vector<std::string> events{ "nebula-event-open", "nebula-event-click", "nebula-event-close" };
+  nebula::surface::eval::Fields fields;
+  HashFlat hf(schema, { 0, 1, 2 }, fields);
+  for (auto i = 0; i < 10000; ++i) {
+    hf.update(nebula::surface::StaticRow(i, i, events[i % 3], nullptr, i % 2 == 0, 'a', 0, 1.0));
+  }
+
+  // columnar rows are compressed by the negotiated codec
+  auto msg = BatchSerde::columnar(hf, { 0, 1, 2 }, {}, Compression::Compression_Zstd);
+  auto ptr = msg.GetRoot();
+  EXPECT_EQ(ptr->type(), BatchType::BatchType_Columnar);
+  EXPECT_EQ(ptr->codec(), Compression::Compression_Zstd);
+  EXPECT_EQ(ptr->columnar(), nullptr);
+  EXPECT_LT(ptr->data()->size(), ptr->raw());
+  Transfer transfer;
+  BatchSerde::transfer(&msg, transfer);
+  EXPECT_GT(transfer.ratio(), 1);
+
+  // rows are read back the same with their key hashes
+  auto shared = std::make_shared<flatbuffers::grpc::Message<BatchRows>>(std::move(msg));
+  for (auto cursor : { BatchSerde::deserialize(shared), BatchSerde::deserialize(shared.get()) }) {
+    auto hashed = std::dynamic_pointer_cast<HashedRowCursor>(cursor);
+    ASSERT_NE(hashed, nullptr);
+    size_t i = 0;
+    while (cursor->hasNext()) {
+      const auto& r = cursor->next();
+      auto e = hf.crow(i);
+      EXPECT_EQ(r.readInt("id"), e->readInt("id"));
+      EXPECT_EQ(r.readString("event"), e->readString("event"));
+      EXPECT_EQ(r.readBool("flag"), e->readBool("flag"));
+      EXPECT_EQ(hashed->hash(), hf.hash(i));
+      ++i;
+    }
+    EXPECT_EQ(i, hf.getRows());
+  }
+
+  // schema not supported by columnar format falls back to flat format with the same codec
+  FlatBuffer list(TypeSerializer::from("ROW<id:int, items:list<string>>"));
+  for (auto i = 0; i < 10000; ++i) {
+    list.add(nebula::surface::StaticRow(i, i % 10, "", nullptr, false, 'a', 0, 1.0));
+  }
+  auto flat = BatchSerde::columnar(list, { 0 }, {}, Compression::Compression_Lz4);
+  EXPECT_EQ(flat.GetRoot()->type(), BatchType::BatchType_Flat);
+  EXPECT_EQ(flat.GetRoot()->codec(), Compression::Compression_Lz4);
+}
+
 } // namespace test
 } // namespace service
 } // namespace nebula
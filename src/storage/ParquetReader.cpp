@@ -26,17 +26,21 @@ namespace storage {
 using nebula::surface::RowData;
 using nebula::type::Kind;
 
+void ParquetReader::nextGroup() {
+  groupReader_ = reader_->RowGroup(group_++);
+  cursorInGroup_ = 0;
+  groupRows_ = groupReader_->metadata()->num_rows();
+
+  // initialize all column readers in the meta store
+  for (auto& item : this->columns_) {
+    item.second.reader = groupReader_->Column(item.second.columnIndex);
+  }
+}
+
 const RowData& ParquetReader::next() {
   // TODO build a flat row out of a reader
   if (UNLIKELY(groupReader_ == nullptr) || cursorInGroup_ == groupRows_) {
-    groupReader_ = reader_->RowGroup(group_++);
-    cursorInGroup_ = 0;
-    groupRows_ = groupReader_->metadata()->num_rows();
-
-    // initialize all column readers in the meta store
-    for (auto& item : this->columns_) {
-      item.second.reader = groupReader_->Column(item.second.columnIndex);
-    }
+    nextGroup();
   }
 
   // read current data from current group reader and set it to current FlatRow
@@ -97,5 +101,136 @@ const RowData& ParquetReader::next() {
   return row_;
 }
 
+// scatter dense values backward in place to their row slots, values[0, valid) are the non-null values
+template <typename T>
+static const uint8_t* scatterNulls(
+  const std::vector<int16_t>& defs, int16_t maxDef, size_t rows, size_t valid, T* values, std::vector<uint8_t>& validity) {
+  if (valid == rows) {
+    return nullptr;
+  }
+
+  validity.assign((rows + 7) >> 3, 0);
+  for (size_t i = rows; i-- > 0;) {
+    if (defs[i] == maxDef) {
+      values[i] = values[--valid];
+      validity[i >> 3] |= (1 << (i & 7));
+    } else {
+      values[i] = T{};
+    }
+  }
+
+  return validity.data();
+}
+
+template <typename R, typename T>
+const uint8_t* ParquetReader::scatter(const ColumnInfo& info, size_t rows, T* values) {
+  auto reader = static_cast<R*>(info.reader.get());
+  defs_.resize(rows);
+
+  // column reader may return less than asked when crossing pages
+  size_t levels = 0;
+  size_t valid = 0;
+  while (levels < rows && reader->HasNext()) {
+    int64_t vread = 0;
+    levels += reader->ReadBatch(rows - levels, defs_.data() + levels, nullptr, values + valid, &vread);
+    valid += vread;
+  }
+
+  N_ENSURE_EQ(levels, rows, "column chunk should have the same rows");
+  return scatterNulls(defs_, reader->descr()->max_definition_level(), rows, valid, values, validity_);
+}
+
+const uint8_t* ParquetReader::scatter(const ColumnInfo& info, size_t rows, std::string_view* values) {
+  auto reader = static_cast<parquet::ByteArrayReader*>(info.reader.get());
+  defs_.resize(rows);
+  bytes_.resize(rows);
+
+  // byte arrays point to page buffer which is released when reader moves to next page
+  // so we copy them out after every batch read
+  chars_.clear();
+  strings_.clear();
+  size_t levels = 0;
+  while (levels < rows && reader->HasNext()) {
+    int64_t vread = 0;
+    levels += reader->ReadBatch(rows - levels, defs_.data() + levels, nullptr, bytes_.data(), &vread);
+    for (int64_t i = 0; i < vread; ++i) {
+      const auto& ba = bytes_[i];
+      strings_.emplace_back(chars_.size(), ba.len);
+      chars_.insert(chars_.end(), ba.ptr, ba.ptr + ba.len);
+    }
+  }
+
+  N_ENSURE_EQ(levels, rows, "column chunk should have the same rows");
+  const auto valid = strings_.size();
+  for (size_t i = 0; i < valid; ++i) {
+    values[i] = std::string_view(chars_.data() + strings_[i].first, strings_[i].second);
+  }
+
+  return scatterNulls(defs_, reader->descr()->max_definition_level(), rows, valid, values, validity_);
+}
+
+size_t ParquetReader::nextChunk(size_t max, const ChunkVisitor& visitor) {
+  if (!hasNext()) {
+    return 0;
+  }
+
+  if (UNLIKELY(groupReader_ == nullptr) || cursorInGroup_ == groupRows_) {
+    nextGroup();
+  }
+
+  // chunk doesn't cross row groups
+  const auto rows = std::min(max, groupRows_ - cursorInGroup_);
+
+#define CHUNK_FROM_PARQUET(T, K, R)                                        \
+  case Kind::K: {                                                          \
+    values_.resize(rows * sizeof(T));                                      \
+    auto values = reinterpret_cast<T*>(values_.data());                    \
+    auto validity = scatter<parquet::R>(info, rows, values);               \
+    visitor(name, info.kind, values, validity, rows);                      \
+    break;                                                                 \
+  }
+
+  for (auto itr = this->columns_.begin(), end = this->columns_.end(); itr != end; ++itr) {
+    const auto& name = itr->first;
+    const auto& info = itr->second;
+
+    switch (info.kind) {
+      CHUNK_FROM_PARQUET(bool, BOOLEAN, BoolReader)
+      CHUNK_FROM_PARQUET(int32_t, INTEGER, Int32Reader)
+      CHUNK_FROM_PARQUET(int64_t, BIGINT, Int64Reader)
+      CHUNK_FROM_PARQUET(float, REAL, FloatReader)
+      CHUNK_FROM_PARQUET(double, DOUBLE, DoubleReader)
+    case Kind::SMALLINT: {
+      // read through int32 reader and narrow into short values in place
+      values_.resize(rows * sizeof(int32_t));
+      auto values = reinterpret_cast<int32_t*>(values_.data());
+      auto validity = scatter<parquet::Int32Reader>(info, rows, values);
+      auto shorts = reinterpret_cast<int16_t*>(values_.data());
+      for (size_t i = 0; i < rows; ++i) {
+        shorts[i] = (int16_t)values[i];
+      }
+
+      visitor(name, info.kind, shorts, validity, rows);
+      break;
+    }
+    case Kind::VARCHAR: {
+      values_.resize(rows * sizeof(std::string_view));
+      auto values = reinterpret_cast<std::string_view*>(values_.data());
+      auto validity = scatter(info, rows, values);
+      visitor(name, info.kind, values, validity, rows);
+      break;
+    }
+    default:
+      throw NException("Type not supported yet");
+    }
+  }
+
+#undef CHUNK_FROM_PARQUET
+
+  cursorInGroup_ += rows;
+  index_ += rows;
+  return rows;
+}
+
 } // namespace storage
 } // namespace nebula
\ No newline at end of file
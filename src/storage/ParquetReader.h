@@ -19,6 +19,7 @@
 #include <folly/Conv.h>
 #include <folly/String.h>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <parquet/api/reader.h>
 #include <string>
@@ -166,6 +167,26 @@ public:
     throw NException("Parquet Reader does not support random access by row number");
   }
 
+  // column chunk visitor: name, kind, values laid out as c++ type of the kind with nulls taking a slot,
+  // validity bitmap in LSB bit order (nullptr if no null in the chunk) and number of values.
+  // values are valid only during the visit.
+  using ChunkVisitor = std::function<void(const std::string&, nebula::type::Kind, const void*, const uint8_t*, size_t)>;
+
+  // read up to given rows column by column within current row group, return number of rows read.
+  // NOTE: do not mix chunk reading with row reading (next) on the same reader.
+  size_t nextChunk(size_t, const ChunkVisitor&);
+
+private:
+  // move to next row group and reset column readers
+  void nextGroup();
+
+  // read given number of values of a column and scatter them into slots by definition levels
+  template <typename R, typename T>
+  const uint8_t* scatter(const ColumnInfo&, size_t, T*);
+
+  // string values of a column chunk
+  const uint8_t* scatter(const ColumnInfo&, size_t, std::string_view*);
+
 private:
   std::unique_ptr<parquet::ParquetFileReader> reader_;
   size_t group_;
@@ -181,6 +202,14 @@ private:
 
   // the row to be visited
   nebula::memory::FlatRow row_;
+
+  // buffers reused by chunk reading
+  std::vector<int16_t> defs_;
+  std::vector<uint8_t> validity_;
+  std::vector<uint8_t> values_;
+  std::vector<parquet::ByteArray> bytes_;
+  std::vector<std::pair<size_t, size_t>> strings_;
+  std::vector<char> chars_;
 }; // namespace storage
 } // namespace storage
 } // namespace nebula
\ No newline at end of file
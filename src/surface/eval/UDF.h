@@ -97,7 +97,8 @@ public:
   //
   // store(input -> store): initialize an input value to store it for first time
   // stack(input -> store): stack more value to existing stored value
-  // merge(store -> store): merge two different stored value
+  // merge(store -> store): merge two different stored value,
+  //                         a string store may be updated in place and returned as merged value.
   // finalize(store -> native): translate stored value into native value it represents
   using StoreFunction = std::function<StoreType(InputType)>;
   using StackFunction = std::function<StoreType(StoreType, InputType)>;
@@ -122,16 +123,17 @@ public:
         [this](EvalContext& ctx, const std::vector<std::unique_ptr<ValueEval>>&, bool& valid) -> decltype(auto) {
           // call the UDF to evalue the result
           auto exprValue = expr_->eval<InputType>(ctx, valid);
-          if constexpr (SK == IK) {
-            return exprValue;
-          } else {
-            // if input type is not the same as store type
-            // hmm, store function should be called, otherwise we only resort to type cast
-            if (store_) {
-              return store_(exprValue);
-            }
 
+          // store function should be called if present, even input type is the same as store type
+          // such as a sketch of strings, otherwise we only resort to type cast
+          if (store_) {
+            return store_(exprValue);
+          }
+
+          if constexpr (std::is_convertible_v<InputType, StoreType>) {
             return static_cast<StoreType>(exprValue);
+          } else {
+            throw NException("store function is required to convert input into store type");
           }
         },
         std::move(stack),
@@ -174,7 +176,11 @@ enum class UDFType {
   AVG,
   COUNT,
   SUM,
-  TDIGEST
+  P50,
+  P90,
+  P99,
+  APPROX_DISTINCT,
+  EXACT_DISTINCT
 };
 
 // UDF traits tells us:
@@ -308,20 +314,54 @@ UDAF_NOT_SUPPORT(AVG, nebula::type::Kind::BOOLEAN)
 UDAF_NOT_SUPPORT(AVG, nebula::type::Kind::VARCHAR)
 UDAF_NOT_SUPPORT(AVG, nebula::type::Kind::INT128)
 
-// add tdigest UDAF traits definition
-// in schema, a digest is serialized as string type
-// while it's store type is a customized serializable struct / object => void*
-STATIC_TRAITS(TDIGEST, true)
-UDAF_TRAITS(TDIGEST, nebula::type::Kind::VARCHAR, nebula::type::Kind::STRUCT, nebula::type::Kind::TINYINT)
-UDAF_TRAITS(TDIGEST, nebula::type::Kind::VARCHAR, nebula::type::Kind::STRUCT, nebula::type::Kind::SMALLINT)
-UDAF_TRAITS(TDIGEST, nebula::type::Kind::VARCHAR, nebula::type::Kind::STRUCT, nebula::type::Kind::INTEGER)
-UDAF_TRAITS(TDIGEST, nebula::type::Kind::VARCHAR, nebula::type::Kind::STRUCT, nebula::type::Kind::BIGINT)
-UDAF_TRAITS(TDIGEST, nebula::type::Kind::VARCHAR, nebula::type::Kind::STRUCT, nebula::type::Kind::REAL)
-UDAF_TRAITS(TDIGEST, nebula::type::Kind::VARCHAR, nebula::type::Kind::STRUCT, nebula::type::Kind::DOUBLE)
-UDAF_NOT_SUPPORT(TDIGEST, nebula::type::Kind::INVALID)
-UDAF_NOT_SUPPORT(TDIGEST, nebula::type::Kind::BOOLEAN)
-UDAF_NOT_SUPPORT(TDIGEST, nebula::type::Kind::VARCHAR)
-UDAF_NOT_SUPPORT(TDIGEST, nebula::type::Kind::INT128)
+// define traits for percentile UDAF backed by t-digest: P50, P90, P99
+// its store is a digest in a fixed size string which is serializable and merged in place
+// the final value is always a DOUBLE
+STATIC_TRAITS(P50, true)
+STATIC_TRAITS(P90, true)
+STATIC_TRAITS(P99, true)
+#define PCT_TYPE(K, NAME) UDAF_TRAITS(NAME, nebula::type::Kind::DOUBLE, nebula::type::Kind::VARCHAR, nebula::type::Kind::K)
+#define PCT_TYPES(NAME)                               \
+  PCT_TYPE(TINYINT, NAME)                             \
+  PCT_TYPE(SMALLINT, NAME)                            \
+  PCT_TYPE(INTEGER, NAME)                             \
+  PCT_TYPE(BIGINT, NAME)                              \
+  PCT_TYPE(REAL, NAME)                                \
+  PCT_TYPE(DOUBLE, NAME)                              \
+  UDAF_NOT_SUPPORT(NAME, nebula::type::Kind::INVALID) \
+  UDAF_NOT_SUPPORT(NAME, nebula::type::Kind::BOOLEAN) \
+  UDAF_NOT_SUPPORT(NAME, nebula::type::Kind::VARCHAR) \
+  UDAF_NOT_SUPPORT(NAME, nebula::type::Kind::INT128)
+
+PCT_TYPES(P50)
+PCT_TYPES(P90)
+PCT_TYPES(P99)
+#undef PCT_TYPES
+#undef PCT_TYPE
+
+// define traits for UDAF: APPROX_DISTINCT
+// a hyper log log sketch estimates distinct values of any input type as a BIGINT
+// its store is sketch registers in a fixed size string, so it can be merged in place
+STATIC_TRAITS(APPROX_DISTINCT, true)
+REPEAT_ALL_TYPES(UDAF_TRAITS_INPUT1, APPROX_DISTINCT, nebula::type::Kind::BIGINT, nebula::type::Kind::VARCHAR)
+
+// define traits for UDAF: EXACT_DISTINCT
+// a roaring bitmap counts distinct values of integer types exactly as a BIGINT
+// its store is the bitmap in portable format plus buffered values in a string
+STATIC_TRAITS(EXACT_DISTINCT, true)
+#define EXACT_DISTINCT_TYPE(K) UDAF_TRAITS(EXACT_DISTINCT, nebula::type::Kind::BIGINT, nebula::type::Kind::VARCHAR, nebula::type::Kind::K)
+EXACT_DISTINCT_TYPE(TINYINT)
+EXACT_DISTINCT_TYPE(SMALLINT)
+EXACT_DISTINCT_TYPE(INTEGER)
+EXACT_DISTINCT_TYPE(BIGINT)
+#undef EXACT_DISTINCT_TYPE
+
+UDAF_NOT_SUPPORT(EXACT_DISTINCT, nebula::type::Kind::INVALID)
+UDAF_NOT_SUPPORT(EXACT_DISTINCT, nebula::type::Kind::BOOLEAN)
+UDAF_NOT_SUPPORT(EXACT_DISTINCT, nebula::type::Kind::REAL)
+UDAF_NOT_SUPPORT(EXACT_DISTINCT, nebula::type::Kind::DOUBLE)
+UDAF_NOT_SUPPORT(EXACT_DISTINCT, nebula::type::Kind::VARCHAR)
+UDAF_NOT_SUPPORT(EXACT_DISTINCT, nebula::type::Kind::INT128)
 
 #undef UDAF_SAME_AS_INPUT_ALL
 #undef UDAF_SAME_AS_INPUT